@@ -0,0 +1,367 @@
+// Сквозные бенчмарки: загрузка APK, диспетчеризация API, рендерер без
+// окна и переходы жизненного цикла активности. APK собираются во
+// временном каталоге (apk_builder.h, dex_builder.h), так что результаты
+// сравнимы между версиями без внешних файлов.
+//
+// Как в Google Benchmark, число итераций растет, пока прогон не займет
+// --benchmark_min_time секунд; время - на итерацию.
+//
+//   ./anexec_bench [--benchmark_filter=<подстрока>] [--benchmark_min_time=<секунды>]
+
+#include "apk_builder.h"
+#include "dex_builder.h"
+#include "../src/android/activity.h"
+#include "../src/android/api.h"
+#include "../src/core/executor.h"
+#include "../src/graphics/renderer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace anexec;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Тело выполняет iterations итераций и возвращает их время в нс (без
+// подготовки); отрицательное значение - ошибка
+using BenchBody = std::function<double(uint64_t iterations)>;
+
+struct Benchmark {
+    std::string name;
+    BenchBody body;
+    uint64_t items_per_iteration;   // Для items/s; 0 - не выводить
+};
+
+struct Options {
+    std::string filter;
+    double min_time{0.5};
+};
+
+double elapsedNs(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// Итерации растут не больше чем в 10 раз за шаг, с запасом до min_time
+bool runBenchmark(const Benchmark& bench, const Options& options) {
+    const double min_ns = options.min_time * 1e9;
+    uint64_t iterations = 1;
+    double ns = 0.0;
+    while (true) {
+        ns = bench.body(iterations);
+        if (ns < 0.0) {
+            std::printf("%-36s %s\n", bench.name.c_str(), "FAILED");
+            return false;
+        }
+        if (ns >= min_ns || iterations >= 1000000000) {
+            break;
+        }
+        const double multiplier = ns > 0.0 ? std::min(10.0, min_ns * 1.4 / ns) : 10.0;
+        iterations = std::max(iterations + 1, static_cast<uint64_t>(iterations * multiplier));
+    }
+
+    std::printf("%-36s %14.0f ns %12llu", bench.name.c_str(), ns / iterations,
+                static_cast<unsigned long long>(iterations));
+    if (bench.items_per_iteration) {
+        std::printf(" %12.3fM items/s", bench.items_per_iteration * iterations / ns * 1e3);
+    }
+    std::printf("\n");
+    return true;
+}
+
+// ---------------------------------------------------------------- loadApk
+
+struct ApkSpec {
+    const char* name;
+    size_t dex_files;
+    size_t classes_per_dex;
+    bool compress_dex;
+    size_t resources;       // Мелкие записи res/, только в центральном каталоге
+};
+
+std::vector<uint8_t> buildAppDex(size_t first_class, size_t classes) {
+    bench::DexBuilder dex;
+    for (size_t i = first_class; i < first_class + classes; ++i) {
+        const std::string descriptor = "Lbench/app/C" + std::to_string(i) + ";";
+        const size_t klass = dex.defineClass(descriptor, "Ljava/lang/Object;");
+        const uint32_t run = dex.method(descriptor, "run", "V", {});
+        dex.addMethod(klass, run, 0x0009, {1, 0, 0, {0x000e}}, false);  // return-void
+    }
+    return dex.build();
+}
+
+bool writeApk(const ApkSpec& spec, const std::string& path) {
+    bench::ZipBuilder zip;
+    bool ok = zip.add("AndroidManifest.xml",
+                      bench::ManifestBuilder::application(
+                          "bench.app", ".MainActivity",
+                          {"android.permission.INTERNET", "android.permission.CAMERA"}),
+                      true);
+    for (size_t i = 0; ok && i < spec.dex_files; ++i) {
+        const std::string name = i == 0 ? "classes.dex" : "classes" + std::to_string(i + 1) + ".dex";
+        ok = zip.add(name, buildAppDex(i * spec.classes_per_dex, spec.classes_per_dex), spec.compress_dex);
+    }
+    const std::vector<uint8_t> resource(256, 0x5a);
+    for (size_t i = 0; ok && i < spec.resources; ++i) {
+        ok = zip.add("res/raw/r" + std::to_string(i), resource, false);
+    }
+    return ok && zip.write(path);
+}
+
+// Без общего реестра образов и кэша распаковки: каждая итерация - холодная загрузка
+BenchBody loadApkBody(std::string path, bool share_images) {
+    return [path = std::move(path), share_images](uint64_t iterations) {
+        ExecutorConfig config;
+        config.enable_graphics = false;
+        config.enable_extraction_cache = false;
+        config.share_images = share_images;
+
+        double ns = 0.0;
+        for (uint64_t i = 0; i < iterations; ++i) {
+            Executor executor(config);
+            const auto start = Clock::now();
+            const Result result = executor.loadApk(path);
+            ns += elapsedNs(start);
+            if (result != Result::Success) {
+                std::fprintf(stderr, "loadApk(%s): %s\n", path.c_str(), executor.getLastError().c_str());
+                return -1.0;
+            }
+        }
+        return ns;
+    };
+}
+
+// ---------------------------------------------------------- handleRequest
+
+void echoHandler(const APIRequest& request) {
+    request.callback(APIResponse{true, std::string(), std::string()});
+}
+
+// Каждый поток делает iterations вызовов; время - от общего старта до
+// завершения последнего потока, то есть на вызов в одном потоке
+BenchBody handleRequestBody(API& api, size_t threads, bool by_name) {
+    return [&api, threads, by_name](uint64_t iterations) {
+        APIRequest request;
+        request.method = "bench.echo";
+        request.method_id = by_name ? INVALID_API_METHOD : api.resolveMethod("bench.echo");
+        request.params.set("key", "value");
+        request.callback = [](APIResponse) {};
+
+        std::atomic<size_t> ready{0};
+        std::atomic<bool> go{false};
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < threads; ++t) {
+            workers.emplace_back([&]() {
+                ++ready;
+                while (!go.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+                for (uint64_t i = 0; i < iterations; ++i) {
+                    api.handleRequest(request);
+                }
+            });
+        }
+        while (ready.load() + 1 < threads) {
+            std::this_thread::yield();
+        }
+
+        const auto start = Clock::now();
+        go.store(true, std::memory_order_release);
+        for (uint64_t i = 0; i < iterations; ++i) {
+            api.handleRequest(request);
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        return elapsedNs(start);
+    };
+}
+
+// --------------------------------------------------------------- Renderer
+
+// Итерация - N команд по одной через submitCommand и кадр, который их
+// рисует. Первый прямоугольник сдвигается каждую итерацию, чтобы кадр не
+// пропускался как неизмененный.
+BenchBody renderBody(Renderer& renderer, size_t commands) {
+    return [&renderer, commands](uint64_t iterations) {
+        std::vector<RenderCommand> frame(commands);
+        for (size_t i = 0; i < commands; ++i) {
+            frame[i].type = i == 0 ? RenderCommand::Type::Clear : RenderCommand::Type::DrawRect;
+            frame[i].x = static_cast<float>((i * 37) % 1000);
+            frame[i].y = static_cast<float>((i * 53) % 1800);
+            frame[i].width = 16.0f + static_cast<float>(i % 64);
+            frame[i].height = 16.0f + static_cast<float>(i % 32);
+        }
+
+        const auto start = Clock::now();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            if (commands > 1) {
+                frame[1].x = static_cast<float>(i % 2) * 8.0f;
+            }
+            for (const RenderCommand& command : frame) {
+                renderer.submitCommand(command);
+            }
+            if (!renderer.waitForIdle(std::chrono::seconds(10))) {
+                std::fprintf(stderr, "renderer did not finish a frame in 10 s\n");
+                return -1.0;
+            }
+        }
+        return elapsedNs(start);
+    };
+}
+
+// -------------------------------------------------------------- Lifecycle
+
+// Создание активности и полный путь до onDestroy: 6 переходов
+double lifecycleCreateDestroy(uint64_t iterations) {
+    const auto start = Clock::now();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        Activity activity;
+        activity.onCreate();
+        activity.onStart();
+        activity.onResume();
+        activity.onPause();
+        activity.onStop();
+        activity.onDestroy();
+    }
+    return elapsedNs(start);
+}
+
+// Уход в фон и возврат: onStart, onResume, onPause, onStop
+double lifecycleCycle(uint64_t iterations) {
+    Activity activity;
+    activity.onCreate();
+    const auto start = Clock::now();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        activity.onStart();
+        activity.onResume();
+        activity.onPause();
+        activity.onStop();
+    }
+    const double ns = elapsedNs(start);
+    activity.onDestroy();
+    return ns;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--benchmark_filter=", 19) == 0) {
+            options.filter = argv[i] + 19;
+        } else if (std::strncmp(argv[i], "--benchmark_min_time=", 21) == 0) {
+            options.min_time = std::strtod(argv[i] + 21, nullptr);
+        } else {
+            std::fprintf(stderr, "usage: %s [--benchmark_filter=<substring>] [--benchmark_min_time=<seconds>]\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+    auto selected = [&options](const std::string& name) {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    };
+
+    std::vector<Benchmark> benchmarks;
+
+    // APK собираются, только если выбраны их бенчмарки
+    std::error_code ec;
+    const std::filesystem::path dir = std::filesystem::temp_directory_path(ec) /
+                                      ("anexec_bench_" + std::to_string(::getpid()));
+    const ApkSpec apks[] = {
+        {"small", 1, 64, false, 16},
+        {"large", 1, 20000, true, 4000},
+        {"multidex", 4, 5000, true, 1000},
+    };
+    for (const ApkSpec& spec : apks) {
+        const std::string name = std::string("loadApk/") + spec.name;
+        const bool shared = spec.dex_files == 1 && spec.compress_dex;
+        if (!selected(name) && !(shared && selected(name + "/shared"))) {
+            continue;
+        }
+        const std::string path = (dir / (std::string(spec.name) + ".apk")).string();
+        std::filesystem::create_directories(dir, ec);
+        if (!writeApk(spec, path)) {
+            std::fprintf(stderr, "failed to write %s\n", path.c_str());
+            return 1;
+        }
+        benchmarks.push_back({name, loadApkBody(path, false), 0});
+        // Повторная загрузка того же APK: образ из ImageRegistry
+        if (shared) {
+            benchmarks.push_back({name + "/shared", loadApkBody(path, true), 0});
+        }
+    }
+
+    API api;
+    APIConfig api_config;
+    api_config.package_name = "bench.app";
+    api_config.version_name = "1.0";
+    api_config.version_code = 1;
+    api_config.min_sdk_level = APILevel::ANDROID_10;
+    api_config.target_sdk_level = APILevel::ANDROID_14;
+    api_config.max_calls_per_second = 0;
+    api.initialize(api_config);
+    api.registerHandler("bench.echo", echoHandler);
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    // 1, 2, 4, ... и все ядра
+    std::vector<size_t> thread_counts;
+    for (size_t threads = 1; threads < cores; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(cores);
+    for (size_t threads : thread_counts) {
+        benchmarks.push_back({"handleRequest/threads:" + std::to_string(threads),
+                              handleRequestBody(api, threads, false), threads});
+    }
+    benchmarks.push_back({"handleRequest/by_name", handleRequestBody(api, 1, true), 1});
+
+    // Без окна: контекст без поверхности, без vsync, чтобы мерить работу, а не темп
+    Renderer renderer;
+    std::string renderer_error;
+    if (selected("renderFrame/")) {
+        RenderConfig render_config;
+        render_config.surface_type = SurfaceType::Surfaceless;
+        render_config.vsync_enabled = false;
+        render_config.msaa_samples = 0;
+        try {
+            renderer.initialize(render_config);
+            renderer.onSurfaceCreated();
+            renderer.onSurfaceChanged(render_config.design_width, render_config.design_height);
+        } catch (const std::exception& e) {
+            renderer_error = e.what();
+        }
+    }
+    for (size_t commands : {1000, 10000, 100000}) {
+        const std::string name = "renderFrame/" + std::to_string(commands);
+        if (renderer_error.empty()) {
+            benchmarks.push_back({name, renderBody(renderer, commands), commands});
+        } else if (selected(name)) {
+            std::printf("%-36s skipped: %s\n", name.c_str(), renderer_error.c_str());
+        }
+    }
+
+    benchmarks.push_back({"lifecycle/create_destroy", lifecycleCreateDestroy, 6});
+    benchmarks.push_back({"lifecycle/background_cycle", lifecycleCycle, 4});
+
+    std::printf("%-36s %17s %12s %20s\n", "benchmark", "time", "iterations", "");
+    int failures = 0;
+    for (const Benchmark& bench : benchmarks) {
+        if (selected(bench.name) && !runBenchmark(bench, options)) {
+            ++failures;
+        }
+    }
+
+    std::filesystem::remove_all(dir, ec);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,272 @@
+#ifndef ANEXEC_BENCH_APK_BUILDER_H
+#define ANEXEC_BENCH_APK_BUILDER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+namespace anexec {
+namespace bench {
+
+inline void append16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+inline void append32(std::vector<uint8_t>& out, uint32_t value) {
+    append16(out, static_cast<uint16_t>(value));
+    append16(out, static_cast<uint16_t>(value >> 16));
+}
+
+inline void put32(std::vector<uint8_t>& out, size_t offset, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[offset + i] = static_cast<uint8_t>(value >> (i * 8));
+    }
+}
+
+// Бинарный AndroidManifest.xml: пул строк UTF-8 и элементы, без карты
+// ресурсов (ManifestParser находит атрибуты android:* по именам)
+class ManifestBuilder {
+public:
+    struct Attribute {
+        std::string name;
+        std::string value;
+        bool is_int;
+    };
+
+    void start(const std::string& tag, const std::vector<Attribute>& attributes) {
+        const uint32_t android = string(ANDROID_NS);
+        const uint32_t size = 16 + 20 + 20 * static_cast<uint32_t>(attributes.size());
+        append16(body, 0x0102);
+        append16(body, 16);
+        append32(body, size);
+        append32(body, 1);              // Строка
+        append32(body, NO_INDEX);       // Комментарий
+        append32(body, NO_INDEX);       // Пространство имен
+        append32(body, string(tag));
+        append16(body, 20);             // Начало атрибутов
+        append16(body, 20);             // Размер атрибута
+        append16(body, static_cast<uint16_t>(attributes.size()));
+        append16(body, 0);
+        append16(body, 0);
+        append16(body, 0);
+        for (const auto& attribute : attributes) {
+            // package - без пространства имен, остальные - android:*
+            append32(body, attribute.name == "package" ? NO_INDEX : android);
+            append32(body, string(attribute.name));
+            const uint32_t value = attribute.is_int
+                ? static_cast<uint32_t>(std::stoul(attribute.value)) : string(attribute.value);
+            append32(body, attribute.is_int ? NO_INDEX : value);
+            append16(body, 8);
+            body.push_back(0);
+            body.push_back(attribute.is_int ? 0x10 : 0x03);
+            append32(body, value);
+        }
+    }
+
+    void end(const std::string& tag) {
+        append16(body, 0x0103);
+        append16(body, 16);
+        append32(body, 24);
+        append32(body, 1);
+        append32(body, NO_INDEX);
+        append32(body, NO_INDEX);
+        append32(body, string(tag));
+    }
+
+    std::vector<uint8_t> build() const {
+        std::vector<uint8_t> pool;
+        append16(pool, 0x0001);
+        append16(pool, 28);
+        append32(pool, 0);              // Размер, ниже
+        append32(pool, static_cast<uint32_t>(strings.size()));
+        append32(pool, 0);              // Стили
+        append32(pool, 1 << 8);         // UTF-8
+        append32(pool, 28 + static_cast<uint32_t>(strings.size()) * 4);
+        append32(pool, 0);
+        pool.resize(pool.size() + strings.size() * 4);
+        const size_t strings_start = pool.size();
+        for (size_t i = 0; i < strings.size(); ++i) {
+            put32(pool, 28 + i * 4, static_cast<uint32_t>(pool.size() - strings_start));
+            appendLength(pool, strings[i].size());   // В UTF-16, для ASCII то же
+            appendLength(pool, strings[i].size());
+            pool.insert(pool.end(), strings[i].begin(), strings[i].end());
+            pool.push_back(0);
+        }
+        while (pool.size() % 4) {
+            pool.push_back(0);
+        }
+        put32(pool, 4, static_cast<uint32_t>(pool.size()));
+
+        std::vector<uint8_t> out;
+        append16(out, 0x0003);
+        append16(out, 8);
+        append32(out, static_cast<uint32_t>(8 + pool.size() + body.size()));
+        out.insert(out.end(), pool.begin(), pool.end());
+        out.insert(out.end(), body.begin(), body.end());
+        return out;
+    }
+
+    // Манифест с главной активностью (MAIN/LAUNCHER) и разрешениями
+    static std::vector<uint8_t> application(const std::string& package, const std::string& activity,
+                                            const std::vector<std::string>& permissions) {
+        ManifestBuilder xml;
+        xml.start("manifest", {{"package", package, false}, {"versionCode", "1", true},
+                               {"versionName", "1.0", false}});
+        xml.start("uses-sdk", {{"minSdkVersion", "29", true}, {"targetSdkVersion", "34", true}});
+        xml.end("uses-sdk");
+        for (const auto& permission : permissions) {
+            xml.start("uses-permission", {{"name", permission, false}});
+            xml.end("uses-permission");
+        }
+        xml.start("application", {});
+        xml.start("activity", {{"name", activity, false}});
+        xml.start("intent-filter", {});
+        xml.start("action", {{"name", "android.intent.action.MAIN", false}});
+        xml.end("action");
+        xml.start("category", {{"name", "android.intent.category.LAUNCHER", false}});
+        xml.end("category");
+        xml.end("intent-filter");
+        xml.end("activity");
+        xml.end("application");
+        xml.end("manifest");
+        return xml.build();
+    }
+
+private:
+    static constexpr uint32_t NO_INDEX = 0xFFFFFFFF;
+    static constexpr char ANDROID_NS[] = "http://schemas.android.com/apk/res/android";
+
+    uint32_t string(const std::string& value) {
+        auto it = string_index.find(value);
+        if (it != string_index.end()) {
+            return it->second;
+        }
+        strings.push_back(value);
+        return string_index[value] = static_cast<uint32_t>(strings.size() - 1);
+    }
+
+    static void appendLength(std::vector<uint8_t>& out, size_t length) {
+        if (length >= 0x80) {
+            out.push_back(static_cast<uint8_t>(0x80 | (length >> 8)));
+        }
+        out.push_back(static_cast<uint8_t>(length));
+    }
+
+    std::vector<std::string> strings;
+    std::map<std::string, uint32_t> string_index;
+    std::vector<uint8_t> body;
+};
+
+// ZIP без подписи и выравнивания: записи STORED или DEFLATE
+class ZipBuilder {
+public:
+    bool add(const std::string& name, const std::vector<uint8_t>& data, bool compress) {
+        Entry entry;
+        entry.name = name;
+        entry.size = static_cast<uint32_t>(data.size());
+        entry.crc = static_cast<uint32_t>(crc32(0, data.data(), static_cast<uInt>(data.size())));
+        entry.method = compress ? 8 : 0;
+        entry.offset = static_cast<uint32_t>(out.size());
+
+        std::vector<uint8_t> packed;
+        if (compress) {
+            if (!deflateRaw(data, packed)) {
+                return false;
+            }
+        }
+        const std::vector<uint8_t>& stored = compress ? packed : data;
+        entry.compressed_size = static_cast<uint32_t>(stored.size());
+
+        append32(out, 0x04034b50);
+        appendCommon(out, entry);
+        append16(out, 0);               // Дополнительное поле
+        out.insert(out.end(), name.begin(), name.end());
+        out.insert(out.end(), stored.begin(), stored.end());
+        entries.push_back(entry);
+        return true;
+    }
+
+    bool write(const std::string& path) const {
+        std::vector<uint8_t> archive = out;
+        const uint32_t directory = static_cast<uint32_t>(archive.size());
+        for (const Entry& entry : entries) {
+            append32(archive, 0x02014b50);
+            append16(archive, 20);      // Версия создателя
+            appendCommon(archive, entry);
+            append16(archive, 0);       // Дополнительное поле
+            append16(archive, 0);       // Комментарий
+            append16(archive, 0);       // Диск
+            append16(archive, 0);
+            append32(archive, 0);
+            append32(archive, entry.offset);
+            archive.insert(archive.end(), entry.name.begin(), entry.name.end());
+        }
+        const uint32_t directory_size = static_cast<uint32_t>(archive.size()) - directory;
+        append32(archive, 0x06054b50);
+        append16(archive, 0);
+        append16(archive, 0);
+        append16(archive, static_cast<uint16_t>(entries.size()));
+        append16(archive, static_cast<uint16_t>(entries.size()));
+        append32(archive, directory_size);
+        append32(archive, directory);
+        append16(archive, 0);
+
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+        const bool ok = std::fwrite(archive.data(), 1, archive.size(), file) == archive.size();
+        return std::fclose(file) == 0 && ok;
+    }
+
+private:
+    struct Entry {
+        std::string name;
+        uint16_t method;
+        uint32_t crc;
+        uint32_t compressed_size;
+        uint32_t size;
+        uint32_t offset;
+    };
+
+    // Поля, общие для локального заголовка и записи каталога
+    static void appendCommon(std::vector<uint8_t>& out, const Entry& entry) {
+        append16(out, 20);              // Нужная версия
+        append16(out, 0);               // Флаги
+        append16(out, entry.method);
+        append16(out, 0);               // Время
+        append16(out, 0x21);            // 1980-01-01
+        append32(out, entry.crc);
+        append32(out, entry.compressed_size);
+        append32(out, entry.size);
+        append16(out, static_cast<uint16_t>(entry.name.size()));
+    }
+
+    static bool deflateRaw(const std::vector<uint8_t>& data, std::vector<uint8_t>& packed) {
+        z_stream stream{};
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        packed.resize(deflateBound(&stream, static_cast<uLong>(data.size())));
+        stream.next_in = const_cast<Bytef*>(data.data());
+        stream.avail_in = static_cast<uInt>(data.size());
+        stream.next_out = packed.data();
+        stream.avail_out = static_cast<uInt>(packed.size());
+        const bool ok = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+        packed.resize(stream.total_out);
+        deflateEnd(&stream);
+        return ok;
+    }
+
+    std::vector<uint8_t> out;
+    std::vector<Entry> entries;
+};
+
+} // namespace bench
+} // namespace anexec
+
+#endif // ANEXEC_BENCH_APK_BUILDER_H
@@ -0,0 +1,295 @@
+#ifndef ANEXEC_BENCH_DEX_BUILDER_H
+#define ANEXEC_BENCH_DEX_BUILDER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace anexec {
+namespace bench {
+
+// Сборка минимального DEX в памяти для бенчмарков: только таблицы,
+// которые читают DexView и ClassLinker (без map_list и контрольных сумм)
+class DexBuilder {
+public:
+    struct Code {
+        uint16_t registers;
+        uint16_t ins;
+        uint16_t outs;
+        std::vector<uint16_t> insns;
+    };
+
+    uint32_t string(const std::string& value) {
+        auto it = string_index.find(value);
+        if (it != string_index.end()) {
+            return it->second;
+        }
+        strings.push_back(value);
+        return string_index[value] = static_cast<uint32_t>(strings.size() - 1);
+    }
+
+    uint32_t type(const std::string& descriptor) {
+        const uint32_t idx = string(descriptor);
+        auto it = std::find(types.begin(), types.end(), idx);
+        if (it != types.end()) {
+            return static_cast<uint32_t>(it - types.begin());
+        }
+        types.push_back(idx);
+        return static_cast<uint32_t>(types.size() - 1);
+    }
+
+    uint32_t proto(const std::string& return_type, const std::vector<std::string>& params) {
+        std::string shorty(1, shortyChar(return_type));
+        std::vector<uint16_t> param_types;
+        for (const auto& param : params) {
+            shorty += shortyChar(param);
+            param_types.push_back(static_cast<uint16_t>(type(param)));
+        }
+        Proto entry{string(shorty), type(return_type), param_types};
+        for (size_t i = 0; i < protos.size(); ++i) {
+            if (protos[i].shorty == entry.shorty && protos[i].return_type == entry.return_type &&
+                protos[i].params == entry.params) {
+                return static_cast<uint32_t>(i);
+            }
+        }
+        protos.push_back(entry);
+        return static_cast<uint32_t>(protos.size() - 1);
+    }
+
+    uint32_t field(const std::string& owner, const std::string& field_type, const std::string& name) {
+        fields.push_back({static_cast<uint16_t>(type(owner)), static_cast<uint16_t>(type(field_type)), string(name)});
+        return static_cast<uint32_t>(fields.size() - 1);
+    }
+
+    uint32_t method(const std::string& owner, const std::string& name,
+                    const std::string& return_type, const std::vector<std::string>& params) {
+        methods.push_back({static_cast<uint16_t>(type(owner)),
+                           static_cast<uint16_t>(proto(return_type, params)), string(name)});
+        return static_cast<uint32_t>(methods.size() - 1);
+    }
+
+    // Класс; поля и методы добавляются по индексу из field()/method()
+    size_t defineClass(const std::string& descriptor, const std::string& super) {
+        ClassSpec spec;
+        spec.type = type(descriptor);
+        spec.super = super.empty() ? 0xFFFFFFFF : type(super);
+        classes.push_back(spec);
+        return classes.size() - 1;
+    }
+
+    void addStaticField(size_t klass, uint32_t field_idx) {
+        classes[klass].static_fields.push_back(field_idx);
+    }
+
+    void addInstanceField(size_t klass, uint32_t field_idx) {
+        classes[klass].instance_fields.push_back(field_idx);
+    }
+
+    void addMethod(size_t klass, uint32_t method_idx, uint32_t access_flags, Code code, bool is_virtual) {
+        auto& list = is_virtual ? classes[klass].virtual_methods : classes[klass].direct_methods;
+        list.push_back({method_idx, access_flags, std::move(code)});
+    }
+
+    std::vector<uint8_t> build() const {
+        constexpr uint32_t HEADER_SIZE = 0x70;
+        const uint32_t string_ids_off = HEADER_SIZE;
+        const uint32_t type_ids_off = string_ids_off + static_cast<uint32_t>(strings.size()) * 4;
+        const uint32_t proto_ids_off = type_ids_off + static_cast<uint32_t>(types.size()) * 4;
+        const uint32_t field_ids_off = proto_ids_off + static_cast<uint32_t>(protos.size()) * 12;
+        const uint32_t method_ids_off = field_ids_off + static_cast<uint32_t>(fields.size()) * 8;
+        const uint32_t class_defs_off = method_ids_off + static_cast<uint32_t>(methods.size()) * 8;
+        const uint32_t data_off = class_defs_off + static_cast<uint32_t>(classes.size()) * 32;
+
+        std::vector<uint8_t> out(data_off, 0);
+        std::memcpy(out.data(), "dex\n035\0", 8);
+        put32(out, 40, 0x12345678);
+        put32(out, 56, static_cast<uint32_t>(strings.size()));
+        put32(out, 60, string_ids_off);
+        put32(out, 64, static_cast<uint32_t>(types.size()));
+        put32(out, 68, type_ids_off);
+        put32(out, 72, static_cast<uint32_t>(protos.size()));
+        put32(out, 76, proto_ids_off);
+        put32(out, 80, static_cast<uint32_t>(fields.size()));
+        put32(out, 84, field_ids_off);
+        put32(out, 88, static_cast<uint32_t>(methods.size()));
+        put32(out, 92, method_ids_off);
+        put32(out, 96, static_cast<uint32_t>(classes.size()));
+        put32(out, 100, class_defs_off);
+
+        for (size_t i = 0; i < strings.size(); ++i) {
+            put32(out, string_ids_off + i * 4, static_cast<uint32_t>(out.size()));
+            putUleb(out, static_cast<uint32_t>(strings[i].size()));
+            out.insert(out.end(), strings[i].begin(), strings[i].end());
+            out.push_back(0);
+        }
+        for (size_t i = 0; i < types.size(); ++i) {
+            put32(out, type_ids_off + i * 4, types[i]);
+        }
+        for (size_t i = 0; i < protos.size(); ++i) {
+            const size_t entry = proto_ids_off + i * 12;
+            put32(out, entry, protos[i].shorty);
+            put32(out, entry + 4, protos[i].return_type);
+            if (!protos[i].params.empty()) {
+                align(out, 4);
+                put32(out, entry + 8, static_cast<uint32_t>(out.size()));
+                append32(out, static_cast<uint32_t>(protos[i].params.size()));
+                for (uint16_t param : protos[i].params) {
+                    append16(out, param);
+                }
+            }
+        }
+        for (size_t i = 0; i < fields.size(); ++i) {
+            put16(out, field_ids_off + i * 8, fields[i].class_idx);
+            put16(out, field_ids_off + i * 8 + 2, fields[i].type_idx);
+            put32(out, field_ids_off + i * 8 + 4, fields[i].name_idx);
+        }
+        for (size_t i = 0; i < methods.size(); ++i) {
+            put16(out, method_ids_off + i * 8, methods[i].class_idx);
+            put16(out, method_ids_off + i * 8 + 2, methods[i].type_idx);
+            put32(out, method_ids_off + i * 8 + 4, methods[i].name_idx);
+        }
+
+        for (size_t i = 0; i < classes.size(); ++i) {
+            const ClassSpec& spec = classes[i];
+            const size_t def = class_defs_off + i * 32;
+            put32(out, def, spec.type);
+            put32(out, def + 4, 0x0001);    // public
+            put32(out, def + 8, spec.super);
+            put32(out, def + 16, 0xFFFFFFFF);
+
+            // Код методов до class_data: нужны смещения code_item
+            std::vector<std::pair<const MethodSpec*, uint32_t>> code_offsets;
+            for (const auto* list : {&spec.direct_methods, &spec.virtual_methods}) {
+                for (const MethodSpec& method : *list) {
+                    align(out, 4);
+                    code_offsets.emplace_back(&method, static_cast<uint32_t>(out.size()));
+                    append16(out, method.code.registers);
+                    append16(out, method.code.ins);
+                    append16(out, method.code.outs);
+                    append16(out, 0);   // tries_size
+                    append32(out, 0);   // debug_info_off
+                    append32(out, static_cast<uint32_t>(method.code.insns.size()));
+                    for (uint16_t unit : method.code.insns) {
+                        append16(out, unit);
+                    }
+                }
+            }
+
+            put32(out, def + 24, static_cast<uint32_t>(out.size()));
+            putUleb(out, static_cast<uint32_t>(spec.static_fields.size()));
+            putUleb(out, static_cast<uint32_t>(spec.instance_fields.size()));
+            putUleb(out, static_cast<uint32_t>(spec.direct_methods.size()));
+            putUleb(out, static_cast<uint32_t>(spec.virtual_methods.size()));
+            for (const auto* list : {&spec.static_fields, &spec.instance_fields}) {
+                std::vector<uint32_t> sorted = *list;
+                std::sort(sorted.begin(), sorted.end());
+                uint32_t previous = 0;
+                for (uint32_t idx : sorted) {
+                    putUleb(out, idx - previous);
+                    putUleb(out, 0x0001);
+                    previous = idx;
+                }
+            }
+            for (const auto* list : {&spec.direct_methods, &spec.virtual_methods}) {
+                std::vector<const MethodSpec*> sorted;
+                for (const MethodSpec& method : *list) {
+                    sorted.push_back(&method);
+                }
+                std::sort(sorted.begin(), sorted.end(), [](const MethodSpec* a, const MethodSpec* b) {
+                    return a->method_idx < b->method_idx;
+                });
+                uint32_t previous = 0;
+                for (const MethodSpec* method : sorted) {
+                    putUleb(out, method->method_idx - previous);
+                    putUleb(out, method->access_flags);
+                    for (const auto& entry : code_offsets) {
+                        if (entry.first == method) {
+                            putUleb(out, entry.second);
+                        }
+                    }
+                    previous = method->method_idx;
+                }
+            }
+        }
+
+        put32(out, 32, static_cast<uint32_t>(out.size()));   // file_size
+        put32(out, 36, HEADER_SIZE);
+        return out;
+    }
+
+private:
+    struct Proto {
+        uint32_t shorty;
+        uint32_t return_type;
+        std::vector<uint16_t> params;
+    };
+
+    struct MemberId {
+        uint16_t class_idx;
+        uint16_t type_idx;      // Для методов - proto_idx
+        uint32_t name_idx;
+    };
+
+    struct MethodSpec {
+        uint32_t method_idx;
+        uint32_t access_flags;
+        Code code;
+    };
+
+    struct ClassSpec {
+        uint32_t type;
+        uint32_t super;
+        std::vector<uint32_t> static_fields;
+        std::vector<uint32_t> instance_fields;
+        std::vector<MethodSpec> direct_methods;
+        std::vector<MethodSpec> virtual_methods;
+    };
+
+    static char shortyChar(const std::string& descriptor) {
+        return descriptor[0] == '[' ? 'L' : descriptor[0];
+    }
+
+    static void put16(std::vector<uint8_t>& out, size_t offset, uint16_t value) {
+        std::memcpy(out.data() + offset, &value, 2);
+    }
+    static void put32(std::vector<uint8_t>& out, size_t offset, uint32_t value) {
+        std::memcpy(out.data() + offset, &value, 4);
+    }
+    static void append16(std::vector<uint8_t>& out, uint16_t value) {
+        out.push_back(static_cast<uint8_t>(value));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+    }
+    static void append32(std::vector<uint8_t>& out, uint32_t value) {
+        append16(out, static_cast<uint16_t>(value));
+        append16(out, static_cast<uint16_t>(value >> 16));
+    }
+    static void putUleb(std::vector<uint8_t>& out, uint32_t value) {
+        do {
+            uint8_t byte = value & 0x7f;
+            value >>= 7;
+            out.push_back(value ? byte | 0x80 : byte);
+        } while (value);
+    }
+    static void align(std::vector<uint8_t>& out, size_t alignment) {
+        while (out.size() % alignment) {
+            out.push_back(0);
+        }
+    }
+
+    std::vector<std::string> strings;
+    std::map<std::string, uint32_t> string_index;
+    std::vector<uint32_t> types;    // Индексы строк
+    std::vector<Proto> protos;
+    std::vector<MemberId> fields;
+    std::vector<MemberId> methods;
+    std::vector<ClassSpec> classes;
+};
+
+} // namespace bench
+} // namespace anexec
+
+#endif // ANEXEC_BENCH_DEX_BUILDER_H
@@ -0,0 +1,163 @@
+// Нагрузочный прогон сборщика: длинные связные списки сменяют друг друга,
+// между узлами - короткоживущий мусор. Узлы доживают до старого
+// поколения, брошенные списки убирает параллельная разметка и
+// подметание, а когда они не успевают - полная сборка. В конце все
+// живые списки проверяются по содержимому. Молодые сборки и циклы
+// старого поколения должны случиться, а полные сборки - оставаться
+// исключением: не чаще, чем на каждый MIN_CYCLES_PER_FULL-й цикл.
+//
+//   ./anexec_bench_heap [узлов в списке] [размер кучи, МБ]
+
+#include "../src/core/class_linker.h"
+#include "../src/core/heap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace anexec;
+
+namespace {
+
+constexpr size_t ROUNDS = 12;
+constexpr size_t LIVE_LISTS = 1;        // Сколько последних списков держат корни
+constexpr size_t GARBAGE_EVERY = 4;     // Мусорный массив на каждые N узлов
+constexpr uint64_t MIN_CYCLES_PER_FULL = 4;
+
+// Узел: [заголовок][next][value]
+struct NodeFields {
+    ObjectRef next;
+    uint32_t value;
+};
+
+NodeFields* fields(Heap& heap, ObjectRef node) {
+    return reinterpret_cast<NodeFields*>(heap.object(node) + 1);
+}
+
+// Номер значения узла: список round, позиция i от хвоста
+uint32_t nodeValue(size_t round, size_t i) {
+    return static_cast<uint32_t>(round * 0x9e3779b1u + i);
+}
+
+bool checkList(Heap& heap, ObjectRef head, size_t round, size_t nodes) {
+    size_t count = 0;
+    for (ObjectRef node = head; node != NULL_REF; node = fields(heap, node)->next) {
+        if (fields(heap, node)->value != nodeValue(round, nodes - 1 - count)) {
+            return false;
+        }
+        ++count;
+    }
+    return count == nodes;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const size_t nodes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1500000;
+    const size_t heap_mb = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 128;
+
+    Heap heap;
+    if (!heap.reserve(heap_mb * 1024 * 1024)) {
+        std::fprintf(stderr, "failed to reserve a %zu MB heap\n", heap_mb);
+        return 1;
+    }
+
+    Class node_class;
+    node_class.descriptor = "Lanexec/bench/Node;";
+    node_class.object_size = sizeof(Object) + sizeof(NodeFields);
+    node_class.reference_offsets = {sizeof(Object)};
+    Class garbage_class;
+    garbage_class.descriptor = "[B";
+    garbage_class.component_size = 1;
+
+    // [round % LIVE_LISTS] - готовые списки, building - строящийся
+    ObjectRef lists[LIVE_LISTS] = {};
+    size_t list_rounds[LIVE_LISTS] = {};
+    ObjectRef building = NULL_REF;
+    heap.addRootSource([&](const Heap::RootVisitor& visit) {
+        for (ObjectRef& list : lists) {
+            visit(list);
+        }
+        visit(building);
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < ROUNDS; ++round) {
+        building = NULL_REF;
+        for (size_t i = 0; i < nodes; ++i) {
+            Object* object = heap.allocate(node_class.object_size);
+            if (!object) {
+                std::fprintf(stderr, "heap exhausted in round %zu at node %zu\n", round, i);
+                return 1;
+            }
+            object->klass = &node_class;
+            const ObjectRef node = heap.ref(object);
+            fields(heap, node)->value = nodeValue(round, i);
+            heap.writeReference(node, &fields(heap, node)->next, building);
+            building = node;
+
+            if (i % GARBAGE_EVERY == 0) {
+                const size_t length = 32 + (i * 7) % 224;
+                Object* garbage = heap.allocate(sizeof(Object) + length);
+                if (!garbage) {
+                    std::fprintf(stderr, "heap exhausted by garbage in round %zu\n", round);
+                    return 1;
+                }
+                garbage->klass = &garbage_class;
+                garbage->length = static_cast<uint32_t>(length);
+            }
+        }
+        // Самый старый список становится мусором старого поколения
+        lists[round % LIVE_LISTS] = building;
+        list_rounds[round % LIVE_LISTS] = round;
+        building = NULL_REF;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int failures = 0;
+    for (size_t i = 0; i < LIVE_LISTS; ++i) {
+        if (!checkList(heap, lists[i], list_rounds[i], nodes)) {
+            std::printf("list of round %zu is corrupted\n", list_rounds[i]);
+            ++failures;
+        }
+    }
+
+    const HeapStats stats = heap.getStats();
+    std::printf("%zu rounds of %zu nodes in a %zu MB heap: %.2f s, %.1f MB/s allocated\n",
+                ROUNDS, nodes, heap_mb, seconds, stats.allocated_bytes / seconds / (1024 * 1024));
+    std::printf("young %llu (mean pause %llu us, max %llu us, target %llu us, eden %zu KB)\n",
+                static_cast<unsigned long long>(stats.young_collections),
+                static_cast<unsigned long long>(
+                    stats.total_young_pause_us / std::max<uint64_t>(stats.young_collections, 1)),
+                static_cast<unsigned long long>(stats.max_young_pause_us),
+                static_cast<unsigned long long>(Heap::PAUSE_TARGET_US),
+                stats.eden_size / 1024);
+    std::printf("concurrent cycles %llu, full %llu (max pause %llu us), max pause %llu us, total pause %llu us\n",
+                static_cast<unsigned long long>(stats.concurrent_cycles),
+                static_cast<unsigned long long>(stats.full_collections),
+                static_cast<unsigned long long>(stats.max_full_pause_us),
+                static_cast<unsigned long long>(stats.max_pause_us),
+                static_cast<unsigned long long>(stats.total_pause_us));
+
+    const struct {
+        const char* name;
+        uint64_t count;
+    } kinds[] = {
+        {"young", stats.young_collections},
+        {"concurrent", stats.concurrent_cycles},
+    };
+    for (const auto& kind : kinds) {
+        if (kind.count == 0) {
+            std::printf("no %s collection happened\n", kind.name);
+            ++failures;
+        }
+    }
+    if (stats.full_collections * MIN_CYCLES_PER_FULL > stats.concurrent_cycles) {
+        std::printf("full collections are not exceptional: %llu per %llu concurrent cycles\n",
+                    static_cast<unsigned long long>(stats.full_collections),
+                    static_cast<unsigned long long>(stats.concurrent_cycles));
+        ++failures;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,286 @@
+// Микробенчмарки интерпретатора: циклы с арифметикой, вызовами и
+// обращениями к полям. Байткод собирается в памяти (dex_builder.h), так
+// что результаты сравнимы между версиями без внешних APK.
+//
+// Горячие циклы переходят в код JIT (OSR), если он доступен; --no-jit
+// оставляет только интерпретатор.
+//
+//   ./anexec_bench_interpreter [--no-jit] [итераций цикла]
+
+#include "dex_builder.h"
+#include "../src/core/apk_image.h"
+#include "../src/core/class_linker.h"
+#include "../src/core/heap.h"
+#include "../src/core/interpreter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+
+using namespace anexec;
+
+namespace {
+
+constexpr char BENCH_CLASS[] = "Lanexec/bench/Loops;";
+constexpr char COUNTER_CLASS[] = "Lanexec/bench/Counter;";
+
+// Все циклы: v0 - счетчик i, последний регистр - n
+std::vector<uint8_t> buildBenchDex() {
+    bench::DexBuilder dex;
+    const size_t loops = dex.defineClass(BENCH_CLASS, "Ljava/lang/Object;");
+    const size_t counter = dex.defineClass(COUNTER_CLASS, "Ljava/lang/Object;");
+
+    const uint32_t value = dex.field(COUNTER_CLASS, "I", "value");
+    const uint32_t total = dex.field(COUNTER_CLASS, "I", "total");
+    dex.addInstanceField(counter, value);
+    dex.addStaticField(counter, total);
+
+    // int step(int x) { return value + x; }
+    const uint32_t step = dex.method(COUNTER_CLASS, "step", "I", {"I"});
+    dex.addMethod(counter, step, 0x0001, {3, 2, 0, {
+        0x1052, static_cast<uint16_t>(value),   // iget v0, v1, value
+        0x20b0,                                 // add-int/2addr v0, v2
+        0x000f                                  // return v0
+    }}, true);
+
+    // static int add(int a, int b) { return a + b; }
+    const uint32_t add = dex.method(BENCH_CLASS, "add", "I", {"I", "I"});
+    dex.addMethod(loops, add, 0x0009, {3, 2, 0, {
+        0x0090, 0x0201,                         // add-int v0, v1, v2
+        0x000f                                  // return v0
+    }}, false);
+
+    // static int arith(int n): acc = (acc + i * i) ^ 0x5a
+    const uint32_t arith = dex.method(BENCH_CLASS, "arith", "I", {"I"});
+    dex.addMethod(loops, arith, 0x0009, {4, 1, 0, {
+        0x0012,                                 // const/4 v0, 0
+        0x0112,                                 // const/4 v1, 0
+        0x3035, 10,                             // if-ge v0, v3, +10
+        0x0292, 0x0000,                         // mul-int v2, v0, v0
+        0x21b0,                                 // add-int/2addr v1, v2
+        0x01df, 0x5a01,                         // xor-int/lit8 v1, v1, 0x5a
+        0x00d8, 0x0100,                         // add-int/lit8 v0, v0, 1
+        0xf728,                                 // goto -9
+        0x010f                                  // return v1
+    }}, false);
+
+    // static int invokeStatic(int n): acc = add(acc, i)
+    const uint32_t invoke_static = dex.method(BENCH_CLASS, "invokeStatic", "I", {"I"});
+    dex.addMethod(loops, invoke_static, 0x0009, {3, 1, 2, {
+        0x0012,                                 // const/4 v0, 0
+        0x0112,                                 // const/4 v1, 0
+        0x2035, 9,                              // if-ge v0, v2, +9
+        0x2071, static_cast<uint16_t>(add), 0x0001,  // invoke-static {v1, v0}, add
+        0x010a,                                 // move-result v1
+        0x00d8, 0x0100,                         // add-int/lit8 v0, v0, 1
+        0xf828,                                 // goto -8
+        0x010f                                  // return v1
+    }}, false);
+
+    // static int invokeVirtual(Counter c, int n): acc = c.step(acc)
+    const uint32_t invoke_virtual = dex.method(BENCH_CLASS, "invokeVirtual", "I", {COUNTER_CLASS, "I"});
+    dex.addMethod(loops, invoke_virtual, 0x0009, {4, 2, 2, {
+        0x0012,                                 // const/4 v0, 0
+        0x0112,                                 // const/4 v1, 0
+        0x3035, 9,                              // if-ge v0, v3, +9
+        0x206e, static_cast<uint16_t>(step), 0x0012,  // invoke-virtual {v2, v1}, step
+        0x010a,                                 // move-result v1
+        0x00d8, 0x0100,                         // add-int/lit8 v0, v0, 1
+        0xf828,                                 // goto -8
+        0x010f                                  // return v1
+    }}, false);
+
+    // static void instanceField(Counter c, int n): c.value += i
+    const uint32_t instance_field = dex.method(BENCH_CLASS, "instanceField", "V", {COUNTER_CLASS, "I"});
+    dex.addMethod(loops, instance_field, 0x0009, {4, 2, 0, {
+        0x0012,                                 // const/4 v0, 0
+        0x3035, 10,                             // if-ge v0, v3, +10
+        0x2152, static_cast<uint16_t>(value),   // iget v1, v2, value
+        0x01b0,                                 // add-int/2addr v1, v0
+        0x2159, static_cast<uint16_t>(value),   // iput v1, v2, value
+        0x00d8, 0x0100,                         // add-int/lit8 v0, v0, 1
+        0xf728,                                 // goto -9
+        0x000e                                  // return-void
+    }}, false);
+
+    // static void staticField(int n): Counter.total += i
+    const uint32_t static_field = dex.method(BENCH_CLASS, "staticField", "V", {"I"});
+    dex.addMethod(loops, static_field, 0x0009, {3, 1, 0, {
+        0x0012,                                 // const/4 v0, 0
+        0x2035, 10,                             // if-ge v0, v2, +10
+        0x0160, static_cast<uint16_t>(total),   // sget v1, total
+        0x01b0,                                 // add-int/2addr v1, v0
+        0x0167, static_cast<uint16_t>(total),   // sput v1, total
+        0x00d8, 0x0100,                         // add-int/lit8 v0, v0, 1
+        0xf728,                                 // goto -9
+        0x000e                                  // return-void
+    }}, false);
+
+    return dex.build();
+}
+
+struct BenchVm {
+    std::vector<uint8_t> dex_data;
+    Heap heap;
+    std::unique_ptr<ClassLinker> linker;
+    std::unique_ptr<Interpreter> interpreter;
+    Class* loops{nullptr};
+    Class* counter{nullptr};
+
+    bool open(bool use_jit) {
+        dex_data = buildBenchDex();
+        auto image = std::make_shared<ApkImage>();
+        image->dex_files.emplace_back("classes.dex", nullptr, dex_data.data(), dex_data.size(), false);
+        if (!image->class_index.build(image->dex_files) || !heap.reserve(64 * 1024 * 1024)) {
+            return false;
+        }
+        linker = std::make_unique<ClassLinker>(heap);
+        linker->attachImage(image);
+        interpreter = std::make_unique<Interpreter>(*linker);
+        if (use_jit && !interpreter->enableJit()) {
+            std::fprintf(stderr, "JIT is not available, measuring the interpreter\n");
+        }
+        loops = linker->findClass(BENCH_CLASS);
+        counter = linker->findClass(COUNTER_CLASS);
+        return loops && counter;
+    }
+
+    Method* method(const char* name, const char* signature) {
+        return linker->findMethod(loops, name, signature);
+    }
+};
+
+struct BenchCase {
+    const char* name;
+    const char* method;
+    const char* signature;
+    bool takes_counter;
+    // Ожидаемый результат для проверки, что цикл действительно выполнился
+    std::function<bool(uint64_t result, uint32_t iterations, BenchVm& vm, ObjectRef counter)> check;
+};
+
+uint32_t arithReference(uint32_t n) {
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        acc = (acc + i * i) ^ 0x5a;
+    }
+    return acc;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bool use_jit = true;
+    uint32_t iterations = 10000000;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--no-jit") == 0) {
+            use_jit = false;
+        } else {
+            iterations = static_cast<uint32_t>(std::strtoul(argv[i], nullptr, 10));
+        }
+    }
+
+    BenchVm vm;
+    if (!vm.open(use_jit)) {
+        std::fprintf(stderr, "failed to set up the benchmark VM\n");
+        return 1;
+    }
+
+    const BenchCase cases[] = {
+        {"arith", "arith", "(I)I", false,
+         [](uint64_t result, uint32_t n, BenchVm&, ObjectRef) {
+             return static_cast<uint32_t>(result) == arithReference(n);
+         }},
+        {"invoke-static", "invokeStatic", "(I)I", false,
+         [](uint64_t result, uint32_t n, BenchVm&, ObjectRef) {
+             return static_cast<uint32_t>(result) == static_cast<uint32_t>(uint64_t{n} * (n - 1) / 2);
+         }},
+        {"invoke-virtual", "invokeVirtual", "(Lanexec/bench/Counter;I)I", true,
+         [](uint64_t result, uint32_t n, BenchVm&, ObjectRef) {
+             return static_cast<uint32_t>(result) == n * 3u;
+         }},
+        {"iget/iput", "instanceField", "(Lanexec/bench/Counter;I)V", true,
+         [](uint64_t, uint32_t n, BenchVm& vm, ObjectRef counter) {
+             const uint32_t value = *reinterpret_cast<uint32_t*>(vm.heap.object(counter) + 1);
+             return value == 3u + static_cast<uint32_t>(uint64_t{n} * (n - 1) / 2);
+         }},
+        {"sget/sput", "staticField", "(I)V", false,
+         [](uint64_t, uint32_t n, BenchVm& vm, ObjectRef) {
+             return static_cast<uint32_t>(vm.counter->statics[0]) ==
+                    static_cast<uint32_t>(uint64_t{n} * (n - 1) / 2);
+         }},
+    };
+
+    std::printf("%-16s %12s %10s %8s\n", "benchmark", "iterations", "ns/iter", "result");
+    int failures = 0;
+    for (const BenchCase& bench : cases) {
+        Method* method = vm.method(bench.method, bench.signature);
+        if (!method) {
+            std::printf("%-16s missing method\n", bench.name);
+            ++failures;
+            continue;
+        }
+
+        // Отдельный объект на каждый прогон; value = 3 для проверки step()
+        ObjectRef counter = vm.linker->allocObject(vm.counter);
+        // Сборка во время прогона может переместить объект
+        Heap::ScopedRoot root(vm.heap, counter);
+        *reinterpret_cast<uint32_t*>(vm.heap.object(counter) + 1) = 3;
+        vm.counter->statics[0] = 0;
+
+        uint32_t args[2];
+        size_t count = 0;
+        if (bench.takes_counter) {
+            args[count++] = counter;
+        }
+        args[count++] = iterations;
+
+        // Прогрев: первый вызов ускоряет код методов
+        uint64_t result = 0;
+        uint32_t warmup[2] = {args[0], args[1]};
+        warmup[count - 1] = 1;
+        if (!vm.interpreter->invoke(method, warmup, count, &result)) {
+            std::printf("%-16s threw during warmup\n", bench.name);
+            ++failures;
+            continue;
+        }
+        *reinterpret_cast<uint32_t*>(vm.heap.object(counter) + 1) = 3;
+        vm.counter->statics[0] = 0;
+        if (bench.takes_counter) {
+            args[0] = counter;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        const bool ok = vm.interpreter->invoke(method, args, count, &result);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        const bool valid = ok && bench.check(result, iterations, vm, counter);
+        const double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+
+        std::printf("%-16s %12u %10.2f %8s\n", bench.name, iterations,
+                    iterations ? ns / iterations : 0.0, valid ? "ok" : "WRONG");
+        if (!valid) {
+            ++failures;
+        }
+    }
+
+    const InterpreterStats stats = vm.interpreter->getStats();
+    std::printf("\ninvocations %llu, quickened methods %llu, quickened instructions %llu\n",
+                static_cast<unsigned long long>(stats.invocations),
+                static_cast<unsigned long long>(stats.quickened_methods),
+                static_cast<unsigned long long>(stats.quickened_instructions));
+    const JitStats jit = vm.interpreter->getJitStats();
+    std::printf("jit: compiled %llu, rejected %llu, code %llu bytes, compile time %llu us\n"
+                "     compiled invocations %llu, osr entries %llu, inline cache hits %llu, misses %llu\n",
+                static_cast<unsigned long long>(jit.compiled_methods),
+                static_cast<unsigned long long>(jit.rejected_methods),
+                static_cast<unsigned long long>(jit.code_bytes),
+                static_cast<unsigned long long>(jit.compile_time_us),
+                static_cast<unsigned long long>(stats.compiled_invocations),
+                static_cast<unsigned long long>(stats.osr_entries),
+                static_cast<unsigned long long>(stats.inline_cache_hits),
+                static_cast<unsigned long long>(stats.inline_cache_misses));
+    return failures ? 1 : 0;
+}
@@ -1 +1,4 @@
-clang++ src/main.cpp src/core/executor.cpp src/core/runtime.cpp src/android/api.cpp src/android/activity.cpp src/graphics/renderer.cpp -o anexec -std=c++17 -lzip -ldl -lGLESv2 -lEGL -O3
\ No newline at end of file
+clang++ src/main.cpp src/core/executor.cpp src/core/apk_archive.cpp src/core/extraction_cache.cpp src/core/thread_pool.cpp src/core/resource_monitor.cpp src/core/looper.cpp src/core/apk_image.cpp src/core/native_loader.cpp src/core/executor_host.cpp src/core/runtime.cpp src/core/zygote.cpp src/core/native_registry.cpp src/core/class_index.cpp src/core/heap.cpp src/core/class_linker.cpp src/core/interpreter.cpp src/core/verifier.cpp src/core/jit.cpp src/core/aot_image.cpp src/core/trace.cpp src/android/api.cpp src/android/permissions.cpp src/android/manifest_parser.cpp src/android/activity.cpp src/graphics/renderer.cpp src/graphics/texture_cache.cpp src/graphics/frame_scheduler.cpp src/graphics/egl_context.cpp src/graphics/frame_readback.cpp src/graphics/damage_tracker.cpp src/graphics/shader_cache.cpp -o anexec -std=c++17 -lzip -lz -ldl -lGLESv2 -lEGL -O3 -pthread
+clang++ bench/interpreter_bench.cpp src/core/interpreter.cpp src/core/verifier.cpp src/core/jit.cpp src/core/class_linker.cpp src/core/heap.cpp src/core/class_index.cpp src/core/apk_image.cpp src/core/resource_monitor.cpp src/core/aot_image.cpp src/core/apk_archive.cpp src/core/trace.cpp -o anexec_bench_interpreter -std=c++17 -lz -O3 -pthread
+clang++ bench/anexec_bench.cpp src/core/executor.cpp src/core/apk_archive.cpp src/core/extraction_cache.cpp src/core/thread_pool.cpp src/core/resource_monitor.cpp src/core/looper.cpp src/core/apk_image.cpp src/core/native_loader.cpp src/core/class_index.cpp src/core/native_registry.cpp src/core/trace.cpp src/android/api.cpp src/android/permissions.cpp src/android/manifest_parser.cpp src/android/activity.cpp src/graphics/renderer.cpp src/graphics/texture_cache.cpp src/graphics/frame_scheduler.cpp src/graphics/egl_context.cpp src/graphics/frame_readback.cpp src/graphics/damage_tracker.cpp src/graphics/shader_cache.cpp -o anexec_bench -std=c++17 -lzip -lz -ldl -lGLESv2 -lEGL -O3 -pthread
+clang++ bench/heap_bench.cpp src/core/heap.cpp -o anexec_bench_heap -std=c++17 -O3 -pthread
@@ -1,10 +1,8 @@
 #include "activity.h"
+#include "../core/trace.h"
 #include <chrono>
 #include <iostream>
-#include <sstream>
-#include <iomanip>
 #include <map>
-#include <ctime>
 
 namespace anexec {
 
@@ -43,16 +41,22 @@ private:
     LifecycleState state;
     std::map<std::string, void*> system_services;
     bool is_finishing;
-    std::vector<std::string> lifecycle_log;
     std::chrono::system_clock::time_point create_time;
     bool has_window_focus;
     SavedState saved_state;
+    uint32_t trace_name;    // activity_name в Tracer
+    std::map<std::string, uint32_t, std::less<>> action_trace_names;  // Intent.action в Tracer
 
-    void logLifecycleEvent(const std::string& event) {
-        std::stringstream ss;
-        ss << "Activity " << activity_name << ": " << event;
-        lifecycle_log.push_back(ss.str());
-        std::cout << ss.str() << std::endl;
+    // Переходы пишутся в трассу, а не в stdout: на каждый переход это
+    // проверка флага, а не форматирование строки и сброс потока
+    void traceLifecycle(TraceEvent event, uint64_t arg = 0) const {
+        traceEvent(event, arg, trace_name);
+    }
+
+    void reportFailure(TraceEvent event, const std::exception& e) const {
+        traceLifecycle(TraceEvent::ActivityError, static_cast<uint64_t>(event));
+        std::cerr << "Activity " << activity_name << ": "
+                  << TRACE_EVENT_INFO[static_cast<size_t>(event)].name << " failed: " << e.what() << '\n';
     }
 
 public:
@@ -62,9 +66,10 @@ public:
         , state(LifecycleState::Created)
         , is_finishing(false)
         , create_time(std::chrono::system_clock::now())
-        , has_window_focus(false) {
-        
-        logLifecycleEvent("Constructed");
+        , has_window_focus(false)
+        , trace_name(Tracer::instance().intern(activity_name)) {
+
+        traceLifecycle(TraceEvent::ActivityConstructed);
     }
 
     void onCreate() {
@@ -73,12 +78,12 @@ public:
         }
 
         try {
-            logLifecycleEvent("onCreate called");
+            traceLifecycle(TraceEvent::ActivityCreate);
             initializeSystemServices();
             state = LifecycleState::Created;
             
         } catch (const std::exception& e) {
-            logLifecycleEvent("onCreate failed: " + std::string(e.what()));
+            reportFailure(TraceEvent::ActivityCreate, e);
             throw;
         }
     }
@@ -90,11 +95,11 @@ public:
         }
 
         try {
-            logLifecycleEvent("onStart called");
+            traceLifecycle(TraceEvent::ActivityStart);
             state = LifecycleState::Started;
             
         } catch (const std::exception& e) {
-            logLifecycleEvent("onStart failed: " + std::string(e.what()));
+            reportFailure(TraceEvent::ActivityStart, e);
             throw;
         }
     }
@@ -106,11 +111,11 @@ public:
         }
 
         try {
-            logLifecycleEvent("onResume called");
+            traceLifecycle(TraceEvent::ActivityResume);
             state = LifecycleState::Resumed;
             
         } catch (const std::exception& e) {
-            logLifecycleEvent("onResume failed: " + std::string(e.what()));
+            reportFailure(TraceEvent::ActivityResume, e);
             throw;
         }
     }
@@ -121,11 +126,11 @@ public:
         }
 
         try {
-            logLifecycleEvent("onPause called");
+            traceLifecycle(TraceEvent::ActivityPause);
             state = LifecycleState::Paused;
             
         } catch (const std::exception& e) {
-            logLifecycleEvent("onPause failed: " + std::string(e.what()));
+            reportFailure(TraceEvent::ActivityPause, e);
             throw;
         }
     }
@@ -136,11 +141,11 @@ public:
         }
 
         try {
-            logLifecycleEvent("onStop called");
+            traceLifecycle(TraceEvent::ActivityStop);
             state = LifecycleState::Stopped;
             
         } catch (const std::exception& e) {
-            logLifecycleEvent("onStop failed: " + std::string(e.what()));
+            reportFailure(TraceEvent::ActivityStop, e);
             throw;
         }
     }
@@ -151,18 +156,18 @@ public:
         }
 
         try {
-            logLifecycleEvent("onDestroy called");
+            traceLifecycle(TraceEvent::ActivityDestroy);
             cleanupSystemServices();
             state = LifecycleState::Destroyed;
             
         } catch (const std::exception& e) {
-            logLifecycleEvent("onDestroy failed: " + std::string(e.what()));
+            reportFailure(TraceEvent::ActivityDestroy, e);
             throw;
         }
     }
 
     void onSaveInstanceState(SavedState& outState) {
-        logLifecycleEvent("Saving instance state");
+        traceLifecycle(TraceEvent::ActivitySaveState);
         outState = saved_state;
         outState.timestamp = std::chrono::system_clock::now();
         outState.is_finishing = is_finishing;
@@ -170,25 +175,32 @@ public:
     }
 
     void onRestoreInstanceState(const SavedState& savedState) {
-        logLifecycleEvent("Restoring instance state");
+        traceLifecycle(TraceEvent::ActivityRestoreState);
         saved_state = savedState;
         has_window_focus = savedState.has_focus;
     }
 
     void onWindowFocusChanged(bool hasFocus) {
         has_window_focus = hasFocus;
-        logLifecycleEvent(std::string("Window focus changed: ") + 
-                         (hasFocus ? "gained focus" : "lost focus"));
+        traceLifecycle(TraceEvent::ActivityFocus, hasFocus);
     }
 
     void startActivity(const Intent& intent) {
-        logLifecycleEvent("Starting new activity: " + intent.action);
+        if (!Tracer::enabled()) {
+            return;
+        }
+        // Действий у активности немного: номер строки берется один раз на действие
+        auto it = action_trace_names.find(intent.action);
+        if (it == action_trace_names.end()) {
+            it = action_trace_names.emplace(intent.action, Tracer::instance().intern(intent.action)).first;
+        }
+        traceEvent(TraceEvent::ActivityLaunch, 0, it->second);
     }
 
     void finish() {
         if (!is_finishing) {
             is_finishing = true;
-            logLifecycleEvent("Activity finishing");
+            traceLifecycle(TraceEvent::ActivityFinish);
             onPause();
             onStop();
             onDestroy();
@@ -230,13 +242,10 @@ private:
         system_services["activity"] = nullptr;
         system_services["input_method"] = nullptr;
         system_services["location"] = nullptr;
-        
-        logLifecycleEvent("System services initialized");
     }
 
     void cleanupSystemServices() {
         system_services.clear();
-        logLifecycleEvent("System services cleaned up");
     }
 };
 
@@ -1,31 +1,183 @@
 #include "api.h"
-#include <map>
+#include "permissions.h"
+#include "../core/native_registry.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
 #include <mutex>
 #include <sstream>
+#include <stdexcept>
 #include <chrono>
+#include <condition_variable>
+#include <thread>
+#include "../core/looper.h"
+#include "../core/mpmc_queue.h"
+#include "../core/token_bucket.h"
+#include "../core/trace.h"
 
 namespace anexec {
 
+APIParams::APIParams(std::initializer_list<std::pair<std::string_view, std::string_view>> init) {
+    for (const auto& [k, v] : init) {
+        set(k, v);
+    }
+}
+
+void APIParams::set(std::string_view k, std::string_view v) {
+    const size_t i = indexOf(k);
+    if (i < count) {
+        // Старое значение остается в буфере: замены редки, буфер короткоживущий
+        Entry& e = entry(i);
+        e.value_offset = append(v);
+        e.value_size = static_cast<uint32_t>(v.size());
+        return;
+    }
+
+    Entry e;
+    e.key_offset = append(k);
+    e.key_size = static_cast<uint32_t>(k.size());
+    e.value_offset = append(v);
+    e.value_size = static_cast<uint32_t>(v.size());
+    if (count < INLINE_PARAMS) {
+        inline_entries[count] = e;
+    } else {
+        more_entries.push_back(e);
+    }
+    ++count;
+}
+
+bool APIParams::contains(std::string_view k) const {
+    return indexOf(k) < count;
+}
+
+std::string_view APIParams::at(std::string_view k) const {
+    const size_t i = indexOf(k);
+    if (i >= count) {
+        throw std::out_of_range("Missing parameter: " + std::string(k));
+    }
+    return value(entry(i));
+}
+
+uint32_t APIParams::append(std::string_view data) {
+    const size_t offset = used_bytes;
+    if (heap_bytes.empty() && offset + data.size() <= INLINE_BYTES) {
+        std::memcpy(inline_bytes + offset, data.data(), data.size());
+    } else {
+        if (heap_bytes.empty()) {
+            heap_bytes.reserve(2 * (offset + data.size()));
+            heap_bytes.assign(inline_bytes, inline_bytes + offset);
+        }
+        heap_bytes.insert(heap_bytes.end(), data.begin(), data.end());
+    }
+    used_bytes += data.size();
+    return static_cast<uint32_t>(offset);
+}
+
+size_t APIParams::indexOf(std::string_view k) const {
+    for (size_t i = 0; i < count; ++i) {
+        if (key(entry(i)) == k) {
+            return i;
+        }
+    }
+    return count;
+}
+
 class API::Impl {
 private:
     struct APIState {
-        bool initialized{false};
+        std::atomic<bool> initialized{false};
         std::string package_name;
         std::string version_name;
         int version_code{0};
         APILevel min_sdk_level{APILevel::ANDROID_10};
         APILevel target_sdk_level{APILevel::ANDROID_13};
-        std::map<std::string, void*> native_functions;
+        PermissionSet permissions;
         mutable std::mutex state_mutex;
     } state;
 
-    std::map<std::string, std::function<void(const APIRequest&)>> handlers;
-    std::mutex handlers_mutex;
+    // Таблица диспетчеризации неизменяема после публикации; регистрация
+    // строит копию и подменяет указатель. Прежние таблицы и обработчики
+    // живут до уничтожения API: читатель мог взять старую таблицу.
+    // Регистраций единицы, так что копирование ничего не стоит.
+    struct HandlerTable {
+        struct Slot {
+            uint64_t hash;
+            APIMethodId id;     // INVALID_API_METHOD - пустой слот
+        };
+
+        std::vector<Slot> slots;                // Открытая адресация, заполнены не больше чем наполовину
+        std::vector<std::string> names;         // [id - 1]
+        std::vector<const APIHandler*> handlers; // [id - 1], nullptr - обработчика нет
+        std::vector<TokenBucket*> limits;       // [id - 1], nullptr - без своего ограничения
+        std::vector<uint32_t> trace_names;      // [id - 1], строки Tracer для событий вызова
+
+        APIMethodId find(std::string_view name, uint64_t hash) const {
+            const size_t mask = slots.size() - 1;
+            for (size_t i = hash & mask;; i = (i + 1) & mask) {
+                const Slot& slot = slots[i];
+                if (slot.id == INVALID_API_METHOD) {
+                    return INVALID_API_METHOD;
+                }
+                if (slot.hash == hash && names[slot.id - 1] == name) {
+                    return slot.id;
+                }
+            }
+        }
 
-    static constexpr int MAX_API_CALLS_PER_SECOND = 1000;
-    std::chrono::system_clock::time_point last_rate_reset;
-    int api_calls_count{0};
-    std::mutex rate_limit_mutex;
+        void insert(uint64_t hash, APIMethodId id) {
+            const size_t mask = slots.size() - 1;
+            size_t i = hash & mask;
+            while (slots[i].id != INVALID_API_METHOD) {
+                i = (i + 1) & mask;
+            }
+            slots[i] = Slot{hash, id};
+        }
+    };
+
+    static constexpr size_t INITIAL_TABLE_SLOTS = 16;
+
+    std::atomic<const HandlerTable*> table{nullptr};
+    mutable std::mutex handlers_mutex;                          // Только для записи
+    std::vector<std::unique_ptr<HandlerTable>> tables;
+    std::vector<std::unique_ptr<APIHandler>> handler_storage;
+    std::vector<std::unique_ptr<TokenBucket>> limit_storage;
+
+    // Общее ограничение процесса; настраивается в initialize()
+    TokenBucket global_limit;
+
+    // Асинхронные запросы. Рабочие потоки запускаются при первом
+    // submitRequest; результаты копятся пачкой и уходят в Looper
+    // вызывающего одной задачей на пачку.
+    struct AsyncJob {
+        APIRequest request;
+        Looper* looper{nullptr};    // nullptr - ответ в рабочем потоке
+    };
+
+    struct Completion {
+        APICallback callback;
+        APIResponse response;
+    };
+
+    // Куда обработчик в рабочем потоке отдает ответ; живет до возврата
+    // из обработчика, поэтому ответ должен прийти до этого
+    struct CompletionSink {
+        APICallback callback;
+        std::vector<Completion>* batch;
+    };
+
+    // Сколько запросов рабочий поток берет за раз
+    static constexpr size_t ASYNC_BATCH = 32;
+
+    size_t async_workers{0};
+    size_t async_queue_capacity{0};
+    std::once_flag async_started;
+    std::unique_ptr<MpmcQueue<AsyncJob>> async_queue;
+    std::vector<std::thread> workers;
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cv;
+    std::atomic<size_t> sleeping{0};
+    std::atomic<bool> stopping{false};
 
     void registerDefaultHandlers() {
         registerHandler("getApiLevel", [this](const APIRequest& req) {
@@ -50,15 +202,7 @@ private:
     }
 
     void handleCheckPermission(const APIRequest& req) {
-        const std::string& permission = req.params.at("permission");
-        bool granted = false;
-
-        if (permission == "android.permission.INTERNET" ||
-            permission == "android.permission.READ_EXTERNAL_STORAGE" ||
-            permission == "android.permission.WRITE_EXTERNAL_STORAGE") {
-            granted = true;
-        }
-
+        const bool granted = state.permissions.has(req.params.at("permission"));
         req.callback(APIResponse{
             .success = true,
             .data = granted ? "granted" : "denied"
@@ -66,46 +210,226 @@ private:
     }
 
     void handleRegisterNativeMethod(const APIRequest& req) {
-        std::lock_guard<std::mutex> lock(state.state_mutex);
-        const std::string& method_name = req.params.at("name");
-        void* method_ptr = reinterpret_cast<void*>(
-            std::stoull(req.params.at("pointer"))
-        );
-        
-        state.native_functions[method_name] = method_ptr;
+        const std::string_view method_name = req.params.at("name");
+        const std::string_view pointer = req.params.at("pointer");
+        uintptr_t address = 0;
+        const auto [end, ec] = std::from_chars(pointer.data(), pointer.data() + pointer.size(), address);
+        if (ec != std::errc() || end != pointer.data() + pointer.size()) {
+            req.callback(APIResponse{
+                .success = false,
+                .error = "Invalid native method pointer: " + std::string(pointer)
+            });
+            return;
+        }
+        void* method_ptr = reinterpret_cast<void*>(address);
+
+        if (NativeRegistry::instance().registerNative(method_name, method_ptr) ==
+            NativeRegistry::INVALID_METHOD) {
+            req.callback(APIResponse{
+                .success = false,
+                .error = "Invalid native method name: " + std::string(method_name)
+            });
+            return;
+        }
 
         req.callback(APIResponse{
             .success = true,
-            .data = "Native method registered: " + method_name
+            .data = "Native method registered: " + std::string(method_name)
         });
     }
 
-    bool checkRateLimit() {
-        std::lock_guard<std::mutex> lock(rate_limit_mutex);
-        
-        auto now = std::chrono::system_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-            now - last_rate_reset
-        );
+    // Под handlers_mutex. Копия текущей таблицы, в которой есть имя;
+    // идентификаторы существующих имен не меняются.
+    std::unique_ptr<HandlerTable> copyTable(std::string_view name, APIMethodId& id) const {
+        const HandlerTable* current = table.load(std::memory_order_relaxed);
+        const uint64_t hash = NativeRegistry::hashName(name);
+        auto next = std::make_unique<HandlerTable>(*current);
+        id = current->find(name, hash);
+        if (id == INVALID_API_METHOD) {
+            next->names.emplace_back(name);
+            next->handlers.push_back(nullptr);
+            next->limits.push_back(nullptr);
+            next->trace_names.push_back(Tracer::instance().intern(name));
+            id = static_cast<APIMethodId>(next->names.size());
+            if (next->names.size() * 2 > next->slots.size()) {
+                next->slots.assign(next->slots.size() * 2, HandlerTable::Slot{0, INVALID_API_METHOD});
+                for (size_t i = 0; i < next->names.size(); ++i) {
+                    next->insert(NativeRegistry::hashName(next->names[i]), static_cast<APIMethodId>(i + 1));
+                }
+            } else {
+                next->insert(hash, id);
+            }
+        }
+        return next;
+    }
 
-        if (elapsed.count() >= 1) {
-            api_calls_count = 0;
-            last_rate_reset = now;
+    void startWorkers() {
+        async_queue = std::make_unique<MpmcQueue<AsyncJob>>(async_queue_capacity);
+        const size_t count = async_workers ? async_workers
+                                           : std::max(1u, std::thread::hardware_concurrency() / 2);
+        workers.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            workers.emplace_back([this]() {
+                workerLoop();
+            });
         }
+    }
 
-        if (api_calls_count >= MAX_API_CALLS_PER_SECOND) {
-            return false;
+    void workerLoop() {
+        std::vector<AsyncJob> jobs(ASYNC_BATCH);
+        std::vector<std::pair<Looper*, std::vector<Completion>>> batches;
+
+        while (true) {
+            size_t count = 0;
+            while (count < ASYNC_BATCH && async_queue->tryPop(jobs[count])) {
+                ++count;
+            }
+
+            if (count == 0) {
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                sleeping.fetch_add(1, std::memory_order_seq_cst);
+                // Пара к барьеру в submit: либо мы увидим запрос, либо нас разбудят
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                sleep_cv.wait(lock, [this]() {
+                    return stopping.load(std::memory_order_acquire) || !async_queue->empty();
+                });
+                sleeping.fetch_sub(1, std::memory_order_relaxed);
+                if (stopping.load(std::memory_order_acquire) && async_queue->empty()) {
+                    return;
+                }
+                continue;
+            }
+
+            // Одна метка времени и одна таблица на всю пачку
+            const HandlerTable* current = table.load(std::memory_order_acquire);
+            const int64_t now = TokenBucket::now();
+            for (size_t i = 0; i < count; ++i) {
+                AsyncJob& job = jobs[i];
+                if (!job.looper) {
+                    dispatch(job.request, current, now);
+                    continue;
+                }
+
+                auto it = std::find_if(batches.begin(), batches.end(), [&job](const auto& batch) {
+                    return batch.first == job.looper;
+                });
+                if (it == batches.end()) {
+                    batches.emplace_back(job.looper, std::vector<Completion>{});
+                    it = batches.end() - 1;
+                }
+                CompletionSink sink{job.request.callback, &it->second};
+                job.request.callback = [sink = &sink](APIResponse response) {
+                    sink->batch->push_back(Completion{sink->callback, std::move(response)});
+                };
+                dispatch(job.request, current, now);
+            }
+
+            for (auto& [looper, completions] : batches) {
+                if (!completions.empty()) {
+                    looper->post([completions = std::move(completions)]() mutable {
+                        for (auto& completion : completions) {
+                            completion.callback(std::move(completion.response));
+                        }
+                    });
+                }
+            }
+            batches.clear();
+            for (size_t i = 0; i < count; ++i) {
+                jobs[i] = AsyncJob{};
+            }
         }
+    }
 
-        api_calls_count++;
+    // Запрос целиком: ограничения, поиск обработчика, вызов
+    void dispatch(const APIRequest& request, const HandlerTable* current, int64_t now) {
+        if (!global_limit.tryAcquire(now)) {
+            request.callback(APIResponse{
+                .success = false,
+                .error = "Rate limit exceeded"
+            });
+            return;
+        }
+
+        APIMethodId id = request.method_id;
+        if (id == INVALID_API_METHOD) {
+            id = current->find(request.method, NativeRegistry::hashName(request.method));
+        }
+        const APIHandler* handler =
+            id != INVALID_API_METHOD && id <= current->handlers.size() ? current->handlers[id - 1] : nullptr;
+        if (!handler) {
+            request.callback(APIResponse{
+                .success = false,
+                .error = "Unknown method: " +
+                         (id != INVALID_API_METHOD && id <= current->names.size()
+                              ? current->names[id - 1]
+                              : std::string(request.method))
+            });
+            return;
+        }
+
+        TokenBucket* limit = current->limits[id - 1];
+        if (limit && !limit->tryAcquire(now)) {
+            request.callback(APIResponse{
+                .success = false,
+                .error = "Rate limit exceeded: " + current->names[id - 1]
+            });
+            return;
+        }
+
+        // Обработчик выполняется без блокировок: таблица не изменится под ним
+        TraceScope trace(TraceEvent::ApiCall, current->trace_names[id - 1], id);
+        try {
+            (*handler)(request);
+        } catch (const std::exception& e) {
+            request.callback(APIResponse{
+                .success = false,
+                .error = std::string("Handler error: ") + e.what()
+            });
+        }
+    }
+
+    bool rejectUninitialized(const APIRequest& request) const {
+        if (state.initialized.load(std::memory_order_acquire)) {
+            return false;
+        }
+        request.callback(APIResponse{
+            .success = false,
+            .error = "API not initialized"
+        });
         return true;
     }
 
+    // Под handlers_mutex
+    void publish(std::unique_ptr<HandlerTable> next) {
+        table.store(next.get(), std::memory_order_release);
+        tables.push_back(std::move(next));
+    }
+
 public:
-    Impl() : last_rate_reset(std::chrono::system_clock::now()) {
+    Impl() {
+        // Пока setPermissions не вызван - прежний набор по умолчанию
+        state.permissions.grant("android.permission.INTERNET");
+        state.permissions.grant("android.permission.READ_EXTERNAL_STORAGE");
+        state.permissions.grant("android.permission.WRITE_EXTERNAL_STORAGE");
+
+        auto empty = std::make_unique<HandlerTable>();
+        empty->slots.resize(INITIAL_TABLE_SLOTS, HandlerTable::Slot{0, INVALID_API_METHOD});
+        table.store(empty.get(), std::memory_order_release);
+        tables.push_back(std::move(empty));
         registerDefaultHandlers();
     }
 
+    ~Impl() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping.store(true, std::memory_order_release);
+        }
+        sleep_cv.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
     void initialize(const APIConfig& config) {
         std::lock_guard<std::mutex> lock(state.state_mutex);
 
@@ -118,56 +442,150 @@ public:
         state.version_code = config.version_code;
         state.min_sdk_level = config.min_sdk_level;
         state.target_sdk_level = config.target_sdk_level;
-        state.initialized = true;
+        global_limit.configure(config.max_calls_per_second, config.max_burst_calls);
+        async_workers = config.async_workers;
+        async_queue_capacity = config.async_queue_capacity;
+        state.initialized.store(true, std::memory_order_release);
     }
 
-    void registerHandler(const std::string& name, 
-                        std::function<void(const APIRequest&)> handler) {
+    void registerHandler(const std::string& name, APIHandler handler) {
         std::lock_guard<std::mutex> lock(handlers_mutex);
-        handlers[name] = std::move(handler);
+        handler_storage.push_back(std::make_unique<APIHandler>(std::move(handler)));
+        APIMethodId id;
+        auto next = copyTable(name, id);
+        next->handlers[id - 1] = handler_storage.back().get();
+        publish(std::move(next));
     }
 
-    void handleRequest(APIRequest request) {
-        if (!state.initialized) {
-            request.callback(APIResponse{
-                .success = false,
-                .error = "API not initialized"
-            });
+    void setMethodRateLimit(std::string_view name, uint32_t rate, uint32_t burst) {
+        std::lock_guard<std::mutex> lock(handlers_mutex);
+        const HandlerTable* current = table.load(std::memory_order_relaxed);
+        const APIMethodId existing = current->find(name, NativeRegistry::hashName(name));
+        if (existing != INVALID_API_METHOD && current->limits[existing - 1]) {
+            current->limits[existing - 1]->configure(rate, burst);
             return;
         }
 
-        if (!checkRateLimit()) {
-            request.callback(APIResponse{
-                .success = false,
-                .error = "Rate limit exceeded"
-            });
-            return;
+        limit_storage.push_back(std::make_unique<TokenBucket>(rate, burst));
+        APIMethodId id;
+        auto next = copyTable(name, id);
+        next->limits[id - 1] = limit_storage.back().get();
+        publish(std::move(next));
+    }
+
+    uint64_t getRejectedCalls() const {
+        std::lock_guard<std::mutex> lock(handlers_mutex);
+        uint64_t total = global_limit.rejected();
+        for (const auto& limit : limit_storage) {
+            total += limit->rejected();
+        }
+        return total;
+    }
+
+    uint64_t getRejectedCalls(std::string_view method) const {
+        const HandlerTable* current = table.load(std::memory_order_acquire);
+        const APIMethodId id = current->find(method, NativeRegistry::hashName(method));
+        if (id == INVALID_API_METHOD || !current->limits[id - 1]) {
+            return 0;
         }
+        return current->limits[id - 1]->rejected();
+    }
 
+    APIMethodId resolveMethod(std::string_view name) {
+        const uint64_t hash = NativeRegistry::hashName(name);
+        const APIMethodId id = table.load(std::memory_order_acquire)->find(name, hash);
+        if (id != INVALID_API_METHOD || name.empty()) {
+            return id;
+        }
         std::lock_guard<std::mutex> lock(handlers_mutex);
-        auto it = handlers.find(request.method);
-        if (it == handlers.end()) {
-            request.callback(APIResponse{
-                .success = false,
-                .error = "Unknown method: " + request.method
-            });
+        APIMethodId created;
+        auto next = copyTable(name, created);
+        if (next->names.size() != table.load(std::memory_order_relaxed)->names.size()) {
+            publish(std::move(next));
+        }
+        return created;
+    }
+
+    void handleRequest(const APIRequest& request) {
+        if (rejectUninitialized(request)) {
             return;
         }
+        dispatch(request, table.load(std::memory_order_acquire), TokenBucket::now());
+    }
 
-        try {
-            it->second(request);
-        } catch (const std::exception& e) {
-            request.callback(APIResponse{
-                .success = false,
-                .error = std::string("Handler error: ") + e.what()
-            });
+    void handleRequests(const APIRequest* requests, size_t count) {
+        if (count == 0 || !state.initialized.load(std::memory_order_acquire)) {
+            for (size_t i = 0; i < count; ++i) {
+                rejectUninitialized(requests[i]);
+            }
+            return;
+        }
+        const HandlerTable* current = table.load(std::memory_order_acquire);
+        const int64_t now = TokenBucket::now();
+        for (size_t i = 0; i < count; ++i) {
+            dispatch(requests[i], current, now);
         }
     }
 
+    size_t submitRequests(const APIRequest* requests, size_t count, Looper* looper) {
+        if (count == 0) {
+            return 0;
+        }
+        if (!state.initialized.load(std::memory_order_acquire)) {
+            for (size_t i = 0; i < count; ++i) {
+                rejectUninitialized(requests[i]);
+            }
+            return count;
+        }
+        std::call_once(async_started, [this]() {
+            startWorkers();
+        });
+
+        // Имя метода не переживет вызов: в очередь идет идентификатор
+        const HandlerTable* current = table.load(std::memory_order_acquire);
+        size_t accepted = 0;
+        for (; accepted < count; ++accepted) {
+            AsyncJob job{requests[accepted], looper};
+            if (job.request.method_id == INVALID_API_METHOD) {
+                job.request.method_id =
+                    current->find(job.request.method, NativeRegistry::hashName(job.request.method));
+            }
+            // Неизвестный метод или идентификатор вне таблицы: dispatch
+            // сразу ответит "Unknown method"
+            if (job.request.method_id == INVALID_API_METHOD ||
+                job.request.method_id > current->names.size()) {
+                dispatch(requests[accepted], current, TokenBucket::now());
+                continue;
+            }
+            job.request.method = current->names[job.request.method_id - 1];
+            if (!async_queue->tryPush(std::move(job))) {
+                break;
+            }
+        }
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (accepted > 0 && sleeping.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            if (accepted > 1) {
+                sleep_cv.notify_all();
+            } else {
+                sleep_cv.notify_one();
+            }
+        }
+        return accepted;
+    }
+
+    void setPermissions(const PermissionSet& permissions) {
+        state.permissions = permissions;
+    }
+
+    bool hasPermission(PermissionId id) const {
+        return state.permissions.has(id);
+    }
+
+    // Без блокировок; на горячем пути лучше NativeRegistry::lookup по идентификатору
     void* getNativeFunction(const std::string& name) const {
-        std::lock_guard<std::mutex> lock(state.state_mutex);
-        auto it = state.native_functions.find(name);
-        return it != state.native_functions.end() ? it->second : nullptr;
+        return NativeRegistry::instance().lookup(name);
     }
 
     APILevel getMinSDKLevel() const {
@@ -191,7 +609,7 @@ public:
     }
 
     bool isInitialized() const {
-        return state.initialized;
+        return state.initialized.load(std::memory_order_acquire);
     }
 };
 
@@ -203,13 +621,60 @@ void API::initialize(const APIConfig& config) {
     impl->initialize(config);
 }
 
-void API::registerHandler(const std::string& name, 
-                        std::function<void(const APIRequest&)> handler) {
+void API::registerHandler(const std::string& name, APIHandler handler) {
     impl->registerHandler(name, std::move(handler));
 }
 
-void API::handleRequest(APIRequest request) {
-    impl->handleRequest(std::move(request));
+APIMethodId API::resolveMethod(std::string_view name) {
+    return impl->resolveMethod(name);
+}
+
+void API::setMethodRateLimit(std::string_view name, uint32_t rate, uint32_t burst) {
+    impl->setMethodRateLimit(name, rate, burst);
+}
+
+uint64_t API::getRejectedCalls() const {
+    return impl->getRejectedCalls();
+}
+
+uint64_t API::getRejectedCalls(std::string_view method) const {
+    return impl->getRejectedCalls(method);
+}
+
+void API::handleRequest(const APIRequest& request) {
+    impl->handleRequest(request);
+}
+
+void API::handleRequests(const APIRequest* requests, size_t count) {
+    impl->handleRequests(requests, count);
+}
+
+bool API::submitRequest(const APIRequest& request) {
+    return impl->submitRequests(&request, 1, Looper::myLooper()) == 1;
+}
+
+bool API::submitRequest(const APIRequest& request, Looper* reply_looper) {
+    return impl->submitRequests(&request, 1, reply_looper) == 1;
+}
+
+size_t API::submitRequests(const APIRequest* requests, size_t count) {
+    return impl->submitRequests(requests, count, Looper::myLooper());
+}
+
+size_t API::submitRequests(const APIRequest* requests, size_t count, Looper* reply_looper) {
+    return impl->submitRequests(requests, count, reply_looper);
+}
+
+void API::setPermissions(const PermissionSet& permissions) {
+    impl->setPermissions(permissions);
+}
+
+bool API::hasPermission(PermissionId id) const {
+    return impl->hasPermission(id);
+}
+
+bool API::hasPermission(std::string_view permission) const {
+    return impl->hasPermission(findPermission(permission));
 }
 
 void* API::getNativeFunction(const std::string& name) const {
@@ -2,12 +2,22 @@
 #define ANEXEC_API_H
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <functional>
-#include <map>
+#include <new>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <initializer_list>
+
+#include "permissions.h"
 
 namespace anexec {
 
+class Looper;
+
 enum class APILevel {
     ANDROID_10 = 29,
     ANDROID_11 = 30,
@@ -23,6 +33,14 @@ struct APIConfig {
     int version_code;
     APILevel min_sdk_level;
     APILevel target_sdk_level;
+    // Ограничение частоты вызовов на процесс (0 - без ограничения) и
+    // сколько вызовов подряд допускается после простоя
+    uint32_t max_calls_per_second{1000};
+    uint32_t max_burst_calls{1000};
+    // Рабочие потоки асинхронных запросов (0 - половина ядер) и емкость
+    // их очереди; при переполнении submitRequest отказывает
+    size_t async_workers{0};
+    size_t async_queue_capacity{1024};
 };
 
 struct APIResponse {
@@ -31,12 +49,105 @@ struct APIResponse {
     std::string error;
 };
 
+// Идентификатор метода API; получается один раз через API::resolveMethod
+using APIMethodId = uint32_t;
+constexpr APIMethodId INVALID_API_METHOD = 0;
+
+// Параметры запроса без выделения памяти в типичном случае: ключи и
+// значения лежат подряд во встроенном буфере, куча - только при переполнении.
+// Копируется целиком (смещения, а не указатели).
+class APIParams {
+public:
+    APIParams() = default;
+    APIParams(std::initializer_list<std::pair<std::string_view, std::string_view>> init);
+
+    // Добавление или замена значения
+    void set(std::string_view key, std::string_view value);
+
+    bool contains(std::string_view key) const;
+    // Как std::map::at: std::out_of_range, если ключа нет
+    std::string_view at(std::string_view key) const;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+private:
+    static constexpr size_t INLINE_PARAMS = 8;
+    static constexpr size_t INLINE_BYTES = 256;
+
+    struct Entry {
+        uint32_t key_offset;
+        uint32_t key_size;
+        uint32_t value_offset;
+        uint32_t value_size;
+    };
+
+    const char* bytes() const { return heap_bytes.empty() ? inline_bytes : heap_bytes.data(); }
+    const Entry& entry(size_t i) const {
+        return i < INLINE_PARAMS ? inline_entries[i] : more_entries[i - INLINE_PARAMS];
+    }
+    Entry& entry(size_t i) {
+        return i < INLINE_PARAMS ? inline_entries[i] : more_entries[i - INLINE_PARAMS];
+    }
+    std::string_view key(const Entry& e) const { return {bytes() + e.key_offset, e.key_size}; }
+    std::string_view value(const Entry& e) const { return {bytes() + e.value_offset, e.value_size}; }
+    uint32_t append(std::string_view data);
+    // size(), если ключа нет
+    size_t indexOf(std::string_view key) const;
+
+    size_t count{0};
+    size_t used_bytes{0};
+    Entry inline_entries[INLINE_PARAMS];
+    std::vector<Entry> more_entries;
+    char inline_bytes[INLINE_BYTES];
+    std::vector<char> heap_bytes;
+};
+
+// Обратный вызов без выделения памяти: вызываемый объект хранится на месте.
+// Годятся указатели на функции и лямбды, захватывающие до трех указателей
+// или ссылок; владеющие захваты (std::string, shared_ptr) не поддерживаются,
+// это проверяется при компиляции.
+class APICallback {
+public:
+    APICallback() = default;
+
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, APICallback>>>
+    APICallback(F f) {
+        static_assert(sizeof(F) <= STORAGE_SIZE, "APICallback: capture too large");
+        static_assert(alignof(F) <= alignof(std::max_align_t), "APICallback: capture over-aligned");
+        static_assert(std::is_trivially_copyable_v<F> && std::is_trivially_destructible_v<F>,
+                      "APICallback: capture must be trivially copyable");
+        ::new (static_cast<void*>(storage)) F(f);
+        invoke = [](const void* callable, APIResponse response) {
+            (*static_cast<const F*>(callable))(std::move(response));
+        };
+    }
+
+    void operator()(APIResponse response) const {
+        if (invoke) {
+            invoke(storage, std::move(response));
+        }
+    }
+    explicit operator bool() const { return invoke != nullptr; }
+
+private:
+    static constexpr size_t STORAGE_SIZE = 3 * sizeof(void*);
+
+    alignas(std::max_align_t) unsigned char storage[STORAGE_SIZE];
+    void (*invoke)(const void*, APIResponse){nullptr};
+};
+
 struct APIRequest {
-    std::string method;
-    std::map<std::string, std::string> params;
-    std::function<void(APIResponse)> callback;
+    // Имя метода; строка должна жить до возврата из handleRequest.
+    // Если method_id задан, имя не используется.
+    std::string_view method;
+    APIMethodId method_id{INVALID_API_METHOD};
+    APIParams params;
+    APICallback callback;
 };
 
+using APIHandler = std::function<void(const APIRequest&)>;
+
 class API {
 public:
     API();
@@ -47,11 +158,40 @@ public:
     API& operator=(const API&) = delete;
 
     void initialize(const APIConfig& config);
-    void registerHandler(const std::string& name, 
-                        std::function<void(const APIRequest&)> handler);
-    void handleRequest(APIRequest request);
+    void registerHandler(const std::string& name, APIHandler handler);
+    // Идентификатор метода для APIRequest::method_id. Можно получить до
+    // регистрации обработчика: он подхватится, когда появится.
+    APIMethodId resolveMethod(std::string_view name);
+    // Без блокировок на пути диспетчеризации; обработчик вызывается в
+    // потоке вызывающего, запросы разных потоков идут параллельно
+    void handleRequest(const APIRequest& request);
+    // Пачка запросов: одна проверка, одна таблица и одна метка времени на всех
+    void handleRequests(const APIRequest* requests, size_t count);
+
+    // Асинхронно: запрос уходит в очередь рабочих потоков. Ответ
+    // приходит в reply_looper (пачками, по задаче на пачку), по умолчанию -
+    // в Looper::myLooper(); nullptr - в рабочем потоке. Looper должен
+    // пережить ответы. false - очередь заполнена, запрос не принят и
+    // ответа не будет.
+    bool submitRequest(const APIRequest& request);
+    bool submitRequest(const APIRequest& request, Looper* reply_looper);
+    // Сколько первых запросов принято; остальные можно отправить позже
+    size_t submitRequests(const APIRequest* requests, size_t count);
+    size_t submitRequests(const APIRequest* requests, size_t count, Looper* reply_looper);
+
+    // Собственное ограничение метода, в дополнение к общему; rate 0 снимает его
+    void setMethodRateLimit(std::string_view name, uint32_t rate, uint32_t burst);
+    // Отклоненные ограничениями вызовы: всего и по методу
+    uint64_t getRejectedCalls() const;
+    uint64_t getRejectedCalls(std::string_view method) const;
     void* getNativeFunction(const std::string& name) const;
 
+    // Разрешения приложения для checkPermission; обычно Executor::getPermissions()
+    void setPermissions(const PermissionSet& permissions);
+    // O(1), без блокировок и выделения памяти
+    bool hasPermission(PermissionId id) const;
+    bool hasPermission(std::string_view permission) const;
+
     APILevel getMinSDKLevel() const;
     APILevel getTargetSDKLevel() const;
     std::string getPackageName() const;
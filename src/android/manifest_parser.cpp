@@ -0,0 +1,607 @@
+#include "manifest_parser.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+namespace anexec {
+
+namespace {
+
+// Типы чанков ResChunk_header
+constexpr uint16_t RES_STRING_POOL_TYPE = 0x0001;
+constexpr uint16_t RES_XML_TYPE = 0x0003;
+constexpr uint16_t RES_XML_START_ELEMENT_TYPE = 0x0102;
+constexpr uint16_t RES_XML_END_ELEMENT_TYPE = 0x0103;
+constexpr uint16_t RES_XML_RESOURCE_MAP_TYPE = 0x0180;
+
+constexpr uint32_t UTF8_FLAG = 1 << 8;
+constexpr uint32_t NO_INDEX = 0xFFFFFFFF;
+
+// Типы Res_value
+constexpr uint8_t TYPE_STRING = 0x03;
+constexpr uint8_t TYPE_FIRST_INT = 0x10;
+constexpr uint8_t TYPE_LAST_INT = 0x1f;
+
+// Идентификаторы атрибутов android:*
+constexpr uint32_t ATTR_NAME = 0x01010003;
+constexpr uint32_t ATTR_TARGET_ACTIVITY = 0x01010202;
+constexpr uint32_t ATTR_MIN_SDK_VERSION = 0x0101020c;
+constexpr uint32_t ATTR_VERSION_CODE = 0x0101021b;
+constexpr uint32_t ATTR_VERSION_NAME = 0x0101021c;
+constexpr uint32_t ATTR_TARGET_SDK_VERSION = 0x01010270;
+
+constexpr size_t CHUNK_HEADER_SIZE = 8;
+constexpr size_t NODE_HEADER_SIZE = 16;
+constexpr size_t ELEMENT_EXT_SIZE = 20;
+constexpr size_t ATTRIBUTE_SIZE = 20;
+
+// Элементы манифеста, которые нас интересуют
+enum Tag : uint8_t {
+    TagUnclassified = 0,
+    TagOther,
+    TagManifest,
+    TagUsesSdk,
+    TagUsesPermission,
+    TagActivity,
+    TagActivityAlias,
+    TagIntentFilter,
+    TagAction,
+    TagCategory
+};
+
+struct TagName {
+    std::string_view name;
+    Tag tag;
+};
+
+constexpr TagName TAG_NAMES[] = {
+    {"manifest", TagManifest},
+    {"uses-sdk", TagUsesSdk},
+    {"uses-permission", TagUsesPermission},
+    {"uses-permission-sdk-23", TagUsesPermission},
+    {"activity", TagActivity},
+    {"activity-alias", TagActivityAlias},
+    {"intent-filter", TagIntentFilter},
+    {"action", TagAction},
+    {"category", TagCategory}
+};
+
+// Атрибуты без ресурсного идентификатора (или без карты ресурсов)
+struct AttrName {
+    std::string_view name;
+    uint32_t id;
+};
+
+constexpr AttrName ATTR_NAMES[] = {
+    {"name", ATTR_NAME},
+    {"targetActivity", ATTR_TARGET_ACTIVITY},
+    {"minSdkVersion", ATTR_MIN_SDK_VERSION},
+    {"versionCode", ATTR_VERSION_CODE},
+    {"versionName", ATTR_VERSION_NAME},
+    {"targetSdkVersion", ATTR_TARGET_SDK_VERSION}
+};
+
+constexpr std::string_view ACTION_MAIN = "android.intent.action.MAIN";
+constexpr std::string_view CATEGORY_LAUNCHER = "android.intent.category.LAUNCHER";
+
+uint16_t read16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t read32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) |
+           (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Арена строк: блоки сохраняются между разборами
+class Arena {
+public:
+    char* allocate(size_t size) {
+        while (current < blocks.size()) {
+            if (used + size <= blocks[current].size) {
+                char* p = blocks[current].data.get() + used;
+                used += size;
+                return p;
+            }
+            ++current;
+            used = 0;
+        }
+
+        size_t block_size = std::max(size, BLOCK_SIZE);
+        blocks.push_back(Block{std::unique_ptr<char[]>(new char[block_size]), block_size});
+        current = blocks.size() - 1;
+        used = size;
+        return blocks[current].data.get();
+    }
+
+    void reset() {
+        current = 0;
+        used = 0;
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 16 * 1024;
+
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t current{0};
+    size_t used{0};
+};
+
+} // namespace
+
+class ManifestParser::Impl {
+private:
+    const uint8_t* data{nullptr};
+    size_t size{0};
+    std::string last_error;
+
+    // Пул строк
+    const uint8_t* string_offsets{nullptr};
+    const uint8_t* strings{nullptr};
+    const uint8_t* pool_end{nullptr};
+    uint32_t string_count{0};
+    bool utf8{false};
+
+    // Карта ресурсов: индекс строки имени атрибута -> идентификатор
+    const uint8_t* resource_ids{nullptr};
+    uint32_t resource_count{0};
+
+    // Кэши по индексу строки, размер меняется только при росте пула
+    std::vector<std::string_view> decoded;
+    std::vector<uint8_t> is_decoded;
+    std::vector<uint8_t> tags;
+    Arena arena;
+
+    // Состояние обхода
+    std::string_view package_name;
+    std::string_view current_activity;
+    int activity_depth{-1};
+    int filter_depth{-1};
+    bool filter_main{false};
+    bool filter_launcher{false};
+    int depth{0};
+
+    bool fail(const char* message) {
+        last_error = message;
+        return false;
+    }
+
+    bool parseStringPool(const uint8_t* chunk, uint16_t header_size, uint32_t chunk_size) {
+        if (header_size < 28 || chunk_size < header_size) {
+            return fail("Corrupted string pool");
+        }
+
+        string_count = read32(chunk + 8);
+        uint32_t flags = read32(chunk + 16);
+        uint32_t strings_start = read32(chunk + 20);
+        utf8 = (flags & UTF8_FLAG) != 0;
+
+        if (static_cast<uint64_t>(header_size) + string_count * 4ull > chunk_size ||
+            strings_start > chunk_size) {
+            return fail("Corrupted string pool");
+        }
+
+        string_offsets = chunk + header_size;
+        strings = chunk + strings_start;
+        pool_end = chunk + chunk_size;
+
+        decoded.resize(string_count);
+        is_decoded.assign(string_count, 0);
+        tags.assign(string_count, TagUnclassified);
+        return true;
+    }
+
+    // Сырые данные строки пула без декодирования
+    bool rawString(uint32_t index, const uint8_t*& chars, size_t& length) const {
+        if (index >= string_count) {
+            return false;
+        }
+
+        uint32_t offset = read32(string_offsets + index * 4);
+        if (strings + 2 > pool_end || offset > static_cast<size_t>(pool_end - strings) - 2) {
+            return false;
+        }
+        const uint8_t* p = strings + offset;
+
+        if (utf8) {
+            // Длина в UTF-16, затем длина в байтах UTF-8 (1 или 2 байта каждая)
+            p += (p[0] & 0x80) ? 2 : 1;
+            if (p + 2 > pool_end) {
+                return false;
+            }
+            length = p[0];
+            if (length & 0x80) {
+                length = ((length & 0x7F) << 8) | p[1];
+                p += 2;
+            } else {
+                p += 1;
+            }
+            chars = p;
+            return p + length <= pool_end;
+        }
+
+        length = read16(p);
+        p += 2;
+        if (length & 0x8000) {
+            if (p + 2 > pool_end) {
+                return false;
+            }
+            length = ((length & 0x7FFF) << 16) | read16(p);
+            p += 2;
+        }
+        chars = p;
+        return p + length * 2 <= pool_end;
+    }
+
+    // Сравнение строки пула с ASCII литералом без декодирования
+    bool equals(uint32_t index, std::string_view literal) const {
+        const uint8_t* chars = nullptr;
+        size_t length = 0;
+        if (!rawString(index, chars, length) || length != literal.size()) {
+            return false;
+        }
+
+        if (utf8) {
+            return std::memcmp(chars, literal.data(), length) == 0;
+        }
+        for (size_t i = 0; i < length; ++i) {
+            if (read16(chars + i * 2) != static_cast<uint8_t>(literal[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // UTF-8 строки берутся прямо из манифеста, UTF-16 перекодируются в арену
+    std::string_view string(uint32_t index) {
+        if (index >= string_count) {
+            return {};
+        }
+        if (is_decoded[index]) {
+            return decoded[index];
+        }
+
+        const uint8_t* chars = nullptr;
+        size_t length = 0;
+        std::string_view result;
+        if (rawString(index, chars, length)) {
+            if (utf8) {
+                result = std::string_view(reinterpret_cast<const char*>(chars), length);
+            } else {
+                result = decodeUtf16(chars, length);
+            }
+        }
+
+        decoded[index] = result;
+        is_decoded[index] = 1;
+        return result;
+    }
+
+    std::string_view decodeUtf16(const uint8_t* chars, size_t length) {
+        char* out = arena.allocate(length * 3);
+        size_t n = 0;
+        for (size_t i = 0; i < length; ++i) {
+            uint32_t c = read16(chars + i * 2);
+            if (c >= 0xD800 && c <= 0xDBFF && i + 1 < length) {
+                uint32_t low = read16(chars + (i + 1) * 2);
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                    ++i;
+                }
+            }
+
+            if (c < 0x80) {
+                out[n++] = static_cast<char>(c);
+            } else if (c < 0x800) {
+                out[n++] = static_cast<char>(0xC0 | (c >> 6));
+                out[n++] = static_cast<char>(0x80 | (c & 0x3F));
+            } else if (c < 0x10000) {
+                out[n++] = static_cast<char>(0xE0 | (c >> 12));
+                out[n++] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                out[n++] = static_cast<char>(0x80 | (c & 0x3F));
+            } else {
+                out[n++] = static_cast<char>(0xF0 | (c >> 18));
+                out[n++] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+                out[n++] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                out[n++] = static_cast<char>(0x80 | (c & 0x3F));
+            }
+        }
+        // Суррогатная пара занимает 4 байта вместо 6, так что length * 3 хватает
+        return std::string_view(out, n);
+    }
+
+    Tag tag(uint32_t index) {
+        if (index >= string_count) {
+            return TagOther;
+        }
+        if (tags[index] == TagUnclassified) {
+            tags[index] = TagOther;
+            for (const auto& entry : TAG_NAMES) {
+                if (equals(index, entry.name)) {
+                    tags[index] = entry.tag;
+                    break;
+                }
+            }
+        }
+        return static_cast<Tag>(tags[index]);
+    }
+
+    uint32_t attributeId(uint32_t name_index) const {
+        if (name_index < resource_count) {
+            uint32_t id = read32(resource_ids + name_index * 4);
+            if (id != 0) {
+                return id;
+            }
+        }
+        for (const auto& entry : ATTR_NAMES) {
+            if (equals(name_index, entry.name)) {
+                return entry.id;
+            }
+        }
+        return 0;
+    }
+
+    std::string_view formatInt(uint32_t value) {
+        char* out = arena.allocate(10);
+        auto result = std::to_chars(out, out + 10, value);
+        return std::string_view(out, static_cast<size_t>(result.ptr - out));
+    }
+
+    // Значение атрибута как строка: строки из пула, числа форматируются
+    std::string_view attributeValue(const uint8_t* attr) {
+        uint32_t raw_value = read32(attr + 8);
+        uint8_t data_type = attr[15];
+        uint32_t value = read32(attr + 16);
+
+        if (data_type == TYPE_STRING) {
+            return string(raw_value != NO_INDEX ? raw_value : value);
+        }
+        if (raw_value != NO_INDEX) {
+            return string(raw_value);
+        }
+        if (data_type >= TYPE_FIRST_INT && data_type <= TYPE_LAST_INT) {
+            return formatInt(value);
+        }
+        return {};
+    }
+
+    // .Main -> package.Main, Main -> package.Main
+    std::string_view className(std::string_view name) {
+        if (name.empty() || package_name.empty() ||
+            (name[0] != '.' && name.find('.') != std::string_view::npos)) {
+            return name;
+        }
+
+        const bool relative = name[0] == '.';
+        const size_t length = package_name.size() + name.size() + (relative ? 0 : 1);
+        char* out = arena.allocate(length);
+        std::memcpy(out, package_name.data(), package_name.size());
+        size_t pos = package_name.size();
+        if (!relative) {
+            out[pos++] = '.';
+        }
+        std::memcpy(out + pos, name.data(), name.size());
+        return std::string_view(out, length);
+    }
+
+    bool startElement(const uint8_t* chunk, uint16_t header_size,
+                      uint32_t chunk_size, ManifestInfo& out) {
+        ++depth;
+        if (header_size < NODE_HEADER_SIZE || header_size + ELEMENT_EXT_SIZE > chunk_size) {
+            return fail("Corrupted XML element");
+        }
+
+        const uint8_t* ext = chunk + header_size;
+        const Tag element = tag(read32(ext + 4));
+        if (element == TagOther) {
+            return true;
+        }
+
+        uint16_t attr_start = read16(ext + 8);
+        uint16_t attr_size = read16(ext + 10);
+        uint16_t attr_count = read16(ext + 12);
+        if (attr_size < ATTRIBUTE_SIZE ||
+            header_size + attr_start + static_cast<uint64_t>(attr_count) * attr_size > chunk_size) {
+            return fail("Corrupted XML attributes");
+        }
+
+        std::string_view name;
+        std::string_view target;
+        for (uint16_t i = 0; i < attr_count; ++i) {
+            const uint8_t* attr = ext + attr_start + i * attr_size;
+            uint32_t attr_name = read32(attr + 4);
+
+            if (element == TagManifest && read32(attr) == NO_INDEX &&
+                equals(attr_name, "package")) {
+                package_name = attributeValue(attr);
+                out.package_name = package_name;
+                continue;
+            }
+
+            switch (attributeId(attr_name)) {
+                case ATTR_NAME:
+                    name = attributeValue(attr);
+                    break;
+                case ATTR_TARGET_ACTIVITY:
+                    target = attributeValue(attr);
+                    break;
+                case ATTR_VERSION_CODE:
+                    if (element == TagManifest) {
+                        out.version_code = read32(attr + 16);
+                    }
+                    break;
+                case ATTR_VERSION_NAME:
+                    if (element == TagManifest) {
+                        out.version_name = attributeValue(attr);
+                    }
+                    break;
+                case ATTR_MIN_SDK_VERSION:
+                    if (element == TagUsesSdk) {
+                        out.min_sdk = attributeValue(attr);
+                    }
+                    break;
+                case ATTR_TARGET_SDK_VERSION:
+                    if (element == TagUsesSdk) {
+                        out.target_sdk = attributeValue(attr);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        switch (element) {
+            case TagUsesPermission:
+                if (!name.empty()) {
+                    out.permissions.push_back(name);
+                }
+                break;
+            case TagActivity:
+            case TagActivityAlias:
+                // Для alias запускается целевая активность
+                current_activity = element == TagActivityAlias && !target.empty() ? target : name;
+                activity_depth = depth;
+                break;
+            case TagIntentFilter:
+                if (activity_depth >= 0) {
+                    filter_depth = depth;
+                    filter_main = false;
+                    filter_launcher = false;
+                }
+                break;
+            case TagAction:
+                filter_main |= filter_depth >= 0 && name == ACTION_MAIN;
+                break;
+            case TagCategory:
+                filter_launcher |= filter_depth >= 0 && name == CATEGORY_LAUNCHER;
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+
+    void endElement(ManifestInfo& out) {
+        if (depth == filter_depth) {
+            if (filter_main && filter_launcher && out.main_activity.empty()) {
+                out.main_activity = className(current_activity);
+            }
+            filter_depth = -1;
+        } else if (depth == activity_depth) {
+            activity_depth = -1;
+            current_activity = {};
+        }
+        --depth;
+    }
+
+    void resetState() {
+        string_offsets = strings = pool_end = nullptr;
+        string_count = 0;
+        resource_ids = nullptr;
+        resource_count = 0;
+        package_name = current_activity = {};
+        activity_depth = filter_depth = -1;
+        filter_main = filter_launcher = false;
+        depth = 0;
+        arena.reset();
+    }
+
+public:
+    bool parse(const uint8_t* manifest, size_t manifest_size, ManifestInfo& out) {
+        data = manifest;
+        size = manifest_size;
+        resetState();
+
+        // Вектор разрешений очищаем, но сохраняем его емкость
+        out.package_name = out.version_name = {};
+        out.min_sdk = out.target_sdk = out.main_activity = {};
+        out.version_code = 0;
+        out.permissions.clear();
+
+        if (size < CHUNK_HEADER_SIZE || read16(data) != RES_XML_TYPE) {
+            return fail("Not a binary XML manifest");
+        }
+
+        uint16_t root_header = read16(data + 2);
+        uint32_t root_size = read32(data + 4);
+        if (root_header < CHUNK_HEADER_SIZE || root_size > size) {
+            return fail("Corrupted binary XML header");
+        }
+
+        const uint8_t* end = data + root_size;
+        const uint8_t* chunk = data + root_header;
+        while (chunk + CHUNK_HEADER_SIZE <= end) {
+            uint16_t type = read16(chunk);
+            uint16_t header_size = read16(chunk + 2);
+            uint32_t chunk_size = read32(chunk + 4);
+            if (chunk_size < CHUNK_HEADER_SIZE || header_size > chunk_size ||
+                chunk_size > static_cast<size_t>(end - chunk)) {
+                return fail("Corrupted binary XML chunk");
+            }
+
+            switch (type) {
+                case RES_STRING_POOL_TYPE:
+                    if (!strings && !parseStringPool(chunk, header_size, chunk_size)) {
+                        return false;
+                    }
+                    break;
+                case RES_XML_RESOURCE_MAP_TYPE:
+                    resource_ids = chunk + header_size;
+                    resource_count = (chunk_size - header_size) / 4;
+                    break;
+                case RES_XML_START_ELEMENT_TYPE:
+                    if (!strings) {
+                        return fail("XML element before string pool");
+                    }
+                    if (!startElement(chunk, header_size, chunk_size, out)) {
+                        return false;
+                    }
+                    break;
+                case RES_XML_END_ELEMENT_TYPE:
+                    endElement(out);
+                    break;
+                default:
+                    // Пространства имен, CDATA и прочее не нужны
+                    break;
+            }
+            chunk += chunk_size;
+        }
+
+        if (out.package_name.empty()) {
+            return fail("Manifest has no package name");
+        }
+
+        // Значения по умолчанию, как у PackageParser
+        if (out.min_sdk.empty()) {
+            out.min_sdk = "1";
+        }
+        if (out.target_sdk.empty()) {
+            out.target_sdk = out.min_sdk;
+        }
+        return true;
+    }
+
+    const std::string& lastError() const {
+        return last_error;
+    }
+};
+
+ManifestParser::ManifestParser() : impl(new Impl()) {}
+ManifestParser::~ManifestParser() = default;
+
+bool ManifestParser::parse(const uint8_t* data, size_t size, ManifestInfo& out) {
+    return impl->parse(data, size, out);
+}
+
+const std::string& ManifestParser::lastError() const {
+    return impl->lastError();
+}
+
+} // namespace anexec
@@ -0,0 +1,56 @@
+#ifndef ANEXEC_MANIFEST_PARSER_H
+#define ANEXEC_MANIFEST_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace anexec {
+
+/**
+ * @brief Сведения из AndroidManifest.xml
+ *
+ * Строки указывают либо прямо в данные манифеста (UTF-8 пул строк),
+ * либо в арену парсера. Действительны, пока жив парсер и данные
+ * манифеста, и до следующего вызова parse().
+ */
+struct ManifestInfo {
+    std::string_view package_name;
+    std::string_view version_name;
+    uint32_t version_code{0};
+    std::string_view min_sdk;
+    std::string_view target_sdk;
+    std::string_view main_activity;      // Полное имя класса
+    std::vector<std::string_view> permissions;
+};
+
+/**
+ * @brief Однопроходный парсер бинарного XML (AXML) манифеста
+ *
+ * Читает пул строк и поток чанков за один проход прямо из отображения
+ * записи ZIP. Строки декодируются только для нужных атрибутов, узлы не
+ * создаются, неинтересные чанки и элементы пропускаются по размеру.
+ * Парсер можно переиспользовать: после первого манифеста память не выделяется.
+ */
+class ManifestParser {
+public:
+    ManifestParser();
+    ~ManifestParser();
+
+    // Запрещаем копирование
+    ManifestParser(const ManifestParser&) = delete;
+    ManifestParser& operator=(const ManifestParser&) = delete;
+
+    bool parse(const uint8_t* data, size_t size, ManifestInfo& out);
+    const std::string& lastError() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_MANIFEST_PARSER_H
@@ -0,0 +1,270 @@
+#include "permissions.h"
+#include "../core/hash.h"
+#include <array>
+#include <atomic>
+#include <mutex>
+
+namespace anexec {
+
+namespace {
+
+// Разрешения платформы; номер - позиция в таблице
+constexpr std::string_view FRAMEWORK_PERMISSIONS[] = {
+    "android.permission.ACCESS_BACKGROUND_LOCATION",
+    "android.permission.ACCESS_COARSE_LOCATION",
+    "android.permission.ACCESS_FINE_LOCATION",
+    "android.permission.ACCESS_MEDIA_LOCATION",
+    "android.permission.ACCESS_NETWORK_STATE",
+    "android.permission.ACCESS_NOTIFICATION_POLICY",
+    "android.permission.ACCESS_WIFI_STATE",
+    "android.permission.ACTIVITY_RECOGNITION",
+    "android.permission.ANSWER_PHONE_CALLS",
+    "android.permission.BLUETOOTH",
+    "android.permission.BLUETOOTH_ADMIN",
+    "android.permission.BLUETOOTH_ADVERTISE",
+    "android.permission.BLUETOOTH_CONNECT",
+    "android.permission.BLUETOOTH_SCAN",
+    "android.permission.BODY_SENSORS",
+    "android.permission.BODY_SENSORS_BACKGROUND",
+    "android.permission.BROADCAST_STICKY",
+    "android.permission.CALL_PHONE",
+    "android.permission.CAMERA",
+    "android.permission.CHANGE_NETWORK_STATE",
+    "android.permission.CHANGE_WIFI_MULTICAST_STATE",
+    "android.permission.CHANGE_WIFI_STATE",
+    "android.permission.DISABLE_KEYGUARD",
+    "android.permission.EXPAND_STATUS_BAR",
+    "android.permission.FOREGROUND_SERVICE",
+    "android.permission.GET_ACCOUNTS",
+    "android.permission.GET_PACKAGE_SIZE",
+    "android.permission.INTERNET",
+    "android.permission.KILL_BACKGROUND_PROCESSES",
+    "android.permission.MANAGE_EXTERNAL_STORAGE",
+    "android.permission.MANAGE_OWN_CALLS",
+    "android.permission.MODIFY_AUDIO_SETTINGS",
+    "android.permission.NEARBY_WIFI_DEVICES",
+    "android.permission.NFC",
+    "android.permission.POST_NOTIFICATIONS",
+    "android.permission.QUERY_ALL_PACKAGES",
+    "android.permission.READ_CALENDAR",
+    "android.permission.READ_CALL_LOG",
+    "android.permission.READ_CONTACTS",
+    "android.permission.READ_EXTERNAL_STORAGE",
+    "android.permission.READ_MEDIA_AUDIO",
+    "android.permission.READ_MEDIA_IMAGES",
+    "android.permission.READ_MEDIA_VIDEO",
+    "android.permission.READ_PHONE_NUMBERS",
+    "android.permission.READ_PHONE_STATE",
+    "android.permission.READ_SMS",
+    "android.permission.READ_SYNC_SETTINGS",
+    "android.permission.READ_SYNC_STATS",
+    "android.permission.RECEIVE_BOOT_COMPLETED",
+    "android.permission.RECEIVE_MMS",
+    "android.permission.RECEIVE_SMS",
+    "android.permission.RECEIVE_WAP_PUSH",
+    "android.permission.RECORD_AUDIO",
+    "android.permission.REORDER_TASKS",
+    "android.permission.REQUEST_DELETE_PACKAGES",
+    "android.permission.REQUEST_IGNORE_BATTERY_OPTIMIZATIONS",
+    "android.permission.REQUEST_INSTALL_PACKAGES",
+    "android.permission.SCHEDULE_EXACT_ALARM",
+    "android.permission.SEND_SMS",
+    "android.permission.SET_WALLPAPER",
+    "android.permission.SET_WALLPAPER_HINTS",
+    "android.permission.SYSTEM_ALERT_WINDOW",
+    "android.permission.TRANSMIT_IR",
+    "android.permission.USE_BIOMETRIC",
+    "android.permission.USE_EXACT_ALARM",
+    "android.permission.USE_FINGERPRINT",
+    "android.permission.USE_FULL_SCREEN_INTENT",
+    "android.permission.USE_SIP",
+    "android.permission.UWB_RANGING",
+    "android.permission.VIBRATE",
+    "android.permission.WAKE_LOCK",
+    "android.permission.WRITE_CALENDAR",
+    "android.permission.WRITE_CALL_LOG",
+    "android.permission.WRITE_CONTACTS",
+    "android.permission.WRITE_EXTERNAL_STORAGE",
+    "android.permission.WRITE_SETTINGS",
+    "android.permission.WRITE_SYNC_SETTINGS",
+    "com.android.alarm.permission.SET_ALARM",
+    "com.android.launcher.permission.INSTALL_SHORTCUT",
+    "com.android.voicemail.permission.ADD_VOICEMAIL",
+    "com.google.android.c2dm.permission.RECEIVE",
+    "com.google.android.gms.permission.AD_ID"
+};
+
+constexpr size_t FRAMEWORK_COUNT = sizeof(FRAMEWORK_PERMISSIONS) / sizeof(FRAMEWORK_PERMISSIONS[0]);
+static_assert(FRAMEWORK_COUNT < MAX_PERMISSIONS, "PermissionSet too small for framework permissions");
+
+// Индекс строится при компиляции: открытая адресация, заполнен на треть
+constexpr size_t INDEX_SIZE = 256;
+static_assert(FRAMEWORK_COUNT * 3 <= INDEX_SIZE, "framework permission index too small");
+
+constexpr std::array<PermissionId, INDEX_SIZE> buildIndex() {
+    std::array<PermissionId, INDEX_SIZE> index{};
+    for (auto& slot : index) {
+        slot = INVALID_PERMISSION;
+    }
+    for (size_t id = 0; id < FRAMEWORK_COUNT; ++id) {
+        size_t i = fnv1a(FRAMEWORK_PERMISSIONS[id]) & (INDEX_SIZE - 1);
+        while (index[i] != INVALID_PERMISSION) {
+            i = (i + 1) & (INDEX_SIZE - 1);
+        }
+        index[i] = static_cast<PermissionId>(id);
+    }
+    return index;
+}
+
+constexpr std::array<PermissionId, INDEX_SIZE> FRAMEWORK_INDEX = buildIndex();
+
+PermissionId findFramework(std::string_view name) {
+    for (size_t i = fnv1a(name) & (INDEX_SIZE - 1);; i = (i + 1) & (INDEX_SIZE - 1)) {
+        const PermissionId id = FRAMEWORK_INDEX[i];
+        if (id == INVALID_PERMISSION || FRAMEWORK_PERMISSIONS[id] == name) {
+            return id;
+        }
+    }
+}
+
+// Разрешения приложений. Регистрация под мьютексом, поиск без блокировок:
+// имя записывается в свою ячейку до публикации номера в индексе и
+// больше не меняется. Индекс - открытая адресация, заполнен не больше чем
+// наполовину.
+constexpr size_t CUSTOM_CAPACITY = MAX_PERMISSIONS - FRAMEWORK_COUNT;
+constexpr size_t CUSTOM_INDEX_SIZE = 2 * MAX_PERMISSIONS;
+static_assert((CUSTOM_INDEX_SIZE & (CUSTOM_INDEX_SIZE - 1)) == 0, "index size must be a power of two");
+
+struct CustomPermissions {
+    std::mutex mutex;
+    std::string names[CUSTOM_CAPACITY];     // Номер - FRAMEWORK_COUNT + позиция
+    std::atomic<size_t> count{0};           // Опубликовано имен
+    std::atomic<PermissionId> index[CUSTOM_INDEX_SIZE];
+
+    CustomPermissions() {
+        for (auto& slot : index) {
+            slot.store(INVALID_PERMISSION, std::memory_order_relaxed);
+        }
+    }
+
+    // Ячейка индекса с этим именем или первая пустая на его пути
+    size_t probe(std::string_view name, PermissionId& id) const {
+        for (size_t i = fnv1a(name) & (CUSTOM_INDEX_SIZE - 1);; i = (i + 1) & (CUSTOM_INDEX_SIZE - 1)) {
+            id = index[i].load(std::memory_order_acquire);
+            if (id == INVALID_PERMISSION || names[id - FRAMEWORK_COUNT] == name) {
+                return i;
+            }
+        }
+    }
+
+    PermissionId find(std::string_view name) const {
+        PermissionId id = INVALID_PERMISSION;
+        probe(name, id);
+        return id;
+    }
+
+    PermissionId add(std::string_view name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        PermissionId id = INVALID_PERMISSION;
+        const size_t slot = probe(name, id);
+        const size_t position = count.load(std::memory_order_relaxed);
+        if (id != INVALID_PERMISSION || position == CUSTOM_CAPACITY) {
+            return id;
+        }
+        names[position] = name;
+        id = static_cast<PermissionId>(FRAMEWORK_COUNT + position);
+        count.store(position + 1, std::memory_order_release);
+        index[slot].store(id, std::memory_order_release);
+        return id;
+    }
+};
+
+CustomPermissions& customPermissions() {
+    static CustomPermissions custom;
+    return custom;
+}
+
+} // namespace
+
+PermissionId permissionId(std::string_view name) {
+    const PermissionId id = findFramework(name);
+    if (id != INVALID_PERMISSION || name.empty()) {
+        return id;
+    }
+
+    CustomPermissions& custom = customPermissions();
+    const PermissionId existing = custom.find(name);
+    return existing != INVALID_PERMISSION ? existing : custom.add(name);
+}
+
+PermissionId findPermission(std::string_view name) {
+    const PermissionId id = findFramework(name);
+    if (id != INVALID_PERMISSION || name.empty()) {
+        return id;
+    }
+    return customPermissions().find(name);
+}
+
+std::string_view permissionName(PermissionId id) {
+    if (id < FRAMEWORK_COUNT) {
+        return FRAMEWORK_PERMISSIONS[id];
+    }
+    const CustomPermissions& custom = customPermissions();
+    const size_t index = static_cast<size_t>(id) - FRAMEWORK_COUNT;
+    // Опубликованное имя больше не меняется
+    return index < custom.count.load(std::memory_order_acquire) ? std::string_view(custom.names[index])
+                                                                : std::string_view();
+}
+
+PermissionSet::PermissionSet(const PermissionSet& other) {
+    *this = other;
+}
+
+PermissionSet& PermissionSet::operator=(const PermissionSet& other) {
+    for (size_t i = 0; i < WORDS; ++i) {
+        words[i].store(other.words[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    return *this;
+}
+
+bool PermissionSet::grant(PermissionId id) {
+    if (id >= MAX_PERMISSIONS) {
+        return false;
+    }
+    words[id / 64].fetch_or(uint64_t{1} << (id % 64), std::memory_order_relaxed);
+    return true;
+}
+
+void PermissionSet::revoke(PermissionId id) {
+    if (id < MAX_PERMISSIONS) {
+        words[id / 64].fetch_and(~(uint64_t{1} << (id % 64)), std::memory_order_relaxed);
+    }
+}
+
+void PermissionSet::clear() {
+    for (auto& word : words) {
+        word.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t PermissionSet::count() const {
+    size_t total = 0;
+    for (const auto& word : words) {
+        for (uint64_t bits = word.load(std::memory_order_relaxed); bits; bits &= bits - 1) {
+            ++total;
+        }
+    }
+    return total;
+}
+
+std::vector<std::string> PermissionSet::names() const {
+    std::vector<std::string> result;
+    for (size_t id = 0; id < MAX_PERMISSIONS; ++id) {
+        if (has(static_cast<PermissionId>(id))) {
+            result.emplace_back(permissionName(static_cast<PermissionId>(id)));
+        }
+    }
+    return result;
+}
+
+} // namespace anexec
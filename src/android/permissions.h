@@ -0,0 +1,66 @@
+#ifndef ANEXEC_PERMISSIONS_H
+#define ANEXEC_PERMISSIONS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace anexec {
+
+// Плотный номер разрешения. Разрешения платформы (android.permission.*)
+// получают номера из постоянной таблицы, прочие (объявленные приложениями)
+// - по первому обращению, пока есть место в наборе. Номера общие для
+// процесса: наборы разных приложений сравнимы. Места хватает на сотни
+// разрешений приложений; когда оно кончается, регистрация возвращает
+// INVALID_PERMISSION, а grant() - false.
+using PermissionId = uint16_t;
+constexpr PermissionId INVALID_PERMISSION = 0xFFFF;
+constexpr size_t MAX_PERMISSIONS = 1024;
+
+// Номер разрешения или INVALID_PERMISSION. Уже известное имя находится
+// без блокировок и без выделения памяти; новое имя приложения регистрируется.
+PermissionId permissionId(std::string_view name);
+
+// Номер, только если разрешение уже известно (ничего не регистрирует).
+// Без блокировок: хеш-таблица для любых имен.
+PermissionId findPermission(std::string_view name);
+
+// Имя по номеру; пустая строка для неизвестного номера
+std::string_view permissionName(PermissionId id);
+
+// Набор разрешений приложения: битовая маска, проверка за O(1).
+// has() можно вызывать из любых потоков одновременно с grant()/revoke().
+class PermissionSet {
+public:
+    PermissionSet() = default;
+    PermissionSet(const PermissionSet& other);
+    PermissionSet& operator=(const PermissionSet& other);
+
+    bool has(PermissionId id) const {
+        return id < MAX_PERMISSIONS &&
+               (words[id / 64].load(std::memory_order_relaxed) >> (id % 64) & 1) != 0;
+    }
+    bool has(std::string_view name) const { return has(findPermission(name)); }
+
+    // false - разрешений больше, чем помещается в набор
+    bool grant(PermissionId id);
+    bool grant(std::string_view name) { return grant(permissionId(name)); }
+    void revoke(PermissionId id);
+    void revoke(std::string_view name) { revoke(findPermission(name)); }
+    void clear();
+
+    size_t count() const;
+    std::vector<std::string> names() const;
+
+private:
+    static constexpr size_t WORDS = MAX_PERMISSIONS / 64;
+
+    std::atomic<uint64_t> words[WORDS] = {};
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_PERMISSIONS_H
@@ -0,0 +1,687 @@
+#include "aot_image.h"
+#include "apk_archive.h"
+#include "apk_image.h"
+#include "class_linker.h"
+#include "dex_instructions.h"
+#include "heap.h"
+#include "interpreter.h"
+#include "jit.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace anexec {
+
+namespace {
+
+constexpr char IMAGE_MAGIC[8] = {'A', 'N', 'X', 'O', 'A', 'T', '0', '1'};
+constexpr uint32_t IMAGE_VERSION = 1;
+
+// Набор команд машинного кода в образе
+constexpr uint32_t ISA_NONE = 0;
+constexpr uint32_t ISA_X86_64 = 1;
+
+// Куча для инициализации классов при сборке
+constexpr size_t BUILD_HEAP_SIZE = 256 * 1024 * 1024;
+
+// Раскладка: заголовок и таблицы, имена DEX, DEX по страницам, затем
+// данные методов и в конце секция кода, тоже по страницам.
+// Таблицы классов и методов отсортированы для двоичного поиска.
+struct ImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t isa;
+    uint32_t dex_count;
+    uint32_t boot_dex_count;    // Первые DEX - платформа, остальные - приложение
+    uint32_t class_count;
+    uint32_t method_count;
+    uint64_t dex_table_off;
+    uint64_t class_table_off;
+    uint64_t method_table_off;
+    uint64_t index_off;         // ClassIndex::serialize() всех DEX
+    uint64_t index_size;
+    uint64_t code_off;
+    uint64_t code_size;
+    uint64_t file_size;
+};
+
+struct DexRecord {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t checksum;
+    uint32_t name_off;
+    uint32_t name_size;
+    uint32_t reserved;
+};
+
+struct ClassRecord {
+    uint32_t dex;
+    uint32_t class_def;
+    uint32_t statics_count;
+    uint32_t reserved;
+    uint64_t statics_off;
+};
+
+struct DexBlob {
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+uint64_t pageSize() {
+    return static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+uint32_t hostIsa() {
+    return Jit::isSupported() ? ISA_X86_64 : ISA_NONE;
+}
+
+// Данные с выравниванием в конец буфера; возвращает их смещение
+uint64_t append(std::vector<uint8_t>& out, const void* data, size_t size, uint64_t alignment) {
+    out.resize(alignUp(out.size(), alignment));
+    const uint64_t offset = out.size();
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+    return offset;
+}
+
+bool writeAt(int fd, const void* buf, size_t size, uint64_t offset) {
+    const auto* in = static_cast<const uint8_t*>(buf);
+    while (size > 0) {
+        ssize_t n = pwrite(fd, in, size, static_cast<off_t>(offset));
+        if (n <= 0) {
+            return false;
+        }
+        in += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+// classes.dex, classes2.dex, ... до первого пропуска, как и у APK.
+// Архив без DEX (ресурсы платформы) не ошибка.
+bool readDexFiles(const std::string& path, std::vector<DexBlob>& out, std::string& error) {
+    ApkArchive archive;
+    if (!archive.open(path)) {
+        error = path + ": " + archive.lastError();
+        return false;
+    }
+    for (int i = 1;; ++i) {
+        const std::string name = i == 1 ? "classes.dex" : "classes" + std::to_string(i) + ".dex";
+        const ZipEntry* entry = archive.find(name);
+        if (!entry) {
+            return true;
+        }
+        DexBlob blob;
+        blob.name = path + "!" + name;
+        if (!archive.inflate(*entry, blob.data)) {
+            error = blob.name + ": failed to extract";
+            return false;
+        }
+        if (!DexView(blob.data.data(), blob.data.size()).valid()) {
+            error = blob.name + ": malformed DEX";
+            return false;
+        }
+        out.push_back(std::move(blob));
+    }
+}
+
+const Method* findInitializer(const Class* klass) {
+    for (const Method& method : klass->methods) {
+        if (method.isStatic() && method.name == "<clinit>") {
+            return &method;
+        }
+    }
+    return nullptr;
+}
+
+bool declaresStatic(const Class* klass, std::string_view name) {
+    for (const Field& field : klass->fields) {
+        if (field.is_static && field.name == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// <clinit> без побочных эффектов вне своего класса: константы, арифметика,
+// переходы и примитивные статические поля, объявленные в самом классе.
+// Без вызовов и выделений, поэтому результат не зависит от процесса и его
+// можно получить при сборке.
+bool isPureInitializer(const Class* klass, const Method& clinit, const DexView& dex) {
+    const uint32_t class_idx = dex.classDef(klass->class_def).class_idx;
+    const uint16_t* insns = DexView::insns(clinit.code);
+    const uint32_t size = clinit.insns_size;
+    for (uint32_t pc = 0; pc < size;) {
+        const uint8_t opcode = insns[pc] & 0xff;
+        const uint32_t width = opcode == OP_NOP ? payloadWidth(insns + pc) : INSTRUCTION_WIDTH[opcode];
+        if (width == 0 || pc + width > size) {
+            return false;
+        }
+        const bool allowed = opcode == OP_NOP ||
+                             (opcode >= 0x01 && opcode <= 0x09) ||     // move*
+                             (opcode >= 0x0e && opcode <= 0x19) ||     // return*, const*
+                             (opcode >= 0x28 && opcode <= 0x3d) ||     // goto, switch, cmp, if
+                             (opcode >= 0x7b && opcode <= 0xe2);       // унарные и бинарные операции
+        if (!allowed) {
+            // sget/sput, кроме -object
+            if (opcode < 0x60 || opcode > 0x6d || opcode == 0x62 || opcode == 0x69) {
+                return false;
+            }
+            const DexFieldId id = dex.fieldId(insns[pc + 1]);
+            if (id.class_idx != class_idx || !declaresStatic(klass, dex.string(id.name_idx))) {
+                return false;
+            }
+        }
+        pc += width;
+    }
+    return true;
+}
+
+// Класс и все его предки с кодом инициализируются чисто: тогда при сборке
+// не выполняется ничего, что меняет чужие статические поля
+bool canPreinitialize(const Class* klass, const ClassIndex& index) {
+    for (; klass && !klass->stub && klass->dex != DEX_NO_INDEX; klass = klass->super) {
+        if (klass->state == Class::State::Error) {
+            return false;
+        }
+        const Method* clinit = findInitializer(klass);
+        if (clinit && (!clinit->code || !isPureInitializer(klass, *clinit, index.dex(klass->dex)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool hasReferenceStatics(Class* klass) {
+    for (const Field& field : klass->fields) {
+        if (field.is_static && (field.type[0] == 'L' || field.type[0] == '[') &&
+            *reinterpret_cast<const ObjectRef*>(klass->staticData() + field.offset) != NULL_REF) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+struct AotImage::MethodRecord {
+    uint32_t dex;
+    uint32_t method_idx;
+    uint32_t insns_size;        // В 16-битных словах
+    uint32_t code_size;         // 0 - машинного кода нет
+    uint32_t call_site_count;
+    uint32_t field_site_count;
+    uint64_t insns_off;         // 0 - код DEX не менялся
+    uint64_t code_off;          // От начала секции кода
+    uint64_t native_offsets_off;    // insns_size записей, см. JitCode
+    uint64_t sites_off;         // Инструкции мест: сначала вызовы, затем поля
+};
+
+AotImage::~AotImage() = default;
+
+std::vector<std::string> AotImage::bootClassPath(const std::string& framework_dir) {
+    std::vector<std::string> jars;
+    if (const char* env = std::getenv("BOOTCLASSPATH")) {
+        std::string_view rest(env);
+        while (!rest.empty()) {
+            const size_t colon = rest.find(':');
+            const std::string_view jar = rest.substr(0, colon);
+            if (!jar.empty()) {
+                jars.emplace_back(jar);
+            }
+            rest = colon == std::string_view::npos ? std::string_view() : rest.substr(colon + 1);
+        }
+        return jars;
+    }
+
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(framework_dir, ec)) {
+        if (entry.is_regular_file(ec) && entry.path().extension() == ".jar") {
+            jars.push_back(entry.path().string());
+        }
+    }
+    std::sort(jars.begin(), jars.end());
+    return jars;
+}
+
+bool AotImage::build(const std::vector<std::string>& boot_jars, const std::string& apk_path,
+                     const std::string& output, AotBuildStats* stats, std::string& error) {
+    std::vector<DexBlob> blobs;
+    for (const std::string& jar : boot_jars) {
+        if (!readDexFiles(jar, blobs, error)) {
+            return false;
+        }
+    }
+    const size_t boot_count = blobs.size();
+    if (!apk_path.empty()) {
+        if (!readDexFiles(apk_path, blobs, error)) {
+            return false;
+        }
+        if (blobs.size() == boot_count) {
+            error = apk_path + ": no classes.dex";
+            return false;
+        }
+    }
+    if (blobs.empty()) {
+        error = "No DEX files to compile";
+        return false;
+    }
+
+    // Классы загружаются и инициализируются тем же линкером и
+    // интерпретатором, что и при запуске: смещения полей и слоты vtable
+    // в ускоренном коде совпадут
+    auto apk = std::make_shared<ApkImage>();
+    for (const DexBlob& blob : blobs) {
+        apk->dex_files.emplace_back(blob.name, nullptr, blob.data.data(), blob.data.size(), false);
+    }
+    if (!apk->class_index.build(apk->dex_files)) {
+        error = "Failed to index classes: malformed DEX";
+        return false;
+    }
+
+    Heap heap;
+    if (!heap.reserve(BUILD_HEAP_SIZE)) {
+        error = "Failed to reserve heap";
+        return false;
+    }
+    ClassLinker linker(heap);
+    linker.attachImage(apk);
+    Interpreter interpreter(linker);
+
+    // Каждый класс один раз: при повторе в нескольких DEX - из того, что выбрал индекс
+    std::vector<Class*> loaded;
+    for (uint32_t d = 0; d < blobs.size(); ++d) {
+        const DexView& dex = apk->class_index.dex(d);
+        for (uint32_t c = 0; c < dex.classDefCount(); ++c) {
+            const std::string_view descriptor = dex.typeDescriptor(dex.classDef(c).class_idx);
+            const ClassRef ref = apk->class_index.find(descriptor);
+            if (ref.dex != d || ref.class_def != c) {
+                continue;
+            }
+            if (Class* klass = linker.findClass(descriptor)) {
+                loaded.push_back(klass);
+            }
+        }
+    }
+
+    for (Class* klass : loaded) {
+        if (klass->state == Class::State::Loaded && canPreinitialize(klass, apk->class_index) &&
+            !interpreter.ensureInitialized(klass)) {
+            interpreter.clearException();
+        }
+    }
+
+    struct PendingClass {
+        ClassRecord record;
+        const std::vector<uint64_t>* statics;
+    };
+    struct PendingMethod {
+        MethodRecord record;
+        const Method* method;
+        std::vector<uint8_t> code;
+        std::vector<uint32_t> native_offsets;
+        std::vector<uint32_t> sites;
+    };
+    std::vector<PendingClass> pending_classes;
+    std::vector<PendingMethod> pending_methods;
+    AotBuildStats result{};
+
+    for (Class* klass : loaded) {
+        if (klass->state == Class::State::Initialized && !hasReferenceStatics(klass) &&
+            (!klass->statics.empty() || findInitializer(klass))) {
+            PendingClass pending{};
+            pending.record.dex = klass->dex;
+            pending.record.class_def = klass->class_def;
+            pending.record.statics_count = static_cast<uint32_t>(klass->statics.size());
+            pending.statics = &klass->statics;
+            pending_classes.push_back(pending);
+        }
+
+        for (Method& method : klass->methods) {
+            if (!method.code) {
+                continue;
+            }
+            // Отвергнутый проверкой код в образ не попадает
+            if (!interpreter.prepare(&method)) {
+                continue;
+            }
+
+            PendingMethod pending{};
+            pending.record.dex = klass->dex;
+            pending.record.method_idx = method.method_idx;
+            pending.record.insns_size = method.insns_size;
+            pending.method = &method;
+            if (method.insns != DexView::insns(method.code)) {
+                ++result.quickened_methods;
+            }
+
+            JitCode compiled;
+            if (Jit::isSupported() && Jit::compile(&method, pending.code, compiled)) {
+                pending.record.code_size = static_cast<uint32_t>(pending.code.size());
+                pending.record.call_site_count = static_cast<uint32_t>(compiled.call_sites.size());
+                pending.record.field_site_count = static_cast<uint32_t>(compiled.field_sites.size());
+                pending.native_offsets = std::move(compiled.native_offsets);
+                for (const JitCallSite& site : compiled.call_sites) {
+                    pending.sites.push_back(static_cast<uint32_t>(site.insn - method.insns));
+                }
+                for (const JitFieldSite& site : compiled.field_sites) {
+                    pending.sites.push_back(static_cast<uint32_t>(site.insn - method.insns));
+                }
+                ++result.compiled_methods;
+            } else {
+                pending.code.clear();
+            }
+            pending_methods.push_back(std::move(pending));
+        }
+    }
+
+    std::sort(pending_classes.begin(), pending_classes.end(), [](const auto& a, const auto& b) {
+        return a.record.dex != b.record.dex ? a.record.dex < b.record.dex : a.record.class_def < b.record.class_def;
+    });
+    std::sort(pending_methods.begin(), pending_methods.end(), [](const auto& a, const auto& b) {
+        return a.record.dex != b.record.dex ? a.record.dex < b.record.dex : a.record.method_idx < b.record.method_idx;
+    });
+
+    // Таблицы заполняются после данных, место под них резервируется сразу
+    const uint64_t page_size = pageSize();
+    ImageHeader header{};
+    std::memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+    header.version = IMAGE_VERSION;
+    header.isa = hostIsa();
+    header.dex_count = static_cast<uint32_t>(blobs.size());
+    header.boot_dex_count = static_cast<uint32_t>(boot_count);
+    header.class_count = static_cast<uint32_t>(pending_classes.size());
+    header.method_count = static_cast<uint32_t>(pending_methods.size());
+
+    std::vector<uint8_t> out(sizeof(ImageHeader));
+    std::vector<DexRecord> dex_records(blobs.size());
+    std::vector<ClassRecord> class_records(pending_classes.size());
+    std::vector<MethodRecord> method_records(pending_methods.size());
+    header.dex_table_off = append(out, dex_records.data(), dex_records.size() * sizeof(DexRecord), 8);
+    header.class_table_off = append(out, class_records.data(), class_records.size() * sizeof(ClassRecord), 8);
+    header.method_table_off = append(out, method_records.data(), method_records.size() * sizeof(MethodRecord), 8);
+
+    for (size_t i = 0; i < blobs.size(); ++i) {
+        dex_records[i].name_off = static_cast<uint32_t>(append(out, blobs[i].name.data(), blobs[i].name.size(), 1));
+        dex_records[i].name_size = static_cast<uint32_t>(blobs[i].name.size());
+    }
+    for (size_t i = 0; i < blobs.size(); ++i) {
+        dex_records[i].offset = append(out, blobs[i].data.data(), blobs[i].data.size(), page_size);
+        dex_records[i].size = blobs[i].data.size();
+        dex_records[i].checksum = apk->class_index.dex(static_cast<uint32_t>(i)).checksum();
+    }
+
+    const std::vector<uint8_t> index = apk->class_index.serialize();
+    header.index_off = append(out, index.data(), index.size(), 8);
+    header.index_size = index.size();
+
+    for (size_t i = 0; i < pending_classes.size(); ++i) {
+        class_records[i] = pending_classes[i].record;
+        const std::vector<uint64_t>& statics = *pending_classes[i].statics;
+        class_records[i].statics_off = append(out, statics.data(), statics.size() * sizeof(uint64_t), 8);
+    }
+    for (size_t i = 0; i < pending_methods.size(); ++i) {
+        PendingMethod& pending = pending_methods[i];
+        MethodRecord& record = method_records[i];
+        record = pending.record;
+        const Method* method = pending.method;
+        if (method->insns != DexView::insns(method->code)) {
+            record.insns_off = append(out, method->insns, size_t{method->insns_size} * sizeof(uint16_t), 4);
+        }
+        if (record.code_size != 0) {
+            record.native_offsets_off = append(out, pending.native_offsets.data(),
+                                               pending.native_offsets.size() * sizeof(uint32_t), 4);
+            record.sites_off = append(out, pending.sites.data(), pending.sites.size() * sizeof(uint32_t), 4);
+        }
+    }
+
+    // Код одной областью: при открытии она получает PROT_EXEC
+    out.resize(alignUp(out.size(), page_size));
+    header.code_off = out.size();
+    for (size_t i = 0; i < pending_methods.size(); ++i) {
+        const std::vector<uint8_t>& code = pending_methods[i].code;
+        if (!code.empty()) {
+            method_records[i].code_off = append(out, code.data(), code.size(), 16) - header.code_off;
+            result.code_bytes += code.size();
+        }
+    }
+    header.code_size = out.size() - header.code_off;
+    out.resize(alignUp(out.size(), page_size));
+    header.file_size = out.size();
+
+    std::memcpy(out.data(), &header, sizeof(header));
+    std::memcpy(out.data() + header.dex_table_off, dex_records.data(), dex_records.size() * sizeof(DexRecord));
+    std::memcpy(out.data() + header.class_table_off, class_records.data(),
+                class_records.size() * sizeof(ClassRecord));
+    std::memcpy(out.data() + header.method_table_off, method_records.data(),
+                method_records.size() * sizeof(MethodRecord));
+
+    // Пишем во временный файл и переименовываем: запущенные процессы
+    // продолжают работать со старым отображением
+    const std::string tmp_path = output + ".tmp." + std::to_string(getpid());
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = "Failed to create " + tmp_path;
+        return false;
+    }
+    bool ok = writeAt(fd, out.data(), out.size(), 0);
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || rename(tmp_path.c_str(), output.c_str()) != 0) {
+        unlink(tmp_path.c_str());
+        error = "Failed to write " + output;
+        return false;
+    }
+
+    if (stats) {
+        result.dex_files = blobs.size();
+        result.boot_dex_files = boot_count;
+        result.classes = loaded.size();
+        result.preinitialized_classes = pending_classes.size();
+        result.methods = pending_methods.size();
+        result.file_size = out.size();
+        *stats = result;
+    }
+    return true;
+}
+
+std::shared_ptr<const AotImage> AotImage::open(const std::string& path, std::string& error) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "Failed to open " + path;
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ImageHeader)) {
+        ::close(fd);
+        error = path + ": not an AOT image";
+        return nullptr;
+    }
+    const size_t file_size = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        error = "Failed to map " + path;
+        return nullptr;
+    }
+
+    std::shared_ptr<AotImage> image(new AotImage());
+    image->path_ = path;
+    image->region = std::make_shared<const MappedRegion>(base, file_size);
+    const uint8_t* data = image->region->data();
+
+    ImageHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    const auto fits = [file_size](uint64_t offset, uint64_t bytes) {
+        return offset <= file_size && bytes <= file_size - offset;
+    };
+    const uint64_t page_size = pageSize();
+    if (std::memcmp(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0 || header.version != IMAGE_VERSION ||
+        header.file_size != file_size || header.boot_dex_count > header.dex_count ||
+        !fits(header.dex_table_off, uint64_t{header.dex_count} * sizeof(DexRecord)) ||
+        !fits(header.class_table_off, uint64_t{header.class_count} * sizeof(ClassRecord)) ||
+        !fits(header.method_table_off, uint64_t{header.method_count} * sizeof(MethodRecord)) ||
+        !fits(header.index_off, header.index_size) || !fits(header.code_off, header.code_size) ||
+        header.class_table_off % 8 != 0 || header.method_table_off % 8 != 0 ||
+        header.index_off % 8 != 0 || header.code_off % page_size != 0) {
+        error = path + ": not an AOT image or wrong version";
+        return nullptr;
+    }
+
+    for (uint32_t i = 0; i < header.dex_count; ++i) {
+        DexRecord record;
+        std::memcpy(&record, data + header.dex_table_off + i * sizeof(record), sizeof(record));
+        if (!fits(record.offset, record.size) || !fits(record.name_off, record.name_size)) {
+            error = path + ": corrupted DEX table";
+            return nullptr;
+        }
+        const DexView dex(data + record.offset, static_cast<size_t>(record.size));
+        if (!dex.valid() || dex.checksum() != record.checksum) {
+            error = path + ": corrupted DEX table";
+            return nullptr;
+        }
+        image->dex_files.emplace_back(
+            std::string(reinterpret_cast<const char*>(data + record.name_off), record.name_size),
+            image->region, data + record.offset, static_cast<size_t>(record.size), false);
+    }
+    image->boot_dex_count = header.boot_dex_count;
+    image->index_data = data + header.index_off;
+    image->index_size = static_cast<size_t>(header.index_size);
+    image->classes = data + header.class_table_off;
+    image->class_count = header.class_count;
+    image->methods = data + header.method_table_off;
+    image->method_count = header.method_count;
+
+    // Код чужой архитектуры или на разделе noexec: методы остаются
+    // ускоренными, но интерпретируются
+    if (header.isa == hostIsa() && header.isa != ISA_NONE && header.code_size != 0 &&
+        mprotect(const_cast<uint8_t*>(data) + header.code_off, alignUp(header.code_size, page_size),
+                 PROT_READ | PROT_EXEC) == 0) {
+        image->code = data + header.code_off;
+        image->code_size = static_cast<size_t>(header.code_size);
+    }
+    return image;
+}
+
+std::shared_ptr<const ApkImage> AotImage::bind(std::shared_ptr<const AotImage> aot,
+                                               std::shared_ptr<const ApkImage> app) {
+    if (!aot) {
+        return app;
+    }
+
+    const size_t boot = aot->boot_dex_count;
+    const size_t app_count = aot->dex_files.size() - boot;
+    bool same_app = app ? app->dex_files.size() == app_count : app_count == 0;
+    for (size_t i = 0; same_app && app && i < app_count; ++i) {
+        const DexMapping& mine = aot->dex_files[boot + i];
+        const DexMapping& theirs = app->dex_files[i];
+        same_app = mine.size() == theirs.size() &&
+                   DexView(mine.data(), mine.size()).checksum() == DexView(theirs.data(), theirs.size()).checksum();
+    }
+
+    // DEX приложения, собранные в образ, - вместе с их кодом; другие
+    // версии приложения работают с образом платформы и своими DEX
+    auto bound = std::make_shared<ApkImage>();
+    bound->aot = aot;
+    bound->aot_dex_count = static_cast<uint32_t>(same_app ? aot->dex_files.size() : boot);
+    bound->dex_files.assign(aot->dex_files.begin(), aot->dex_files.begin() + bound->aot_dex_count);
+    if (!same_app && app) {
+        bound->dex_files.insert(bound->dex_files.end(), app->dex_files.begin(), app->dex_files.end());
+    }
+    if (!same_app || !bound->class_index.load(bound->dex_files, aot->index_data, aot->index_size, aot->region)) {
+        bound->class_index.build(bound->dex_files);
+    }
+    return bound;
+}
+
+const AotImage::MethodRecord* AotImage::findMethod(uint32_t dex, uint32_t method_idx) const {
+    const auto* first = reinterpret_cast<const MethodRecord*>(methods);
+    const auto* last = first + method_count;
+    const auto* it = std::lower_bound(first, last, std::make_pair(dex, method_idx),
+                                      [](const MethodRecord& record, const std::pair<uint32_t, uint32_t>& key) {
+                                          return record.dex != key.first ? record.dex < key.first
+                                                                         : record.method_idx < key.second;
+                                      });
+    return it != last && it->dex == dex && it->method_idx == method_idx ? it : nullptr;
+}
+
+const uint64_t* AotImage::statics(uint32_t dex, uint32_t class_def, size_t& count) const {
+    const auto* first = reinterpret_cast<const ClassRecord*>(classes);
+    const auto* last = first + class_count;
+    const auto* it = std::lower_bound(first, last, std::make_pair(dex, class_def),
+                                      [](const ClassRecord& record, const std::pair<uint32_t, uint32_t>& key) {
+                                          return record.dex != key.first ? record.dex < key.first
+                                                                         : record.class_def < key.second;
+                                      });
+    if (it == last || it->dex != dex || it->class_def != class_def || it->statics_off % 8 != 0 ||
+        it->statics_off + uint64_t{it->statics_count} * sizeof(uint64_t) > region->size()) {
+        return nullptr;
+    }
+    count = it->statics_count;
+    return reinterpret_cast<const uint64_t*>(region->data() + it->statics_off);
+}
+
+const uint16_t* AotImage::insns(const Method* method) const {
+    const MethodRecord* record = findMethod(method->owner->dex, method->method_idx);
+    if (!record || record->insns_size != method->insns_size) {
+        return nullptr;
+    }
+    if (record->insns_off == 0) {
+        return DexView::insns(method->code);
+    }
+    if (record->insns_off % 2 != 0 ||
+        record->insns_off + uint64_t{record->insns_size} * sizeof(uint16_t) > region->size()) {
+        return nullptr;
+    }
+    return reinterpret_cast<const uint16_t*>(region->data() + record->insns_off);
+}
+
+bool AotImage::loadCode(Method* method, JitCode& out) const {
+    const MethodRecord* record = findMethod(method->owner->dex, method->method_idx);
+    const uint64_t file_size = region->size();
+    const uint64_t sites = uint64_t{record ? record->call_site_count : 0} + (record ? record->field_site_count : 0);
+    if (!code || !record || record->code_size == 0 || record->insns_size != method->insns_size ||
+        record->code_off + record->code_size > code_size ||
+        record->native_offsets_off + uint64_t{record->insns_size} * sizeof(uint32_t) > file_size ||
+        record->sites_off + sites * sizeof(uint32_t) > file_size ||
+        record->native_offsets_off % 4 != 0 || record->sites_off % 4 != 0) {
+        return false;
+    }
+
+    const auto* offsets = reinterpret_cast<const uint32_t*>(region->data() + record->native_offsets_off);
+    const auto* pcs = reinterpret_cast<const uint32_t*>(region->data() + record->sites_off);
+    for (uint32_t i = 0; i < record->insns_size; ++i) {
+        if (offsets[i] != NO_NATIVE_OFFSET && offsets[i] >= record->code_size) {
+            return false;
+        }
+    }
+    for (uint64_t i = 0; i < sites; ++i) {
+        if (pcs[i] >= method->insns_size) {
+            return false;
+        }
+    }
+    out.code = code + record->code_off;
+    out.size = record->code_size;
+    out.native_offsets.assign(offsets, offsets + record->insns_size);
+    out.call_sites.clear();
+    out.field_sites.clear();
+    for (uint32_t i = 0; i < record->call_site_count; ++i) {
+        out.call_sites.push_back({nullptr, nullptr, method, method->insns + pcs[i]});
+    }
+    for (uint32_t i = 0; i < record->field_site_count; ++i) {
+        out.field_sites.push_back({nullptr, method, method->insns + pcs[record->call_site_count + i]});
+    }
+    out.bindSites();
+    return true;
+}
+
+} // namespace anexec
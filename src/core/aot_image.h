@@ -0,0 +1,105 @@
+#ifndef ANEXEC_AOT_IMAGE_H
+#define ANEXEC_AOT_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dex_file.h"
+#include "mapped_region.h"
+
+namespace anexec {
+
+struct ApkImage;
+struct JitCode;
+struct Method;
+
+struct AotBuildStats {
+    size_t dex_files;
+    size_t boot_dex_files;
+    size_t classes;                 // Загружено и слинковано при сборке
+    size_t preinitialized_classes;  // Статические поля сохранены в образе
+    size_t methods;                 // Методов с кодом
+    size_t quickened_methods;
+    size_t compiled_methods;        // С машинным кодом
+    uint64_t code_bytes;
+    uint64_t file_size;
+};
+
+// Образ AOT (аналог oat): DEX платформы и приложения, индекс классов,
+// статические поля классов с чистым <clinit>, ускоренный код методов и
+// их машинный код. Строится заранее (anexec --compile-image) и при старте
+// целиком отображается в память: страницы только читаются и общие для
+// всех процессов, поэтому холодный старт - это промахи страниц, а не
+// загрузка классов и интерпретация. Машинный код не зависит от адреса
+// отображения (см. JitCode), адреса процесса он берет из JitThread.
+class AotImage {
+public:
+    static constexpr const char* DEFAULT_NAME = "boot.oat";
+
+    ~AotImage();
+
+    // Запрещаем копирование
+    AotImage(const AotImage&) = delete;
+    AotImage& operator=(const AotImage&) = delete;
+
+    // Компиляция DEX из boot_jars и (если apk_path не пуст) из APK в файл
+    // output. Файл пишется во временный и переименовывается.
+    static bool build(const std::vector<std::string>& boot_jars, const std::string& apk_path,
+                      const std::string& output, AotBuildStats* stats, std::string& error);
+
+    // BOOTCLASSPATH из окружения, иначе *.jar каталога framework_dir по имени
+    static std::vector<std::string> bootClassPath(const std::string& framework_dir);
+
+    static std::shared_ptr<const AotImage> open(const std::string& path, std::string& error);
+
+    // Образ для линкера: DEX платформы из образа, затем DEX приложения.
+    // Если DEX приложения совпадают с собранными в образ, берутся копии
+    // из образа вместе с индексом классов и кодом. app может быть nullptr.
+    static std::shared_ptr<const ApkImage> bind(std::shared_ptr<const AotImage> aot,
+                                                std::shared_ptr<const ApkImage> app);
+
+    // Значения статических полей класса после <clinit> или nullptr
+    const uint64_t* statics(uint32_t dex, uint32_t class_def, size_t& count) const;
+
+    // Код метода для интерпретатора: ускоренная копия из образа или
+    // исходный код DEX. nullptr - метода в образе нет.
+    const uint16_t* insns(const Method* method) const;
+
+    // Машинный код метода в out: адрес в отображении образа и места
+    // вызовов по уже установленному method->insns. false - кода нет.
+    bool loadCode(Method* method, JitCode& out) const;
+
+    const std::string& path() const { return path_; }
+    size_t dexCount() const { return dex_files.size(); }
+    size_t bootDexCount() const { return boot_dex_count; }
+    size_t methodCount() const { return method_count; }
+    size_t classCount() const { return class_count; }
+    bool hasCode() const { return code_size != 0; }
+
+private:
+    struct MethodRecord;
+
+    AotImage() = default;
+
+    const MethodRecord* findMethod(uint32_t dex, uint32_t method_idx) const;
+
+    std::string path_;
+    std::shared_ptr<const MappedRegion> region;
+    std::vector<DexMapping> dex_files;
+    uint32_t boot_dex_count{0};
+    const uint8_t* index_data{nullptr};   // Сериализованный ClassIndex всех DEX
+    size_t index_size{0};
+    const uint8_t* classes{nullptr};
+    size_t class_count{0};
+    const uint8_t* methods{nullptr};
+    size_t method_count{0};
+    const uint8_t* code{nullptr};         // Отображено с PROT_EXEC
+    size_t code_size{0};
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_AOT_IMAGE_H
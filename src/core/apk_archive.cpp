@@ -0,0 +1,328 @@
+#include "apk_archive.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+namespace anexec {
+
+namespace {
+
+constexpr uint32_t EOCD_SIGNATURE = 0x06054b50;
+constexpr uint32_t ZIP64_LOCATOR_SIGNATURE = 0x07064b50;
+constexpr uint32_t ZIP64_EOCD_SIGNATURE = 0x06064b50;
+constexpr uint32_t CENTRAL_SIGNATURE = 0x02014b50;
+constexpr uint32_t LOCAL_SIGNATURE = 0x04034b50;
+
+constexpr size_t EOCD_SIZE = 22;
+constexpr size_t ZIP64_LOCATOR_SIZE = 20;
+constexpr size_t ZIP64_EOCD_SIZE = 56;
+constexpr size_t CENTRAL_HEADER_SIZE = 46;
+constexpr size_t LOCAL_HEADER_SIZE = 30;
+constexpr size_t MAX_COMMENT_SIZE = 0xFFFF;
+
+uint16_t read16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t read32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) |
+           (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t read64(const uint8_t* p) {
+    return static_cast<uint64_t>(read32(p)) |
+           (static_cast<uint64_t>(read32(p + 4)) << 32);
+}
+
+bool readAt(int fd, void* buf, size_t size, uint64_t offset) {
+    auto* out = static_cast<uint8_t*>(buf);
+    while (size > 0) {
+        ssize_t n = pread(fd, out, size, static_cast<off_t>(offset));
+        if (n <= 0) {
+            return false;
+        }
+        out += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+// Разбор расширенного поля ZIP64 для значений, не уместившихся в 32 бита
+void applyZip64Extra(const uint8_t* extra, size_t extra_len, ZipEntry& entry) {
+    size_t pos = 0;
+    while (pos + 4 <= extra_len) {
+        uint16_t id = read16(extra + pos);
+        uint16_t len = read16(extra + pos + 2);
+        const uint8_t* data = extra + pos + 4;
+        if (len > extra_len - pos - 4) {
+            return;
+        }
+        if (id == 0x0001) {
+            size_t off = 0;
+            if (entry.size == 0xFFFFFFFF && off + 8 <= len) {
+                entry.size = read64(data + off);
+                off += 8;
+            }
+            if (entry.compressed_size == 0xFFFFFFFF && off + 8 <= len) {
+                entry.compressed_size = read64(data + off);
+                off += 8;
+            }
+            if (entry.local_header_offset == 0xFFFFFFFF && off + 8 <= len) {
+                entry.local_header_offset = read64(data + off);
+            }
+            return;
+        }
+        pos += 4 + len;
+    }
+}
+
+} // namespace
+
+ApkArchive::~ApkArchive() {
+    close();
+}
+
+bool ApkArchive::open(const std::string& path) {
+    close();
+    path_ = path;
+
+    fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+        last_error_ = "Failed to open APK file";
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        last_error_ = "Failed to stat APK file";
+        close();
+        return false;
+    }
+    file_size_ = static_cast<uint64_t>(st.st_size);
+
+    if (!readCentralDirectory()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ApkArchive::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    file_size_ = 0;
+    entries_.clear();
+}
+
+const ZipEntry* ApkArchive::find(const std::string& name) const {
+    for (const auto& entry : entries_) {
+        if (entry.name == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+bool ApkArchive::dataOffset(const ZipEntry& entry, uint64_t& offset) const {
+    uint8_t header[LOCAL_HEADER_SIZE];
+    if (!readAt(fd_, header, sizeof(header), entry.local_header_offset) ||
+        read32(header) != LOCAL_SIGNATURE) {
+        return false;
+    }
+
+    // Длины имени и extra в локальном заголовке могут отличаться
+    // от центрального каталога (zipalign дописывает выравнивание в extra)
+    uint64_t name_len = read16(header + 26);
+    uint64_t extra_len = read16(header + 28);
+    // Локальный заголовок прочитан, значит смещение его конца не больше
+    // размера файла и сумма не переполняется; размер данных берется из
+    // каталога и может быть любым, поэтому сравнивается с остатком файла
+    offset = entry.local_header_offset + LOCAL_HEADER_SIZE + name_len + extra_len;
+    return offset <= file_size_ && entry.compressed_size <= file_size_ - offset;
+}
+
+std::shared_ptr<const MappedRegion> ApkArchive::mapRaw(const ZipEntry& entry,
+                                                       const uint8_t*& data) const {
+    uint64_t offset = 0;
+    if (!dataOffset(entry, offset) || entry.compressed_size == 0) {
+        return nullptr;
+    }
+
+    // mmap требует выровненного смещения, поэтому отображаем с начала страницы
+    const uint64_t page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    const uint64_t aligned_offset = offset & ~(page_size - 1);
+    const size_t delta = static_cast<size_t>(offset - aligned_offset);
+    const size_t map_size = delta + static_cast<size_t>(entry.compressed_size);
+
+    void* base = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE,
+                      fd_, static_cast<off_t>(aligned_offset));
+    if (base == MAP_FAILED) {
+        return nullptr;
+    }
+
+    auto region = std::make_shared<const MappedRegion>(base, map_size);
+    data = region->data() + delta;
+    return region;
+}
+
+bool ApkArchive::inflate(const ZipEntry& entry, std::vector<uint8_t>& buffer) const {
+    buffer.resize(static_cast<size_t>(entry.size));
+    return inflate(entry, buffer.data(), buffer.size());
+}
+
+bool ApkArchive::inflate(const ZipEntry& entry, uint8_t* out, size_t size) const {
+    if (size != entry.size) {
+        return false;
+    }
+
+    const uint8_t* raw = nullptr;
+    auto region = mapRaw(entry, raw);
+    if (!region) {
+        return false;
+    }
+
+    if (entry.isStored()) {
+        std::memcpy(out, raw, size);
+        return true;
+    }
+    if (entry.method != 8) {
+        return false;
+    }
+
+    z_stream stream{};
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        return false;
+    }
+
+    // zlib принимает uInt, поэтому большие записи подаем частями
+    constexpr uint64_t CHUNK = 1u << 30;
+    uint64_t in_left = entry.compressed_size;
+    uint64_t out_left = entry.size;
+    stream.next_in = const_cast<Bytef*>(raw);
+    stream.next_out = out;
+
+    int rc = Z_OK;
+    while (rc == Z_OK) {
+        if (stream.avail_in == 0) {
+            stream.avail_in = static_cast<uInt>(std::min(in_left, CHUNK));
+            in_left -= stream.avail_in;
+        }
+        if (stream.avail_out == 0) {
+            stream.avail_out = static_cast<uInt>(std::min(out_left, CHUNK));
+            out_left -= stream.avail_out;
+        }
+        rc = ::inflate(&stream, Z_NO_FLUSH);
+    }
+    inflateEnd(&stream);
+
+    return rc == Z_STREAM_END && stream.total_out == entry.size;
+}
+
+bool ApkArchive::readCentralDirectory() {
+    if (file_size_ < EOCD_SIZE) {
+        last_error_ = "APK file is too small";
+        return false;
+    }
+
+    // Ищем End Of Central Directory с конца файла (после него может быть комментарий)
+    size_t tail_size = static_cast<size_t>(
+        std::min<uint64_t>(file_size_, EOCD_SIZE + MAX_COMMENT_SIZE));
+    uint64_t tail_offset = file_size_ - tail_size;
+    std::vector<uint8_t> tail(tail_size);
+    if (!readAt(fd_, tail.data(), tail_size, tail_offset)) {
+        last_error_ = "Failed to read APK file";
+        return false;
+    }
+
+    size_t eocd = tail_size;
+    for (size_t i = tail_size - EOCD_SIZE + 1; i-- > 0;) {
+        if (read32(&tail[i]) == EOCD_SIGNATURE) {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd == tail_size) {
+        last_error_ = "ZIP end of central directory not found";
+        return false;
+    }
+
+    uint64_t entry_count = read16(&tail[eocd + 10]);
+    uint64_t cd_size = read32(&tail[eocd + 12]);
+    uint64_t cd_offset = read32(&tail[eocd + 16]);
+
+    // ZIP64: реальные значения лежат в отдельной записи перед локатором
+    uint64_t eocd_abs = tail_offset + eocd;
+    if (eocd_abs >= ZIP64_LOCATOR_SIZE) {
+        uint8_t locator[ZIP64_LOCATOR_SIZE];
+        if (readAt(fd_, locator, sizeof(locator), eocd_abs - ZIP64_LOCATOR_SIZE) &&
+            read32(locator) == ZIP64_LOCATOR_SIGNATURE) {
+            uint8_t eocd64[ZIP64_EOCD_SIZE];
+            uint64_t eocd64_offset = read64(locator + 8);
+            if (!readAt(fd_, eocd64, sizeof(eocd64), eocd64_offset) ||
+                read32(eocd64) != ZIP64_EOCD_SIGNATURE) {
+                last_error_ = "Corrupted ZIP64 end of central directory";
+                return false;
+            }
+            entry_count = read64(eocd64 + 32);
+            cd_size = read64(eocd64 + 40);
+            cd_offset = read64(eocd64 + 48);
+        }
+    }
+
+    // Значения из ZIP64 произвольные: сумма может переполниться
+    if (cd_offset > file_size_ || cd_size > file_size_ - cd_offset) {
+        last_error_ = "ZIP central directory is out of bounds";
+        return false;
+    }
+
+    std::vector<uint8_t> cd(static_cast<size_t>(cd_size));
+    if (!readAt(fd_, cd.data(), cd.size(), cd_offset)) {
+        last_error_ = "Failed to read ZIP central directory";
+        return false;
+    }
+
+    // Число записей тоже не проверено: больше, чем заголовков минимального
+    // размера помещается в каталог, их быть не может
+    entries_.reserve(static_cast<size_t>(std::min<uint64_t>(entry_count, cd_size / CENTRAL_HEADER_SIZE)));
+    size_t pos = 0;
+    for (uint64_t i = 0; i < entry_count; ++i) {
+        if (CENTRAL_HEADER_SIZE > cd.size() - pos || read32(&cd[pos]) != CENTRAL_SIGNATURE) {
+            last_error_ = "Corrupted ZIP central directory";
+            return false;
+        }
+
+        const uint8_t* h = &cd[pos];
+        size_t name_len = read16(h + 28);
+        size_t extra_len = read16(h + 30);
+        size_t comment_len = read16(h + 32);
+        if (name_len + extra_len + comment_len > cd.size() - pos - CENTRAL_HEADER_SIZE) {
+            last_error_ = "Corrupted ZIP central directory";
+            return false;
+        }
+
+        ZipEntry entry;
+        entry.method = read16(h + 10);
+        entry.crc32 = read32(h + 16);
+        entry.compressed_size = read32(h + 20);
+        entry.size = read32(h + 24);
+        entry.local_header_offset = read32(h + 42);
+        entry.name.assign(reinterpret_cast<const char*>(h + CENTRAL_HEADER_SIZE), name_len);
+        applyZip64Extra(h + CENTRAL_HEADER_SIZE + name_len, extra_len, entry);
+
+        entries_.push_back(std::move(entry));
+        pos += CENTRAL_HEADER_SIZE + name_len + extra_len + comment_len;
+    }
+
+    return true;
+}
+
+} // namespace anexec
@@ -0,0 +1,74 @@
+#ifndef ANEXEC_APK_ARCHIVE_H
+#define ANEXEC_APK_ARCHIVE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "mapped_region.h"
+
+namespace anexec {
+
+// Запись центрального каталога ZIP
+struct ZipEntry {
+    std::string name;                // Имя записи
+    uint16_t method{0};              // Метод сжатия (0 - STORED, 8 - DEFLATE)
+    uint32_t crc32{0};               // Контрольная сумма
+    uint64_t compressed_size{0};     // Размер в архиве
+    uint64_t size{0};                // Размер после распаковки
+    uint64_t local_header_offset{0}; // Смещение локального заголовка
+
+    bool isStored() const { return method == 0 && compressed_size == size; }
+};
+
+// Чтение центрального каталога APK без распаковки.
+// libzip не отдает смещение данных записи, а оно нужно,
+// чтобы отображать несжатые записи напрямую из файла.
+class ApkArchive {
+public:
+    ApkArchive() = default;
+    ~ApkArchive();
+
+    // Запрещаем копирование
+    ApkArchive(const ApkArchive&) = delete;
+    ApkArchive& operator=(const ApkArchive&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    int fd() const { return fd_; }
+    uint64_t fileSize() const { return file_size_; }
+    const std::string& path() const { return path_; }
+    const std::string& lastError() const { return last_error_; }
+
+    const std::vector<ZipEntry>& entries() const { return entries_; }
+    const ZipEntry* find(const std::string& name) const;
+
+    // Смещение начала данных записи в файле (читает локальный заголовок)
+    bool dataOffset(const ZipEntry& entry, uint64_t& offset) const;
+
+    // Отображение сырых (возможно сжатых) данных записи, data - их начало
+    std::shared_ptr<const MappedRegion> mapRaw(const ZipEntry& entry,
+                                               const uint8_t*& data) const;
+
+    // Распаковка записи в буфер без libzip (raw deflate из отображения).
+    // Буфер переиспользуется между вызовами.
+    bool inflate(const ZipEntry& entry, std::vector<uint8_t>& buffer) const;
+
+    // То же в готовую память размером entry.size
+    bool inflate(const ZipEntry& entry, uint8_t* out, size_t size) const;
+
+private:
+    bool readCentralDirectory();
+
+    int fd_{-1};
+    uint64_t file_size_{0};
+    std::string path_;
+    std::string last_error_;
+    std::vector<ZipEntry> entries_;
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_APK_ARCHIVE_H
@@ -0,0 +1,99 @@
+#include "apk_image.h"
+#include "resource_monitor.h"
+#include <algorithm>
+
+namespace anexec {
+
+namespace {
+
+// Размер отображений; записи из одного файла кэша считаем один раз
+uint64_t mappedBytes(const std::vector<DexMapping>& mappings) {
+    std::vector<const MappedRegion*> seen;
+    uint64_t total = 0;
+    for (const auto& mapping : mappings) {
+        const MappedRegion* region = mapping.region().get();
+        if (region && std::find(seen.begin(), seen.end(), region) == seen.end()) {
+            seen.push_back(region);
+            total += region->size();
+        }
+    }
+    return total;
+}
+
+} // namespace
+
+ApkImage::~ApkImage() {
+    ResourceMonitor::instance().add(MemoryCategory::DexMaps, -static_cast<int64_t>(dex_memory));
+}
+
+void ApkImage::account() {
+    dex_memory = mappedBytes(dex_files);
+    ResourceMonitor::instance().add(MemoryCategory::DexMaps, static_cast<int64_t>(dex_memory));
+}
+
+ImageRegistry& ImageRegistry::instance() {
+    static ImageRegistry registry;
+    return registry;
+}
+
+std::shared_ptr<const ApkImage> ImageRegistry::acquire(uint64_t key, const Loader& loader) {
+    std::promise<std::shared_ptr<const ApkImage>> promise;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        Slot& slot = slots[key];
+        if (auto image = slot.image.lock()) {
+            return image;
+        }
+        if (slot.in_flight) {
+            // Тот же APK уже загружается в другом потоке. Ждать можно и в
+            // потоке пула: TaskGroup::wait() в загрузчике не берет чужих
+            // задач, поэтому загрузка не окажется в стеке под этим ожиданием
+            auto loading = slot.loading;
+            lock.unlock();
+            return loading.get();
+        }
+        slot.in_flight = true;
+        slot.loading = promise.get_future().share();
+    }
+
+    // Загрузка идет без блокировки реестра: другие APK не ждут
+    std::shared_ptr<const ApkImage> image;
+    try {
+        image = loader();
+    } catch (...) {
+        image = nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Slot& slot = slots[key];
+        slot.in_flight = false;
+        slot.loading = {};
+        slot.image = image;
+        if (!image) {
+            slots.erase(key);
+        }
+
+        // Заодно убираем записи умерших образов
+        for (auto it = slots.begin(); it != slots.end();) {
+            if (!it->second.in_flight && it->second.image.expired() && it->first != key) {
+                it = slots.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    promise.set_value(image);
+    return image;
+}
+
+size_t ImageRegistry::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t alive = 0;
+    for (const auto& [key, slot] : slots) {
+        alive += slot.image.expired() ? 0 : 1;
+    }
+    return alive;
+}
+
+} // namespace anexec
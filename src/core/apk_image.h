@@ -0,0 +1,75 @@
+#ifndef ANEXEC_APK_IMAGE_H
+#define ANEXEC_APK_IMAGE_H
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "class_index.h"
+#include "dex_file.h"
+
+namespace anexec {
+
+class AotImage;
+
+// Неизменяемый набор отображений DEX одного APK.
+// После публикации в ImageRegistry данные только читаются, поэтому
+// исполнители одного APK делят одни и те же страницы.
+struct ApkImage {
+    std::vector<DexMapping> dex_files;
+    ClassIndex class_index;     // Ссылается на dex_files
+    uint64_t dex_memory{0};
+    // Образ AOT, из которого взяты первые aot_dex_count DEX (см. AotImage::bind)
+    std::shared_ptr<const AotImage> aot;
+    uint32_t aot_dex_count{0};
+
+    ApkImage() = default;
+    ~ApkImage();
+
+    ApkImage(const ApkImage&) = delete;
+    ApkImage& operator=(const ApkImage&) = delete;
+
+    // Подсчет размера отображений и учет в ResourceMonitor (один раз на образ)
+    void account();
+};
+
+// Реестр образов APK процесса. Образ живет, пока на него ссылается
+// хотя бы один исполнитель; одновременные загрузки одного APK
+// выполняются один раз, остальные ждут результата.
+class ImageRegistry {
+public:
+    using Loader = std::function<std::shared_ptr<ApkImage>()>;
+
+    static ImageRegistry& instance();
+
+    ImageRegistry(const ImageRegistry&) = delete;
+    ImageRegistry& operator=(const ImageRegistry&) = delete;
+
+    // Возвращает готовый образ или вызывает loader в текущем потоке.
+    // Если loader вернул nullptr, ждавшие потоки тоже получат nullptr.
+    std::shared_ptr<const ApkImage> acquire(uint64_t key, const Loader& loader);
+
+    // Количество живых образов
+    size_t size() const;
+
+private:
+    ImageRegistry() = default;
+
+    struct Slot {
+        std::weak_ptr<const ApkImage> image;
+        std::shared_future<std::shared_ptr<const ApkImage>> loading;
+        bool in_flight{false};
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, Slot> slots;
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_APK_IMAGE_H
@@ -0,0 +1,189 @@
+#include "class_index.h"
+#include "hash.h"
+#include <cstring>
+
+namespace anexec {
+
+namespace {
+
+constexpr char INDEX_MAGIC[8] = {'A', 'N', 'X', 'C', 'L', 'I', 'D', 'X'};
+constexpr uint32_t INDEX_VERSION = 1;
+
+struct IndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t dex_count;
+    uint64_t capacity;
+    uint64_t count;
+};
+
+// Для проверки, что индекс построен по тем же DEX
+struct IndexDexRecord {
+    uint32_t checksum;
+    uint32_t size;
+};
+
+} // namespace
+
+uint64_t ClassIndex::hashDescriptor(std::string_view descriptor) {
+    const uint64_t hash = fnv1a(descriptor);
+    // 0 занят под пустой слот
+    return hash ? hash : 1;
+}
+
+std::string ClassIndex::toDescriptor(std::string_view class_name) {
+    std::string descriptor;
+    descriptor.reserve(class_name.size() + 2);
+    descriptor += 'L';
+    for (char c : class_name) {
+        descriptor += c == '.' ? '/' : c;
+    }
+    descriptor += ';';
+    return descriptor;
+}
+
+bool ClassIndex::openViews(const std::vector<DexMapping>& dex_files) {
+    views.clear();
+    views.reserve(dex_files.size());
+    for (const auto& dex : dex_files) {
+        views.emplace_back(dex.data(), dex.size());
+        if (!views.back().valid()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ClassIndex::build(const std::vector<DexMapping>& dex_files) {
+    slots = nullptr;
+    mask = 0;
+    count = 0;
+    region.reset();
+    if (!openViews(dex_files)) {
+        return false;
+    }
+
+    size_t total = 0;
+    for (const auto& view : views) {
+        total += view.classDefCount();
+    }
+    // Не больше половины слотов заняты
+    size_t capacity = 16;
+    while (capacity < total * 2) {
+        capacity <<= 1;
+    }
+    owned.assign(capacity, Slot{0, 0, 0});
+    mask = capacity - 1;
+    slots = owned.data();
+
+    for (uint32_t d = 0; d < views.size(); ++d) {
+        const DexView& view = views[d];
+        for (uint32_t i = 0; i < view.classDefCount(); ++i) {
+            const std::string_view descriptor = view.typeDescriptor(view.classDef(i).class_idx);
+            if (descriptor.empty()) {
+                continue;
+            }
+            const uint64_t hash = hashDescriptor(descriptor);
+            size_t slot = hash & mask;
+            bool duplicate = false;
+            while (owned[slot].hash != 0) {
+                if (owned[slot].hash == hash && descriptorOf(owned[slot]) == descriptor) {
+                    duplicate = true;
+                    break;
+                }
+                slot = (slot + 1) & mask;
+            }
+            if (!duplicate) {
+                owned[slot] = Slot{hash, d, i};
+                ++count;
+            }
+        }
+    }
+    return true;
+}
+
+bool ClassIndex::load(const std::vector<DexMapping>& dex_files, const uint8_t* data, size_t size,
+                      std::shared_ptr<const MappedRegion> data_region) {
+    if (!data || size < sizeof(IndexHeader) || !openViews(dex_files)) {
+        return false;
+    }
+
+    IndexHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+        header.version != INDEX_VERSION || header.dex_count != views.size() ||
+        header.capacity < 16 || (header.capacity & (header.capacity - 1)) != 0) {
+        return false;
+    }
+
+    const size_t slots_offset = sizeof(IndexHeader) + views.size() * sizeof(IndexDexRecord);
+    if (slots_offset + header.capacity * sizeof(Slot) != size ||
+        reinterpret_cast<uintptr_t>(data + slots_offset) % alignof(Slot) != 0) {
+        return false;
+    }
+    for (size_t d = 0; d < views.size(); ++d) {
+        IndexDexRecord record;
+        std::memcpy(&record, data + sizeof(IndexHeader) + d * sizeof(record), sizeof(record));
+        if (record.checksum != views[d].checksum() || record.size != views[d].size()) {
+            return false;
+        }
+    }
+
+    owned.clear();
+    slots = reinterpret_cast<const Slot*>(data + slots_offset);
+    mask = static_cast<size_t>(header.capacity - 1);
+    count = static_cast<size_t>(header.count);
+    region = std::move(data_region);
+    return true;
+}
+
+std::vector<uint8_t> ClassIndex::serialize() const {
+    if (!slots) {
+        return {};
+    }
+
+    IndexHeader header;
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.dex_count = static_cast<uint32_t>(views.size());
+    header.capacity = mask + 1;
+    header.count = count;
+
+    const size_t slots_offset = sizeof(IndexHeader) + views.size() * sizeof(IndexDexRecord);
+    std::vector<uint8_t> out(slots_offset + (mask + 1) * sizeof(Slot));
+    std::memcpy(out.data(), &header, sizeof(header));
+    for (size_t d = 0; d < views.size(); ++d) {
+        const IndexDexRecord record{views[d].checksum(), static_cast<uint32_t>(views[d].size())};
+        std::memcpy(out.data() + sizeof(IndexHeader) + d * sizeof(record), &record, sizeof(record));
+    }
+    std::memcpy(out.data() + slots_offset, slots, (mask + 1) * sizeof(Slot));
+    return out;
+}
+
+std::string_view ClassIndex::descriptorOf(const Slot& slot) const {
+    if (slot.dex >= views.size()) {
+        return {};
+    }
+    const DexView& view = views[slot.dex];
+    return view.typeDescriptor(view.classDef(slot.class_def).class_idx);
+}
+
+ClassRef ClassIndex::find(std::string_view descriptor) const {
+    if (!slots || descriptor.empty()) {
+        return ClassRef{};
+    }
+    const uint64_t hash = hashDescriptor(descriptor);
+    // Граница на случай поврежденного кэша без пустых слотов
+    for (size_t probe = 0, i = hash & mask; probe <= mask; ++probe, i = (i + 1) & mask) {
+        const Slot& slot = slots[i];
+        if (slot.hash == 0) {
+            return ClassRef{};
+        }
+        if (slot.hash == hash && descriptorOf(slot) == descriptor) {
+            return ClassRef{slot.dex, slot.class_def};
+        }
+    }
+    return ClassRef{};
+}
+
+} // namespace anexec
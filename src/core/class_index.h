@@ -0,0 +1,77 @@
+#ifndef ANEXEC_CLASS_INDEX_H
+#define ANEXEC_CLASS_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "dex_file.h"
+
+namespace anexec {
+
+// Где определен класс: номер DEX в образе и номер записи class_defs
+struct ClassRef {
+    uint32_t dex{DEX_NO_INDEX};
+    uint32_t class_def{DEX_NO_INDEX};
+
+    bool valid() const { return dex != DEX_NO_INDEX; }
+};
+
+// Индекс классов APK: хеш дескриптора -> (dex, class_def) в плоской
+// таблице с открытой адресацией. Строки не копируются: при совпадении
+// хеша дескриптор сверяется прямо с type_ids/string_ids из DEX.
+// Таблица сериализуется как есть, так что загрузка из кэша - это
+// проверка заголовка поверх отображения файла, без разбора DEX.
+class ClassIndex {
+public:
+    ClassIndex() = default;
+
+    // Запрещаем копирование: slots может указывать в собственный буфер
+    ClassIndex(const ClassIndex&) = delete;
+    ClassIndex& operator=(const ClassIndex&) = delete;
+
+    // Разбор class_defs всех DEX; при повторе класса побеждает первый DEX
+    bool build(const std::vector<DexMapping>& dex_files);
+
+    // Таблица из сериализованных данных (обычно отображение кэша).
+    // region держит данные; false - данные не от этих DEX файлов.
+    bool load(const std::vector<DexMapping>& dex_files, const uint8_t* data, size_t size,
+              std::shared_ptr<const MappedRegion> region);
+
+    std::vector<uint8_t> serialize() const;
+
+    // Дескриптор вида "Lcom/example/Main;"
+    ClassRef find(std::string_view descriptor) const;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const DexView& dex(uint32_t index) const { return views[index]; }
+
+    // "com.example.Main" -> "Lcom/example/Main;"
+    static std::string toDescriptor(std::string_view class_name);
+
+private:
+    struct Slot {
+        uint64_t hash;          // 0 - пустой слот
+        uint32_t dex;
+        uint32_t class_def;
+    };
+
+    static uint64_t hashDescriptor(std::string_view descriptor);
+    bool openViews(const std::vector<DexMapping>& dex_files);
+    std::string_view descriptorOf(const Slot& slot) const;
+
+    std::vector<DexView> views;
+    std::vector<Slot> owned;        // Построенная таблица
+    const Slot* slots{nullptr};     // owned или данные из кэша
+    size_t mask{0};
+    size_t count{0};
+    std::shared_ptr<const MappedRegion> region;
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_CLASS_INDEX_H
@@ -0,0 +1,688 @@
+#include "class_linker.h"
+#include "apk_image.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace anexec {
+
+namespace {
+
+constexpr std::string_view OBJECT_DESCRIPTOR = "Ljava/lang/Object;";
+constexpr std::string_view STRING_DESCRIPTOR = "Ljava/lang/String;";
+
+// Иерархия исключений платформы: нужна, чтобы catch по базовому
+// классу ловил исключения, которые бросает сам интерпретатор
+struct FrameworkSuper {
+    std::string_view descriptor;
+    std::string_view super;
+};
+
+constexpr FrameworkSuper FRAMEWORK_SUPERS[] = {
+    {"Ljava/lang/Exception;", "Ljava/lang/Throwable;"},
+    {"Ljava/lang/Error;", "Ljava/lang/Throwable;"},
+    {"Ljava/lang/RuntimeException;", "Ljava/lang/Exception;"},
+    {"Ljava/lang/ArithmeticException;", "Ljava/lang/RuntimeException;"},
+    {"Ljava/lang/IndexOutOfBoundsException;", "Ljava/lang/RuntimeException;"},
+    {"Ljava/lang/ArrayIndexOutOfBoundsException;", "Ljava/lang/IndexOutOfBoundsException;"},
+    {"Ljava/lang/ArrayStoreException;", "Ljava/lang/RuntimeException;"},
+    {"Ljava/lang/ClassCastException;", "Ljava/lang/RuntimeException;"},
+    {"Ljava/lang/IllegalArgumentException;", "Ljava/lang/RuntimeException;"},
+    {"Ljava/lang/IllegalStateException;", "Ljava/lang/RuntimeException;"},
+    {"Ljava/lang/InstantiationError;", "Ljava/lang/IncompatibleClassChangeError;"},
+    {"Ljava/lang/NegativeArraySizeException;", "Ljava/lang/RuntimeException;"},
+    {"Ljava/lang/NullPointerException;", "Ljava/lang/RuntimeException;"},
+    {"Ljava/lang/UnsupportedOperationException;", "Ljava/lang/RuntimeException;"},
+    {"Ljava/lang/LinkageError;", "Ljava/lang/Error;"},
+    {"Ljava/lang/IncompatibleClassChangeError;", "Ljava/lang/LinkageError;"},
+    {"Ljava/lang/AbstractMethodError;", "Ljava/lang/IncompatibleClassChangeError;"},
+    {"Ljava/lang/NoSuchFieldError;", "Ljava/lang/IncompatibleClassChangeError;"},
+    {"Ljava/lang/NoSuchMethodError;", "Ljava/lang/IncompatibleClassChangeError;"},
+    {"Ljava/lang/NoClassDefFoundError;", "Ljava/lang/LinkageError;"},
+    {"Ljava/lang/UnsatisfiedLinkError;", "Ljava/lang/LinkageError;"},
+    {"Ljava/lang/VerifyError;", "Ljava/lang/LinkageError;"},
+    {"Ljava/lang/VirtualMachineError;", "Ljava/lang/Error;"},
+    {"Ljava/lang/InternalError;", "Ljava/lang/VirtualMachineError;"},
+    {"Ljava/lang/OutOfMemoryError;", "Ljava/lang/VirtualMachineError;"},
+    {"Ljava/lang/StackOverflowError;", "Ljava/lang/VirtualMachineError;"}
+};
+
+std::string_view frameworkSuper(std::string_view descriptor) {
+    for (const auto& entry : FRAMEWORK_SUPERS) {
+        if (entry.descriptor == descriptor) {
+            return entry.super;
+        }
+    }
+    return OBJECT_DESCRIPTOR;
+}
+
+bool isPrimitive(std::string_view descriptor) {
+    return descriptor.size() == 1 && std::strchr("VZBSCIJFD", descriptor[0]) != nullptr;
+}
+
+bool isReference(std::string_view type) {
+    return !type.empty() && (type[0] == 'L' || type[0] == '[');
+}
+
+// Размер поля или элемента массива по дескриптору
+uint8_t valueSize(char type) {
+    switch (type) {
+        case 'Z':
+        case 'B':
+            return 1;
+        case 'S':
+        case 'C':
+            return 2;
+        case 'J':
+        case 'D':
+            return 8;
+        default:
+            return 4;   // int, float и ссылки
+    }
+}
+
+// Аргументы метода в 32-битных словах по shorty (без this)
+uint16_t argumentWords(std::string_view shorty) {
+    uint16_t words = 0;
+    for (size_t i = 1; i < shorty.size(); ++i) {
+        words += shorty[i] == 'J' || shorty[i] == 'D' ? 2 : 1;
+    }
+    return words;
+}
+
+} // namespace
+
+ClassLinker::ClassLinker(Heap& heap) : heap_(heap) {
+    // Статические поля, объекты Class и строки DEX живут, пока жив загрузчик
+    root_source = heap_.addRootSource([this](const Heap::RootVisitor& visit) {
+        for (auto& entry : classes) {
+            Class* klass = entry.second.get();
+            visit(klass->class_object);
+            for (const Field& field : klass->fields) {
+                if (field.is_static && isReference(field.type)) {
+                    visit(*reinterpret_cast<ObjectRef*>(klass->staticData() + field.offset));
+                }
+            }
+        }
+        for (DexCache& cache : caches) {
+            for (ObjectRef& string : cache.strings) {
+                visit(string);
+            }
+        }
+    });
+}
+
+ClassLinker::~ClassLinker() {
+    heap_.removeRootSource(root_source);
+}
+
+void ClassLinker::attachImage(std::shared_ptr<const ApkImage> new_image) {
+    classes.clear();
+    caches.clear();
+    string_class = nullptr;
+    loaded_count = 0;
+    image = std::move(new_image);
+    if (!image) {
+        return;
+    }
+
+    const size_t dex_count = image->dex_files.size();
+    caches.resize(dex_count);
+    for (size_t i = 0; i < dex_count; ++i) {
+        const DexView& dex = image->class_index.dex(static_cast<uint32_t>(i));
+        DexCache& cache = caches[i];
+        cache.dex = &dex;
+        cache.types.assign(dex.typeCount(), nullptr);
+        cache.methods.assign(dex.methodCount(), nullptr);
+        cache.fields.assign(dex.fieldCount(), nullptr);
+        cache.strings.assign(dex.stringCount(), NULL_REF);
+    }
+}
+
+Class* ClassLinker::findClass(std::string_view descriptor) {
+    auto it = classes.find(descriptor);
+    if (it != classes.end()) {
+        // Error также означает, что класс сейчас линкуется (циклическое наследование)
+        return it->second->state == Class::State::Error ? nullptr : it->second.get();
+    }
+    if (descriptor.empty()) {
+        return nullptr;
+    }
+    if (descriptor[0] == '[') {
+        return defineArray(descriptor);
+    }
+    return defineClass(descriptor);
+}
+
+Class* ClassLinker::defineClass(std::string_view descriptor) {
+    const ClassRef ref = image ? image->class_index.find(descriptor) : ClassRef{};
+    if (!ref.valid()) {
+        return defineStub(descriptor);
+    }
+    const DexView& dex = image->class_index.dex(ref.dex);
+    auto klass = std::make_unique<Class>();
+    // Строка из DEX живет, пока жив образ
+    klass->descriptor = dex.typeDescriptor(dex.classDef(ref.class_def).class_idx);
+    klass->dex = ref.dex;
+    klass->class_def = ref.class_def;
+    klass->state = Class::State::Error;
+    if (Tracer::enabled()) {
+        klass->trace_name = Tracer::instance().intern(klass->descriptor);
+    }
+    Class* raw = klass.get();
+    classes.emplace(raw->descriptor, std::move(klass));
+    TraceScope trace(TraceEvent::ClassLoad, raw->trace_name);
+
+    if (!linkClass(raw, dex)) {
+        return nullptr;
+    }
+    raw->state = Class::State::Loaded;
+    ++loaded_count;
+    return raw;
+}
+
+Class* ClassLinker::defineStub(std::string_view descriptor) {
+    const bool reference = descriptor.size() > 2 && descriptor.front() == 'L' && descriptor.back() == ';';
+    if (!reference && !isPrimitive(descriptor)) {
+        return nullptr;
+    }
+
+    Class* super = nullptr;
+    if (reference && descriptor != OBJECT_DESCRIPTOR) {
+        super = findClass(frameworkSuper(descriptor));
+        if (!super) {
+            return nullptr;
+        }
+    }
+
+    auto klass = std::make_unique<Class>();
+    klass->name_storage = std::string(descriptor);
+    klass->descriptor = klass->name_storage;
+    klass->super = super;
+    klass->stub = true;
+    klass->state = Class::State::Initialized;
+    Class* raw = klass.get();
+    classes.emplace(raw->descriptor, std::move(klass));
+    if (descriptor == STRING_DESCRIPTOR) {
+        string_class = raw;
+    }
+    return raw;
+}
+
+Class* ClassLinker::defineArray(std::string_view descriptor) {
+    Class* component = findClass(descriptor.substr(1));
+    Class* object = findClass(OBJECT_DESCRIPTOR);
+    if (!component || !object || component->descriptor == "V") {
+        return nullptr;
+    }
+
+    auto klass = std::make_unique<Class>();
+    klass->name_storage = std::string(descriptor);
+    klass->descriptor = klass->name_storage;
+    klass->super = object;
+    klass->component = component;
+    klass->component_size = valueSize(descriptor[1]);
+    klass->reference_elements = isReference(descriptor.substr(1));
+    klass->state = Class::State::Initialized;
+    Class* raw = klass.get();
+    classes.emplace(raw->descriptor, std::move(klass));
+    return raw;
+}
+
+bool ClassLinker::linkClass(Class* klass, const DexView& dex) {
+    const DexClassDef def = dex.classDef(klass->class_def);
+    klass->access_flags = def.access_flags;
+
+    if (def.superclass_idx != DEX_NO_INDEX) {
+        klass->super = findClass(dex.typeDescriptor(def.superclass_idx));
+        if (!klass->super || klass->super->isInterface() || klass->super->isArray()) {
+            return false;
+        }
+        klass->object_size = klass->super->object_size;
+        klass->reference_offsets = klass->super->reference_offsets;
+    } else if (klass->descriptor != OBJECT_DESCRIPTOR) {
+        return false;
+    }
+
+    if (def.interfaces_off != 0) {
+        const uint32_t count = dex.read32(def.interfaces_off);
+        for (uint32_t i = 0; i < count; ++i) {
+            Class* interface = findClass(dex.typeDescriptor(dex.read16(def.interfaces_off + 4 + i * 2)));
+            if (!interface) {
+                return false;
+            }
+            klass->interfaces.push_back(interface);
+        }
+    }
+
+    return linkMembers(klass, dex);
+}
+
+std::string ClassLinker::signatureOf(const DexView& dex, uint32_t proto_idx) const {
+    const DexProtoId proto = dex.protoId(proto_idx);
+    std::string signature = "(";
+    if (proto.parameters_off != 0) {
+        const uint32_t count = dex.read32(proto.parameters_off);
+        for (uint32_t i = 0; i < count; ++i) {
+            signature += dex.typeDescriptor(dex.read16(proto.parameters_off + 4 + i * 2));
+        }
+    }
+    signature += ')';
+    signature += dex.typeDescriptor(proto.return_type_idx);
+    return signature;
+}
+
+bool ClassLinker::linkMembers(Class* klass, const DexView& dex) {
+    const DexClassDef def = dex.classDef(klass->class_def);
+    std::vector<Method*> virtuals;
+    if (def.class_data_off == 0) {
+        return buildVtable(klass, virtuals);
+    }
+
+    DexCache& cache = caches[klass->dex];
+    uint64_t offset = def.class_data_off;
+    const uint32_t static_fields = dex.readUleb128(offset);
+    const uint32_t instance_fields = dex.readUleb128(offset);
+    const uint32_t direct_methods = dex.readUleb128(offset);
+    const uint32_t virtual_methods = dex.readUleb128(offset);
+
+    // Указатели на поля попадают в DexCache, поэтому без перевыделений
+    klass->fields.reserve(static_cast<size_t>(static_fields) + instance_fields);
+    klass->statics.assign(static_fields, 0);
+
+    uint32_t field_idx = 0;
+    for (uint32_t i = 0; i < static_fields + instance_fields; ++i) {
+        if (i == static_fields) {
+            field_idx = 0;      // Разности индексов считаются заново для каждого списка
+        }
+        field_idx += dex.readUleb128(offset);
+        dex.readUleb128(offset);    // access_flags
+        const DexFieldId id = dex.fieldId(field_idx);
+
+        Field field;
+        field.owner = klass;
+        field.name = dex.string(id.name_idx);
+        field.type = dex.typeDescriptor(id.type_idx);
+        field.is_static = i < static_fields;
+        if (field.name.empty() || field.type.empty()) {
+            return false;
+        }
+        if (field.is_static) {
+            field.offset = i * 8;
+        } else {
+            const uint32_t size = valueSize(field.type[0]);
+            field.offset = (klass->object_size + size - 1) & ~(size - 1);
+            klass->object_size = field.offset + size;
+            if (isReference(field.type)) {
+                klass->reference_offsets.push_back(field.offset);
+            }
+        }
+        klass->fields.push_back(field);
+        if (field_idx < cache.fields.size()) {
+            cache.fields[field_idx] = &klass->fields.back();
+        }
+    }
+
+    uint32_t method_idx = 0;
+    for (uint32_t i = 0; i < direct_methods + virtual_methods; ++i) {
+        if (i == direct_methods) {
+            method_idx = 0;
+        }
+        method_idx += dex.readUleb128(offset);
+        const uint32_t access_flags = dex.readUleb128(offset);
+        const uint32_t code_off = dex.readUleb128(offset);
+        const DexMethodId id = dex.methodId(method_idx);
+
+        klass->methods.emplace_back();
+        Method& method = klass->methods.back();
+        method.owner = klass;
+        method.name = dex.string(id.name_idx);
+        method.shorty = dex.string(dex.protoId(id.proto_idx).shorty_idx);
+        method.signature = signatureOf(dex, id.proto_idx);
+        method.access_flags = access_flags;
+        method.method_idx = method_idx;
+        if (method.name.empty() || method.shorty.empty()) {
+            return false;
+        }
+
+        method.code = dex.codeItem(code_off);
+        if (method.code) {
+            method.registers_size = method.code->registers_size;
+            method.ins_size = method.code->ins_size;
+            method.tries_size = method.code->tries_size;
+            method.insns = DexView::insns(method.code);
+            method.insns_size = method.code->insns_size;
+            if (method.ins_size > method.registers_size) {
+                return false;
+            }
+        } else if (code_off != 0) {
+            return false;
+        } else {
+            method.ins_size = argumentWords(method.shorty) + (method.isStatic() ? 0 : 1);
+        }
+
+        if (method_idx < cache.methods.size()) {
+            cache.methods[method_idx] = &method;
+        }
+        if (i >= direct_methods) {
+            virtuals.push_back(&method);
+        }
+    }
+
+    return buildVtable(klass, virtuals);
+}
+
+bool ClassLinker::buildVtable(Class* klass, const std::vector<Method*>& virtuals) {
+    // У интерфейсов vtable нет: вызовы через них ищут реализацию по имени
+    if (klass->isInterface()) {
+        return true;
+    }
+    if (klass->super) {
+        klass->vtable = klass->super->vtable;
+    }
+    for (Method* method : virtuals) {
+        size_t slot = klass->vtable.size();
+        for (size_t i = 0; i < klass->vtable.size(); ++i) {
+            const Method* inherited = klass->vtable[i];
+            if (inherited->name == method->name && inherited->signature == method->signature) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot >= NO_VTABLE_INDEX) {
+            return false;
+        }
+        method->vtable_index = static_cast<uint16_t>(slot);
+        if (slot == klass->vtable.size()) {
+            klass->vtable.push_back(method);
+        } else {
+            klass->vtable[slot] = method;
+        }
+    }
+    return true;
+}
+
+Class* ClassLinker::resolveType(uint32_t dex, uint32_t type_idx) {
+    DexCache& cache = caches[dex];
+    if (type_idx >= cache.types.size()) {
+        return nullptr;
+    }
+    if (!cache.types[type_idx]) {
+        cache.types[type_idx] = findClass(cache.dex->typeDescriptor(type_idx));
+    }
+    return cache.types[type_idx];
+}
+
+Method* ClassLinker::findMethod(Class* klass, std::string_view name, std::string_view signature) const {
+    for (Class* current = klass; current; current = current->super) {
+        for (Method& method : current->methods) {
+            if (method.name == name && method.signature == signature) {
+                return &method;
+            }
+        }
+    }
+    // Методы интерфейсов (в том числе default)
+    for (Class* current = klass; current; current = current->super) {
+        for (Class* interface : current->interfaces) {
+            if (Method* method = findMethod(interface, name, signature)) {
+                return method;
+            }
+        }
+    }
+    return nullptr;
+}
+
+Method* ClassLinker::stubMethod(Class* klass, const DexView& dex, const DexMethodId& id) {
+    // Заглушка объявляется в ближайшем классе платформы
+    Class* owner = klass;
+    while (owner && !owner->stub) {
+        owner = owner->super;
+    }
+    if (!owner) {
+        return nullptr;
+    }
+
+    owner->methods.emplace_back();
+    Method& method = owner->methods.back();
+    method.owner = owner;
+    method.name = dex.string(id.name_idx);
+    method.shorty = dex.string(dex.protoId(id.proto_idx).shorty_idx);
+    method.signature = signatureOf(dex, id.proto_idx);
+    method.ins_size = argumentWords(method.shorty);
+    method.stub = true;
+    return &method;
+}
+
+Method* ClassLinker::resolveMethod(uint32_t dex, uint32_t method_idx) {
+    DexCache& cache = caches[dex];
+    if (method_idx >= cache.methods.size()) {
+        return nullptr;
+    }
+    if (cache.methods[method_idx]) {
+        return cache.methods[method_idx];
+    }
+
+    const DexMethodId id = cache.dex->methodId(method_idx);
+    Class* klass = resolveType(dex, id.class_idx);
+    if (!klass) {
+        return nullptr;
+    }
+    const std::string_view name = cache.dex->string(id.name_idx);
+    const std::string signature = signatureOf(*cache.dex, id.proto_idx);
+    Method* method = findMethod(klass, name, signature);
+    if (!method) {
+        method = stubMethod(klass, *cache.dex, id);
+    }
+    cache.methods[method_idx] = method;
+    return method;
+}
+
+const Field* ClassLinker::resolveField(uint32_t dex, uint32_t field_idx, bool is_static) {
+    DexCache& cache = caches[dex];
+    if (field_idx >= cache.fields.size()) {
+        return nullptr;
+    }
+    const Field* cached = cache.fields[field_idx];
+    if (cached) {
+        return cached->is_static == is_static ? cached : nullptr;
+    }
+
+    const DexFieldId id = cache.dex->fieldId(field_idx);
+    Class* klass = resolveType(dex, id.class_idx);
+    const std::string_view name = cache.dex->string(id.name_idx);
+    const std::string_view type = cache.dex->typeDescriptor(id.type_idx);
+    for (Class* current = klass; current; current = current->super) {
+        for (const Field& field : current->fields) {
+            if (field.name == name && field.type == type) {
+                cache.fields[field_idx] = &field;
+                return field.is_static == is_static ? &field : nullptr;
+            }
+        }
+    }
+    // Константы интерфейсов
+    if (klass && is_static) {
+        for (Class* interface : klass->interfaces) {
+            for (const Field& field : interface->fields) {
+                if (field.is_static && field.name == name && field.type == type) {
+                    cache.fields[field_idx] = &field;
+                    return &field;
+                }
+            }
+        }
+    }
+    return nullptr;
+}
+
+ObjectRef ClassLinker::resolveString(uint32_t dex, uint32_t string_idx) {
+    DexCache& cache = caches[dex];
+    if (string_idx >= cache.strings.size()) {
+        return NULL_REF;
+    }
+    if (cache.strings[string_idx] == NULL_REF) {
+        cache.strings[string_idx] = allocString(cache.dex->string(string_idx));
+    }
+    return cache.strings[string_idx];
+}
+
+Method* ClassLinker::findImplementation(Class* klass, const Method* method) {
+    if (method->vtable_index != NO_VTABLE_INDEX && method->vtable_index < klass->vtable.size()) {
+        return klass->vtable[method->vtable_index];
+    }
+    auto it = klass->interface_cache.find(method);
+    if (it != klass->interface_cache.end()) {
+        return it->second;
+    }
+    Method* found = findMethod(klass, method->name, method->signature);
+    if (!found) {
+        found = const_cast<Method*>(method);
+    }
+    klass->interface_cache.emplace(method, found);
+    return found;
+}
+
+void ClassLinker::initializeStatics(Class* klass) {
+    if (klass->stub || klass->dex == DEX_NO_INDEX) {
+        return;
+    }
+    const DexView& dex = *caches[klass->dex].dex;
+    const uint32_t values_off = dex.classDef(klass->class_def).static_values_off;
+    if (values_off == 0) {
+        return;
+    }
+
+    uint64_t offset = values_off;
+    const uint32_t count = dex.readUleb128(offset);
+    for (uint32_t i = 0; i < count && i < klass->statics.size(); ++i) {
+        const uint8_t header = dex.read8(offset++);
+        const uint32_t type = header & 0x1f;
+        const uint32_t arg = header >> 5;
+        const uint32_t size = arg + 1;
+
+        uint64_t raw = 0;
+        if (type != 0x1e && type != 0x1f) {
+            for (uint32_t b = 0; b < size; ++b) {
+                raw |= static_cast<uint64_t>(dex.read8(offset++)) << (b * 8);
+            }
+        }
+
+        uint64_t value = 0;
+        switch (type) {
+            case 0x00:  // byte
+            case 0x02:  // short
+            case 0x04:  // int
+            case 0x06: {    // long
+                const uint32_t shift = 64 - size * 8;
+                const int64_t extended = static_cast<int64_t>(raw << shift) >> shift;
+                value = type == 0x06 ? static_cast<uint64_t>(extended)
+                                     : static_cast<uint32_t>(extended);
+                break;
+            }
+            case 0x03:  // char
+                value = raw;
+                break;
+            case 0x10:  // float: значащие байты старшие
+                value = static_cast<uint32_t>(raw << ((4 - size) * 8));
+                break;
+            case 0x11:  // double
+                value = raw << ((8 - size) * 8);
+                break;
+            case 0x17:  // string
+                value = resolveString(klass->dex, static_cast<uint32_t>(raw));
+                break;
+            case 0x1e:  // null
+                break;
+            case 0x1f:  // boolean
+                value = arg;
+                break;
+            case 0x18:  // type: объектов Class пока нет, остается null
+                break;
+            default:
+                // Массивы и аннотации в статических значениях не встречаются у javac/d8
+                return;
+        }
+        klass->statics[i] = value;
+    }
+}
+
+ObjectRef ClassLinker::allocObject(Class* klass) {
+    Object* object = heap_.allocate(klass->object_size);
+    if (!object) {
+        return NULL_REF;
+    }
+    object->klass = klass;
+    return heap_.ref(object);
+}
+
+ObjectRef ClassLinker::allocArray(Class* array_class, int32_t length) {
+    const uint64_t bytes = sizeof(Object) + static_cast<uint64_t>(length) * array_class->component_size;
+    if (length < 0 || bytes > heap_.capacity()) {
+        return NULL_REF;
+    }
+    Object* object = heap_.allocate(static_cast<size_t>(bytes));
+    if (!object) {
+        return NULL_REF;
+    }
+    object->klass = array_class;
+    object->length = static_cast<uint32_t>(length);
+    return heap_.ref(object);
+}
+
+ObjectRef ClassLinker::allocString(std::string_view utf8) {
+    if (!string_class) {
+        string_class = findClass(STRING_DESCRIPTOR);
+    }
+    if (!string_class || utf8.size() > std::numeric_limits<uint32_t>::max()) {
+        return NULL_REF;
+    }
+    // Размер строки сборщик считает так же: не меньше object_size ее класса
+    Object* object = heap_.allocate(std::max<size_t>(string_class->object_size, sizeof(Object) + utf8.size()));
+    if (!object) {
+        return NULL_REF;
+    }
+    object->klass = string_class;
+    object->length = static_cast<uint32_t>(utf8.size());
+    std::memcpy(object + 1, utf8.data(), utf8.size());
+    return heap_.ref(object);
+}
+
+ObjectRef ClassLinker::classObject(Class* klass) {
+    if (klass->class_object == NULL_REF) {
+        if (Class* class_class = findClass("Ljava/lang/Class;")) {
+            klass->class_object = allocObject(class_class);
+        }
+    }
+    return klass->class_object;
+}
+
+bool ClassLinker::isAssignable(const Class* from, const Class* to) {
+    if (from == to) {
+        return true;
+    }
+    if (to->descriptor == OBJECT_DESCRIPTOR) {
+        return !isPrimitive(from->descriptor);
+    }
+    if (from->isArray()) {
+        if (!to->isArray()) {
+            return false;
+        }
+        // Массивы примитивов совместимы только сами с собой
+        if (from->component->descriptor.size() == 1 || to->component->descriptor.size() == 1) {
+            return false;
+        }
+        return isAssignable(from->component, to->component);
+    }
+    for (const Class* current = from; current; current = current->super) {
+        if (current == to) {
+            return true;
+        }
+        for (const Class* interface : current->interfaces) {
+            if (isAssignable(interface, to)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+} // namespace anexec
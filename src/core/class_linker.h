@@ -0,0 +1,182 @@
+#ifndef ANEXEC_CLASS_LINKER_H
+#define ANEXEC_CLASS_LINKER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "dex_file.h"
+#include "heap.h"
+
+namespace anexec {
+
+struct ApkImage;
+struct Class;
+struct JitCode;
+
+// Флаги доступа DEX
+constexpr uint32_t ACC_STATIC = 0x0008;
+constexpr uint32_t ACC_NATIVE = 0x0100;
+constexpr uint32_t ACC_INTERFACE = 0x0200;
+constexpr uint32_t ACC_ABSTRACT = 0x0400;
+constexpr uint32_t ACC_CONSTRUCTOR = 0x10000;
+
+constexpr uint16_t NO_VTABLE_INDEX = 0xFFFF;
+
+struct Field {
+    Class* owner;
+    std::string_view name;
+    std::string_view type;      // Дескриптор типа
+    uint32_t offset;            // В объекте или в статической области класса
+    bool is_static;
+};
+
+struct Method {
+    Class* owner{nullptr};
+    std::string_view name;
+    std::string_view shorty;    // "VIL": возвращаемый тип, затем параметры
+    std::string signature;      // "(ILjava/lang/String;)V"
+    uint32_t access_flags{0};
+    uint32_t method_idx{DEX_NO_INDEX};  // В method_ids DEX класса-владельца
+    uint16_t vtable_index{NO_VTABLE_INDEX};
+    uint16_t registers_size{0};
+    uint16_t ins_size{0};       // Слов аргументов, включая this
+    uint16_t tries_size{0};
+    const DexCodeItem* code{nullptr};
+    // Исполняемый код: исходный из DEX, после первого вызова - ускоренная копия
+    const uint16_t* insns{nullptr};
+    uint32_t insns_size{0};
+    std::unique_ptr<uint16_t[]> quickened;
+    bool prepared{false};
+    bool rejected{false};       // Код не прошел проверку: вызов бросает VerifyError
+    bool stub{false};           // Метод платформы без кода: вызов ничего не делает
+    uint32_t trace_name{0};     // name в Tracer, берется при первом событии
+    // Вызовы и обратные переходы для JIT; машинный код появляется
+    // в jit_code из потока компиляции (Jit::State в jit_state)
+    uint32_t hotness{0};
+    std::atomic<uint8_t> jit_state{0};
+    std::atomic<const JitCode*> jit_code{nullptr};
+
+    bool isStatic() const { return (access_flags & ACC_STATIC) != 0; }
+    bool isNative() const { return (access_flags & ACC_NATIVE) != 0; }
+    bool isAbstract() const { return (access_flags & ACC_ABSTRACT) != 0; }
+};
+
+struct Class {
+    enum class State : uint8_t {
+        Loaded,
+        Initializing,
+        Initialized,
+        Error
+    };
+
+    std::string name_storage;   // Для классов не из DEX (платформа, массивы)
+    std::string_view descriptor;
+    Class* super{nullptr};
+    Class* component{nullptr};  // Тип элементов массива
+    std::vector<Class*> interfaces;
+    uint32_t dex{DEX_NO_INDEX};
+    uint32_t class_def{DEX_NO_INDEX};
+    uint32_t access_flags{0};
+    uint32_t object_size{sizeof(Object)};
+    uint8_t component_size{0};  // Размер элемента массива, 0 - не массив
+    bool reference_elements{false};     // Массив ссылок
+    std::vector<uint32_t> reference_offsets;    // Поля-ссылки объекта, с полями предков
+    bool stub{false};           // Класс платформы: в образе его нет
+    State state{State::Loaded};
+    ObjectRef class_object{NULL_REF};   // Объект java.lang.Class, создается по запросу
+    uint32_t trace_name{0};     // descriptor в Tracer; 0 - запись была выключена
+
+    std::deque<Method> methods; // deque: указатели на методы не меняются
+    std::vector<Method*> vtable;
+    std::vector<Field> fields;
+    std::vector<uint64_t> statics;  // По 8 байт на статическое поле
+    std::unordered_map<const Method*, Method*> interface_cache;
+
+    bool isArray() const { return component_size != 0; }
+    bool isInterface() const { return (access_flags & ACC_INTERFACE) != 0; }
+    uint8_t* staticData() { return reinterpret_cast<uint8_t*>(statics.data()); }
+};
+
+// Разрешенные ссылки одного DEX по индексам DEX, заполняются при первом обращении
+struct DexCache {
+    const DexView* dex{nullptr};
+    std::vector<Class*> types;
+    std::vector<Method*> methods;
+    std::vector<const Field*> fields;
+    std::vector<ObjectRef> strings;
+};
+
+// Загрузка и линковка классов образа: раскладка полей, vtable и
+// разрешение ссылок DEX. Классов платформы в образе нет, вместо них
+// создаются заглушки, вызовы их методов ничего не делают.
+// Не потокобезопасен: используется потоком выполнения приложения.
+class ClassLinker {
+public:
+    explicit ClassLinker(Heap& heap);
+    ~ClassLinker();
+
+    // Запрещаем копирование
+    ClassLinker(const ClassLinker&) = delete;
+    ClassLinker& operator=(const ClassLinker&) = delete;
+
+    void attachImage(std::shared_ptr<const ApkImage> image);
+
+    // Дескриптор вида "Lcom/example/Main;" или "[I". Класс загружен и
+    // слинкован, но не инициализирован. nullptr - класс не загружается.
+    Class* findClass(std::string_view descriptor);
+
+    Class* resolveType(uint32_t dex, uint32_t type_idx);
+    Method* resolveMethod(uint32_t dex, uint32_t method_idx);
+    const Field* resolveField(uint32_t dex, uint32_t field_idx, bool is_static);
+    ObjectRef resolveString(uint32_t dex, uint32_t string_idx);
+
+    // Поиск по имени и сигнатуре в классе и его предках
+    Method* findMethod(Class* klass, std::string_view name, std::string_view signature) const;
+
+    // Реализация method для объекта класса klass (invoke-virtual/interface)
+    Method* findImplementation(Class* klass, const Method* method);
+
+    // Значения статических полей из static_values_off
+    void initializeStatics(Class* klass);
+
+    ObjectRef allocObject(Class* klass);
+    ObjectRef allocArray(Class* array_class, int32_t length);
+    ObjectRef allocString(std::string_view utf8);
+    ObjectRef classObject(Class* klass);
+
+    static bool isAssignable(const Class* from, const Class* to);
+
+    Heap& heap() { return heap_; }
+    const ApkImage* getImage() const { return image.get(); }
+    DexCache& dexCache(uint32_t dex) { return caches[dex]; }
+    size_t loadedClasses() const { return loaded_count; }
+
+private:
+    Class* defineClass(std::string_view descriptor);
+    Class* defineStub(std::string_view descriptor);
+    Class* defineArray(std::string_view descriptor);
+    bool linkClass(Class* klass, const DexView& dex);
+    bool linkMembers(Class* klass, const DexView& dex);
+    bool buildVtable(Class* klass, const std::vector<Method*>& virtuals);
+    std::string signatureOf(const DexView& dex, uint32_t proto_idx) const;
+    Method* stubMethod(Class* klass, const DexView& dex, const DexMethodId& id);
+
+    Heap& heap_;
+    std::shared_ptr<const ApkImage> image;
+    std::vector<DexCache> caches;
+    std::unordered_map<std::string_view, std::unique_ptr<Class>> classes;
+    Class* string_class{nullptr};
+    size_t loaded_count{0};
+    size_t root_source{0};
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_CLASS_LINKER_H
@@ -0,0 +1,329 @@
+#ifndef ANEXEC_DEX_FILE_H
+#define ANEXEC_DEX_FILE_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "mapped_region.h"
+
+namespace anexec {
+
+// Отображение DEX файла в память.
+// Для несжатых записей это окно прямо в файл APK (MAP_PRIVATE),
+// для сжатых - анонимная память с распакованными данными
+// либо файл из кэша распаковки. Несколько DEX могут ссылаться
+// на одну область (например, все DEX из одного файла кэша).
+class DexMapping {
+public:
+    DexMapping() = default;
+    DexMapping(std::string name, std::shared_ptr<const MappedRegion> region,
+               const uint8_t* data, size_t size, bool zero_copy)
+        : name_(std::move(name)), region_(std::move(region)),
+          data_(data), size_(size), zero_copy_(zero_copy) {}
+
+    void reset() {
+        region_.reset();
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    const std::string& name() const { return name_; }
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    size_t mappedSize() const { return region_ ? region_->size() : 0; }
+    bool isZeroCopy() const { return zero_copy_; }  // Отображено прямо из APK
+    bool empty() const { return data_ == nullptr; }
+    const std::shared_ptr<const MappedRegion>& region() const { return region_; }
+
+private:
+    std::string name_;
+    std::shared_ptr<const MappedRegion> region_;
+    const uint8_t* data_{nullptr};
+    size_t size_{0};
+    bool zero_copy_{false};
+};
+
+// Запись class_defs (class_def_item)
+struct DexClassDef {
+    uint32_t class_idx;
+    uint32_t access_flags;
+    uint32_t superclass_idx;
+    uint32_t interfaces_off;
+    uint32_t source_file_idx;
+    uint32_t annotations_off;
+    uint32_t class_data_off;
+    uint32_t static_values_off;
+};
+
+// Записи field_ids, method_ids и proto_ids
+struct DexFieldId {
+    uint16_t class_idx;
+    uint16_t type_idx;
+    uint32_t name_idx;
+};
+
+struct DexMethodId {
+    uint16_t class_idx;
+    uint16_t proto_idx;
+    uint32_t name_idx;
+};
+
+struct DexProtoId {
+    uint32_t shorty_idx;
+    uint32_t return_type_idx;
+    uint32_t parameters_off;
+};
+
+// Заголовок code_item; за ним insns_size 16-битных слов кода
+struct DexCodeItem {
+    uint16_t registers_size;
+    uint16_t ins_size;
+    uint16_t outs_size;
+    uint16_t tries_size;
+    uint32_t debug_info_off;
+    uint32_t insns_size;
+};
+
+// Запись tries; handler_off - смещение от начала списка обработчиков
+struct DexTryItem {
+    uint32_t start_addr;
+    uint16_t insn_count;
+    uint16_t handler_off;
+};
+
+constexpr uint32_t DEX_NO_INDEX = 0xFFFFFFFF;
+
+// Чтение таблиц DEX прямо из отображения, без копирования и разбора
+// целиком. Все смещения проверяются по размеру файла; некорректная
+// ссылка дает пустой результат, а не чтение за границей.
+class DexView {
+public:
+    DexView() = default;
+    DexView(const uint8_t* data, size_t size) { open(data, size); }
+
+    bool open(const uint8_t* data, size_t size) {
+        data_ = data;
+        size_ = size;
+        valid_ = false;
+        if (!data || size < HEADER_SIZE || std::memcmp(data, "dex\n", 4) != 0 ||
+            read32(ENDIAN_TAG_OFF) != ENDIAN_CONSTANT) {
+            return false;
+        }
+        string_ids_size_ = read32(STRING_IDS_SIZE_OFF);
+        string_ids_off_ = read32(STRING_IDS_OFF_OFF);
+        type_ids_size_ = read32(TYPE_IDS_SIZE_OFF);
+        type_ids_off_ = read32(TYPE_IDS_OFF_OFF);
+        method_ids_size_ = read32(METHOD_IDS_SIZE_OFF);
+        method_ids_off_ = read32(METHOD_IDS_OFF_OFF);
+        class_defs_size_ = read32(CLASS_DEFS_SIZE_OFF);
+        class_defs_off_ = read32(CLASS_DEFS_OFF_OFF);
+        proto_ids_size_ = read32(PROTO_IDS_SIZE_OFF);
+        proto_ids_off_ = read32(PROTO_IDS_OFF_OFF);
+        field_ids_size_ = read32(FIELD_IDS_SIZE_OFF);
+        field_ids_off_ = read32(FIELD_IDS_OFF_OFF);
+        valid_ = fits(string_ids_off_, uint64_t{string_ids_size_} * 4) &&
+                 fits(type_ids_off_, uint64_t{type_ids_size_} * 4) &&
+                 fits(proto_ids_off_, uint64_t{proto_ids_size_} * sizeof(DexProtoId)) &&
+                 fits(field_ids_off_, uint64_t{field_ids_size_} * sizeof(DexFieldId)) &&
+                 fits(method_ids_off_, uint64_t{method_ids_size_} * sizeof(DexMethodId)) &&
+                 fits(class_defs_off_, uint64_t{class_defs_size_} * sizeof(DexClassDef));
+        return valid_;
+    }
+
+    bool valid() const { return valid_; }
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    uint32_t checksum() const { return valid_ ? read32(CHECKSUM_OFF) : 0; }
+
+    uint32_t stringCount() const { return string_ids_size_; }
+    uint32_t typeCount() const { return type_ids_size_; }
+    uint32_t protoCount() const { return proto_ids_size_; }
+    uint32_t fieldCount() const { return field_ids_size_; }
+    uint32_t methodCount() const { return method_ids_size_; }
+    uint32_t classDefCount() const { return class_defs_size_; }
+
+    // Строка в MUTF-8 (для ASCII совпадает с UTF-8)
+    std::string_view string(uint32_t idx) const {
+        if (idx >= string_ids_size_) {
+            return {};
+        }
+        uint32_t offset = read32(string_ids_off_ + idx * 4);
+        // Длина в UTF-16 единицах (uleb128) нам не нужна: строка оканчивается нулем
+        for (int i = 0; i < 5 && offset < size_; ++i) {
+            if ((data_[offset++] & 0x80) == 0) {
+                break;
+            }
+        }
+        if (offset >= size_) {
+            return {};
+        }
+        const void* end = std::memchr(data_ + offset, 0, size_ - offset);
+        if (!end) {
+            return {};
+        }
+        return std::string_view(reinterpret_cast<const char*>(data_ + offset),
+                                static_cast<const uint8_t*>(end) - (data_ + offset));
+    }
+
+    // Дескриптор типа, например "Landroid/app/Activity;"
+    std::string_view typeDescriptor(uint32_t type_idx) const {
+        if (type_idx >= type_ids_size_) {
+            return {};
+        }
+        return string(read32(type_ids_off_ + type_idx * 4));
+    }
+
+    DexClassDef classDef(uint32_t idx) const {
+        DexClassDef def{};
+        if (idx < class_defs_size_) {
+            std::memcpy(&def, data_ + class_defs_off_ + idx * sizeof(DexClassDef), sizeof(def));
+        }
+        return def;
+    }
+
+    DexFieldId fieldId(uint32_t idx) const {
+        DexFieldId id{};
+        if (idx < field_ids_size_) {
+            std::memcpy(&id, data_ + field_ids_off_ + idx * sizeof(DexFieldId), sizeof(id));
+        }
+        return id;
+    }
+
+    DexMethodId methodId(uint32_t idx) const {
+        DexMethodId id{};
+        if (idx < method_ids_size_) {
+            std::memcpy(&id, data_ + method_ids_off_ + idx * sizeof(DexMethodId), sizeof(id));
+        }
+        return id;
+    }
+
+    DexProtoId protoId(uint32_t idx) const {
+        DexProtoId id{};
+        if (idx < proto_ids_size_) {
+            std::memcpy(&id, data_ + proto_ids_off_ + idx * sizeof(DexProtoId), sizeof(id));
+        }
+        return id;
+    }
+
+    // Код метода или nullptr; возвращаемый указатель выровнен на 4,
+    // insns проверены по размеру файла
+    const DexCodeItem* codeItem(uint32_t offset) const {
+        if (offset == 0 || (offset & 3) != 0 || !fits(offset, sizeof(DexCodeItem))) {
+            return nullptr;
+        }
+        const auto* code = reinterpret_cast<const DexCodeItem*>(data_ + offset);
+        if (!fits(offset + sizeof(DexCodeItem), uint64_t{code->insns_size} * 2)) {
+            return nullptr;
+        }
+        return code;
+    }
+
+    static const uint16_t* insns(const DexCodeItem* code) {
+        return reinterpret_cast<const uint16_t*>(code + 1);
+    }
+
+    // tries идут после insns (с выравниванием на 4), за ними обработчики
+    uint64_t triesOffset(const DexCodeItem* code) const {
+        uint64_t offset = static_cast<uint64_t>(reinterpret_cast<const uint8_t*>(insns(code)) - data_) +
+                          uint64_t{code->insns_size} * 2;
+        return (offset + 3) & ~uint64_t{3};
+    }
+
+    // uleb128; offset сдвигается за прочитанное значение
+    uint32_t readUleb128(uint64_t& offset) const {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 35 && offset < size_; shift += 7) {
+            const uint8_t byte = data_[offset++];
+            value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+        return value;
+    }
+
+    int32_t readSleb128(uint64_t& offset) const {
+        uint32_t value = 0;
+        int shift = 0;
+        uint8_t byte = 0;
+        for (; shift < 35 && offset < size_; shift += 7) {
+            byte = data_[offset++];
+            value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                shift += 7;
+                break;
+            }
+        }
+        if (shift < 32 && (byte & 0x40) != 0) {
+            value |= ~uint32_t{0} << shift;
+        }
+        return static_cast<int32_t>(value);
+    }
+
+    uint32_t read32(uint64_t offset) const {
+        uint32_t value = 0;
+        if (offset + 4 <= size_) {
+            std::memcpy(&value, data_ + offset, 4);
+        }
+        return value;
+    }
+
+    uint16_t read16(uint64_t offset) const {
+        uint16_t value = 0;
+        if (offset + 2 <= size_) {
+            std::memcpy(&value, data_ + offset, 2);
+        }
+        return value;
+    }
+
+    uint8_t read8(uint64_t offset) const {
+        return offset < size_ ? data_[offset] : 0;
+    }
+
+private:
+    static constexpr size_t HEADER_SIZE = 0x70;
+    static constexpr size_t CHECKSUM_OFF = 8;
+    static constexpr size_t ENDIAN_TAG_OFF = 40;
+    static constexpr size_t STRING_IDS_SIZE_OFF = 56;
+    static constexpr size_t STRING_IDS_OFF_OFF = 60;
+    static constexpr size_t TYPE_IDS_SIZE_OFF = 64;
+    static constexpr size_t TYPE_IDS_OFF_OFF = 68;
+    static constexpr size_t PROTO_IDS_SIZE_OFF = 72;
+    static constexpr size_t PROTO_IDS_OFF_OFF = 76;
+    static constexpr size_t FIELD_IDS_SIZE_OFF = 80;
+    static constexpr size_t FIELD_IDS_OFF_OFF = 84;
+    static constexpr size_t METHOD_IDS_SIZE_OFF = 88;
+    static constexpr size_t METHOD_IDS_OFF_OFF = 92;
+    static constexpr size_t CLASS_DEFS_SIZE_OFF = 96;
+    static constexpr size_t CLASS_DEFS_OFF_OFF = 100;
+    static constexpr uint32_t ENDIAN_CONSTANT = 0x12345678;
+
+    bool fits(uint64_t offset, uint64_t bytes) const {
+        return offset + bytes <= size_;
+    }
+
+    const uint8_t* data_{nullptr};
+    size_t size_{0};
+    bool valid_{false};
+    uint32_t string_ids_size_{0};
+    uint32_t string_ids_off_{0};
+    uint32_t type_ids_size_{0};
+    uint32_t type_ids_off_{0};
+    uint32_t proto_ids_size_{0};
+    uint32_t proto_ids_off_{0};
+    uint32_t field_ids_size_{0};
+    uint32_t field_ids_off_{0};
+    uint32_t method_ids_size_{0};
+    uint32_t method_ids_off_{0};
+    uint32_t class_defs_size_{0};
+    uint32_t class_defs_off_{0};
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_DEX_FILE_H
@@ -0,0 +1,71 @@
+#ifndef ANEXEC_DEX_INSTRUCTIONS_H
+#define ANEXEC_DEX_INSTRUCTIONS_H
+
+#include <cstdint>
+
+namespace anexec {
+
+// Ширина инструкций в 16-битных словах по опкоду
+inline constexpr uint8_t INSTRUCTION_WIDTH[256] = {
+    1, 1, 2, 3, 1, 2, 3, 1, 2, 3, 1, 1, 1, 1, 1, 1,  // 00
+    1, 1, 1, 2, 3, 2, 2, 3, 5, 2, 2, 3, 2, 1, 1, 2,  // 10
+    2, 1, 2, 2, 3, 3, 3, 1, 1, 2, 3, 3, 3, 2, 2, 2,  // 20
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1,  // 30
+    1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,  // 40
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,  // 50
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3,  // 60
+    3, 3, 3, 1, 3, 3, 3, 3, 3, 1, 1, 1, 1, 1, 1, 1,  // 70
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // 80
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,  // 90
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,  // a0
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // b0
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // c0
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,  // d0
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 2, 2, 2, 2, 2,  // e0
+    2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1  // f0
+};
+
+enum Opcode : uint8_t {
+    OP_NOP = 0x00,
+    OP_IGET = 0x52,
+    OP_IPUT_SHORT = 0x5f,
+    OP_INVOKE_VIRTUAL = 0x6e,
+    OP_INVOKE_VIRTUAL_RANGE = 0x74,
+    OP_INVOKE_VIRTUAL_QUICK = 0xe9,
+    OP_INVOKE_VIRTUAL_RANGE_QUICK = 0xea
+};
+
+// Ускоренные варианты iget..iput-short (0x52-0x5f), нумерация как в odex
+inline constexpr uint8_t QUICK_FIELD_OPCODE[14] = {
+    0xe3, 0xe4, 0xe5, 0xef, 0xf0, 0xf1, 0xf2,   // iget, -wide, -object, -boolean, -byte, -char, -short
+    0xe6, 0xe7, 0xe8, 0xeb, 0xec, 0xed, 0xee    // iput, ...
+};
+
+constexpr uint16_t PACKED_SWITCH_PAYLOAD = 0x0100;
+constexpr uint16_t SPARSE_SWITCH_PAYLOAD = 0x0200;
+constexpr uint16_t FILL_ARRAY_DATA_PAYLOAD = 0x0300;
+
+// 32-битный операнд из двух слов кода
+inline int32_t read32(const uint16_t* units) {
+    return static_cast<int32_t>(units[0] | static_cast<uint32_t>(units[1]) << 16);
+}
+
+// Размер псевдоинструкции с данными (switch, fill-array-data) в словах
+inline uint32_t payloadWidth(const uint16_t* insn) {
+    switch (insn[0]) {
+        case PACKED_SWITCH_PAYLOAD:
+            return insn[1] * 2u + 4;
+        case SPARSE_SWITCH_PAYLOAD:
+            return insn[1] * 4u + 2;
+        case FILL_ARRAY_DATA_PAYLOAD: {
+            const uint64_t count = static_cast<uint32_t>(read32(insn + 2));
+            return static_cast<uint32_t>(4 + (count * insn[1] + 1) / 2);
+        }
+        default:
+            return 1;
+    }
+}
+
+} // namespace anexec
+
+#endif // ANEXEC_DEX_INSTRUCTIONS_H
@@ -1,82 +1,496 @@
 #include "executor.h"
+#include "apk_archive.h"
+#include "apk_image.h"
+#include "dex_file.h"
+#include "extraction_cache.h"
+#include "looper.h"
+#include "native_loader.h"
+#include "resource_monitor.h"
+#include "seqlock.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "../android/manifest_parser.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <iostream>
+#include <mutex>
 #include <zip.h>
-#include <dlfcn.h>
+#include <pthread.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/mman.h>
 
 namespace anexec {
 
+namespace {
+
+// Индекс классов хранится в кэше распаковки отдельным файлом: он нужен
+// и APK без сжатых DEX, у которых своего файла кэша нет
+constexpr uint64_t CLASS_INDEX_KEY_SALT = 0x636c617373696478ULL;   // "classidx"
+constexpr const char* CLASS_INDEX_ENTRY = "class.index";
+
+// Разбор бинарного манифеста прямо из отображения записи ZIP.
+// Общая часть loadApk и inspectApk; парсер, буфер и manifest принадлежат
+// вызывающему и переиспользуются: parse() очищает manifest, сохраняя
+// емкость списка разрешений.
+bool readManifest(const ApkArchive& archive, ManifestParser& parser, std::vector<uint8_t>& buffer,
+                  ManifestInfo& manifest, ApkInfo& info, std::string& error) {
+    const ZipEntry* entry = archive.find("AndroidManifest.xml");
+    if (!entry || entry->size == 0) {
+        error = "AndroidManifest.xml not found";
+        return false;
+    }
+
+    const uint8_t* data = nullptr;
+    std::shared_ptr<const MappedRegion> region;
+    if (entry->isStored()) {
+        region = archive.mapRaw(*entry, data);
+    } else if (archive.inflate(*entry, buffer)) {
+        data = buffer.data();
+    }
+    if (!data) {
+        error = "Failed to read AndroidManifest.xml";
+        return false;
+    }
+
+    if (!parser.parse(data, static_cast<size_t>(entry->size), manifest)) {
+        error = "Invalid AndroidManifest.xml: " + parser.lastError();
+        return false;
+    }
+
+    info.package_name = manifest.package_name;
+    info.version_name = manifest.version_name;
+    info.version_code = manifest.version_code;
+    info.min_sdk = manifest.min_sdk;
+    info.target_sdk = manifest.target_sdk;
+    info.main_activity = manifest.main_activity;
+    info.permissions.assign(manifest.permissions.begin(), manifest.permissions.end());
+    return true;
+}
+
+} // namespace
+
 class Executor::Impl {
 private:
     ApkInfo apk_info;
-    ExecutionState state;
+    std::atomic<ExecutionState> state;
     ExecutorConfig config;
     std::string last_error;
     EventCallback event_callback;
     ErrorCallback error_callback;
-    bool is_running;
-    void* dex_data;
-    size_t dex_size;
-    std::vector<void*> loaded_libs;
+    Looper looper;
+    ApkArchive archive;
+    std::shared_ptr<const ApkImage> image;  // Общий для исполнителей одного APK
+    ManifestParser manifest_parser;
+    std::vector<uint8_t> manifest_buffer;
+    ManifestInfo manifest_info;     // Для readManifest; строки после разбора не используются
+
+    // Статистика
+    std::atomic<uint64_t> dex_memory{0};
+    std::atomic<int64_t> start_time{0};
+    clockid_t runtime_cpu_clock{};
+    std::atomic<bool> has_cpu_clock{false};
+    mutable int64_t last_cpu_sample{0};
+    mutable int64_t last_wall_sample{0};
+    mutable std::mutex sample_mutex;
+    mutable SeqLock<Statistics> snapshot;
+    Looper::TimerId statistics_timer{0};    // Следующая публикация; 0 - не запланирована
+    NativeLoader native_loader;  // lib/<abi>/*.so, загружаются по требованию
+
+    // Разрешения: запрошенные манифестом, допустимые по конфигурации и выданные
+    PermissionSet requested_permissions;
+    PermissionSet allowed_permissions;
+    PermissionSet permissions;
 
     void updateState(ExecutionState new_state) {
-        state = new_state;
+        state.store(new_state, std::memory_order_release);
+        notifyState(new_state);
+    }
+
+    void notifyState(ExecutionState new_state) {
         if (event_callback) {
-            event_callback("State changed to: " + std::to_string(static_cast<int>(state)));
+            event_callback("State changed to: " + std::to_string(static_cast<int>(new_state)));
+        }
+    }
+
+    // Переход только из ожидаемого состояния: pause/resume и execute могут гоняться
+    bool transitionState(ExecutionState from, ExecutionState to) {
+        if (!state.compare_exchange_strong(from, to, std::memory_order_acq_rel)) {
+            return false;
+        }
+        notifyState(to);
+        return true;
+    }
+
+    // Периодическая публикация статистики; без интервала цикл не просыпается.
+    // Таймер отменяется в finish(): иначе он пережил бы остановку и будил
+    // цикл, который снова запустят start() или execute().
+    void scheduleStatistics() {
+        if (config.statistics_interval_ms == 0) {
+            return;
+        }
+        statistics_timer = looper.postDelayed([this]() {
+            statistics_timer = 0;
+            getStatistics();
+            scheduleStatistics();
+        }, std::chrono::milliseconds(config.statistics_interval_ms));
+    }
+
+    void cancelStatistics() {
+        if (statistics_timer != 0) {
+            looper.cancel(statistics_timer);
+            statistics_timer = 0;
         }
     }
 
-    bool extractDex(const std::string& apk_path) {
-        int err = 0;
-        zip* z = zip_open(apk_path.c_str(), 0, &err);
-        if (!z) {
-            last_error = "Failed to open APK file";
+    // Несжатая запись отображается прямо из файла APK, без копирования
+    bool mapStoredEntry(const ZipEntry& entry, DexMapping& out) {
+        const uint8_t* data = nullptr;
+        auto region = archive.mapRaw(entry, data);
+        if (!region) {
+            last_error = "Failed to map " + entry.name;
+            return false;
+        }
+
+        out = DexMapping(entry.name, std::move(region), data,
+                         static_cast<size_t>(entry.size), true);
+        return true;
+    }
+
+    // Сжатая запись распаковывается потоком в анонимную память.
+    // Вызывается из рабочих потоков, поэтому ошибку возвращаем через error.
+    static bool inflateEntry(zip_t* z, const ZipEntry& entry,
+                             DexMapping& out, std::string& error) {
+        const size_t size = static_cast<size_t>(entry.size);
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED) {
+            error = "Failed to allocate memory for " + entry.name;
             return false;
         }
+        auto region = std::make_shared<const MappedRegion>(data, size);
+
+        bool ok = false;
+        zip_file_t* file = zip_fopen(z, entry.name.c_str(), 0);
+        if (file) {
+            auto* cursor = static_cast<uint8_t*>(data);
+            size_t remaining = size;
+            while (remaining > 0) {
+                zip_int64_t n = zip_fread(file, cursor, remaining);
+                if (n <= 0) {
+                    break;
+                }
+                cursor += n;
+                remaining -= static_cast<size_t>(n);
+            }
+            ok = remaining == 0;
+            zip_fclose(file);
+        }
+
+        if (!ok) {
+            error = "Failed to decompress " + entry.name;
+            return false;
+        }
+
+        mprotect(data, size, PROT_READ);
+        out = DexMapping(entry.name, region, region->data(), size, false);
+        return true;
+    }
+
+    // classes.dex -> 1, classesN.dex -> N (N >= 2), иначе 0
+    static int dexIndex(const std::string& name) {
+        static const std::string prefix = "classes";
+        static const std::string suffix = ".dex";
+        if (name.size() < prefix.size() + suffix.size() ||
+            name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            return 0;
+        }
+
+        const std::string digits = name.substr(prefix.size(),
+            name.size() - prefix.size() - suffix.size());
+        if (digits.empty()) {
+            return 1;
+        }
+        if (digits[0] == '0' || digits.size() > 4 ||
+            digits.find_first_not_of("0123456789") != std::string::npos) {
+            return 0;
+        }
+        int index = std::stoi(digits);
+        return index >= 2 ? index : 0;
+    }
 
-        struct zip_stat st;
-        zip_stat_init(&st);
-        
-        if (zip_stat(z, "classes.dex", 0, &st) == 0) {
-            dex_size = st.size;
-            dex_data = mmap(nullptr, dex_size, 
-                           PROT_READ | PROT_WRITE, 
-                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-            
-            if (dex_data == MAP_FAILED) {
+    struct InflateJob {
+        const ZipEntry* entry;
+        DexMapping* out;
+    };
+
+    // Распаковка сжатых записей параллельно. У каждого потока свой zip_t,
+    // потому что дескрипторы libzip не потокобезопасны.
+    bool inflateParallel(const std::vector<InflateJob>& jobs) {
+        std::vector<std::string> errors(jobs.size());
+        std::atomic<size_t> next{0};
+
+        auto worker = [&]() {
+            int err = 0;
+            zip_t* z = zip_open(archive.path().c_str(), ZIP_RDONLY, &err);
+            for (size_t i = next++; i < jobs.size(); i = next++) {
+                if (!z) {
+                    errors[i] = "Failed to open APK file";
+                    continue;
+                }
+                inflateEntry(z, *jobs[i].entry, *jobs[i].out, errors[i]);
+            }
+            if (z) {
                 zip_close(z);
-                last_error = "Failed to allocate memory for DEX";
+            }
+        };
+
+        // Текущий поток тоже распаковывает, пул добавляет остальных
+        ThreadPool& pool = ThreadPool::shared();
+        const size_t workers = std::min(jobs.size(), pool.size() + 1);
+        {
+            TaskGroup group(pool);
+            for (size_t i = 1; i < workers; ++i) {
+                group.run(worker);
+            }
+            worker();
+            group.wait();
+        }
+
+        for (const auto& error : errors) {
+            if (!error.empty()) {
+                last_error = error;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Попытка взять все сжатые записи из кэша одним mmap
+    bool loadFromCache(ExtractionCache& cache, uint64_t key,
+                       const std::vector<InflateJob>& jobs) {
+        CachedBlob blob;
+        if (!cache.load(key, blob)) {
+            return false;
+        }
+
+        for (const auto& job : jobs) {
+            const CachedBlob::Item* item = blob.find(job.entry->name);
+            if (!item || item->size != job.entry->size || item->crc32 != job.entry->crc32) {
                 return false;
             }
+        }
+
+        for (const auto& job : jobs) {
+            const CachedBlob::Item* item = blob.find(job.entry->name);
+            *job.out = DexMapping(item->name, blob.region(), item->data,
+                                  static_cast<size_t>(item->size), false);
+        }
+        return true;
+    }
+
+    void storeToCache(ExtractionCache& cache, uint64_t key,
+                      const std::vector<InflateJob>& jobs) {
+        std::vector<ExtractionCache::StoreItem> items;
+        items.reserve(jobs.size());
+        for (const auto& job : jobs) {
+            items.push_back(ExtractionCache::StoreItem{
+                job.entry->name, job.out->data(), job.out->size(), job.entry->crc32
+            });
+        }
+
+        // Ошибка записи кэша не мешает запуску
+        if (!cache.store(key, items) && event_callback) {
+            event_callback("Failed to write extraction cache " + cache.blobPath(key));
+        }
+    }
+
+    bool parseManifest() {
+        TraceScope trace(TraceEvent::ManifestParse);
+        if (!readManifest(archive, manifest_parser, manifest_buffer, manifest_info, apk_info, last_error)) {
+            return false;
+        }
+        requested_permissions.clear();
+        for (const auto& permission : apk_info.permissions) {
+            // Номера разрешений приложений кончились: такое разрешение не
+            // выдать, о чем и сообщаем вместо молчаливого отказа
+            if (!requested_permissions.grant(permission) && event_callback) {
+                event_callback("Permission table is full, not requested: " + permission);
+            }
+        }
+        computePermissions();
+        return true;
+    }
+
+    bool permissionAllowed(PermissionId id) const {
+        return config.allowed_permissions.empty() || allowed_permissions.has(id);
+    }
+
+    // Выданные = запрошенные, кроме не разрешенных конфигурацией
+    void computePermissions() {
+        permissions.clear();
+        for (const auto& permission : apk_info.permissions) {
+            const PermissionId id = findPermission(permission);
+            if (permissionAllowed(id)) {
+                permissions.grant(id);
+            }
+        }
+    }
+
+    static int64_t monotonicNanos() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    }
+
+    void releaseMappings() {
+        dex_memory.store(0, std::memory_order_relaxed);
+        image.reset();
+    }
 
-            zip_file* dex_file = zip_fopen(z, "classes.dex", 0);
-            if (dex_file) {
-                zip_fread(dex_file, dex_data, st.size);
-                zip_fclose(dex_file);
+    // Образ APK: из реестра, если этот APK уже загружен другим исполнителем
+    bool loadImage() {
+        releaseMappings();
+
+        // Ключ по содержимому: копии одного APK тоже делят образ
+        const uint64_t key = ExtractionCache::computeKey(archive);
+        std::shared_ptr<const ApkImage> loaded;
+        if (config.share_images) {
+            bool loaded_here = false;
+            loaded = ImageRegistry::instance().acquire(key, [&]() {
+                loaded_here = true;
+                return buildImage(key);
+            });
+            // Чужая загрузка не удалась: повторяем сами, чтобы получить свою ошибку
+            if (!loaded && !loaded_here) {
+                loaded = buildImage(key);
             }
+        } else {
+            loaded = buildImage(key);
+        }
+        if (!loaded) {
+            return false;
         }
 
-        zip_close(z);
+        image = std::move(loaded);
+        dex_memory.store(image->dex_memory, std::memory_order_relaxed);
         return true;
     }
 
-public:
-    Impl() : state(ExecutionState::NotStarted), 
-             is_running(false), 
-             dex_data(nullptr), 
-             dex_size(0) {}
+    std::shared_ptr<ApkImage> buildImage(uint64_t key) {
+        auto built = std::make_shared<ApkImage>();
+        if (!extractDex(key, built->dex_files)) {
+            return nullptr;
+        }
+        buildClassIndex(key, *built);
+        built->account();
+        return built;
+    }
 
-    ~Impl() {
-        if (dex_data) {
-            munmap(dex_data, dex_size);
+    // Индекс из кэша, если он от тех же DEX; иначе разбор class_defs и запись.
+    // Без индекса APK запускается, но классы приложения не найдутся.
+    void buildClassIndex(uint64_t key, ApkImage& built) {
+        TraceScope trace(TraceEvent::ClassIndexBuild);
+        const bool use_cache = config.enable_extraction_cache && !config.data_dir.empty();
+        ExtractionCache cache(config.data_dir + "/cache/extracted", config.extraction_cache_limit);
+        const uint64_t index_key = key ^ CLASS_INDEX_KEY_SALT;
+        if (use_cache) {
+            CachedBlob blob;
+            if (cache.load(index_key, blob)) {
+                const CachedBlob::Item* item = blob.find(CLASS_INDEX_ENTRY);
+                if (item && built.class_index.load(built.dex_files, item->data,
+                                                   static_cast<size_t>(item->size), blob.region())) {
+                    return;
+                }
+            }
         }
-        for (void* lib : loaded_libs) {
-            dlclose(lib);
+
+        if (!built.class_index.build(built.dex_files)) {
+            if (event_callback) {
+                event_callback("Failed to index classes: malformed DEX");
+            }
+            return;
+        }
+        if (use_cache) {
+            const std::vector<uint8_t> bytes = built.class_index.serialize();
+            if (!cache.store(index_key, {{CLASS_INDEX_ENTRY, bytes.data(), bytes.size(), 0}}) &&
+                event_callback) {
+                event_callback("Failed to write class index " + cache.blobPath(index_key));
+            }
         }
     }
 
+    bool extractDex(uint64_t key, std::vector<DexMapping>& dex_files) {
+        TraceScope trace(TraceEvent::DexMap);
+        // Как и Android, загружаем classes.dex, classes2.dex, ... до первого пропуска
+        std::vector<std::pair<int, const ZipEntry*>> found;
+        for (const auto& entry : archive.entries()) {
+            if (int index = dexIndex(entry.name)) {
+                found.emplace_back(index, &entry);
+            }
+        }
+        std::sort(found.begin(), found.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        std::vector<const ZipEntry*> entries;
+        for (const auto& [index, entry] : found) {
+            if (index != static_cast<int>(entries.size()) + 1) {
+                break;
+            }
+            entries.push_back(entry);
+        }
+
+        dex_files.resize(entries.size());
+        std::vector<InflateJob> compressed;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const ZipEntry& entry = *entries[i];
+            if (entry.size == 0) {
+                last_error = "Empty " + entry.name;
+                return false;
+            }
+            if (entry.isStored()) {
+                if (!mapStoredEntry(entry, dex_files[i])) {
+                    return false;
+                }
+            } else {
+                compressed.push_back(InflateJob{&entry, &dex_files[i]});
+            }
+        }
+
+        if (compressed.empty()) {
+            return true;
+        }
+
+        // Всё, что пришлось бы распаковывать, сначала ищем в кэше
+        if (!config.enable_extraction_cache || config.data_dir.empty()) {
+            return inflateParallel(compressed);
+        }
+
+        ExtractionCache cache(config.data_dir + "/cache/extracted",
+                              config.extraction_cache_limit);
+        if (loadFromCache(cache, key, compressed)) {
+            return true;
+        }
+
+        if (!inflateParallel(compressed)) {
+            return false;
+        }
+        storeToCache(cache, key, compressed);
+        return true;
+    }
+
+public:
+    Impl() : state(ExecutionState::NotStarted) {}
+
+    ~Impl() {
+        native_loader.unloadAll();
+        releaseMappings();
+    }
+
     Result loadApk(const std::string& path) {
+        TraceScope trace(TraceEvent::ApkLoad);
         updateState(ExecutionState::Loading);
 
         try {
@@ -87,18 +501,30 @@ public:
             }
 
             // Заполняем базовую информацию об APK
+            apk_info = ApkInfo{};
             apk_info.apk_path = path;
             apk_info.load_time = std::chrono::system_clock::now();
-            
-            // Временно заполняем тестовыми данными
-            apk_info.package_name = "com.example.test";
-            apk_info.version_name = "1.0.0";
-            apk_info.version_code = 1;
-            apk_info.min_sdk = "21";
-            apk_info.target_sdk = "33";
-            apk_info.main_activity = "com.example.test.MainActivity";
-            
-            if (!extractDex(path)) {
+
+            // Библиотеки ссылаются на прежний архив
+            native_loader.unloadAll();
+            bool opened;
+            {
+                TraceScope open_trace(TraceEvent::ApkOpen);
+                opened = archive.open(path);
+            }
+            if (!opened) {
+                last_error = archive.lastError();
+                updateState(ExecutionState::Error);
+                return Result::InvalidApk;
+            }
+            native_loader.attach(&archive, utils::getArchitecture(), config.share_images);
+
+            if (!parseManifest()) {
+                updateState(ExecutionState::Error);
+                return Result::InvalidApk;
+            }
+
+            if (!loadImage()) {
                 updateState(ExecutionState::Error);
                 return Result::RuntimeError;
             }
@@ -114,48 +540,103 @@ public:
     }
 
     Result execute() {
+        Result result = start();
+        if (result != Result::Success) {
+            return result;
+        }
+
+        // Поток спит в epoll_wait, пока нет задач, таймеров или stop().
+        // Если stop() вызван до execute(), цикл сразу завершится.
         try {
-            updateState(ExecutionState::Running);
-            is_running = true;
+            looper.loop();
+        } catch (const std::exception& e) {
+            last_error = e.what();
+            finish(ExecutionState::Error);
+            return Result::RuntimeError;
+        }
+        finish(ExecutionState::Stopped);
+        return Result::Success;
+    }
 
-            while (is_running) {
-                // Здесь будет основной цикл выполнения
-                // Временно просто спим
-                usleep(100000);
-            }
+    Result start() {
+        updateState(ExecutionState::Running);
 
-            updateState(ExecutionState::Stopped);
-            return Result::Success;
+        // Часы CPU потока выполнения читаются из других потоков в getStatistics.
+        // Под ExecutorHost поток каждый раз другой, тогда загрузка CPU не считается.
+        if (pthread_getcpuclockid(pthread_self(), &runtime_cpu_clock) == 0) {
+            has_cpu_clock.store(true, std::memory_order_release);
+        }
+        start_time.store(monotonicNanos(), std::memory_order_release);
+        scheduleStatistics();
+        return Result::Success;
+    }
 
+    bool runOnce() {
+        try {
+            return looper.pollOnce(0);
         } catch (const std::exception& e) {
             last_error = e.what();
             updateState(ExecutionState::Error);
-            return Result::RuntimeError;
+            return false;
+        }
+    }
+
+    void finish(ExecutionState final_state) {
+        cancelStatistics();
+        looper.reset();
+        has_cpu_clock.store(false, std::memory_order_release);
+        if (getState() != ExecutionState::Error) {
+            updateState(final_state);
         }
     }
 
     void pause() {
-        if (state == ExecutionState::Running) {
-            updateState(ExecutionState::Paused);
+        if (transitionState(ExecutionState::Running, ExecutionState::Paused)) {
+            looper.wake();
         }
     }
 
     void resume() {
-        if (state == ExecutionState::Paused) {
-            updateState(ExecutionState::Running);
+        if (transitionState(ExecutionState::Paused, ExecutionState::Running)) {
+            looper.wake();
         }
     }
 
     void stop() {
-        is_running = false;
+        looper.quit();
+    }
+
+    Looper& getLooper() {
+        return looper;
+    }
+
+    bool loadLibrary(const std::string& name) {
+        if (!native_loader.loadLibrary(name)) {
+            last_error = native_loader.getLastError();
+            return false;
+        }
+        return true;
+    }
+
+    void* findNativeSymbol(const std::string& symbol) {
+        return native_loader.findSymbol(symbol);
     }
 
     ApkInfo getInfo() const {
         return apk_info;
     }
 
+    const std::vector<DexMapping>& getDexFiles() const {
+        static const std::vector<DexMapping> none;
+        return image ? image->dex_files : none;
+    }
+
+    std::shared_ptr<const ApkImage> getImage() const {
+        return image;
+    }
+
     ExecutionState getState() const {
-        return state;
+        return state.load(std::memory_order_acquire);
     }
 
     std::string getLastError() const {
@@ -164,6 +645,38 @@ public:
 
     void setConfig(const ExecutorConfig& new_config) {
         config = new_config;
+        allowed_permissions.clear();
+        for (const auto& permission : config.allowed_permissions) {
+            allowed_permissions.grant(permission);
+        }
+        computePermissions();
+    }
+
+    bool hasPermission(PermissionId id) const {
+        return permissions.has(id);
+    }
+
+    Result grantPermission(const std::string& permission) {
+        const PermissionId id = findPermission(permission);
+        if (id == INVALID_PERMISSION || !requested_permissions.has(id)) {
+            last_error = "Permission not requested in manifest: " + permission;
+            return Result::PermissionDenied;
+        }
+        if (!permissionAllowed(id)) {
+            last_error = "Permission not allowed by configuration: " + permission;
+            return Result::PermissionDenied;
+        }
+        permissions.grant(id);
+        return Result::Success;
+    }
+
+    Result revokePermission(const std::string& permission) {
+        permissions.revoke(findPermission(permission));
+        return Result::Success;
+    }
+
+    const PermissionSet& getPermissions() const {
+        return permissions;
     }
 
     ExecutorConfig getConfig() const {
@@ -178,21 +691,56 @@ public:
         error_callback = callback;
     }
 
+    // Снимает показания и публикует их в снимок для других потоков
     Statistics getStatistics() const {
+        std::lock_guard<std::mutex> lock(sample_mutex);
         Statistics stats{};
-        // Временно заполняем нулями
-        stats.memory_used = 0;
-        stats.peak_memory = 0;
-        stats.cpu_usage = 0.0;
+
+        const ResourceMonitor& monitor = ResourceMonitor::instance();
+        const ResourceMonitor::ProcessMemory memory = monitor.sampleProcessMemory();
+        stats.memory_used = memory.resident;
+        stats.peak_memory = memory.peak_resident;
+        stats.dex_memory = dex_memory.load(std::memory_order_relaxed);
+        stats.native_lib_memory = native_loader.loadedBytes();
+        stats.graphics_memory = monitor.get(MemoryCategory::GraphicsBuffers);
+
+        // Загрузка CPU потоком выполнения с прошлого замера
+        const int64_t wall_now = monotonicNanos();
+        if (has_cpu_clock.load(std::memory_order_acquire)) {
+            struct timespec ts;
+            if (clock_gettime(runtime_cpu_clock, &ts) == 0) {
+                const int64_t cpu_now = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+                if (last_wall_sample > 0 && wall_now > last_wall_sample) {
+                    stats.cpu_usage = static_cast<double>(cpu_now - last_cpu_sample) /
+                                      static_cast<double>(wall_now - last_wall_sample);
+                }
+                stats.cpu_time = std::chrono::milliseconds(cpu_now / 1000000);
+                last_cpu_sample = cpu_now;
+                last_wall_sample = wall_now;
+            }
+        }
+
+        // Сеть пока не эмулируется
         stats.network_rx = 0;
         stats.network_tx = 0;
-        stats.uptime = std::chrono::milliseconds(0);
+
+        const int64_t started = start_time.load(std::memory_order_acquire);
+        stats.uptime = std::chrono::milliseconds(started > 0 ? (wall_now - started) / 1000000 : 0);
+
+        snapshot.store(stats);
         return stats;
     }
+
+    Statistics getStatisticsSnapshot() const {
+        return snapshot.load();
+    }
 };
 
 // Реализация публичных методов класса Executor
 Executor::Executor() : impl(new Impl()) {}
+Executor::Executor(const ExecutorConfig& config) : impl(new Impl()) {
+    impl->setConfig(config);
+}
 Executor::~Executor() = default;
 
 Executor::Executor(Executor&& other) noexcept = default;
@@ -202,6 +750,32 @@ Result Executor::loadApk(const std::string& path) {
     return impl->loadApk(path);
 }
 
+Result Executor::inspectApk(const std::string& path, ApkInfo& info, std::string* error) {
+    // Для пакетного сканирования: у каждого потока свой парсер, буфер и результат
+    thread_local ManifestParser parser;
+    thread_local std::vector<uint8_t> buffer;
+    thread_local ManifestInfo manifest;
+
+    std::string message;
+    ApkArchive archive;
+    info = ApkInfo{};
+    info.apk_path = path;
+    info.load_time = std::chrono::system_clock::now();
+
+    Result result = Result::Success;
+    if (!archive.open(path)) {
+        message = archive.lastError();
+        result = Result::InvalidApk;
+    } else if (!readManifest(archive, parser, buffer, manifest, info, message)) {
+        result = Result::InvalidApk;
+    }
+
+    if (error) {
+        *error = std::move(message);
+    }
+    return result;
+}
+
 Result Executor::execute() {
     return impl->execute();
 }
@@ -218,10 +792,42 @@ void Executor::stop() {
     impl->stop();
 }
 
+Result Executor::start() {
+    return impl->start();
+}
+
+bool Executor::runOnce() {
+    return impl->runOnce();
+}
+
+void Executor::finish() {
+    impl->finish(ExecutionState::Stopped);
+}
+
+Looper& Executor::getLooper() {
+    return impl->getLooper();
+}
+
+bool Executor::loadLibrary(const std::string& name) {
+    return impl->loadLibrary(name);
+}
+
+void* Executor::findNativeSymbol(const std::string& symbol) {
+    return impl->findNativeSymbol(symbol);
+}
+
 ApkInfo Executor::getInfo() const {
     return impl->getInfo();
 }
 
+const std::vector<DexMapping>& Executor::getDexFiles() const {
+    return impl->getDexFiles();
+}
+
+std::shared_ptr<const ApkImage> Executor::getImage() const {
+    return impl->getImage();
+}
+
 ExecutionState Executor::getState() const {
     return impl->getState();
 }
@@ -246,14 +852,50 @@ void Executor::setErrorCallback(ErrorCallback callback) {
     impl->setErrorCallback(callback);
 }
 
+bool Executor::hasPermission(const std::string& permission) const {
+    return impl->hasPermission(findPermission(permission));
+}
+
+bool Executor::hasPermission(PermissionId permission) const {
+    return impl->hasPermission(permission);
+}
+
+Result Executor::grantPermission(const std::string& permission) {
+    return impl->grantPermission(permission);
+}
+
+Result Executor::revokePermission(const std::string& permission) {
+    return impl->revokePermission(permission);
+}
+
+const PermissionSet& Executor::getPermissions() const {
+    return impl->getPermissions();
+}
+
 Executor::Statistics Executor::getStatistics() const {
     return impl->getStatistics();
 }
 
+Executor::Statistics Executor::getStatisticsSnapshot() const {
+    return impl->getStatisticsSnapshot();
+}
+
 namespace utils {
     bool isApkCompatible(const ApkInfo& info) {
-        // Временная реализация
-        return true;
+        if (info.package_name.empty()) {
+            return false;
+        }
+
+        // Приложение не должно требовать API новее поддерживаемого
+        int min_sdk = 0;
+        int supported = std::stoi(getAndroidApiLevel());
+        auto [ptr, ec] = std::from_chars(info.min_sdk.data(),
+                                         info.min_sdk.data() + info.min_sdk.size(), min_sdk);
+        if (ec != std::errc() || ptr != info.min_sdk.data() + info.min_sdk.size()) {
+            // Кодовое имя предварительной версии (например, "UpsideDownCake")
+            return false;
+        }
+        return min_sdk <= supported;
     }
     
     std::string getArchitecture() {
@@ -8,8 +8,14 @@
 #include <filesystem>
 #include <chrono>
 
+#include "dex_file.h"
+#include "looper.h"
+#include "../android/permissions.h"
+
 namespace anexec {
 
+struct ApkImage;
+
 // Информация об APK файле
 struct ApkInfo {
     std::string package_name;        // Имя пакета
@@ -53,7 +59,11 @@ struct ExecutorConfig {
     bool enable_network{true};      // Включить сеть
     bool sandbox_mode{true};        // Режим песочницы
     std::string data_dir;           // Директория для данных
-    std::vector<std::string> allowed_permissions; // Разрешенные права
+    std::vector<std::string> allowed_permissions; // Разрешенные права (пусто - все из манифеста)
+    bool enable_extraction_cache{true};  // Кэш распакованных DEX в data_dir
+    uint64_t extraction_cache_limit{1024ull * 1024 * 1024}; // Размер кэша (1GB по умолчанию)
+    bool share_images{true};        // Общие отображения DEX/библиотек для одинаковых APK
+    uint32_t statistics_interval_ms{0}; // Период публикации статистики (0 - только по запросу)
 };
 
 class Executor {
@@ -73,13 +83,38 @@ public:
 
     // Основные операции
     Result loadApk(const std::string& path);
+
+    // Только открытие APK и разбор манифеста, без DEX и запуска.
+    // Потокобезопасна, предназначена для пакетной проверки APK.
+    static Result inspectApk(const std::string& path, ApkInfo& info,
+                             std::string* error = nullptr);
+
+    // Обрабатывает события цикла до stop(). stop()/pause()/resume()
+    // можно вызывать из любого потока, цикл просыпается сразу.
     Result execute();
     void pause();
     void resume();
     void stop();
 
+    // Пошаговое выполнение для ExecutorHost: start(), затем runOnce() каждый раз,
+    // когда дескриптор getLooper().getFd() готов к чтению, до false; затем finish().
+    // runOnce() не блокируется и не должен вызываться из двух потоков сразу.
+    Result start();
+    bool runOnce();
+    void finish();
+
+    // Цикл событий потока выполнения: post/postDelayed для задач в этом потоке
+    Looper& getLooper();
+
+    // System.loadLibrary("foo"): lib/<abi>/libfoo.so из APK при первом вызове
+    bool loadLibrary(const std::string& name);
+    void* findNativeSymbol(const std::string& symbol);
+
     // Получение информации
     ApkInfo getInfo() const;
+    const std::vector<DexMapping>& getDexFiles() const; // classes.dex, classes2.dex, ...
+    // DEX и индекс классов; общий с другими исполнителями того же APK
+    std::shared_ptr<const ApkImage> getImage() const;
     ExecutionState getState() const;
     std::string getLastError() const;
 
@@ -94,23 +129,35 @@ public:
     void setEventCallback(EventCallback callback);
     void setErrorCallback(ErrorCallback callback);
 
-    // Управление разрешениями
+    // Управление разрешениями. Набор считается один раз при загрузке APK:
+    // запрошенные в манифесте, ограниченные allowed_permissions.
+    // Проверки - O(1) по битовой маске, из любого потока.
     bool hasPermission(const std::string& permission) const;
+    bool hasPermission(PermissionId permission) const;
     Result grantPermission(const std::string& permission);
     Result revokePermission(const std::string& permission);
+    const PermissionSet& getPermissions() const;
 
     // Статистика
     struct Statistics {
-        size_t memory_used;         // Использованная память
+        size_t memory_used;         // Использованная память (RSS процесса)
         size_t peak_memory;         // Пиковое использование памяти
-        double cpu_usage;           // Использование CPU
+        size_t dex_memory;          // Отображения DEX (общие для одинаковых APK)
+        size_t native_lib_memory;   // Загруженные нативные библиотеки
+        size_t graphics_memory;     // Буферы и текстуры GL процесса
+        double cpu_usage;           // Доля ядра потоком выполнения с прошлого замера
+        std::chrono::milliseconds cpu_time; // Процессорное время потока выполнения
         uint64_t network_rx;        // Принятые данные
         uint64_t network_tx;        // Отправленные данные
         std::chrono::milliseconds uptime; // Время работы
     };
     
+    // Снимает новые показания (дешево, можно вызывать 10 раз в секунду)
     Statistics getStatistics() const;
 
+    // Последние опубликованные показания, читаются без блокировок из любого потока
+    Statistics getStatisticsSnapshot() const;
+
 private:
     class Impl;
     std::unique_ptr<Impl> impl;
@@ -0,0 +1,113 @@
+#include "executor_host.h"
+#include "looper.h"
+#include <vector>
+#include <sys/epoll.h>
+
+namespace anexec {
+
+class ExecutorHost::Impl {
+private:
+    ThreadPool& pool;
+    Looper looper;
+    std::vector<std::unique_ptr<Executor>> executors;
+    size_t active{0};
+
+    // EPOLLONESHOT: пока исполнитель работает в пуле, хост его не опрашивает
+    void watch(size_t index, TaskGroup& group) {
+        const int fd = executors[index]->getLooper().getFd();
+        looper.addFd(fd, EPOLLIN | EPOLLONESHOT, [this, index, &group](int, uint32_t) {
+            dispatch(index, group);
+        });
+    }
+
+    void dispatch(size_t index, TaskGroup& group) {
+        group.run([this, index, &group]() {
+            const bool alive = executors[index]->runOnce();
+            // Перевзвод и завершение - в потоке хоста, он владеет epoll
+            looper.post([this, index, alive, &group]() {
+                completed(index, alive, group);
+            });
+        });
+    }
+
+    void completed(size_t index, bool alive, TaskGroup& group) {
+        if (alive) {
+            watch(index, group);
+            return;
+        }
+
+        Executor& executor = *executors[index];
+        looper.removeFd(executor.getLooper().getFd());
+        executor.finish();
+        if (--active == 0) {
+            looper.quit();
+        }
+    }
+
+public:
+    explicit Impl(ThreadPool& thread_pool) : pool(thread_pool) {}
+
+    Executor& add(std::unique_ptr<Executor> executor) {
+        executors.push_back(std::move(executor));
+        return *executors.back();
+    }
+
+    size_t size() const {
+        return executors.size();
+    }
+
+    Executor& get(size_t index) {
+        return *executors.at(index);
+    }
+
+    Result run() {
+        if (executors.empty()) {
+            return Result::Success;
+        }
+
+        TaskGroup group(pool);
+        active = executors.size();
+        for (size_t i = 0; i < executors.size(); ++i) {
+            executors[i]->start();
+            watch(i, group);
+        }
+
+        // Цикл завершается, когда остановился последний исполнитель,
+        // поэтому незавершенных задач в пуле к этому моменту нет
+        looper.loop();
+        group.wait();
+        looper.reset();
+        return Result::Success;
+    }
+
+    void stop() {
+        for (auto& executor : executors) {
+            executor->stop();
+        }
+    }
+};
+
+ExecutorHost::ExecutorHost(ThreadPool& pool) : impl(new Impl(pool)) {}
+ExecutorHost::~ExecutorHost() = default;
+
+Executor& ExecutorHost::add(std::unique_ptr<Executor> executor) {
+    return impl->add(std::move(executor));
+}
+
+size_t ExecutorHost::size() const {
+    return impl->size();
+}
+
+Executor& ExecutorHost::get(size_t index) {
+    return impl->get(index);
+}
+
+Result ExecutorHost::run() {
+    return impl->run();
+}
+
+void ExecutorHost::stop() {
+    impl->stop();
+}
+
+} // namespace anexec
@@ -0,0 +1,43 @@
+#ifndef ANEXEC_EXECUTOR_HOST_H
+#define ANEXEC_EXECUTOR_HOST_H
+
+#include <memory>
+#include <cstddef>
+
+#include "executor.h"
+#include "thread_pool.h"
+
+namespace anexec {
+
+// Несколько исполнителей в одном процессе без отдельного потока на каждый.
+// Один поток хоста ждет дескрипторы циклов всех исполнителей в epoll,
+// готовые исполнители выполняются пулом потоков (каждый не более чем
+// в одном потоке одновременно). Одинаковые APK делят образ через ImageRegistry.
+class ExecutorHost {
+public:
+    explicit ExecutorHost(ThreadPool& pool = ThreadPool::shared());
+    ~ExecutorHost();
+
+    // Запрещаем копирование
+    ExecutorHost(const ExecutorHost&) = delete;
+    ExecutorHost& operator=(const ExecutorHost&) = delete;
+
+    // Добавляет исполнитель с уже загруженным APK. Только до run().
+    Executor& add(std::unique_ptr<Executor> executor);
+    size_t size() const;
+    Executor& get(size_t index);
+
+    // Обслуживает исполнители, пока все они не остановятся
+    Result run();
+
+    // Останавливает все исполнители; можно вызывать из любого потока
+    void stop();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_EXECUTOR_HOST_H
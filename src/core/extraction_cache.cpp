@@ -0,0 +1,315 @@
+#include "extraction_cache.h"
+#include "apk_archive.h"
+#include "hash.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+namespace anexec {
+
+namespace {
+
+constexpr char BLOB_MAGIC[8] = {'A', 'N', 'X', 'C', 'A', 'C', 'H', 'E'};
+constexpr uint32_t BLOB_VERSION = 2;
+constexpr const char* BLOB_SUFFIX = ".blob";
+constexpr const char* TMP_INFIX = ".tmp.";
+// Старше этого временный файл считается брошенным, даже если pid занят
+// новым процессом
+constexpr auto STALE_TMP_AGE = std::chrono::hours(1);
+
+struct BlobHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t item_count;
+    uint64_t key;
+    uint64_t file_size;
+};
+
+struct BlobItemRecord {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t name_offset;
+    uint32_t name_size;
+    uint32_t crc32;
+    uint32_t data_crc;      // CRC записанных данных: кэш мог испортиться на диске
+};
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// <ключ>.blob.tmp.<pid> остается, если процесс упал посреди store()
+bool isStaleTemp(const std::filesystem::directory_entry& entry) {
+    const std::string name = entry.path().filename().string();
+    const size_t infix = name.rfind(TMP_INFIX);
+    if (infix == std::string::npos) {
+        return false;
+    }
+    const std::string pid_text = name.substr(infix + std::strlen(TMP_INFIX));
+    char* end = nullptr;
+    const long pid = std::strtol(pid_text.c_str(), &end, 10);
+    if (pid_text.empty() || *end != '\0' || pid <= 0) {
+        return false;
+    }
+    if (kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH) {
+        return true;
+    }
+    std::error_code ec;
+    const auto mtime = entry.last_write_time(ec);
+    return !ec && std::filesystem::file_time_type::clock::now() - mtime > STALE_TMP_AGE;
+}
+
+uint32_t dataCrc(const uint8_t* data, uint64_t size) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+    while (size > 0) {
+        const uInt chunk = static_cast<uInt>(std::min<uint64_t>(size, 1u << 30));
+        crc = crc32(crc, data, chunk);
+        data += chunk;
+        size -= chunk;
+    }
+    return static_cast<uint32_t>(crc);
+}
+
+bool writeAt(int fd, const void* buf, size_t size, uint64_t offset) {
+    const auto* in = static_cast<const uint8_t*>(buf);
+    while (size > 0) {
+        ssize_t n = pwrite(fd, in, size, static_cast<off_t>(offset));
+        if (n <= 0) {
+            return false;
+        }
+        in += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+const CachedBlob::Item* CachedBlob::find(const std::string& name) const {
+    for (const auto& item : items_) {
+        if (item.name == name) {
+            return &item;
+        }
+    }
+    return nullptr;
+}
+
+ExtractionCache::ExtractionCache(std::string dir, uint64_t size_limit)
+    : dir_(std::move(dir)), size_limit_(size_limit) {}
+
+uint64_t ExtractionCache::computeKey(const ApkArchive& archive) {
+    uint64_t hash = FNV1A_OFFSET_BASIS;
+
+    struct stat st;
+    if (fstat(archive.fd(), &st) == 0) {
+        uint64_t size = static_cast<uint64_t>(st.st_size);
+        uint64_t mtime = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ULL +
+                         static_cast<uint64_t>(st.st_mtim.tv_nsec);
+        hash = fnv1a(hash, &size, sizeof(size));
+        hash = fnv1a(hash, &mtime, sizeof(mtime));
+    }
+
+    // CRC всех записей: перезапись файла с тем же размером и mtime тоже даст промах
+    for (const auto& entry : archive.entries()) {
+        hash = fnv1a(hash, entry.name.data(), entry.name.size());
+        hash = fnv1a(hash, &entry.crc32, sizeof(entry.crc32));
+        hash = fnv1a(hash, &entry.size, sizeof(entry.size));
+    }
+    return hash;
+}
+
+std::string ExtractionCache::blobPath(uint64_t key) const {
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return dir_ + "/" + name + BLOB_SUFFIX;
+}
+
+bool ExtractionCache::load(uint64_t key, CachedBlob& out) const {
+    const std::string path = blobPath(key);
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(BlobHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    const size_t file_size = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    auto region = std::make_shared<const MappedRegion>(base, file_size);
+
+    BlobHeader header;
+    std::memcpy(&header, region->data(), sizeof(header));
+    if (std::memcmp(header.magic, BLOB_MAGIC, sizeof(BLOB_MAGIC)) != 0 ||
+        header.version != BLOB_VERSION || header.key != key ||
+        header.file_size != file_size) {
+        return false;
+    }
+
+    const uint64_t table_end = sizeof(BlobHeader) +
+        static_cast<uint64_t>(header.item_count) * sizeof(BlobItemRecord);
+    if (table_end > file_size) {
+        return false;
+    }
+
+    std::vector<CachedBlob::Item> items;
+    items.reserve(header.item_count);
+    for (uint32_t i = 0; i < header.item_count; ++i) {
+        BlobItemRecord record;
+        std::memcpy(&record, region->data() + sizeof(BlobHeader) + i * sizeof(record),
+                    sizeof(record));
+        // Поля записи берутся из файла: суммы могут переполниться
+        if (record.offset > file_size || record.size > file_size - record.offset ||
+            record.name_offset > file_size || record.name_size > file_size - record.name_offset) {
+            return false;
+        }
+        // Файл, испорченный на диске, не должен попасть в исполнение
+        if (dataCrc(region->data() + record.offset, record.size) != record.data_crc) {
+            return false;
+        }
+
+        items.push_back(CachedBlob::Item{
+            std::string(reinterpret_cast<const char*>(region->data() + record.name_offset),
+                        record.name_size),
+            region->data() + record.offset,
+            record.size,
+            record.crc32
+        });
+    }
+
+    // Обновляем mtime: по нему работает вытеснение самых старых файлов
+    utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+
+    out.region_ = std::move(region);
+    out.items_ = std::move(items);
+    return true;
+}
+
+bool ExtractionCache::store(uint64_t key, const std::vector<StoreItem>& items) {
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    if (ec) {
+        return false;
+    }
+
+    const uint64_t page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+
+    // Раскладка: заголовок, таблица записей, имена, затем данные по страницам
+    std::vector<BlobItemRecord> records(items.size());
+    uint64_t offset = sizeof(BlobHeader) + items.size() * sizeof(BlobItemRecord);
+    for (size_t i = 0; i < items.size(); ++i) {
+        records[i].name_offset = static_cast<uint32_t>(offset);
+        records[i].name_size = static_cast<uint32_t>(items[i].name.size());
+        offset += items[i].name.size();
+    }
+    for (size_t i = 0; i < items.size(); ++i) {
+        offset = alignUp(offset, page_size);
+        records[i].offset = offset;
+        records[i].size = items[i].size;
+        records[i].crc32 = items[i].crc32;
+        records[i].data_crc = dataCrc(items[i].data, items[i].size);
+        offset += items[i].size;
+    }
+
+    BlobHeader header;
+    std::memcpy(header.magic, BLOB_MAGIC, sizeof(BLOB_MAGIC));
+    header.version = BLOB_VERSION;
+    header.item_count = static_cast<uint32_t>(items.size());
+    header.key = key;
+    header.file_size = offset;
+
+    // Пишем во временный файл и переименовываем: читатели не увидят половину файла
+    const std::string path = blobPath(key);
+    const std::string tmp_path = path + TMP_INFIX + std::to_string(getpid());
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool ok = ftruncate(fd, static_cast<off_t>(offset)) == 0 &&
+              writeAt(fd, &header, sizeof(header), 0) &&
+              writeAt(fd, records.data(), records.size() * sizeof(BlobItemRecord),
+                      sizeof(BlobHeader));
+    for (size_t i = 0; ok && i < items.size(); ++i) {
+        ok = writeAt(fd, items[i].name.data(), items[i].name.size(), records[i].name_offset) &&
+             writeAt(fd, items[i].data, static_cast<size_t>(items[i].size), records[i].offset);
+    }
+    // Данные на диске раньше переименования: после сбоя питания под
+    // постоянным именем не окажется файла с недописанными блоками
+    ok = ok && fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+
+    evict(key);
+    return true;
+}
+
+void ExtractionCache::evict(uint64_t keep_key) {
+    struct BlobFile {
+        std::filesystem::path path;
+        std::filesystem::file_time_type mtime;
+        uint64_t size;
+    };
+
+    std::error_code ec;
+    std::vector<BlobFile> files;
+    uint64_t total = 0;
+    const std::filesystem::path keep = blobPath(keep_key);
+
+    for (const auto& entry : std::filesystem::directory_iterator(dir_, ec)) {
+        if (!entry.is_regular_file(ec)) {
+            continue;
+        }
+        if (entry.path().extension() != BLOB_SUFFIX) {
+            // Недописанные файлы упавших процессов иначе копились бы вечно
+            if (isStaleTemp(entry)) {
+                std::filesystem::remove(entry.path(), ec);
+            }
+            continue;
+        }
+        BlobFile file{entry.path(), entry.last_write_time(ec), entry.file_size(ec)};
+        if (ec) {
+            continue;
+        }
+        total += file.size;
+        if (file.path != keep) {
+            files.push_back(std::move(file));
+        }
+    }
+
+    std::sort(files.begin(), files.end(), [](const BlobFile& a, const BlobFile& b) {
+        return a.mtime < b.mtime;
+    });
+
+    for (const auto& file : files) {
+        if (total <= size_limit_) {
+            break;
+        }
+        if (std::filesystem::remove(file.path, ec)) {
+            total -= file.size;
+        }
+    }
+}
+
+} // namespace anexec
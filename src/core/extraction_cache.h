@@ -0,0 +1,71 @@
+#ifndef ANEXEC_EXTRACTION_CACHE_H
+#define ANEXEC_EXTRACTION_CACHE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "mapped_region.h"
+
+namespace anexec {
+
+class ApkArchive;
+
+// Файл кэша, отображенный в память целиком одним mmap
+class CachedBlob {
+public:
+    struct Item {
+        std::string name;         // Имя записи в APK
+        const uint8_t* data;      // Данные внутри отображения
+        uint64_t size;
+        uint32_t crc32;           // CRC записи APK, из которой получены данные
+    };
+
+    const Item* find(const std::string& name) const;
+    const std::vector<Item>& items() const { return items_; }
+    const std::shared_ptr<const MappedRegion>& region() const { return region_; }
+
+private:
+    friend class ExtractionCache;
+
+    std::shared_ptr<const MappedRegion> region_;
+    std::vector<Item> items_;
+};
+
+// Кэш распакованных записей APK (DEX, нативные библиотеки).
+// Один файл <ключ>.blob на APK; данные в нем выровнены по страницам,
+// поэтому повторный запуск - это один mmap без распаковки.
+class ExtractionCache {
+public:
+    struct StoreItem {
+        std::string name;
+        const uint8_t* data;
+        uint64_t size;
+        uint32_t crc32;
+    };
+
+    ExtractionCache(std::string dir, uint64_t size_limit);
+
+    // Ключ: размер и mtime файла APK плюс хеш центрального каталога
+    static uint64_t computeKey(const ApkArchive& archive);
+
+    // Данные сверяются с CRC, записанным в store(): испорченный файл - промах
+    bool load(uint64_t key, CachedBlob& out) const;
+    bool store(uint64_t key, const std::vector<StoreItem>& items);
+
+    // Удаляет самые старые файлы, пока кэш больше лимита, и временные
+    // файлы процессов, упавших посреди store()
+    void evict(uint64_t keep_key);
+
+    const std::string& directory() const { return dir_; }
+    std::string blobPath(uint64_t key) const;
+
+private:
+    std::string dir_;
+    uint64_t size_limit_;
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_EXTRACTION_CACHE_H
@@ -0,0 +1,36 @@
+#ifndef ANEXEC_HASH_H
+#define ANEXEC_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace anexec {
+
+// FNV-1a: ключи кэшей на диске и хеши имен в таблицах поиска
+constexpr uint64_t FNV1A_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+constexpr uint64_t FNV1A_PRIME = 0x100000001b3ULL;
+
+// Продолжает hash байтами data: ключ можно собрать из нескольких полей
+inline uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= p[i];
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+// constexpr, чтобы хеш известных имен считался при компиляции
+constexpr uint64_t fnv1a(std::string_view text) {
+    uint64_t hash = FNV1A_OFFSET_BASIS;
+    for (char c : text) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+} // namespace anexec
+
+#endif // ANEXEC_HASH_H
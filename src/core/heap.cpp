@@ -0,0 +1,1003 @@
+#include "heap.h"
+#include "class_linker.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <sys/mman.h>
+
+namespace anexec {
+
+namespace {
+
+// Биты Object::flags
+constexpr uint32_t AGE_MASK = 0x0f;         // Пережитых сборок молодого поколения
+constexpr uint32_t FORWARDED = 0x10;        // Скопирован при сборке, новый адрес в klass
+constexpr uint32_t REMEMBERED = 0x20;       // Объект старого поколения в запомненном множестве
+
+constexpr uint32_t TENURE_AGE = 3;
+constexpr size_t PAGE_SIZE = 4096;
+constexpr size_t MIN_CAPACITY = 1024 * 1024;
+constexpr size_t MAX_YOUNG_SIZE = 64 * 1024 * 1024;
+constexpr size_t MIN_EDEN_SIZE = 512 * 1024;
+constexpr size_t MIN_FREE_CHUNK = 16;
+constexpr size_t FREE_CLASSES = 33;         // Списки свободных блоков по степеням двойки
+constexpr size_t SWEEP_SPAN = 256 * 1024;   // Подметается за одно взятие блокировки
+constexpr size_t INITIATING_OCCUPANCY_PERCENT = 60;
+constexpr uint64_t INITIAL_CYCLE_YOUNG_GCS = 16;    // Длина цикла до первого замера, в молодых сборках
+constexpr size_t REMARK_BUDGET = 4096;      // Объектов, размечаемых в паузе remark
+constexpr size_t ABORT_CHECK_INTERVAL = 1024;
+
+// Эпохи уникальны для всех куч: TLAB действителен, пока эпоха его кучи не сменилась
+std::atomic<uint64_t> next_epoch{1};
+
+struct Tlab {
+    uint64_t epoch{0};
+    const void* owner{nullptr};
+    uint8_t* top{nullptr};
+    uint8_t* end{nullptr};
+    uint64_t objects{0};    // Еще не учтены в статистике кучи
+    uint64_t bytes{0};
+};
+
+thread_local Tlab tlab;
+
+size_t alignSize(size_t bytes) {
+    return (bytes + Heap::ALIGNMENT - 1) & ~(Heap::ALIGNMENT - 1);
+}
+
+size_t objectSize(const Object* object) {
+    const Class* klass = object->klass;
+    if (klass->isArray()) {
+        return alignSize(sizeof(Object) + size_t{object->length} * klass->component_size);
+    }
+    // У строк символы идут сразу за заголовком, у остальных объектов length = 0
+    return alignSize(std::max<size_t>(klass->object_size, sizeof(Object) + object->length));
+}
+
+template <typename Visitor>
+void visitReferences(Object* object, Visitor&& visit) {
+    const Class* klass = object->klass;
+    if (klass->isArray()) {
+        if (klass->reference_elements) {
+            auto* elements = reinterpret_cast<ObjectRef*>(object + 1);
+            for (uint32_t i = 0; i < object->length; ++i) {
+                visit(elements[i]);
+            }
+        }
+        return;
+    }
+    auto* bytes = reinterpret_cast<uint8_t*>(object);
+    for (uint32_t offset : klass->reference_offsets) {
+        visit(*reinterpret_cast<ObjectRef*>(bytes + offset));
+    }
+}
+
+size_t floorLog2(size_t value) {
+    return 63 - static_cast<size_t>(__builtin_clzll(value));
+}
+
+uint64_t microsecondsSince(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+} // namespace
+
+class Heap::Impl {
+public:
+    enum class Phase : uint8_t {
+        Idle,
+        Marking,    // Фоновый поток размечает старое поколение
+        Sweeping    // Фоновый поток подметает размеченное
+    };
+
+    struct FreeChunk {
+        size_t offset;
+        size_t size;
+    };
+
+    Impl(Heap& heap, size_t capacity) : heap(heap), base(heap.base_) {
+        size_t young = std::min(capacity / 4, MAX_YOUNG_SIZE) & ~(PAGE_SIZE - 1);
+        survivor_size = (young / 8) & ~(PAGE_SIZE - 1);
+        eden_start = PAGE_SIZE;     // Первая страница: null и ничего больше
+        eden_end = PAGE_SIZE + young - 2 * survivor_size;
+        survivor_start[0] = eden_end;
+        survivor_start[1] = eden_end + survivor_size;
+        old_start = survivor_start[1] + survivor_size;
+        old_end = capacity;
+        heap.young_limit_ = static_cast<ObjectRef>(old_start);
+
+        // Начальный eden мал: первые сборки не знают доли выживших, а
+        // adaptEden растит его, пока пауза укладывается в цель
+        eden_limit = std::min(eden_end, eden_start + 4 * MIN_EDEN_SIZE);
+        eden_top.store(eden_start, std::memory_order_relaxed);
+        survivor_top = survivor_start[0];
+        old_top = old_start;
+        epoch = next_epoch.fetch_add(1);
+        last_young_gc = std::chrono::steady_clock::now();
+    }
+
+    ~Impl() {
+        if (worker.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+                abort.store(true);
+            }
+            cv.notify_all();
+            worker.join();
+        }
+        if (bitmap) {
+            munmap(bitmap, bitmap_bytes);
+        }
+    }
+
+    bool reserveBitmap(size_t capacity) {
+        // Бит на каждые 8 байт кучи: отмечает начало живого объекта
+        bitmap_bytes = (capacity / Heap::ALIGNMENT + 7) / 8;
+        bitmap_bytes = (bitmap_bytes + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+        void* memory = mmap(nullptr, bitmap_bytes, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (memory == MAP_FAILED) {
+            return false;
+        }
+        bitmap = static_cast<uint64_t*>(memory);
+        return true;
+    }
+
+    Object* allocateSlow(size_t bytes) {
+        if (remark_pending.load(std::memory_order_acquire)) {
+            remark();
+        }
+        if (bytes >= Heap::LARGE_OBJECT_SIZE) {
+            return allocateLarge(bytes);
+        }
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            if (bytes > Heap::TLAB_SIZE / 4) {
+                // Крупнее четверти TLAB - прямо из eden, чтобы не терять хвосты TLAB
+                if (uint8_t* memory = allocateEden(bytes)) {
+                    std::memset(memory, 0, bytes);
+                    allocated_objects.fetch_add(1, std::memory_order_relaxed);
+                    allocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+                    return reinterpret_cast<Object*>(memory);
+                }
+            } else if (refillTlab()) {
+                auto* object = reinterpret_cast<Object*>(tlab.top);
+                tlab.top += bytes;
+                ++tlab.objects;
+                tlab.bytes += bytes;
+                return object;
+            }
+            if (attempt == 0) {
+                collect(false);
+            }
+        }
+        // Живые объекты заняли молодое поколение целиком: остается старое
+        return allocateLarge(bytes);
+    }
+
+    // start_cycle - начать цикл старого поколения, даже если порог заполнения не достигнут
+    void collect(bool full, bool start_cycle = false) {
+        const auto start = std::chrono::steady_clock::now();
+        flushTlab();
+        const bool compact = full || !promotionFits();
+        if (compact) {
+            collectFull();
+        } else {
+            std::unique_lock<std::mutex> lock(mutex);
+            evacuateYoung(false);
+            if (phase == Phase::Idle && (start_cycle || cycleNeeded())) {
+                startMarking();
+            }
+        }
+        const uint64_t pause = microsecondsSince(start);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!compact) {
+            adaptEden(pause);
+            stats.max_young_pause_us = std::max(stats.max_young_pause_us, pause);
+            stats.total_young_pause_us += pause;
+        } else {
+            stats.max_full_pause_us = std::max(stats.max_full_pause_us, pause);
+            stats.total_full_pause_us += pause;
+        }
+        recordPause(pause);
+    }
+
+    uint64_t currentEpoch() const {
+        return epoch;
+    }
+
+    void writeBarrier(ObjectRef holder, ObjectRef* slot, ObjectRef value) {
+        if (marking) {
+            // Snapshot-at-the-beginning: перезаписываемая ссылка могла быть
+            // единственным путем к объекту, который разметчик еще не видел
+            const ObjectRef previous = *slot;
+            if (previous >= old_start && !isMarked(previous)) {
+                satb.push_back(previous);
+            }
+        }
+        // Объекты старого поколения может в это время читать разметчик
+        __atomic_store_n(slot, value, __ATOMIC_RELAXED);
+        if (value != NULL_REF && value < old_start) {
+            Object* object = heap.object(holder);
+            if ((object->flags & REMEMBERED) == 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                remember(holder);
+            }
+        }
+    }
+
+    size_t addRootSource(RootSource source) {
+        root_sources.emplace_back(next_root_id, std::move(source));
+        return next_root_id++;
+    }
+
+    void removeRootSource(size_t id) {
+        root_sources.erase(std::remove_if(root_sources.begin(), root_sources.end(),
+                                          [id](const auto& entry) { return entry.first == id; }),
+                           root_sources.end());
+    }
+
+    size_t used() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return youngUsed() + oldUsed();
+    }
+
+    uint64_t allocatedObjects() const {
+        uint64_t count = allocated_objects.load(std::memory_order_relaxed);
+        if (tlab.owner == this) {
+            count += tlab.objects;
+        }
+        return count;
+    }
+
+    HeapStats getStats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        HeapStats result = stats;
+        result.allocated_objects = allocatedObjects();
+        result.allocated_bytes = allocated_bytes.load(std::memory_order_relaxed) +
+                                 (tlab.owner == this ? tlab.bytes : 0);
+        result.eden_size = eden_limit - eden_start;
+        result.old_used = oldUsed();
+        result.old_capacity = old_end - old_start;
+        return result;
+    }
+
+private:
+    Heap& heap;
+    uint8_t* const base;
+
+    // Раскладка: [страница null][eden][survivor 0][survivor 1][старое поколение]
+    size_t eden_start{0};
+    size_t eden_end{0};
+    size_t eden_limit{0};           // Используемая часть eden
+    std::atomic<size_t> eden_top{0};
+    size_t survivor_size{0};
+    size_t survivor_start[2]{};
+    int from_space{0};              // Survivor с живыми объектами, другой пуст
+    size_t survivor_top{0};
+    size_t old_start{0};
+    size_t old_end{0};
+    uint64_t epoch{0};
+
+    // Старое поколение, запомненное множество и состояние цикла - под mutex
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    size_t old_top{0};
+    std::vector<FreeChunk> free_lists[FREE_CLASSES];
+    size_t free_bytes{0};
+    std::set<ObjectRef> remembered;     // Объекты старого поколения со ссылками в молодое
+    Phase phase{Phase::Idle};
+    bool allocate_black{false};         // Новые объекты старого поколения сразу живые
+    std::vector<ObjectRef> gray;
+    size_t sweep_limit{0};
+    bool stop{false};
+    bool worker_busy{false};
+    std::atomic<bool> abort{false};
+    std::atomic<bool> remark_pending{false};
+    std::thread worker;
+
+    // Только поток приложения
+    bool marking{false};                // Барьер записи сохраняет старые значения
+    std::vector<ObjectRef> satb;
+    std::vector<std::pair<size_t, RootSource>> root_sources;
+    size_t next_root_id{0};
+
+    uint64_t* bitmap{nullptr};
+    size_t bitmap_bytes{0};
+
+    // Статистика: счетчики выделения пополняются при смене TLAB
+    std::atomic<uint64_t> allocated_objects{0};
+    std::atomic<uint64_t> allocated_bytes{0};
+    uint64_t bytes_at_last_young_gc{0};
+    std::chrono::steady_clock::time_point last_young_gc;
+    uint64_t promoted_average{0};       // Переносится в старое поколение за молодую сборку
+    uint64_t cycle_start_young{0};      // stats.young_collections в начале цикла
+    uint64_t cycle_young_gcs{INITIAL_CYCLE_YOUNG_GCS};  // Молодых сборок за последний цикл
+    HeapStats stats{};
+
+    // --- Выделение ---
+
+    uint8_t* allocateEden(size_t bytes) {
+        size_t top = eden_top.load(std::memory_order_relaxed);
+        do {
+            if (bytes > eden_limit - std::min(top, eden_limit)) {
+                return nullptr;
+            }
+        } while (!eden_top.compare_exchange_weak(top, top + bytes, std::memory_order_relaxed));
+        return base + top;
+    }
+
+    void flushTlab() {
+        if (tlab.owner == this) {
+            allocated_objects.fetch_add(tlab.objects, std::memory_order_relaxed);
+            allocated_bytes.fetch_add(tlab.bytes, std::memory_order_relaxed);
+        }
+        tlab = Tlab{};
+    }
+
+    bool refillTlab() {
+        flushTlab();
+        uint8_t* memory = allocateEden(Heap::TLAB_SIZE);
+        if (!memory) {
+            return false;
+        }
+        // После сборки eden используется повторно: обнуляем при выдаче
+        std::memset(memory, 0, Heap::TLAB_SIZE);
+        tlab.epoch = epoch;
+        tlab.owner = this;
+        tlab.top = memory;
+        tlab.end = memory + Heap::TLAB_SIZE;
+        return true;
+    }
+
+    Object* allocateLarge(size_t bytes) {
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            // Цикл старого поколения начинается с паузы молодой сборки. До
+            // выделения: сборка не должна видеть объект без класса.
+            bool start_cycle = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                start_cycle = phase == Phase::Idle && occupancyReached(bytes);
+            }
+            if (start_cycle) {
+                collect(false, true);
+            }
+            uint8_t* memory = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                memory = allocateOld(bytes);
+            }
+            if (memory) {
+                std::memset(memory, 0, bytes);
+                allocated_objects.fetch_add(1, std::memory_order_relaxed);
+                allocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+                return reinterpret_cast<Object*>(memory);
+            }
+            if (attempt == 0) {
+                collect(true);
+            }
+        }
+        return nullptr;
+    }
+
+    // Под mutex
+    bool occupancyReached(size_t incoming) const {
+        return (oldUsed() + incoming) * 100 > (old_end - old_start) * INITIATING_OCCUPANCY_PERCENT;
+    }
+
+    // Под mutex. Цикл начинается по заполнению или раньше, если при
+    // нынешнем темпе переноса место под выживших кончится до того, как
+    // цикл успеет освободить мусор: иначе остается только полная сборка.
+    // Длина цикла - замер прошлого, с двойным запасом.
+    bool cycleNeeded() const {
+        const uint64_t during_cycle = promoted_average * (cycle_young_gcs + 1) * 2;
+        return occupancyReached(0) ||
+               promotionHeadroom() < during_cycle + (eden_limit - eden_start) + survivor_size;
+    }
+
+    // Под mutex. Свободный блок подходящего размера или конец старого поколения.
+    uint8_t* allocateOld(size_t bytes) {
+        size_t offset = 0;
+        for (size_t i = floorLog2(bytes) + 1; i < FREE_CLASSES && offset == 0; ++i) {
+            if (free_lists[i].empty()) {
+                continue;
+            }
+            const FreeChunk chunk = free_lists[i].back();
+            free_lists[i].pop_back();
+            free_bytes -= chunk.size;
+            offset = chunk.offset;
+            if (chunk.size - bytes >= MIN_FREE_CHUNK) {
+                addFree(chunk.offset + bytes, chunk.size - bytes);
+            }
+        }
+        if (offset == 0) {
+            if (bytes > old_end - old_top) {
+                return nullptr;
+            }
+            offset = old_top;
+            old_top += bytes;
+        }
+        if (allocate_black) {
+            setMark(static_cast<ObjectRef>(offset));
+        }
+        return base + offset;
+    }
+
+    // Под mutex
+    void addFree(size_t offset, size_t size) {
+        free_lists[floorLog2(size)].push_back({offset, size});
+        free_bytes += size;
+        // Умершие объекты покидают запомненное множество
+        auto first = remembered.lower_bound(static_cast<ObjectRef>(offset));
+        auto last = remembered.lower_bound(static_cast<ObjectRef>(offset + size));
+        remembered.erase(first, last);
+    }
+
+    void clearFreeLists() {
+        for (auto& list : free_lists) {
+            list.clear();
+        }
+        free_bytes = 0;
+    }
+
+    // Под mutex
+    void remember(ObjectRef holder) {
+        heap.object(holder)->flags |= REMEMBERED;
+        remembered.insert(holder);
+    }
+
+    size_t youngUsed() const {
+        return std::min(eden_top.load(std::memory_order_relaxed), eden_limit) - eden_start +
+               survivor_top - survivor_start[from_space];
+    }
+
+    size_t oldUsed() const {
+        return old_top - old_start - free_bytes;
+    }
+
+    // Под mutex. Сколько выживших гарантированно поместится в старое
+    // поколение. Объекты молодого поколения меньше LARGE_OBJECT_SIZE, а
+    // allocateOld берет блок из класса выше класса объекта, поэтому блок
+    // не меньше LARGE_OBJECT_SIZE заполняется, пока от него не останется
+    // меньше LARGE_OBJECT_SIZE. Блоки меньше не учитываются.
+    size_t promotionHeadroom() const {
+        size_t headroom = old_end - old_top;
+        for (size_t i = floorLog2(Heap::LARGE_OBJECT_SIZE); i < FREE_CLASSES; ++i) {
+            for (const FreeChunk& chunk : free_lists[i]) {
+                headroom += chunk.size - Heap::LARGE_OBJECT_SIZE;
+            }
+        }
+        return headroom;
+    }
+
+    // Выжить может все молодое поколение: столько места нужно в старом.
+    // Во время подметания свободные блоки еще не все в списках, поэтому,
+    // если места не хватает, ждем, пока подметание его освободит: это
+    // дешевле полной сборки.
+    bool promotionFits() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (youngUsed() <= promotionHeadroom()) {
+            return true;
+        }
+        cv.wait(lock, [this] { return phase != Phase::Sweeping || youngUsed() <= promotionHeadroom(); });
+        return youngUsed() <= promotionHeadroom();
+    }
+
+    // --- Битовая карта разметки ---
+
+    bool setMark(ObjectRef ref) {
+        const size_t bit = ref / Heap::ALIGNMENT;
+        const uint64_t mask = uint64_t{1} << (bit & 63);
+        return (__atomic_fetch_or(&bitmap[bit / 64], mask, __ATOMIC_RELAXED) & mask) != 0;
+    }
+
+    bool isMarked(ObjectRef ref) const {
+        const size_t bit = ref / Heap::ALIGNMENT;
+        return (__atomic_load_n(&bitmap[bit / 64], __ATOMIC_RELAXED) >> (bit & 63)) & 1;
+    }
+
+    // Границы областей выровнены по странице, то есть по словам карты
+    void clearMarks(size_t from, size_t to) {
+        const size_t first = from / Heap::ALIGNMENT / 64;
+        const size_t last = (to / Heap::ALIGNMENT + 63) / 64;
+        std::memset(bitmap + first, 0, (last - first) * sizeof(uint64_t));
+    }
+
+    // Первый размеченный объект в [from, to) или to
+    size_t nextMarked(size_t from, size_t to) const {
+        size_t bit = from / Heap::ALIGNMENT;
+        const size_t end = to / Heap::ALIGNMENT;
+        while (bit < end) {
+            const uint64_t word = __atomic_load_n(&bitmap[bit / 64], __ATOMIC_RELAXED) >> (bit & 63);
+            if (word != 0) {
+                bit += static_cast<size_t>(__builtin_ctzll(word));
+                return bit < end ? bit * Heap::ALIGNMENT : to;
+            }
+            bit = (bit / 64 + 1) * 64;
+        }
+        return to;
+    }
+
+    template <typename Fn>
+    void forEachMarked(size_t from, size_t to, Fn&& fn) {
+        for (size_t offset = nextMarked(from, to); offset < to; offset = nextMarked(offset + Heap::ALIGNMENT, to)) {
+            fn(offset);
+        }
+    }
+
+    // --- Корни ---
+
+    template <typename Visitor>
+    void visitRoots(Visitor&& visit) {
+        const RootVisitor visitor = [&visit](ObjectRef& ref) {
+            if (ref != NULL_REF) {
+                visit(ref);
+            }
+        };
+        for (auto& entry : root_sources) {
+            entry.second(visitor);
+        }
+        for (ObjectRef* root : heap.scoped_roots_) {
+            visitor(*root);
+        }
+    }
+
+    // --- Молодое поколение ---
+
+    bool inFromSpace(ObjectRef ref) const {
+        return (ref >= eden_start && ref < eden_limit) ||
+               (ref >= survivor_start[from_space] && ref < survivor_start[from_space] + survivor_size);
+    }
+
+    // Под mutex. Копирует живые объекты eden и survivor (алгоритм Чейни);
+    // место в старом поколении под всех выживших проверено заранее.
+    void evacuateYoung(bool tenure_all) {
+        epoch = next_epoch.fetch_add(1);
+        const size_t to_start = survivor_start[1 - from_space];
+        const size_t to_end = to_start + survivor_size;
+        size_t to_top = to_start;
+        std::vector<ObjectRef> promoted;
+        uint64_t promoted_bytes = 0;
+
+        auto forward = [&](ObjectRef& ref) {
+            if (ref == NULL_REF || !inFromSpace(ref)) {
+                return;
+            }
+            Object* object = heap.object(ref);
+            if (object->flags & FORWARDED) {
+                ref = static_cast<ObjectRef>(reinterpret_cast<uintptr_t>(object->klass));
+                return;
+            }
+            const size_t size = objectSize(object);
+            const uint32_t age = (object->flags & AGE_MASK) + 1;
+            uint8_t* copy = nullptr;
+            bool tenured = false;
+            if (!tenure_all && age < TENURE_AGE && size <= to_end - to_top) {
+                copy = base + to_top;
+                to_top += size;
+            } else {
+                copy = allocateOld(size);
+                tenured = true;
+                if (!copy) {
+                    // Не бывает: promotionFits() проверила место для всего молодого поколения
+                    std::abort();
+                }
+            }
+            std::memcpy(copy, object, size);
+            auto* moved = reinterpret_cast<Object*>(copy);
+            moved->flags = tenured ? 0 : age;
+            const ObjectRef moved_ref = heap.ref(moved);
+            object->klass = reinterpret_cast<Class*>(static_cast<uintptr_t>(moved_ref));
+            object->flags |= FORWARDED;
+            if (tenured) {
+                promoted.push_back(moved_ref);
+                promoted_bytes += size;
+            }
+            ref = moved_ref;
+        };
+
+        visitRoots(forward);
+
+        // Старые объекты, на которые ссылались молодые; без таких ссылок - из множества
+        for (auto it = remembered.begin(); it != remembered.end();) {
+            Object* holder = heap.object(*it);
+            bool young = false;
+            visitReferences(holder, [&](ObjectRef& ref) {
+                forward(ref);
+                young |= ref != NULL_REF && ref < old_start;
+            });
+            if (young) {
+                ++it;
+            } else {
+                holder->flags &= ~REMEMBERED;
+                it = remembered.erase(it);
+            }
+        }
+
+        size_t scan = to_start;
+        while (scan < to_top || !promoted.empty()) {
+            while (scan < to_top) {
+                Object* object = heap.object(static_cast<ObjectRef>(scan));
+                visitReferences(object, forward);
+                scan += objectSize(object);
+            }
+            while (!promoted.empty()) {
+                const ObjectRef ref = promoted.back();
+                promoted.pop_back();
+                bool young = false;
+                visitReferences(heap.object(ref), [&](ObjectRef& field) {
+                    forward(field);
+                    young |= field != NULL_REF && field < old_start;
+                });
+                if (young) {
+                    remember(ref);
+                }
+            }
+        }
+
+        from_space = 1 - from_space;
+        survivor_top = to_top;
+        eden_top.store(eden_start, std::memory_order_relaxed);
+
+        const auto now = std::chrono::steady_clock::now();
+        const uint64_t bytes = allocated_bytes.load(std::memory_order_relaxed);
+        const uint64_t interval = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(now - last_young_gc).count());
+        if (interval > 0) {
+            stats.allocation_rate = (bytes - bytes_at_last_young_gc) * 1000000 / interval;
+        }
+        bytes_at_last_young_gc = bytes;
+        last_young_gc = now;
+        stats.promoted_bytes += promoted_bytes;
+        promoted_average = (promoted_average * 3 + promoted_bytes) / 4;
+        ++stats.young_collections;
+    }
+
+    // Пауза молодой сборки растет с числом выживших, а их тем больше, чем
+    // больше eden: при превышении цели eden уменьшается, с запасом - растет
+    void adaptEden(uint64_t pause_us) {
+        const size_t size = eden_limit - eden_start;
+        if (pause_us > Heap::PAUSE_TARGET_US && size / 2 >= MIN_EDEN_SIZE) {
+            eden_limit = eden_start + size / 2;
+        } else if (pause_us < Heap::PAUSE_TARGET_US / 4 && eden_limit < eden_end) {
+            eden_limit = std::min(eden_end, eden_start + size * 2);
+        }
+    }
+
+    void recordPause(uint64_t pause_us) {
+        stats.last_pause_us = pause_us;
+        stats.max_pause_us = std::max(stats.max_pause_us, pause_us);
+        stats.total_pause_us += pause_us;
+    }
+
+    // --- Параллельная разметка старого поколения ---
+
+    // Под mutex, сразу после молодой сборки: eden пуст, поэтому снимок -
+    // это корни и объекты survivor
+    void startMarking() {
+        if (!worker.joinable()) {
+            worker = std::thread([this] { workerLoop(); });
+        }
+        gray.clear();
+        auto shade = [this](ObjectRef& ref) {
+            if (ref >= old_start && !setMark(ref)) {
+                gray.push_back(ref);
+            }
+        };
+        visitRoots(shade);
+        for (size_t scan = survivor_start[from_space]; scan < survivor_top;) {
+            Object* object = heap.object(static_cast<ObjectRef>(scan));
+            visitReferences(object, shade);
+            scan += objectSize(object);
+        }
+        phase = Phase::Marking;
+        cycle_start_young = stats.young_collections;
+        allocate_black = true;
+        marking = true;
+        cv.notify_all();
+    }
+
+    // Разметка от серых объектов; false - прервана полной сборкой
+    bool drain(std::vector<ObjectRef>& work, size_t budget) {
+        size_t processed = 0;
+        while (!work.empty() && processed < budget) {
+            const ObjectRef ref = work.back();
+            work.pop_back();
+            visitReferences(heap.object(ref), [&](ObjectRef& field) {
+                const ObjectRef value = __atomic_load_n(&field, __ATOMIC_RELAXED);
+                if (value >= old_start && !setMark(value)) {
+                    work.push_back(value);
+                }
+            });
+            if (++processed % ABORT_CHECK_INTERVAL == 0 && abort.load(std::memory_order_relaxed)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Поток приложения на safepoint: серых объектов у фонового потока не
+    // осталось. Пауза: досмотреть ссылки из буфера SATB и начать подметание.
+    void remark() {
+        const auto start = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!remark_pending.load(std::memory_order_relaxed) || phase != Phase::Marking) {
+            return;
+        }
+        std::vector<ObjectRef> work;
+        for (ObjectRef ref : satb) {
+            if (!setMark(ref)) {
+                work.push_back(ref);
+            }
+        }
+        satb.clear();
+        drain(work, REMARK_BUDGET);
+        remark_pending.store(false, std::memory_order_relaxed);
+        if (!work.empty()) {
+            // Работы больше, чем укладывается в паузу: обратно фоновому потоку
+            gray = std::move(work);
+        } else {
+            marking = false;
+            phase = Phase::Sweeping;
+            sweep_limit = old_top;
+            clearFreeLists();
+        }
+        cv.notify_all();
+        recordPause(microsecondsSince(start));
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            // Отмененный цикл ждет, пока abortCycle не вернет фазу Idle: иначе
+            // прерванное подметание начиналось бы заново, не отпуская mutex
+            cv.wait(lock, [this] {
+                return stop || (!abort.load(std::memory_order_relaxed) &&
+                                (phase == Phase::Sweeping ||
+                                 (phase == Phase::Marking && !gray.empty() &&
+                                  !remark_pending.load(std::memory_order_relaxed))));
+            });
+            if (stop) {
+                return;
+            }
+            worker_busy = true;
+            if (phase == Phase::Marking) {
+                std::vector<ObjectRef> work = std::move(gray);
+                gray.clear();
+                lock.unlock();
+                const bool done = drain(work, SIZE_MAX);
+                lock.lock();
+                if (done && phase == Phase::Marking) {
+                    remark_pending.store(true, std::memory_order_release);
+                }
+            } else {
+                sweep(lock);
+            }
+            worker_busy = false;
+            cv.notify_all();
+        }
+    }
+
+    // Свободные промежутки между размеченными объектами - в списки блоков.
+    // Блокировка отпускается между участками, чтобы не задерживать приложение.
+    void sweep(std::unique_lock<std::mutex>& lock) {
+        size_t cursor = old_start;
+        while (cursor < sweep_limit) {
+            if (abort.load(std::memory_order_relaxed) || phase != Phase::Sweeping) {
+                return;
+            }
+            const size_t span_end = std::min(cursor + SWEEP_SPAN, sweep_limit);
+            while (cursor < span_end) {
+                const size_t live = nextMarked(cursor, span_end);
+                if (live > cursor) {
+                    addFree(cursor, live - cursor);
+                }
+                cursor = live < span_end ? live + objectSize(heap.object(static_cast<ObjectRef>(live))) : span_end;
+            }
+            // Приложение может ждать места под выживших (promotionFits)
+            cv.notify_all();
+            lock.unlock();
+            lock.lock();
+        }
+        clearMarks(old_start, old_top);
+        allocate_black = false;
+        phase = Phase::Idle;
+        ++stats.concurrent_cycles;
+        cycle_young_gcs = std::max<uint64_t>(stats.young_collections - cycle_start_young, 1);
+    }
+
+    // Под mutex: фоновый поток останавливается, цикл отменяется
+    void abortCycle(std::unique_lock<std::mutex>& lock) {
+        if (phase == Phase::Idle) {
+            return;
+        }
+        abort.store(true, std::memory_order_relaxed);
+        cv.notify_all();
+        cv.wait(lock, [this] { return !worker_busy; });
+        abort.store(false, std::memory_order_relaxed);
+        remark_pending.store(false, std::memory_order_relaxed);
+        phase = Phase::Idle;
+        allocate_black = false;
+        marking = false;
+        gray.clear();
+        satb.clear();
+    }
+
+    // --- Полная сборка ---
+
+    // Разметка всей кучи, уплотнение старого поколения скольжением (Lisp 2:
+    // новый адрес живого объекта временно хранится в flags), затем перенос
+    // всего живого молодого поколения в старое
+    void collectFull() {
+        std::unique_lock<std::mutex> lock(mutex);
+        abortCycle(lock);
+        epoch = next_epoch.fetch_add(1);
+        clearMarks(0, old_top);
+
+        size_t young_live = 0;
+        std::vector<ObjectRef> work;
+        auto mark = [&](ObjectRef& ref) {
+            if (ref != NULL_REF && !setMark(ref)) {
+                work.push_back(ref);
+                if (ref < old_start) {
+                    young_live += objectSize(heap.object(ref));
+                }
+            }
+        };
+        visitRoots(mark);
+        while (!work.empty()) {
+            const ObjectRef ref = work.back();
+            work.pop_back();
+            visitReferences(heap.object(ref), mark);
+        }
+
+        size_t destination = old_start;
+        forEachMarked(old_start, old_top, [&](size_t offset) {
+            Object* object = heap.object(static_cast<ObjectRef>(offset));
+            const size_t size = objectSize(object);
+            object->flags = static_cast<uint32_t>(destination);
+            destination += size;
+        });
+
+        auto relocate = [&](ObjectRef& ref) {
+            if (ref >= old_start) {
+                ref = heap.object(ref)->flags;
+            }
+        };
+        visitRoots(relocate);
+        const size_t young_regions[][2] = {
+            {eden_start, std::min(eden_top.load(std::memory_order_relaxed), eden_limit)},
+            {survivor_start[from_space], survivor_top}
+        };
+        for (const auto& region : young_regions) {
+            forEachMarked(region[0], region[1], [&](size_t offset) {
+                visitReferences(heap.object(static_cast<ObjectRef>(offset)), relocate);
+            });
+        }
+        std::vector<ObjectRef> holders;
+        forEachMarked(old_start, old_top, [&](size_t offset) {
+            Object* object = heap.object(static_cast<ObjectRef>(offset));
+            bool young = false;
+            visitReferences(object, [&](ObjectRef& ref) {
+                relocate(ref);
+                young |= ref != NULL_REF && ref < old_start;
+            });
+            if (young) {
+                holders.push_back(object->flags);
+            }
+        });
+        forEachMarked(old_start, old_top, [&](size_t offset) {
+            Object* object = heap.object(static_cast<ObjectRef>(offset));
+            const size_t size = objectSize(object);
+            const ObjectRef target = object->flags;
+            std::memmove(base + target, object, size);
+            heap.object(target)->flags = 0;
+        });
+
+        clearMarks(0, old_top);
+        old_top = destination;
+        clearFreeLists();
+        remembered.clear();
+        for (ObjectRef holder : holders) {
+            remember(holder);
+        }
+        ++stats.full_collections;
+
+        // Иначе живое не помещается в кучу: молодое поколение остается как есть
+        if (young_live <= old_end - old_top) {
+            evacuateYoung(true);
+        }
+    }
+};
+
+Heap::Heap() = default;
+
+Heap::~Heap() {
+    impl.reset();
+    if (base_) {
+        munmap(base_, capacity_);
+    }
+}
+
+bool Heap::reserve(size_t capacity) {
+    if (base_ || capacity < MIN_CAPACITY) {
+        return false;
+    }
+    if (capacity > MAX_CAPACITY) {
+        capacity = MAX_CAPACITY;
+    }
+    capacity &= ~(PAGE_SIZE - 1);
+    // MAP_NORESERVE: резервируем адреса, а не память
+    void* base = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    base_ = static_cast<uint8_t*>(base);
+    capacity_ = capacity;
+    impl = std::make_unique<Impl>(*this, capacity);
+    if (!impl->reserveBitmap(capacity)) {
+        impl.reset();
+        munmap(base_, capacity_);
+        base_ = nullptr;
+        capacity_ = 0;
+        return false;
+    }
+    return true;
+}
+
+Object* Heap::allocate(size_t bytes) {
+    if (!impl) {
+        return nullptr;
+    }
+    bytes = alignSize(bytes);
+    if (tlab.owner == impl.get() && bytes <= static_cast<size_t>(tlab.end - tlab.top) &&
+        tlab.epoch == impl->currentEpoch()) {
+        auto* object = reinterpret_cast<Object*>(tlab.top);
+        tlab.top += bytes;
+        ++tlab.objects;
+        tlab.bytes += bytes;
+        return object;
+    }
+    return impl->allocateSlow(bytes);
+}
+
+size_t Heap::addRootSource(RootSource source) {
+    return impl ? impl->addRootSource(std::move(source)) : 0;
+}
+
+void Heap::removeRootSource(size_t id) {
+    if (impl) {
+        impl->removeRootSource(id);
+    }
+}
+
+void Heap::writeOldReference(ObjectRef holder, ObjectRef* slot, ObjectRef value) {
+    impl->writeBarrier(holder, slot, value);
+}
+
+void Heap::collectGarbage() {
+    if (impl) {
+        impl->collect(false);
+    }
+}
+
+size_t Heap::used() const {
+    return impl ? impl->used() : 0;
+}
+
+uint64_t Heap::allocatedObjects() const {
+    return impl ? impl->allocatedObjects() : 0;
+}
+
+HeapStats Heap::getStats() const {
+    return impl ? impl->getStats() : HeapStats{};
+}
+
+} // namespace anexec
@@ -0,0 +1,150 @@
+#ifndef ANEXEC_HEAP_H
+#define ANEXEC_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace anexec {
+
+struct Class;
+
+// Ссылка на объект - смещение от начала кучи (как сжатые ссылки ART),
+// поэтому помещается в один 32-битный регистр Dalvik. 0 - null.
+using ObjectRef = uint32_t;
+constexpr ObjectRef NULL_REF = 0;
+
+// Заголовок объекта; поля или элементы массива идут сразу за ним
+struct Object {
+    Class* klass;
+    uint32_t flags;     // Служебные биты сборщика (возраст, запомненный объект)
+    uint32_t length;    // Длина массива или строки
+};
+
+static_assert(sizeof(Object) == 16, "object header must stay 16 bytes");
+
+struct HeapStats {
+    uint64_t allocated_bytes;       // Выдано под объекты за все время
+    uint64_t allocated_objects;
+    uint64_t allocation_rate;       // Байт в секунду между двумя последними сборками молодого поколения
+    uint64_t young_collections;
+    uint64_t concurrent_cycles;     // Завершенных циклов старого поколения
+    uint64_t full_collections;      // Полных сборок с уплотнением
+    uint64_t promoted_bytes;
+    uint64_t last_pause_us;
+    uint64_t max_pause_us;
+    uint64_t max_young_pause_us;    // Только сборки молодого поколения
+    uint64_t total_young_pause_us;
+    uint64_t max_full_pause_us;     // Только полные сборки с уплотнением
+    uint64_t total_full_pause_us;
+    uint64_t total_pause_us;
+    size_t eden_size;               // Текущий размер eden (подстраивается под паузы)
+    size_t old_used;
+    size_t old_capacity;
+};
+
+// Управляемая куча: одна область адресов размером heap_size, резервируемая
+// целиком при старте. Молодое поколение (eden и два survivor) лежит в
+// начале области, старое - за ним.
+//  - Потоки выделяют память сдвигом указателя в своем TLAB, взятом из eden.
+//  - Когда eden заканчивается, выделяющий поток останавливается и копирует
+//    живые объекты eden и survivor в другой survivor или, после нескольких
+//    сборок, в старое поколение. Ссылки из старого поколения в молодое
+//    запоминаются барьером записи. Пауза пропорциональна числу выживших,
+//    а размер eden подстраивается так, чтобы она укладывалась в PAUSE_TARGET_US.
+//  - Старое поколение размечается фоновым потоком параллельно с приложением
+//    (snapshot-at-the-beginning: барьер сохраняет перезаписываемые ссылки) и
+//    подметается им же в списки свободных блоков. Цикл начинается по порогу
+//    заполнения или раньше, если по темпу переноса выживших место кончится
+//    до конца цикла. Если места все же не остается - полная сборка с
+//    уплотнением старого поколения.
+// Управляемый код в каждый момент выполняет один поток: сборка идет в
+// потоке, которому не хватило памяти, другие потоки объекты не трогают.
+class Heap {
+public:
+    // Сжатые ссылки ограничивают кучу 4GB
+    static constexpr size_t MAX_CAPACITY = (size_t{1} << 32) - 4096;
+    static constexpr size_t ALIGNMENT = 8;
+    static constexpr size_t TLAB_SIZE = 32 * 1024;
+    // Крупные объекты сразу создаются в старом поколении, без копирования
+    static constexpr size_t LARGE_OBJECT_SIZE = 64 * 1024;
+    static constexpr uint64_t PAUSE_TARGET_US = 4000;
+
+    // Обходчик корней получает каждую ссылку по адресу и может ее заменить
+    using RootVisitor = std::function<void(ObjectRef& ref)>;
+    using RootSource = std::function<void(const RootVisitor& visitor)>;
+
+    // Ссылка в переменной C++, которую сборщик обновляет при перемещении объекта
+    class ScopedRoot {
+    public:
+        ScopedRoot(Heap& heap, ObjectRef& ref) : heap(heap) { heap.scoped_roots_.push_back(&ref); }
+        ~ScopedRoot() { heap.scoped_roots_.pop_back(); }
+
+        ScopedRoot(const ScopedRoot&) = delete;
+        ScopedRoot& operator=(const ScopedRoot&) = delete;
+
+    private:
+        Heap& heap;
+    };
+
+    Heap();
+    ~Heap();
+
+    // Запрещаем копирование
+    Heap(const Heap&) = delete;
+    Heap& operator=(const Heap&) = delete;
+
+    bool reserve(size_t capacity);
+
+    // Обнуленная память под объект; nullptr - куча исчерпана и после сборки.
+    // Может запустить сборку, которая перемещает объекты.
+    Object* allocate(size_t bytes);
+
+    // Стеки, статические поля, кэши. Возвращает номер для removeRootSource.
+    size_t addRootSource(RootSource source);
+    void removeRootSource(size_t id);
+
+    // Запись ссылки value в поле объекта holder с барьером сборщика
+    void writeReference(ObjectRef holder, ObjectRef* slot, ObjectRef value) {
+        if (holder < young_limit_) {
+            *slot = value;
+            return;
+        }
+        writeOldReference(holder, slot, value);
+    }
+
+    // Сборка молодого поколения немедленно (для тестов и перед замерами)
+    void collectGarbage();
+
+    Object* object(ObjectRef ref) const {
+        return reinterpret_cast<Object*>(base_ + ref);
+    }
+    ObjectRef ref(const Object* object) const {
+        return object ? static_cast<ObjectRef>(reinterpret_cast<const uint8_t*>(object) - base_) : NULL_REF;
+    }
+
+    uint8_t* base() const { return base_; }
+    size_t capacity() const { return capacity_; }
+    // Ссылки меньше этой границы - объекты молодого поколения
+    ObjectRef youngLimit() const { return young_limit_; }
+    size_t used() const;
+    uint64_t allocatedObjects() const;
+    HeapStats getStats() const;
+
+private:
+    class Impl;
+
+    void writeOldReference(ObjectRef holder, ObjectRef* slot, ObjectRef value);
+
+    uint8_t* base_{nullptr};
+    size_t capacity_{0};
+    ObjectRef young_limit_{0};
+    std::vector<ObjectRef*> scoped_roots_;
+    std::unique_ptr<Impl> impl;
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_HEAP_H
@@ -0,0 +1,1870 @@
+#include "interpreter.h"
+#include "aot_image.h"
+#include "apk_image.h"
+#include "dex_instructions.h"
+#include "verifier.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#if !defined(__GNUC__)
+#error "threaded dispatch needs labels as values (GCC or Clang)"
+#endif
+
+namespace anexec {
+
+namespace {
+
+constexpr std::string_view ABSTRACT_METHOD_ERROR = "Ljava/lang/AbstractMethodError;";
+constexpr std::string_view ARITHMETIC_EXCEPTION = "Ljava/lang/ArithmeticException;";
+constexpr std::string_view ARRAY_INDEX_EXCEPTION = "Ljava/lang/ArrayIndexOutOfBoundsException;";
+constexpr std::string_view ARRAY_STORE_EXCEPTION = "Ljava/lang/ArrayStoreException;";
+constexpr std::string_view CLASS_CAST_EXCEPTION = "Ljava/lang/ClassCastException;";
+constexpr std::string_view INCOMPATIBLE_CLASS_CHANGE_ERROR = "Ljava/lang/IncompatibleClassChangeError;";
+constexpr std::string_view ILLEGAL_ARGUMENT_EXCEPTION = "Ljava/lang/IllegalArgumentException;";
+constexpr std::string_view INSTANTIATION_ERROR = "Ljava/lang/InstantiationError;";
+constexpr std::string_view INTERNAL_ERROR = "Ljava/lang/InternalError;";
+constexpr std::string_view NEGATIVE_ARRAY_SIZE_EXCEPTION = "Ljava/lang/NegativeArraySizeException;";
+constexpr std::string_view NO_CLASS_DEF_FOUND_ERROR = "Ljava/lang/NoClassDefFoundError;";
+constexpr std::string_view NO_SUCH_FIELD_ERROR = "Ljava/lang/NoSuchFieldError;";
+constexpr std::string_view NO_SUCH_METHOD_ERROR = "Ljava/lang/NoSuchMethodError;";
+constexpr std::string_view NULL_POINTER_EXCEPTION = "Ljava/lang/NullPointerException;";
+constexpr std::string_view OUT_OF_MEMORY_ERROR = "Ljava/lang/OutOfMemoryError;";
+constexpr std::string_view STACK_OVERFLOW_ERROR = "Ljava/lang/StackOverflowError;";
+constexpr std::string_view UNSATISFIED_LINK_ERROR = "Ljava/lang/UnsatisfiedLinkError;";
+constexpr std::string_view VERIFY_ERROR = "Ljava/lang/VerifyError;";
+
+// Кадр метода; за ним лежат регистры, затем их копия для ссылок.
+// В refs[i] хранится ссылка, если в регистре i объект, иначе 0:
+// так корни для будущего сборщика известны точно.
+struct Frame {
+    Frame* caller;
+    Method* method;
+    const uint16_t* pc;     // Инструкция вызова, пока работает вызванный метод
+    uint32_t registers;
+    uint32_t reserved;
+
+    uint32_t* regs() { return reinterpret_cast<uint32_t*>(this + 1); }
+    ObjectRef* refs() { return regs() + registers; }
+};
+
+static_assert(sizeof(Frame) % 8 == 0, "frames must keep the stack 8-byte aligned");
+
+// Вложенность кода JIT в стеке C++: каждый вход в скомпилированный метод
+// и выход из него в интерпретатор занимает кадры машинного стека. Глубже
+// методы выполняются интерпретатором, который стек C++ не углубляет.
+constexpr uint32_t MAX_NATIVE_DEPTH = 256;
+
+// После порога счетчик сбрасывается так, чтобы готовность кода JIT для
+// цикла проверялась раз в столько обратных переходов
+constexpr uint32_t HOTNESS_RECHECK_INTERVAL = 1024;
+
+inline uint64_t loadWide(const uint32_t* regs) {
+    uint64_t value;
+    std::memcpy(&value, regs, sizeof(value));
+    return value;
+}
+
+inline void storeWide(uint32_t* regs, uint64_t value) {
+    std::memcpy(regs, &value, sizeof(value));
+}
+
+inline uint32_t floatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline float bitsFloat(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline uint64_t doubleBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline double bitsDouble(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Приведение по правилам Java: NaN - 0, вне диапазона - насыщение
+template <typename To, typename From>
+To floatToIntegral(From value) {
+    if (std::isnan(value)) {
+        return 0;
+    }
+    if (value >= static_cast<From>(std::numeric_limits<To>::max())) {
+        return std::numeric_limits<To>::max();
+    }
+    if (value <= static_cast<From>(std::numeric_limits<To>::min())) {
+        return std::numeric_limits<To>::min();
+    }
+    return static_cast<To>(value);
+}
+
+} // namespace
+
+class Interpreter::Impl {
+public:
+    Impl(ClassLinker& linker, size_t stack_size)
+        : linker(linker),
+          stack(new uint64_t[(stack_size + 7) / 8]),
+          stack_top(reinterpret_cast<uint8_t*>(stack.get())),
+          stack_end(stack_top + (stack_size + 7) / 8 * 8) {
+        root_source = linker.heap().addRootSource([this](const Heap::RootVisitor& visit) { visitRoots(visit); });
+    }
+
+    ~Impl() {
+        linker.heap().removeRootSource(root_source);
+    }
+
+    bool invoke(Method* method, const uint32_t* args, size_t count, uint64_t* result) {
+        uint64_t ignored = 0;
+        if (!result) {
+            result = &ignored;
+        }
+        *result = 0;
+        if (method->stub) {
+            return true;
+        }
+        if (!method->code) {
+            throwNew(method->isAbstract() ? ABSTRACT_METHOD_ERROR : UNSATISFIED_LINK_ERROR);
+            return false;
+        }
+        if (count != method->ins_size) {
+            throwNew(ILLEGAL_ARGUMENT_EXCEPTION);
+            return false;
+        }
+        if (!method->prepared) {
+            prepare(method);
+        }
+        if (method->rejected) {
+            throwNew(VERIFY_ERROR);
+            return false;
+        }
+
+        // Аргументы сразу попадают в кадр: дальше возможна сборка, и
+        // ссылки в args к ее окончанию могут устареть
+        Frame* frame = pushFrame(method, nullptr);
+        if (!frame) {
+            throwNew(STACK_OVERFLOW_ERROR);
+            return false;
+        }
+        uint32_t* ins = frame->regs() + method->registers_size - count;
+        ObjectRef* in_refs = frame->refs() + method->registers_size - count;
+        size_t word = 0;
+        if (!method->isStatic()) {
+            ins[0] = in_refs[0] = args[0];
+            word = 1;
+        }
+        for (size_t i = 1; i < method->shorty.size() && word < count; ++i) {
+            const char type = method->shorty[i];
+            ins[word] = args[word];
+            if (type == 'L') {
+                in_refs[word] = args[word];
+            }
+            ++word;
+            if ((type == 'J' || type == 'D') && word < count) {
+                ins[word] = args[word];
+                ++word;
+            }
+        }
+
+        // Ошибка нехватки памяти создается заранее: при исчерпании кучи ее уже не выделить
+        if (oom_error == NULL_REF) {
+            if (Class* klass = linker.findClass(OUT_OF_MEMORY_ERROR)) {
+                oom_error = linker.allocObject(klass);
+            }
+        }
+        if (method->isStatic() && !ensureInitialized(method->owner)) {
+            popFrame(frame);
+            return false;
+        }
+
+        ++stats.invocations;
+        countInvocation(method);
+        if (const JitCode* code = method->jit_code.load(std::memory_order_acquire)) {
+            return runCompiled(frame, code, code->nativeAt(0), result);
+        }
+        return execute(frame, method->insns, false, result);
+    }
+
+    bool enableJit(size_t code_cache_size) {
+        if (jit) {
+            return true;
+        }
+        if (!Jit::isSupported()) {
+            return false;
+        }
+        auto compiler = std::make_unique<Jit>(code_cache_size);
+        if (!compiler->start()) {
+            return false;
+        }
+        jit = std::move(compiler);
+        return true;
+    }
+
+    JitStats getJitStats() const {
+        return jit ? jit->getStats() : JitStats{};
+    }
+
+    bool ensureInitialized(Class* klass) {
+        // Initializing: повторный вход из <clinit> того же класса
+        if (klass->state == Class::State::Initialized || klass->state == Class::State::Initializing) {
+            return true;
+        }
+        if (klass->state == Class::State::Error) {
+            throwNew(NO_CLASS_DEF_FOUND_ERROR);
+            return false;
+        }
+        if (klass->super && !ensureInitialized(klass->super)) {
+            klass->state = Class::State::Error;
+            return false;
+        }
+
+        klass->state = Class::State::Initializing;
+        if (initializeFromImage(klass)) {
+            klass->state = Class::State::Initialized;
+            return true;
+        }
+        linker.initializeStatics(klass);
+        for (Method& method : klass->methods) {
+            if (method.isStatic() && method.name == "<clinit>") {
+                if (!invoke(&method, nullptr, 0, nullptr)) {
+                    klass->state = Class::State::Error;
+                    return false;
+                }
+                break;
+            }
+        }
+        klass->state = Class::State::Initialized;
+        return true;
+    }
+
+    // Ускорение при первом вызове: копия кода, в которой обращения к полям
+    // объектов и виртуальные вызовы ссылаются прямо на смещение и слот vtable.
+    // Ссылки, которые не разрешаются, остаются как есть и при выполнении
+    // бросают соответствующую ошибку. Перед этим код проверяется:
+    // отвергнутый метод не выполняется и не компилируется.
+    void prepare(Method* method) {
+        method->prepared = true;
+        if (!method->code || method->owner->dex == DEX_NO_INDEX) {
+            return;
+        }
+        if (!verifyCode(*linker.dexCache(method->owner->dex).dex, method->code)) {
+            method->rejected = true;
+            ++stats.rejected_methods;
+            return;
+        }
+        if (prepareFromImage(method)) {
+            return;
+        }
+        const uint32_t dex = method->owner->dex;
+        const uint32_t size = method->insns_size;
+        std::unique_ptr<uint16_t[]> code(new uint16_t[size]);
+        std::memcpy(code.get(), method->insns, size * sizeof(uint16_t));
+
+        uint32_t quickened = 0;
+        for (uint32_t pc = 0; pc < size;) {
+            const uint16_t inst = code[pc];
+            const uint8_t opcode = inst & 0xff;
+            const uint32_t width = opcode == OP_NOP ? payloadWidth(code.get() + pc) : INSTRUCTION_WIDTH[opcode];
+            if (pc + width > size) {
+                break;
+            }
+
+            if (opcode >= OP_IGET && opcode <= OP_IPUT_SHORT) {
+                const Field* field = linker.resolveField(dex, code[pc + 1], false);
+                if (field && field->offset <= 0xFFFF) {
+                    code[pc] = static_cast<uint16_t>((inst & 0xff00) | QUICK_FIELD_OPCODE[opcode - OP_IGET]);
+                    code[pc + 1] = static_cast<uint16_t>(field->offset);
+                    ++quickened;
+                }
+            } else if (opcode == OP_INVOKE_VIRTUAL || opcode == OP_INVOKE_VIRTUAL_RANGE) {
+                const Method* target = linker.resolveMethod(dex, code[pc + 1]);
+                if (target && target->vtable_index != NO_VTABLE_INDEX && !target->owner->isInterface()) {
+                    const uint8_t quick = opcode == OP_INVOKE_VIRTUAL ? OP_INVOKE_VIRTUAL_QUICK
+                                                                      : OP_INVOKE_VIRTUAL_RANGE_QUICK;
+                    code[pc] = static_cast<uint16_t>((inst & 0xff00) | quick);
+                    code[pc + 1] = target->vtable_index;
+                    ++quickened;
+                }
+            }
+            pc += width;
+        }
+
+        if (quickened != 0) {
+            method->quickened = std::move(code);
+            method->insns = method->quickened.get();
+            ++stats.quickened_methods;
+            stats.quickened_instructions += quickened;
+        }
+    }
+
+    ObjectRef exception{NULL_REF};
+    InterpreterStats stats{};
+
+private:
+    ClassLinker& linker;
+    std::unique_ptr<uint64_t[]> stack;
+    uint8_t* stack_top;
+    uint8_t* const stack_end;
+    ObjectRef caught{NULL_REF};     // Для move-exception
+    ObjectRef oom_error{NULL_REF};
+    std::unique_ptr<Jit> jit;
+    std::vector<std::unique_ptr<JitCode>> aot_code;     // Код из образа AOT
+    const JitHelpers jit_helpers{&Impl::jitInvoke, &Impl::jitInvokeCached, &Impl::jitStaticField,
+                                 &Impl::jitWriteReference};
+    JitThread jit_thread{0, this, &jit_helpers, linker.heap().base(), linker.heap().youngLimit()};
+    uint32_t native_depth{0};
+    size_t root_source{0};
+
+    Frame* pushFrame(Method* method, Frame* caller) {
+        const size_t bytes = sizeof(Frame) + size_t{method->registers_size} * 2 * sizeof(uint32_t);
+        if (bytes > static_cast<size_t>(stack_end - stack_top)) {
+            return nullptr;
+        }
+        auto* frame = reinterpret_cast<Frame*>(stack_top);
+        // Кадры должны оставаться выровненными на 8 для wide-регистров
+        stack_top += (bytes + 7) & ~size_t{7};
+        frame->caller = caller;
+        frame->method = method;
+        frame->pc = nullptr;
+        frame->registers = method->registers_size;
+        std::memset(frame->regs(), 0, size_t{method->registers_size} * 2 * sizeof(uint32_t));
+        return frame;
+    }
+
+    void popFrame(Frame* frame) {
+        stack_top = reinterpret_cast<uint8_t*>(frame);
+    }
+
+    // Кадры лежат в стеке подряд; регистр со ссылкой обновляется вместе с refs
+    void visitRoots(const Heap::RootVisitor& visit) {
+        uint8_t* cursor = reinterpret_cast<uint8_t*>(stack.get());
+        while (cursor < stack_top) {
+            auto* frame = reinterpret_cast<Frame*>(cursor);
+            uint32_t* regs = frame->regs();
+            ObjectRef* refs = frame->refs();
+            for (uint32_t i = 0; i < frame->registers; ++i) {
+                if (refs[i] != NULL_REF) {
+                    visit(refs[i]);
+                    regs[i] = refs[i];
+                }
+            }
+            cursor += (sizeof(Frame) + size_t{frame->registers} * 2 * sizeof(uint32_t) + 7) & ~size_t{7};
+        }
+        visit(exception);
+        visit(caught);
+        visit(oom_error);
+    }
+
+    // Кадр вызываемого метода с аргументами из регистров инструкции вызова
+    Frame* pushCall(Frame* frame, Method* callee, const uint16_t* pc, bool range) {
+        Frame* const callee_frame = pushFrame(callee, frame);
+        if (!callee_frame) {
+            return nullptr;
+        }
+        const uint32_t count = callee->ins_size;
+        uint32_t* const regs = frame->regs();
+        ObjectRef* const refs = frame->refs();
+        uint32_t* const ins = callee_frame->regs() + callee->registers_size - count;
+        ObjectRef* const in_refs = callee_frame->refs() + callee->registers_size - count;
+        if (range) {
+            std::memcpy(ins, regs + pc[2], count * sizeof(uint32_t));
+            std::memcpy(in_refs, refs + pc[2], count * sizeof(ObjectRef));
+        } else {
+            const uint32_t args = pc[2] | static_cast<uint32_t>(pc[0] & 0x0f00) << 8;
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint32_t reg = (args >> (i * 4)) & 0xf;
+                ins[i] = regs[reg];
+                in_refs[i] = refs[reg];
+            }
+        }
+        return callee_frame;
+    }
+
+    void countInvocation(Method* method) {
+        if (++method->hotness == Jit::COMPILE_THRESHOLD && jit) {
+            jit->requestCompile(method);
+        }
+    }
+
+    // Выполнение кадра кодом JIT с адреса start. Выход в интерпретатор
+    // продолжает тот же кадр с указанной инструкции. Кадр снимается.
+    bool runCompiled(Frame* frame, const JitCode* code, const void* start, uint64_t* result) {
+        ++native_depth;
+        ++stats.compiled_invocations;
+        const uint32_t status = code->run(&jit_thread, frame->regs(), start);
+        --native_depth;
+        if (status == JIT_RETURNED) {
+            popFrame(frame);
+            *result = jit_thread.retval;
+            return true;
+        }
+        const uint16_t* pc = frame->method->insns + (status & ~JIT_EXCEPTION);
+        return execute(frame, pc, (status & JIT_EXCEPTION) != 0, result);
+    }
+
+    // Метод вызывается из кода JIT: свой кадр, затем JIT или интерпретатор
+    bool callFromJit(Frame* frame, Method* callee, const uint16_t* pc) {
+        jit_thread.retval = 0;
+        if (!callee->code) {
+            if (callee->stub) {
+                return true;
+            }
+            throwNew(callee->isAbstract() ? ABSTRACT_METHOD_ERROR : UNSATISFIED_LINK_ERROR);
+            return false;
+        }
+        const uint8_t opcode = pc[0] & 0xff;
+        const bool range = (opcode >= 0x74 && opcode <= 0x78) || opcode == OP_INVOKE_VIRTUAL_RANGE_QUICK;
+        const uint32_t count = range ? pc[0] >> 8 : pc[0] >> 12;
+        if (count != callee->ins_size) {
+            throwNew(INCOMPATIBLE_CLASS_CHANGE_ERROR);
+            return false;
+        }
+        if (!callee->prepared) {
+            prepare(callee);
+        }
+        if (callee->rejected) {
+            throwNew(VERIFY_ERROR);
+            return false;
+        }
+        Frame* const callee_frame = pushCall(frame, callee, pc, range);
+        if (!callee_frame) {
+            throwNew(STACK_OVERFLOW_ERROR);
+            return false;
+        }
+        frame->pc = pc;
+        ++stats.invocations;
+        countInvocation(callee);
+
+        uint64_t value = 0;
+        const JitCode* code = callee->jit_code.load(std::memory_order_acquire);
+        const bool ok = code && native_depth < MAX_NATIVE_DEPTH
+                            ? runCompiled(callee_frame, code, code->nativeAt(0), &value)
+                            : execute(callee_frame, callee->insns, false, &value);
+        jit_thread.retval = value;
+        return ok;
+    }
+
+    // Точки входа из машинного кода (JitHelpers)
+    static bool jitInvoke(JitThread* thread, JitCallSite* site, uint32_t* regs) {
+        Impl& self = *static_cast<Impl*>(thread->owner);
+        Frame* const frame = reinterpret_cast<Frame*>(regs) - 1;
+        const uint16_t* pc = site->insn;
+        const uint8_t opcode = pc[0] & 0xff;
+        const bool range = (opcode >= 0x74 && opcode <= 0x78) || opcode == OP_INVOKE_VIRTUAL_RANGE_QUICK;
+        const uint32_t dex_index = site->caller->owner->dex;
+        const ObjectRef receiver = regs[range ? pc[2] : pc[2] & 0xf];
+        Method* callee = site->cached_target;
+
+        switch (opcode) {
+            case 0x6e: case 0x72: case 0x74: case 0x78:     // invoke-virtual/interface
+            case OP_INVOKE_VIRTUAL_QUICK: case OP_INVOKE_VIRTUAL_RANGE_QUICK: {
+                if (receiver == NULL_REF) {
+                    self.throwNew(NULL_POINTER_EXCEPTION);
+                    return false;
+                }
+                Class* klass = self.linker.heap().object(receiver)->klass;
+                if (opcode == OP_INVOKE_VIRTUAL_QUICK || opcode == OP_INVOKE_VIRTUAL_RANGE_QUICK) {
+                    if (pc[1] >= klass->vtable.size()) {
+                        self.throwNew(INCOMPATIBLE_CLASS_CHANGE_ERROR);
+                        return false;
+                    }
+                    callee = klass->vtable[pc[1]];
+                } else {
+                    const Method* resolved = self.linker.resolveMethod(dex_index, pc[1]);
+                    if (!resolved) {
+                        self.throwNew(NO_SUCH_METHOD_ERROR);
+                        return false;
+                    }
+                    callee = self.linker.findImplementation(klass, resolved);
+                    if (!callee) {
+                        self.throwNew(ABSTRACT_METHOD_ERROR);
+                        return false;
+                    }
+                }
+                // Мономорфный кэш: запоминается последний класс получателя
+                site->cached_class = klass;
+                site->cached_target = callee;
+                ++self.stats.inline_cache_misses;
+                break;
+            }
+            case 0x6f: case 0x75: {     // invoke-super
+                if (!callee) {
+                    Method* resolved = self.linker.resolveMethod(dex_index, pc[1]);
+                    if (!resolved) {
+                        self.throwNew(NO_SUCH_METHOD_ERROR);
+                        return false;
+                    }
+                    const Class* super = site->caller->owner->super;
+                    callee = resolved;
+                    if (super && resolved->vtable_index < super->vtable.size()) {
+                        callee = super->vtable[resolved->vtable_index];
+                    }
+                    site->cached_target = callee;
+                }
+                if (receiver == NULL_REF) {
+                    self.throwNew(NULL_POINTER_EXCEPTION);
+                    return false;
+                }
+                break;
+            }
+            case 0x70: case 0x76:       // invoke-direct
+                if (!callee) {
+                    callee = site->cached_target = self.linker.resolveMethod(dex_index, pc[1]);
+                    if (!callee) {
+                        self.throwNew(NO_SUCH_METHOD_ERROR);
+                        return false;
+                    }
+                }
+                if (receiver == NULL_REF) {
+                    self.throwNew(NULL_POINTER_EXCEPTION);
+                    return false;
+                }
+                break;
+            default:                    // invoke-static
+                if (!callee) {
+                    callee = site->cached_target = self.linker.resolveMethod(dex_index, pc[1]);
+                    if (!callee) {
+                        self.throwNew(NO_SUCH_METHOD_ERROR);
+                        return false;
+                    }
+                }
+                if (callee->owner->state != Class::State::Initialized && !self.ensureInitialized(callee->owner)) {
+                    return false;
+                }
+                break;
+        }
+        return self.callFromJit(frame, callee, pc);
+    }
+
+    // Класс получателя совпал с запомненным в месте вызова
+    static bool jitInvokeCached(JitThread* thread, JitCallSite* site, uint32_t* regs) {
+        Impl& self = *static_cast<Impl*>(thread->owner);
+        ++self.stats.inline_cache_hits;
+        return self.callFromJit(reinterpret_cast<Frame*>(regs) - 1, site->cached_target, site->insn);
+    }
+
+    static void jitWriteReference(JitThread* thread, uint32_t holder, uint32_t offset, uint32_t value) {
+        Heap& heap = static_cast<Impl*>(thread->owner)->linker.heap();
+        heap.writeReference(holder, reinterpret_cast<ObjectRef*>(heap.base() + holder + offset), value);
+    }
+
+    static uint8_t* jitStaticField(JitThread* thread, JitFieldSite* site) {
+        Impl& self = *static_cast<Impl*>(thread->owner);
+        const Field* field = self.linker.resolveField(site->caller->owner->dex, site->insn[1], true);
+        if (!field) {
+            self.throwNew(NO_SUCH_FIELD_ERROR);
+            return nullptr;
+        }
+        Class* owner = field->owner;
+        if (owner->state != Class::State::Initialized && !self.ensureInitialized(owner)) {
+            return nullptr;
+        }
+        uint8_t* address = owner->staticData() + field->offset;
+        // Пока класс инициализируется (обращение из его <clinit>), не кэшируем
+        if (owner->state == Class::State::Initialized) {
+            site->address = address;
+        }
+        return address;
+    }
+
+    void throwNew(std::string_view descriptor) {
+        Class* klass = linker.findClass(descriptor);
+        ObjectRef ref = klass ? linker.allocObject(klass) : NULL_REF;
+        exception = ref != NULL_REF ? ref : oom_error;
+        ++stats.exceptions_thrown;
+    }
+
+    // Образ AOT, в который собран DEX класса
+    const AotImage* aotImage(const Class* klass) const {
+        const ApkImage* image = linker.getImage();
+        return image && image->aot && klass->dex < image->aot_dex_count ? image->aot.get() : nullptr;
+    }
+
+    // Код метода из образа AOT: ускоренная копия уже в отображении образа,
+    // машинный код ставится сразу, без ожидания JIT
+    bool prepareFromImage(Method* method) {
+        const AotImage* aot = aotImage(method->owner);
+        const uint16_t* insns = aot ? aot->insns(method) : nullptr;
+        if (!insns) {
+            return false;
+        }
+        method->insns = insns;
+        ++stats.aot_methods;
+
+        auto code = std::make_unique<JitCode>();
+        if (aot->loadCode(method, *code)) {
+            method->jit_state.store(Jit::Compiled, std::memory_order_relaxed);
+            method->jit_code.store(code.get(), std::memory_order_release);
+            aot_code.push_back(std::move(code));
+            ++stats.aot_compiled_methods;
+        }
+        return true;
+    }
+
+    // Статические поля класса, инициализированного при сборке образа:
+    // <clinit> не выполняется
+    bool initializeFromImage(Class* klass) {
+        const AotImage* aot = aotImage(klass);
+        size_t count = 0;
+        const uint64_t* values = aot ? aot->statics(klass->dex, klass->class_def, count) : nullptr;
+        if (!values || count != klass->statics.size()) {
+            return false;
+        }
+        std::copy(values, values + count, klass->statics.begin());
+        ++stats.preinitialized_classes;
+        return true;
+    }
+
+    // Обработчик для исключения в инструкции address метода или false
+    bool findCatch(Method* method, uint32_t address, uint32_t& handler) {
+        const uint32_t dex_index = method->owner->dex;
+        const DexView& dex = *linker.dexCache(dex_index).dex;
+        const Class* thrown = reinterpret_cast<Object*>(linker.heap().base() + exception)->klass;
+        const uint64_t tries = dex.triesOffset(method->code);
+        const uint64_t handlers = tries + uint64_t{method->tries_size} * sizeof(DexTryItem);
+
+        for (uint32_t i = 0; i < method->tries_size; ++i) {
+            const uint64_t item = tries + uint64_t{i} * sizeof(DexTryItem);
+            const uint32_t start = dex.read32(item);
+            if (address < start || address - start >= dex.read16(item + 4)) {
+                continue;
+            }
+            // Блоки try не пересекаются: подходит только этот
+            uint64_t offset = handlers + dex.read16(item + 6);
+            const int32_t size = dex.readSleb128(offset);
+            for (int32_t h = 0; h < std::abs(size); ++h) {
+                const uint32_t type_idx = dex.readUleb128(offset);
+                const uint32_t target = dex.readUleb128(offset);
+                const Class* klass = linker.resolveType(dex_index, type_idx);
+                if (klass && ClassLinker::isAssignable(thrown, klass)) {
+                    handler = target;
+                    return handler < method->insns_size;
+                }
+            }
+            if (size <= 0) {
+                handler = dex.readUleb128(offset);     // catch-all
+                return handler < method->insns_size;
+            }
+            return false;
+        }
+        return false;
+    }
+
+    // Выполняет entry с инструкции start (и все вызываемые им методы).
+    // pending_exception - в start брошено исключение, сначала ищется обработчик.
+    bool execute(Frame* entry, const uint16_t* start, bool pending_exception, uint64_t* result);
+};
+
+#define INST_A (static_cast<uint32_t>(inst >> 8) & 0x0f)
+#define INST_B (static_cast<uint32_t>(inst >> 12))
+#define INST_AA (static_cast<uint32_t>(inst >> 8))
+
+#define DISPATCH() do { inst = *pc; goto *HANDLERS[inst & 0xff]; } while (0)
+#define NEXT(width) do { pc += (width); DISPATCH(); } while (0)
+// Обратный переход - счетчик горячести метода для JIT
+#define BRANCH(offset) do { \
+        const int32_t offset_ = (offset); \
+        pc += offset_; \
+        if (offset_ <= 0 && ++method->hotness >= Jit::COMPILE_THRESHOLD) goto back_edge; \
+        DISPATCH(); \
+    } while (0)
+
+#define LOAD_FRAME() do { \
+        method = frame->method; \
+        regs = frame->regs(); \
+        refs = frame->refs(); \
+        dex_index = method->owner->dex; \
+        dex_cache = dex_index != DEX_NO_INDEX ? &linker.dexCache(dex_index) : nullptr; \
+    } while (0)
+
+#define SET_INT(r, value) do { \
+        const uint32_t r_ = (r); \
+        regs[r_] = static_cast<uint32_t>(value); \
+        refs[r_] = NULL_REF; \
+    } while (0)
+#define SET_REF(r, value) do { \
+        const uint32_t r_ = (r); \
+        regs[r_] = refs[r_] = (value); \
+    } while (0)
+#define SET_WIDE(r, value) do { \
+        const uint32_t r_ = (r); \
+        storeWide(regs + r_, static_cast<uint64_t>(value)); \
+        refs[r_] = refs[r_ + 1] = NULL_REF; \
+    } while (0)
+#define GET_WIDE(r) loadWide(regs + (r))
+#define GET_FLOAT(r) bitsFloat(regs[r])
+#define GET_DOUBLE(r) bitsDouble(GET_WIDE(r))
+
+#define OBJECT(ref) reinterpret_cast<Object*>(heap + (ref))
+#define THROW(descriptor) do { throwNew(descriptor); goto handle_exception; } while (0)
+
+// Разрешенные ссылки: сначала DexCache, при промахе - ClassLinker
+#define RESOLVE_METHOD(idx) \
+    ((idx) < dex_cache->methods.size() && dex_cache->methods[idx] ? dex_cache->methods[idx] \
+                                                                  : linker.resolveMethod(dex_index, idx))
+#define RESOLVE_TYPE(idx) \
+    ((idx) < dex_cache->types.size() && dex_cache->types[idx] ? dex_cache->types[idx] \
+                                                              : linker.resolveType(dex_index, idx))
+
+#define BINOP_INT(name, expr) \
+    op_##name##_int: { \
+        const uint16_t bc = pc[1]; \
+        const uint32_t a = regs[bc & 0xff]; \
+        const uint32_t b = regs[bc >> 8]; \
+        SET_INT(INST_AA, expr); \
+        NEXT(2); \
+    } \
+    op_##name##_int_2addr: { \
+        const uint32_t a = regs[INST_A]; \
+        const uint32_t b = regs[INST_B]; \
+        SET_INT(INST_A, expr); \
+        NEXT(1); \
+    }
+
+// Деление: 0 - ArithmeticException, MIN / -1 переполняется без исключения
+#define DIV_INT(name, expr) \
+    op_##name##_int: { \
+        const uint16_t bc = pc[1]; \
+        const int32_t a = static_cast<int32_t>(regs[bc & 0xff]); \
+        const int32_t b = static_cast<int32_t>(regs[bc >> 8]); \
+        if (b == 0) THROW(ARITHMETIC_EXCEPTION); \
+        SET_INT(INST_AA, expr); \
+        NEXT(2); \
+    } \
+    op_##name##_int_2addr: { \
+        const int32_t a = static_cast<int32_t>(regs[INST_A]); \
+        const int32_t b = static_cast<int32_t>(regs[INST_B]); \
+        if (b == 0) THROW(ARITHMETIC_EXCEPTION); \
+        SET_INT(INST_A, expr); \
+        NEXT(1); \
+    }
+
+#define BINOP_LONG(name, expr) \
+    op_##name##_long: { \
+        const uint16_t bc = pc[1]; \
+        const uint64_t a = GET_WIDE(bc & 0xff); \
+        const uint64_t b = GET_WIDE(bc >> 8); \
+        SET_WIDE(INST_AA, expr); \
+        NEXT(2); \
+    } \
+    op_##name##_long_2addr: { \
+        const uint64_t a = GET_WIDE(INST_A); \
+        const uint64_t b = GET_WIDE(INST_B); \
+        SET_WIDE(INST_A, expr); \
+        NEXT(1); \
+    }
+
+// Сдвиг long: величина сдвига в обычном int-регистре
+#define SHIFT_LONG(name, expr) \
+    op_##name##_long: { \
+        const uint16_t bc = pc[1]; \
+        const uint64_t a = GET_WIDE(bc & 0xff); \
+        const uint32_t b = regs[bc >> 8] & 0x3f; \
+        SET_WIDE(INST_AA, expr); \
+        NEXT(2); \
+    } \
+    op_##name##_long_2addr: { \
+        const uint64_t a = GET_WIDE(INST_A); \
+        const uint32_t b = regs[INST_B] & 0x3f; \
+        SET_WIDE(INST_A, expr); \
+        NEXT(1); \
+    }
+
+#define DIV_LONG(name, expr) \
+    op_##name##_long: { \
+        const uint16_t bc = pc[1]; \
+        const int64_t a = static_cast<int64_t>(GET_WIDE(bc & 0xff)); \
+        const int64_t b = static_cast<int64_t>(GET_WIDE(bc >> 8)); \
+        if (b == 0) THROW(ARITHMETIC_EXCEPTION); \
+        SET_WIDE(INST_AA, expr); \
+        NEXT(2); \
+    } \
+    op_##name##_long_2addr: { \
+        const int64_t a = static_cast<int64_t>(GET_WIDE(INST_A)); \
+        const int64_t b = static_cast<int64_t>(GET_WIDE(INST_B)); \
+        if (b == 0) THROW(ARITHMETIC_EXCEPTION); \
+        SET_WIDE(INST_A, expr); \
+        NEXT(1); \
+    }
+
+#define BINOP_FLOAT(name, expr) \
+    op_##name##_float: { \
+        const uint16_t bc = pc[1]; \
+        const float a = GET_FLOAT(bc & 0xff); \
+        const float b = GET_FLOAT(bc >> 8); \
+        SET_INT(INST_AA, floatBits(expr)); \
+        NEXT(2); \
+    } \
+    op_##name##_float_2addr: { \
+        const float a = GET_FLOAT(INST_A); \
+        const float b = GET_FLOAT(INST_B); \
+        SET_INT(INST_A, floatBits(expr)); \
+        NEXT(1); \
+    }
+
+#define BINOP_DOUBLE(name, expr) \
+    op_##name##_double: { \
+        const uint16_t bc = pc[1]; \
+        const double a = GET_DOUBLE(bc & 0xff); \
+        const double b = GET_DOUBLE(bc >> 8); \
+        SET_WIDE(INST_AA, doubleBits(expr)); \
+        NEXT(2); \
+    } \
+    op_##name##_double_2addr: { \
+        const double a = GET_DOUBLE(INST_A); \
+        const double b = GET_DOUBLE(INST_B); \
+        SET_WIDE(INST_A, doubleBits(expr)); \
+        NEXT(1); \
+    }
+
+// Операции с константой: lit16 (22s) и lit8 (22b)
+#define LITOP_INT(name16, name8, expr) \
+    op_##name16: { \
+        const uint32_t a = regs[INST_B]; \
+        const uint32_t b = static_cast<uint32_t>(static_cast<int16_t>(pc[1])); \
+        SET_INT(INST_A, expr); \
+        NEXT(2); \
+    } \
+    op_##name8: { \
+        const uint16_t bc = pc[1]; \
+        const uint32_t a = regs[bc & 0xff]; \
+        const uint32_t b = static_cast<uint32_t>(static_cast<int8_t>(bc >> 8)); \
+        SET_INT(INST_AA, expr); \
+        NEXT(2); \
+    }
+
+#define LITDIV_INT(name16, name8, expr) \
+    op_##name16: { \
+        const int32_t a = static_cast<int32_t>(regs[INST_B]); \
+        const int32_t b = static_cast<int16_t>(pc[1]); \
+        if (b == 0) THROW(ARITHMETIC_EXCEPTION); \
+        SET_INT(INST_A, expr); \
+        NEXT(2); \
+    } \
+    op_##name8: { \
+        const uint16_t bc = pc[1]; \
+        const int32_t a = static_cast<int32_t>(regs[bc & 0xff]); \
+        const int32_t b = static_cast<int8_t>(bc >> 8); \
+        if (b == 0) THROW(ARITHMETIC_EXCEPTION); \
+        SET_INT(INST_AA, expr); \
+        NEXT(2); \
+    }
+
+#define IF_TEST(name, op) \
+    op_if_##name: { \
+        if (static_cast<int32_t>(regs[INST_A]) op static_cast<int32_t>(regs[INST_B])) { \
+            BRANCH(static_cast<int16_t>(pc[1])); \
+        } \
+        NEXT(2); \
+    } \
+    op_if_##name##z: { \
+        if (static_cast<int32_t>(regs[INST_AA]) op 0) { \
+            BRANCH(static_cast<int16_t>(pc[1])); \
+        } \
+        NEXT(2); \
+    }
+
+// Элемент массива для aget/aput (23x): element указывает на vCC-й элемент vBB
+#define ARRAY_ELEMENT(type) \
+    const uint16_t bc = pc[1]; \
+    const ObjectRef array_ref = regs[bc & 0xff]; \
+    if (array_ref == NULL_REF) THROW(NULL_POINTER_EXCEPTION); \
+    Object* const array = OBJECT(array_ref); \
+    const uint32_t index = regs[bc >> 8]; \
+    if (index >= array->length) THROW(ARRAY_INDEX_EXCEPTION); \
+    type* const element = reinterpret_cast<type*>(array + 1) + index
+
+// Поле объекта vB по смещению из ускоренной инструкции
+#define QUICK_FIELD(type) \
+    const ObjectRef object_ref = regs[INST_B]; \
+    if (object_ref == NULL_REF) THROW(NULL_POINTER_EXCEPTION); \
+    type* const field = reinterpret_cast<type*>(heap + object_ref + pc[1])
+
+// Статическое поле; класс инициализируется при первом обращении
+#define STATIC_FIELD(type) \
+    const Field* resolved = pc[1] < dex_cache->fields.size() ? dex_cache->fields[pc[1]] : nullptr; \
+    if (!resolved || !resolved->is_static) { \
+        resolved = linker.resolveField(dex_index, pc[1], true); \
+        if (!resolved) THROW(NO_SUCH_FIELD_ERROR); \
+    } \
+    if (resolved->owner->state != Class::State::Initialized && !ensureInitialized(resolved->owner)) { \
+        goto handle_exception; \
+    } \
+    type* const field = reinterpret_cast<type*>(resolved->owner->staticData() + resolved->offset)
+
+bool Interpreter::Impl::execute(Frame* entry, const uint16_t* start, bool pending_exception, uint64_t* result) {
+    static const void* const HANDLERS[256] = {
+        &&op_nop, &&op_move, &&op_move_from16, &&op_move_16,  // 00
+        &&op_move_wide, &&op_move_wide_from16, &&op_move_wide_16, &&op_move_object,  // 04
+        &&op_move_object_from16, &&op_move_object_16, &&op_move_result, &&op_move_result_wide,  // 08
+        &&op_move_result_object, &&op_move_exception, &&op_return_void, &&op_return,  // 0c
+        &&op_return_wide, &&op_return_object, &&op_const_4, &&op_const_16,  // 10
+        &&op_const, &&op_const_high16, &&op_const_wide_16, &&op_const_wide_32,  // 14
+        &&op_const_wide, &&op_const_wide_high16, &&op_const_string, &&op_const_string_jumbo,  // 18
+        &&op_const_class, &&op_monitor_enter, &&op_monitor_exit, &&op_check_cast,  // 1c
+        &&op_instance_of, &&op_array_length, &&op_new_instance, &&op_new_array,  // 20
+        &&op_filled_new_array, &&op_filled_new_array_range, &&op_fill_array_data, &&op_throw,  // 24
+        &&op_goto, &&op_goto_16, &&op_goto_32, &&op_packed_switch,  // 28
+        &&op_sparse_switch, &&op_cmpl_float, &&op_cmpg_float, &&op_cmpl_double,  // 2c
+        &&op_cmpg_double, &&op_cmp_long, &&op_if_eq, &&op_if_ne,  // 30
+        &&op_if_lt, &&op_if_ge, &&op_if_gt, &&op_if_le,  // 34
+        &&op_if_eqz, &&op_if_nez, &&op_if_ltz, &&op_if_gez,  // 38
+        &&op_if_gtz, &&op_if_lez, &&op_unused, &&op_unused,  // 3c
+        &&op_unused, &&op_unused, &&op_unused, &&op_unused,  // 40
+        &&op_aget, &&op_aget_wide, &&op_aget_object, &&op_aget_boolean,  // 44
+        &&op_aget_byte, &&op_aget_char, &&op_aget_short, &&op_aput,  // 48
+        &&op_aput_wide, &&op_aput_object, &&op_aput_boolean, &&op_aput_byte,  // 4c
+        &&op_aput_char, &&op_aput_short, &&op_iget, &&op_iget_wide,  // 50
+        &&op_iget_object, &&op_iget_boolean, &&op_iget_byte, &&op_iget_char,  // 54
+        &&op_iget_short, &&op_iput, &&op_iput_wide, &&op_iput_object,  // 58
+        &&op_iput_boolean, &&op_iput_byte, &&op_iput_char, &&op_iput_short,  // 5c
+        &&op_sget, &&op_sget_wide, &&op_sget_object, &&op_sget_boolean,  // 60
+        &&op_sget_byte, &&op_sget_char, &&op_sget_short, &&op_sput,  // 64
+        &&op_sput_wide, &&op_sput_object, &&op_sput_boolean, &&op_sput_byte,  // 68
+        &&op_sput_char, &&op_sput_short, &&op_invoke_virtual, &&op_invoke_super,  // 6c
+        &&op_invoke_direct, &&op_invoke_static, &&op_invoke_interface, &&op_unused,  // 70
+        &&op_invoke_virtual_range, &&op_invoke_super_range, &&op_invoke_direct_range, &&op_invoke_static_range,  // 74
+        &&op_invoke_interface_range, &&op_unused, &&op_unused, &&op_neg_int,  // 78
+        &&op_not_int, &&op_neg_long, &&op_not_long, &&op_neg_float,  // 7c
+        &&op_neg_double, &&op_int_to_long, &&op_int_to_float, &&op_int_to_double,  // 80
+        &&op_long_to_int, &&op_long_to_float, &&op_long_to_double, &&op_float_to_int,  // 84
+        &&op_float_to_long, &&op_float_to_double, &&op_double_to_int, &&op_double_to_long,  // 88
+        &&op_double_to_float, &&op_int_to_byte, &&op_int_to_char, &&op_int_to_short,  // 8c
+        &&op_add_int, &&op_sub_int, &&op_mul_int, &&op_div_int,  // 90
+        &&op_rem_int, &&op_and_int, &&op_or_int, &&op_xor_int,  // 94
+        &&op_shl_int, &&op_shr_int, &&op_ushr_int, &&op_add_long,  // 98
+        &&op_sub_long, &&op_mul_long, &&op_div_long, &&op_rem_long,  // 9c
+        &&op_and_long, &&op_or_long, &&op_xor_long, &&op_shl_long,  // a0
+        &&op_shr_long, &&op_ushr_long, &&op_add_float, &&op_sub_float,  // a4
+        &&op_mul_float, &&op_div_float, &&op_rem_float, &&op_add_double,  // a8
+        &&op_sub_double, &&op_mul_double, &&op_div_double, &&op_rem_double,  // ac
+        &&op_add_int_2addr, &&op_sub_int_2addr, &&op_mul_int_2addr, &&op_div_int_2addr,  // b0
+        &&op_rem_int_2addr, &&op_and_int_2addr, &&op_or_int_2addr, &&op_xor_int_2addr,  // b4
+        &&op_shl_int_2addr, &&op_shr_int_2addr, &&op_ushr_int_2addr, &&op_add_long_2addr,  // b8
+        &&op_sub_long_2addr, &&op_mul_long_2addr, &&op_div_long_2addr, &&op_rem_long_2addr,  // bc
+        &&op_and_long_2addr, &&op_or_long_2addr, &&op_xor_long_2addr, &&op_shl_long_2addr,  // c0
+        &&op_shr_long_2addr, &&op_ushr_long_2addr, &&op_add_float_2addr, &&op_sub_float_2addr,  // c4
+        &&op_mul_float_2addr, &&op_div_float_2addr, &&op_rem_float_2addr, &&op_add_double_2addr,  // c8
+        &&op_sub_double_2addr, &&op_mul_double_2addr, &&op_div_double_2addr, &&op_rem_double_2addr,  // cc
+        &&op_add_int_lit16, &&op_rsub_int, &&op_mul_int_lit16, &&op_div_int_lit16,  // d0
+        &&op_rem_int_lit16, &&op_and_int_lit16, &&op_or_int_lit16, &&op_xor_int_lit16,  // d4
+        &&op_add_int_lit8, &&op_rsub_int_lit8, &&op_mul_int_lit8, &&op_div_int_lit8,  // d8
+        &&op_rem_int_lit8, &&op_and_int_lit8, &&op_or_int_lit8, &&op_xor_int_lit8,  // dc
+        &&op_shl_int_lit8, &&op_shr_int_lit8, &&op_ushr_int_lit8, &&op_iget_quick,  // e0
+        &&op_iget_wide_quick, &&op_iget_object_quick, &&op_iput_quick, &&op_iput_wide_quick,  // e4
+        &&op_iput_object_quick, &&op_invoke_virtual_quick, &&op_invoke_virtual_range_quick, &&op_iput_boolean_quick,  // e8
+        &&op_iput_byte_quick, &&op_iput_char_quick, &&op_iput_short_quick, &&op_iget_boolean_quick,  // ec
+        &&op_iget_byte_quick, &&op_iget_char_quick, &&op_iget_short_quick, &&op_unused,  // f0
+        &&op_unused, &&op_unused, &&op_unused, &&op_unused,  // f4
+        &&op_unused, &&op_unused, &&op_unused, &&op_unused,  // f8
+        &&op_unused, &&op_unused, &&op_unused, &&op_unused  // fc
+    };
+
+    uint8_t* const heap = linker.heap().base();
+    Frame* frame = entry;
+    Method* method = nullptr;
+    uint32_t* regs = nullptr;
+    ObjectRef* refs = nullptr;
+    uint32_t dex_index = DEX_NO_INDEX;
+    DexCache* dex_cache = nullptr;
+    LOAD_FRAME();
+
+    const uint16_t* pc = start;
+    uint16_t inst = 0;
+    uint64_t retval = 0;        // Результат последнего вызова для move-result
+    Method* callee = nullptr;
+    bool range = false;
+
+    if (pending_exception) {
+        goto handle_exception;
+    }
+    DISPATCH();
+
+    op_nop:
+        NEXT(1);
+
+    op_move:
+        SET_INT(INST_A, regs[INST_B]);
+        NEXT(1);
+    op_move_from16:
+        SET_INT(INST_AA, regs[pc[1]]);
+        NEXT(2);
+    op_move_16:
+        SET_INT(pc[1], regs[pc[2]]);
+        NEXT(3);
+    op_move_wide:
+        SET_WIDE(INST_A, GET_WIDE(INST_B));
+        NEXT(1);
+    op_move_wide_from16:
+        SET_WIDE(INST_AA, GET_WIDE(pc[1]));
+        NEXT(2);
+    op_move_wide_16:
+        SET_WIDE(pc[1], GET_WIDE(pc[2]));
+        NEXT(3);
+    op_move_object:
+        SET_REF(INST_A, regs[INST_B]);
+        NEXT(1);
+    op_move_object_from16:
+        SET_REF(INST_AA, regs[pc[1]]);
+        NEXT(2);
+    op_move_object_16:
+        SET_REF(pc[1], regs[pc[2]]);
+        NEXT(3);
+    op_move_result:
+        SET_INT(INST_AA, retval);
+        NEXT(1);
+    op_move_result_wide:
+        SET_WIDE(INST_AA, retval);
+        NEXT(1);
+    op_move_result_object:
+        SET_REF(INST_AA, static_cast<ObjectRef>(retval));
+        NEXT(1);
+    op_move_exception:
+        SET_REF(INST_AA, caught);
+        caught = NULL_REF;
+        NEXT(1);
+
+    op_return_void:
+        retval = 0;
+        goto do_return;
+    op_return:
+    op_return_object:
+        retval = regs[INST_AA];
+        goto do_return;
+    op_return_wide:
+        retval = GET_WIDE(INST_AA);
+        goto do_return;
+
+    op_const_4:
+        SET_INT(INST_A, static_cast<int32_t>(static_cast<int16_t>(inst)) >> 12);
+        NEXT(1);
+    op_const_16:
+        SET_INT(INST_AA, static_cast<int16_t>(pc[1]));
+        NEXT(2);
+    op_const:
+        SET_INT(INST_AA, read32(pc + 1));
+        NEXT(3);
+    op_const_high16:
+        SET_INT(INST_AA, static_cast<uint32_t>(pc[1]) << 16);
+        NEXT(2);
+    op_const_wide_16:
+        SET_WIDE(INST_AA, static_cast<int64_t>(static_cast<int16_t>(pc[1])));
+        NEXT(2);
+    op_const_wide_32:
+        SET_WIDE(INST_AA, static_cast<int64_t>(read32(pc + 1)));
+        NEXT(3);
+    op_const_wide:
+        SET_WIDE(INST_AA, static_cast<uint32_t>(read32(pc + 1)) |
+                          static_cast<uint64_t>(static_cast<uint32_t>(read32(pc + 3))) << 32);
+        NEXT(5);
+    op_const_wide_high16:
+        SET_WIDE(INST_AA, static_cast<uint64_t>(pc[1]) << 48);
+        NEXT(2);
+    op_const_string: {
+        const ObjectRef string = linker.resolveString(dex_index, pc[1]);
+        if (string == NULL_REF) THROW(OUT_OF_MEMORY_ERROR);
+        SET_REF(INST_AA, string);
+        NEXT(2);
+    }
+    op_const_string_jumbo: {
+        const ObjectRef string = linker.resolveString(dex_index, static_cast<uint32_t>(read32(pc + 1)));
+        if (string == NULL_REF) THROW(OUT_OF_MEMORY_ERROR);
+        SET_REF(INST_AA, string);
+        NEXT(3);
+    }
+    op_const_class: {
+        Class* klass = RESOLVE_TYPE(pc[1]);
+        if (!klass) THROW(NO_CLASS_DEF_FOUND_ERROR);
+        const ObjectRef object = linker.classObject(klass);
+        if (object == NULL_REF) THROW(OUT_OF_MEMORY_ERROR);
+        SET_REF(INST_AA, object);
+        NEXT(2);
+    }
+
+    // Поток приложения один, мониторам остается только проверка на null
+    op_monitor_enter:
+    op_monitor_exit:
+        if (regs[INST_AA] == NULL_REF) THROW(NULL_POINTER_EXCEPTION);
+        NEXT(1);
+
+    op_check_cast: {
+        const ObjectRef ref = regs[INST_AA];
+        if (ref != NULL_REF) {
+            const Class* klass = RESOLVE_TYPE(pc[1]);
+            if (!klass) THROW(NO_CLASS_DEF_FOUND_ERROR);
+            if (!ClassLinker::isAssignable(OBJECT(ref)->klass, klass)) THROW(CLASS_CAST_EXCEPTION);
+        }
+        NEXT(2);
+    }
+    op_instance_of: {
+        const ObjectRef ref = regs[INST_B];
+        bool matches = false;
+        if (ref != NULL_REF) {
+            const Class* klass = RESOLVE_TYPE(pc[1]);
+            if (!klass) THROW(NO_CLASS_DEF_FOUND_ERROR);
+            matches = ClassLinker::isAssignable(OBJECT(ref)->klass, klass);
+        }
+        SET_INT(INST_A, matches ? 1 : 0);
+        NEXT(2);
+    }
+    op_array_length: {
+        const ObjectRef ref = regs[INST_B];
+        if (ref == NULL_REF) THROW(NULL_POINTER_EXCEPTION);
+        SET_INT(INST_A, OBJECT(ref)->length);
+        NEXT(1);
+    }
+    op_new_instance: {
+        Class* klass = RESOLVE_TYPE(pc[1]);
+        if (!klass) THROW(NO_CLASS_DEF_FOUND_ERROR);
+        if (klass->isInterface() || klass->isArray() || (klass->access_flags & ACC_ABSTRACT) != 0) {
+            THROW(INSTANTIATION_ERROR);
+        }
+        if (klass->state != Class::State::Initialized && !ensureInitialized(klass)) {
+            goto handle_exception;
+        }
+        const ObjectRef object = linker.allocObject(klass);
+        if (object == NULL_REF) THROW(OUT_OF_MEMORY_ERROR);
+        SET_REF(INST_AA, object);
+        NEXT(2);
+    }
+    op_new_array: {
+        const int32_t length = static_cast<int32_t>(regs[INST_B]);
+        if (length < 0) THROW(NEGATIVE_ARRAY_SIZE_EXCEPTION);
+        Class* klass = RESOLVE_TYPE(pc[1]);
+        if (!klass || !klass->isArray()) THROW(NO_CLASS_DEF_FOUND_ERROR);
+        const ObjectRef array = linker.allocArray(klass, length);
+        if (array == NULL_REF) THROW(OUT_OF_MEMORY_ERROR);
+        SET_REF(INST_A, array);
+        NEXT(2);
+    }
+    op_filled_new_array:
+        range = false;
+        goto filled_new_array;
+    op_filled_new_array_range:
+        range = true;
+        goto filled_new_array;
+    filled_new_array: {
+        Class* klass = RESOLVE_TYPE(pc[1]);
+        if (!klass || !klass->isArray()) THROW(NO_CLASS_DEF_FOUND_ERROR);
+        // Только int[] и массивы ссылок (проверяет верификатор)
+        if (klass->component_size != 4 || klass->component->descriptor == "F") THROW(INTERNAL_ERROR);
+        const uint32_t count = range ? INST_AA : INST_B;
+        const ObjectRef array = linker.allocArray(klass, static_cast<int32_t>(count));
+        if (array == NULL_REF) THROW(OUT_OF_MEMORY_ERROR);
+        auto* data = reinterpret_cast<uint32_t*>(OBJECT(array) + 1);
+        const uint32_t args = pc[2] | INST_A << 16;
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint32_t value = regs[range ? pc[2] + i : (args >> (i * 4)) & 0xf];
+            if (klass->reference_elements) {
+                // Крупный массив мог сразу оказаться в старом поколении
+                linker.heap().writeReference(array, data + i, value);
+            } else {
+                data[i] = value;
+            }
+        }
+        retval = array;
+        NEXT(3);
+    }
+    op_fill_array_data: {
+        const ObjectRef ref = regs[INST_AA];
+        if (ref == NULL_REF) THROW(NULL_POINTER_EXCEPTION);
+        const uint16_t* payload = pc + read32(pc + 1);
+        Object* const array = OBJECT(ref);
+        const uint16_t width = payload[1];
+        const uint32_t count = static_cast<uint32_t>(read32(payload + 2));
+        if (width != array->klass->component_size) THROW(INTERNAL_ERROR);
+        if (count > array->length) THROW(ARRAY_INDEX_EXCEPTION);
+        std::memcpy(array + 1, payload + 4, size_t{count} * width);
+        NEXT(3);
+    }
+
+    op_throw: {
+        const ObjectRef ref = regs[INST_AA];
+        if (ref == NULL_REF) THROW(NULL_POINTER_EXCEPTION);
+        exception = ref;
+        ++stats.exceptions_thrown;
+        goto handle_exception;
+    }
+
+    op_goto:
+        BRANCH(static_cast<int8_t>(inst >> 8));
+    op_goto_16:
+        BRANCH(static_cast<int16_t>(pc[1]));
+    op_goto_32:
+        BRANCH(read32(pc + 1));
+    op_packed_switch: {
+        const uint16_t* payload = pc + read32(pc + 1);
+        const uint32_t index = regs[INST_AA] - static_cast<uint32_t>(read32(payload + 2));
+        if (index < payload[1]) {
+            BRANCH(read32(payload + 4 + index * 2));
+        }
+        NEXT(3);
+    }
+    op_sparse_switch: {
+        const uint16_t* payload = pc + read32(pc + 1);
+        const int32_t value = static_cast<int32_t>(regs[INST_AA]);
+        const uint16_t* keys = payload + 2;
+        // Ключи отсортированы по возрастанию
+        int32_t low = 0;
+        int32_t high = static_cast<int32_t>(payload[1]) - 1;
+        while (low <= high) {
+            const int32_t middle = (low + high) / 2;
+            const int32_t key = read32(keys + middle * 2);
+            if (key < value) {
+                low = middle + 1;
+            } else if (key > value) {
+                high = middle - 1;
+            } else {
+                BRANCH(read32(keys + payload[1] * 2 + middle * 2));
+            }
+        }
+        NEXT(3);
+    }
+
+    op_cmpl_float: {
+        const uint16_t bc = pc[1];
+        const float a = GET_FLOAT(bc & 0xff);
+        const float b = GET_FLOAT(bc >> 8);
+        SET_INT(INST_AA, a > b ? 1 : a == b ? 0 : -1);
+        NEXT(2);
+    }
+    op_cmpg_float: {
+        const uint16_t bc = pc[1];
+        const float a = GET_FLOAT(bc & 0xff);
+        const float b = GET_FLOAT(bc >> 8);
+        SET_INT(INST_AA, a < b ? -1 : a == b ? 0 : 1);
+        NEXT(2);
+    }
+    op_cmpl_double: {
+        const uint16_t bc = pc[1];
+        const double a = GET_DOUBLE(bc & 0xff);
+        const double b = GET_DOUBLE(bc >> 8);
+        SET_INT(INST_AA, a > b ? 1 : a == b ? 0 : -1);
+        NEXT(2);
+    }
+    op_cmpg_double: {
+        const uint16_t bc = pc[1];
+        const double a = GET_DOUBLE(bc & 0xff);
+        const double b = GET_DOUBLE(bc >> 8);
+        SET_INT(INST_AA, a < b ? -1 : a == b ? 0 : 1);
+        NEXT(2);
+    }
+    op_cmp_long: {
+        const uint16_t bc = pc[1];
+        const int64_t a = static_cast<int64_t>(GET_WIDE(bc & 0xff));
+        const int64_t b = static_cast<int64_t>(GET_WIDE(bc >> 8));
+        SET_INT(INST_AA, a < b ? -1 : a == b ? 0 : 1);
+        NEXT(2);
+    }
+
+    IF_TEST(eq, ==)
+    IF_TEST(ne, !=)
+    IF_TEST(lt, <)
+    IF_TEST(ge, >=)
+    IF_TEST(gt, >)
+    IF_TEST(le, <=)
+
+    op_aget: {
+        ARRAY_ELEMENT(uint32_t);
+        SET_INT(INST_AA, *element);
+        NEXT(2);
+    }
+    op_aget_wide: {
+        ARRAY_ELEMENT(uint64_t);
+        SET_WIDE(INST_AA, *element);
+        NEXT(2);
+    }
+    op_aget_object: {
+        ARRAY_ELEMENT(ObjectRef);
+        SET_REF(INST_AA, *element);
+        NEXT(2);
+    }
+    op_aget_boolean: {
+        ARRAY_ELEMENT(uint8_t);
+        SET_INT(INST_AA, *element);
+        NEXT(2);
+    }
+    op_aget_byte: {
+        ARRAY_ELEMENT(int8_t);
+        SET_INT(INST_AA, *element);
+        NEXT(2);
+    }
+    op_aget_char: {
+        ARRAY_ELEMENT(uint16_t);
+        SET_INT(INST_AA, *element);
+        NEXT(2);
+    }
+    op_aget_short: {
+        ARRAY_ELEMENT(int16_t);
+        SET_INT(INST_AA, *element);
+        NEXT(2);
+    }
+    op_aput: {
+        ARRAY_ELEMENT(uint32_t);
+        *element = regs[INST_AA];
+        NEXT(2);
+    }
+    op_aput_wide: {
+        ARRAY_ELEMENT(uint64_t);
+        *element = GET_WIDE(INST_AA);
+        NEXT(2);
+    }
+    op_aput_object: {
+        ARRAY_ELEMENT(ObjectRef);
+        const ObjectRef value = regs[INST_AA];
+        if (value != NULL_REF && !ClassLinker::isAssignable(OBJECT(value)->klass, array->klass->component)) {
+            THROW(ARRAY_STORE_EXCEPTION);
+        }
+        linker.heap().writeReference(array_ref, element, value);
+        NEXT(2);
+    }
+    op_aput_boolean:
+    op_aput_byte: {
+        ARRAY_ELEMENT(uint8_t);
+        *element = static_cast<uint8_t>(regs[INST_AA]);
+        NEXT(2);
+    }
+    op_aput_char:
+    op_aput_short: {
+        ARRAY_ELEMENT(uint16_t);
+        *element = static_cast<uint16_t>(regs[INST_AA]);
+        NEXT(2);
+    }
+
+    // Неускоренные iget/iput: поле не разрешилось при подготовке метода
+    // (или смещение не помещается в 16 бит) - повторяем разрешение
+    op_iget:
+    op_iget_wide:
+    op_iget_object:
+    op_iget_boolean:
+    op_iget_byte:
+    op_iget_char:
+    op_iget_short:
+    op_iput:
+    op_iput_wide:
+    op_iput_object:
+    op_iput_boolean:
+    op_iput_byte:
+    op_iput_char:
+    op_iput_short: {
+        const Field* resolved = linker.resolveField(dex_index, pc[1], false);
+        if (!resolved) THROW(NO_SUCH_FIELD_ERROR);
+        const ObjectRef object_ref = regs[INST_B];
+        if (object_ref == NULL_REF) THROW(NULL_POINTER_EXCEPTION);
+        uint8_t* const address = heap + object_ref + resolved->offset;
+        switch (inst & 0xff) {
+            case 0x52: SET_INT(INST_A, *reinterpret_cast<uint32_t*>(address)); break;
+            case 0x53: SET_WIDE(INST_A, *reinterpret_cast<uint64_t*>(address)); break;
+            case 0x54: SET_REF(INST_A, *reinterpret_cast<ObjectRef*>(address)); break;
+            case 0x55: SET_INT(INST_A, *address); break;
+            case 0x56: SET_INT(INST_A, *reinterpret_cast<int8_t*>(address)); break;
+            case 0x57: SET_INT(INST_A, *reinterpret_cast<uint16_t*>(address)); break;
+            case 0x58: SET_INT(INST_A, *reinterpret_cast<int16_t*>(address)); break;
+            case 0x59: *reinterpret_cast<uint32_t*>(address) = regs[INST_A]; break;
+            case 0x5b: linker.heap().writeReference(object_ref, reinterpret_cast<ObjectRef*>(address), regs[INST_A]); break;
+            case 0x5a: *reinterpret_cast<uint64_t*>(address) = GET_WIDE(INST_A); break;
+            case 0x5c:
+            case 0x5d: *address = static_cast<uint8_t>(regs[INST_A]); break;
+            default: *reinterpret_cast<uint16_t*>(address) = static_cast<uint16_t>(regs[INST_A]); break;
+        }
+        NEXT(2);
+    }
+
+    op_iget_quick: {
+        QUICK_FIELD(uint32_t);
+        SET_INT(INST_A, *field);
+        NEXT(2);
+    }
+    op_iget_wide_quick: {
+        QUICK_FIELD(uint64_t);
+        SET_WIDE(INST_A, *field);
+        NEXT(2);
+    }
+    op_iget_object_quick: {
+        QUICK_FIELD(ObjectRef);
+        SET_REF(INST_A, *field);
+        NEXT(2);
+    }
+    op_iget_boolean_quick: {
+        QUICK_FIELD(uint8_t);
+        SET_INT(INST_A, *field);
+        NEXT(2);
+    }
+    op_iget_byte_quick: {
+        QUICK_FIELD(int8_t);
+        SET_INT(INST_A, *field);
+        NEXT(2);
+    }
+    op_iget_char_quick: {
+        QUICK_FIELD(uint16_t);
+        SET_INT(INST_A, *field);
+        NEXT(2);
+    }
+    op_iget_short_quick: {
+        QUICK_FIELD(int16_t);
+        SET_INT(INST_A, *field);
+        NEXT(2);
+    }
+    op_iput_quick: {
+        QUICK_FIELD(uint32_t);
+        *field = regs[INST_A];
+        NEXT(2);
+    }
+    op_iput_object_quick: {
+        QUICK_FIELD(ObjectRef);
+        linker.heap().writeReference(object_ref, field, regs[INST_A]);
+        NEXT(2);
+    }
+    op_iput_wide_quick: {
+        QUICK_FIELD(uint64_t);
+        *field = GET_WIDE(INST_A);
+        NEXT(2);
+    }
+    op_iput_boolean_quick:
+    op_iput_byte_quick: {
+        QUICK_FIELD(uint8_t);
+        *field = static_cast<uint8_t>(regs[INST_A]);
+        NEXT(2);
+    }
+    op_iput_char_quick:
+    op_iput_short_quick: {
+        QUICK_FIELD(uint16_t);
+        *field = static_cast<uint16_t>(regs[INST_A]);
+        NEXT(2);
+    }
+
+    // Статические поля хранятся по 8 байт; узкие значения - 32 бита
+    op_sget:
+    op_sget_boolean:
+    op_sget_byte:
+    op_sget_char:
+    op_sget_short: {
+        STATIC_FIELD(uint32_t);
+        SET_INT(INST_AA, *field);
+        NEXT(2);
+    }
+    op_sget_wide: {
+        STATIC_FIELD(uint64_t);
+        SET_WIDE(INST_AA, *field);
+        NEXT(2);
+    }
+    op_sget_object: {
+        STATIC_FIELD(ObjectRef);
+        SET_REF(INST_AA, *field);
+        NEXT(2);
+    }
+    op_sput:
+    op_sput_object:
+    op_sput_boolean:
+    op_sput_byte:
+    op_sput_char:
+    op_sput_short: {
+        STATIC_FIELD(uint32_t);
+        *field = regs[INST_AA];
+        NEXT(2);
+    }
+    op_sput_wide: {
+        STATIC_FIELD(uint64_t);
+        *field = GET_WIDE(INST_AA);
+        NEXT(2);
+    }
+
+    op_invoke_virtual:
+    op_invoke_interface:
+        range = false;
+        goto invoke_virtual;
+    op_invoke_virtual_range:
+    op_invoke_interface_range:
+        range = true;
+        goto invoke_virtual;
+    invoke_virtual: {
+        const Method* resolved = RESOLVE_METHOD(pc[1]);
+        if (!resolved) THROW(NO_SUCH_METHOD_ERROR);
+        const ObjectRef receiver = regs[range ? pc[2] : pc[2] & 0xf];
+        if (receiver == NULL_REF) THROW(NULL_POINTER_EXCEPTION);
+        callee = linker.findImplementation(OBJECT(receiver)->klass, resolved);
+        goto invoke_method;
+    }
+    op_invoke_virtual_quick:
+        range = false;
+        goto invoke_virtual_quick;
+    op_invoke_virtual_range_quick:
+        range = true;
+        goto invoke_virtual_quick;
+    invoke_virtual_quick: {
+        const ObjectRef receiver = regs[range ? pc[2] : pc[2] & 0xf];
+        if (receiver == NULL_REF) THROW(NULL_POINTER_EXCEPTION);
+        const Class* klass = OBJECT(receiver)->klass;
+        if (pc[1] >= klass->vtable.size()) THROW(INCOMPATIBLE_CLASS_CHANGE_ERROR);
+        callee = klass->vtable[pc[1]];
+        goto invoke_method;
+    }
+    op_invoke_super:
+        range = false;
+        goto invoke_super;
+    op_invoke_super_range:
+        range = true;
+        goto invoke_super;
+    invoke_super: {
+        Method* resolved = RESOLVE_METHOD(pc[1]);
+        if (!resolved) THROW(NO_SUCH_METHOD_ERROR);
+        if (regs[range ? pc[2] : pc[2] & 0xf] == NULL_REF) THROW(NULL_POINTER_EXCEPTION);
+        const Class* super = method->owner->super;
+        callee = resolved;
+        if (super && resolved->vtable_index < super->vtable.size()) {
+            callee = super->vtable[resolved->vtable_index];
+        }
+        goto invoke_method;
+    }
+    op_invoke_direct:
+        range = false;
+        goto invoke_direct;
+    op_invoke_direct_range:
+        range = true;
+        goto invoke_direct;
+    invoke_direct: {
+        callee = RESOLVE_METHOD(pc[1]);
+        if (!callee) THROW(NO_SUCH_METHOD_ERROR);
+        if (regs[range ? pc[2] : pc[2] & 0xf] == NULL_REF) THROW(NULL_POINTER_EXCEPTION);
+        goto invoke_method;
+    }
+    op_invoke_static:
+        range = false;
+        goto invoke_static;
+    op_invoke_static_range:
+        range = true;
+        goto invoke_static;
+    invoke_static: {
+        callee = RESOLVE_METHOD(pc[1]);
+        if (!callee) THROW(NO_SUCH_METHOD_ERROR);
+        if (callee->owner->state != Class::State::Initialized && !ensureInitialized(callee->owner)) {
+            goto handle_exception;
+        }
+        goto invoke_method;
+    }
+
+    // Общая часть вызова: новый кадр на стеке интерпретатора, аргументы
+    // копируются в его последние ins_size регистров
+    invoke_method: {
+        if (!callee->code) {
+            if (callee->stub) {
+                retval = 0;
+                NEXT(3);
+            }
+            THROW(callee->isAbstract() ? ABSTRACT_METHOD_ERROR : UNSATISFIED_LINK_ERROR);
+        }
+        const uint32_t count = range ? INST_AA : INST_B;
+        if (count != callee->ins_size) THROW(INCOMPATIBLE_CLASS_CHANGE_ERROR);
+        if (!callee->prepared) {
+            prepare(callee);
+        }
+        if (callee->rejected) THROW(VERIFY_ERROR);
+        Frame* const callee_frame = pushCall(frame, callee, pc, range);
+        if (!callee_frame) THROW(STACK_OVERFLOW_ERROR);
+
+        frame->pc = pc;
+        ++stats.invocations;
+        countInvocation(callee);
+        if (const JitCode* code = callee->jit_code.load(std::memory_order_acquire)) {
+            if (native_depth < MAX_NATIVE_DEPTH) {
+                uint64_t value = 0;
+                if (!runCompiled(callee_frame, code, code->nativeAt(0), &value)) {
+                    goto handle_exception;
+                }
+                retval = value;
+                NEXT(3);
+            }
+        }
+        frame = callee_frame;
+        LOAD_FRAME();
+        pc = method->insns;
+        DISPATCH();
+    }
+
+    // Горячий цикл: запросить компиляцию, а когда код готов - продолжить
+    // метод в нем с этой же инструкции (OSR)
+    back_edge: {
+        method->hotness = Jit::COMPILE_THRESHOLD - HOTNESS_RECHECK_INTERVAL;
+        const JitCode* code = method->jit_code.load(std::memory_order_acquire);
+        if (!code) {
+            if (jit) {
+                jit->requestCompile(method);
+            }
+            DISPATCH();
+        }
+        const void* native = code->nativeAt(static_cast<uint32_t>(pc - method->insns));
+        if (!native || native_depth >= MAX_NATIVE_DEPTH) {
+            DISPATCH();
+        }
+        ++stats.osr_entries;
+        Frame* const current = frame;
+        Frame* const caller = frame->caller;
+        uint64_t value = 0;
+        const bool ok = runCompiled(frame, code, native, &value);
+        if (current == entry) {
+            *result = value;
+            return ok;
+        }
+        frame = caller;
+        LOAD_FRAME();
+        pc = frame->pc;
+        if (!ok) {
+            goto handle_exception;
+        }
+        retval = value;
+        NEXT(3);
+    }
+
+    do_return: {
+        Frame* const caller = frame->caller;
+        popFrame(frame);
+        if (frame == entry) {
+            *result = retval;
+            return true;
+        }
+        frame = caller;
+        LOAD_FRAME();
+        pc = frame->pc;
+        NEXT(3);
+    }
+
+    op_neg_int:
+        SET_INT(INST_A, 0u - regs[INST_B]);
+        NEXT(1);
+    op_not_int:
+        SET_INT(INST_A, ~regs[INST_B]);
+        NEXT(1);
+    op_neg_long:
+        SET_WIDE(INST_A, 0ull - GET_WIDE(INST_B));
+        NEXT(1);
+    op_not_long:
+        SET_WIDE(INST_A, ~GET_WIDE(INST_B));
+        NEXT(1);
+    op_neg_float:
+        SET_INT(INST_A, floatBits(-GET_FLOAT(INST_B)));
+        NEXT(1);
+    op_neg_double:
+        SET_WIDE(INST_A, doubleBits(-GET_DOUBLE(INST_B)));
+        NEXT(1);
+    op_int_to_long:
+        SET_WIDE(INST_A, static_cast<int64_t>(static_cast<int32_t>(regs[INST_B])));
+        NEXT(1);
+    op_int_to_float:
+        SET_INT(INST_A, floatBits(static_cast<float>(static_cast<int32_t>(regs[INST_B]))));
+        NEXT(1);
+    op_int_to_double:
+        SET_WIDE(INST_A, doubleBits(static_cast<double>(static_cast<int32_t>(regs[INST_B]))));
+        NEXT(1);
+    op_long_to_int:
+        SET_INT(INST_A, static_cast<uint32_t>(GET_WIDE(INST_B)));
+        NEXT(1);
+    op_long_to_float:
+        SET_INT(INST_A, floatBits(static_cast<float>(static_cast<int64_t>(GET_WIDE(INST_B)))));
+        NEXT(1);
+    op_long_to_double:
+        SET_WIDE(INST_A, doubleBits(static_cast<double>(static_cast<int64_t>(GET_WIDE(INST_B)))));
+        NEXT(1);
+    op_float_to_int:
+        SET_INT(INST_A, floatToIntegral<int32_t>(GET_FLOAT(INST_B)));
+        NEXT(1);
+    op_float_to_long:
+        SET_WIDE(INST_A, floatToIntegral<int64_t>(GET_FLOAT(INST_B)));
+        NEXT(1);
+    op_float_to_double:
+        SET_WIDE(INST_A, doubleBits(static_cast<double>(GET_FLOAT(INST_B))));
+        NEXT(1);
+    op_double_to_int:
+        SET_INT(INST_A, floatToIntegral<int32_t>(GET_DOUBLE(INST_B)));
+        NEXT(1);
+    op_double_to_long:
+        SET_WIDE(INST_A, floatToIntegral<int64_t>(GET_DOUBLE(INST_B)));
+        NEXT(1);
+    op_double_to_float:
+        SET_INT(INST_A, floatBits(static_cast<float>(GET_DOUBLE(INST_B))));
+        NEXT(1);
+    op_int_to_byte:
+        SET_INT(INST_A, static_cast<int8_t>(regs[INST_B]));
+        NEXT(1);
+    op_int_to_char:
+        SET_INT(INST_A, static_cast<uint16_t>(regs[INST_B]));
+        NEXT(1);
+    op_int_to_short:
+        SET_INT(INST_A, static_cast<int16_t>(regs[INST_B]));
+        NEXT(1);
+
+    BINOP_INT(add, a + b)
+    BINOP_INT(sub, a - b)
+    BINOP_INT(mul, a * b)
+    DIV_INT(div, a == std::numeric_limits<int32_t>::min() && b == -1 ? a : a / b)
+    DIV_INT(rem, b == -1 ? 0 : a % b)
+    BINOP_INT(and, a & b)
+    BINOP_INT(or, a | b)
+    BINOP_INT(xor, a ^ b)
+    BINOP_INT(shl, a << (b & 0x1f))
+    BINOP_INT(shr, static_cast<uint32_t>(static_cast<int32_t>(a) >> (b & 0x1f)))
+    BINOP_INT(ushr, a >> (b & 0x1f))
+
+    BINOP_LONG(add, a + b)
+    BINOP_LONG(sub, a - b)
+    BINOP_LONG(mul, a * b)
+    DIV_LONG(div, a == std::numeric_limits<int64_t>::min() && b == -1 ? a : a / b)
+    DIV_LONG(rem, b == -1 ? 0 : a % b)
+    BINOP_LONG(and, a & b)
+    BINOP_LONG(or, a | b)
+    BINOP_LONG(xor, a ^ b)
+    SHIFT_LONG(shl, a << b)
+    SHIFT_LONG(shr, static_cast<uint64_t>(static_cast<int64_t>(a) >> b))
+    SHIFT_LONG(ushr, a >> b)
+
+    BINOP_FLOAT(add, a + b)
+    BINOP_FLOAT(sub, a - b)
+    BINOP_FLOAT(mul, a * b)
+    BINOP_FLOAT(div, a / b)
+    BINOP_FLOAT(rem, std::fmod(a, b))
+
+    BINOP_DOUBLE(add, a + b)
+    BINOP_DOUBLE(sub, a - b)
+    BINOP_DOUBLE(mul, a * b)
+    BINOP_DOUBLE(div, a / b)
+    BINOP_DOUBLE(rem, std::fmod(a, b))
+
+    LITOP_INT(add_int_lit16, add_int_lit8, a + b)
+    LITOP_INT(rsub_int, rsub_int_lit8, b - a)
+    LITOP_INT(mul_int_lit16, mul_int_lit8, a * b)
+    LITDIV_INT(div_int_lit16, div_int_lit8, a == std::numeric_limits<int32_t>::min() && b == -1 ? a : a / b)
+    LITDIV_INT(rem_int_lit16, rem_int_lit8, b == -1 ? 0 : a % b)
+    LITOP_INT(and_int_lit16, and_int_lit8, a & b)
+    LITOP_INT(or_int_lit16, or_int_lit8, a | b)
+    LITOP_INT(xor_int_lit16, xor_int_lit8, a ^ b)
+
+    op_shl_int_lit8: {
+        const uint16_t bc = pc[1];
+        SET_INT(INST_AA, regs[bc & 0xff] << ((bc >> 8) & 0x1f));
+        NEXT(2);
+    }
+    op_shr_int_lit8: {
+        const uint16_t bc = pc[1];
+        SET_INT(INST_AA, static_cast<int32_t>(regs[bc & 0xff]) >> ((bc >> 8) & 0x1f));
+        NEXT(2);
+    }
+    op_ushr_int_lit8: {
+        const uint16_t bc = pc[1];
+        SET_INT(INST_AA, regs[bc & 0xff] >> ((bc >> 8) & 0x1f));
+        NEXT(2);
+    }
+
+    // invoke-polymorphic, invoke-custom и неиспользуемые опкоды
+    op_unused:
+        THROW(VERIFY_ERROR);
+
+    // Поиск обработчика от текущего кадра к вызывающим
+    handle_exception: {
+        while (true) {
+            uint32_t handler = 0;
+            if (exception != NULL_REF && method->tries_size != 0 &&
+                findCatch(method, static_cast<uint32_t>(pc - method->insns), handler)) {
+                caught = exception;
+                exception = NULL_REF;
+                pc = method->insns + handler;
+                DISPATCH();
+            }
+            Frame* const caller = frame->caller;
+            popFrame(frame);
+            if (frame == entry) {
+                return false;
+            }
+            frame = caller;
+            LOAD_FRAME();
+            pc = frame->pc;
+        }
+    }
+}
+
+#undef INST_A
+#undef INST_B
+#undef INST_AA
+#undef DISPATCH
+#undef NEXT
+#undef BRANCH
+#undef LOAD_FRAME
+#undef SET_INT
+#undef SET_REF
+#undef SET_WIDE
+#undef GET_WIDE
+#undef GET_FLOAT
+#undef GET_DOUBLE
+#undef OBJECT
+#undef THROW
+#undef RESOLVE_METHOD
+#undef RESOLVE_TYPE
+#undef BINOP_INT
+#undef DIV_INT
+#undef BINOP_LONG
+#undef SHIFT_LONG
+#undef DIV_LONG
+#undef BINOP_FLOAT
+#undef BINOP_DOUBLE
+#undef LITOP_INT
+#undef LITDIV_INT
+#undef IF_TEST
+#undef ARRAY_ELEMENT
+#undef QUICK_FIELD
+#undef STATIC_FIELD
+
+Interpreter::Interpreter(ClassLinker& linker, size_t stack_size)
+    : impl(new Impl(linker, stack_size)) {}
+
+Interpreter::~Interpreter() = default;
+
+bool Interpreter::invoke(Method* method, const uint32_t* args, size_t count, uint64_t* result) {
+    return impl->invoke(method, args, count, result);
+}
+
+bool Interpreter::ensureInitialized(Class* klass) {
+    return impl->ensureInitialized(klass);
+}
+
+bool Interpreter::prepare(Method* method) {
+    if (!method->prepared) {
+        impl->prepare(method);
+    }
+    return !method->rejected;
+}
+
+bool Interpreter::enableJit(size_t code_cache_size) {
+    return impl->enableJit(code_cache_size);
+}
+
+JitStats Interpreter::getJitStats() const {
+    return impl->getJitStats();
+}
+
+ObjectRef Interpreter::getException() const {
+    return impl->exception;
+}
+
+void Interpreter::clearException() {
+    impl->exception = NULL_REF;
+}
+
+InterpreterStats Interpreter::getStats() const {
+    return impl->stats;
+}
+
+} // namespace anexec
@@ -0,0 +1,77 @@
+#ifndef ANEXEC_INTERPRETER_H
+#define ANEXEC_INTERPRETER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "class_linker.h"
+#include "jit.h"
+
+namespace anexec {
+
+struct InterpreterStats {
+    uint64_t invocations;           // Вызовов методов с кодом
+    uint64_t quickened_methods;     // Методов, код которых переписан
+    uint64_t quickened_instructions;
+    uint64_t exceptions_thrown;
+    uint64_t compiled_invocations;  // Вызовов кода JIT
+    uint64_t osr_entries;           // Переходов в код JIT посреди цикла
+    uint64_t inline_cache_hits;
+    uint64_t inline_cache_misses;
+    uint64_t aot_methods;           // Код взят из образа AOT
+    uint64_t aot_compiled_methods;  // Из них с машинным кодом
+    uint64_t preinitialized_classes;    // Статические поля из образа, без <clinit>
+    uint64_t rejected_methods;      // Не прошли проверку байткода
+};
+
+// Интерпретатор байткода Dalvik. Обработчик каждой инструкции сам
+// переходит к следующей по таблице меток (computed goto), без общего
+// цикла со switch. Кадры регистров лежат подряд на собственном стеке,
+// вызов метода с кодом не углубляет стек C++. При первом вызове код
+// метода проверяется (verifier.h; не прошедший бросает VerifyError),
+// затем копируется и ускоряется: iget/iput получают смещение поля в
+// объекте, invoke-virtual - номер слота vtable.
+// С включенным JIT горячие методы выполняются машинным кодом, в том
+// числе с середины цикла, а редкие случаи возвращаются в интерпретатор.
+// Методы из образа AOT сразу берут оттуда ускоренный и машинный код.
+// Не потокобезопасен: один интерпретатор на поток приложения.
+class Interpreter {
+public:
+    static constexpr size_t DEFAULT_STACK_SIZE = 1024 * 1024;
+
+    explicit Interpreter(ClassLinker& linker, size_t stack_size = DEFAULT_STACK_SIZE);
+    ~Interpreter();
+
+    // Запрещаем копирование
+    Interpreter(const Interpreter&) = delete;
+    Interpreter& operator=(const Interpreter&) = delete;
+
+    // args - слова аргументов по shorty метода, this первым.
+    // false - метод завершился исключением, см. getException().
+    bool invoke(Method* method, const uint32_t* args, size_t count, uint64_t* result = nullptr);
+
+    // Статические значения и <clinit> при первом обращении к классу
+    bool ensureInitialized(Class* klass);
+
+    // Проверка и ускорение кода метода без вызова (сборка образа AOT).
+    // false - код не прошел проверку
+    bool prepare(Method* method);
+
+    // Компиляция горячих методов в фоновом потоке. false - JIT для этой
+    // архитектуры нет или кэш кода не создан: остается интерпретатор.
+    bool enableJit(size_t code_cache_size = Jit::DEFAULT_CODE_CACHE_SIZE);
+    JitStats getJitStats() const;
+
+    ObjectRef getException() const;
+    void clearException();
+    InterpreterStats getStats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_INTERPRETER_H
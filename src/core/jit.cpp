@@ -0,0 +1,1123 @@
+#include "jit.h"
+#include "class_linker.h"
+#include "dex_instructions.h"
+#include "heap.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace anexec {
+
+namespace {
+
+enum Reg : uint8_t {
+    RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+    R12 = 12, R13 = 13, R14 = 14
+};
+
+constexpr uint8_t XMM0 = 0;
+
+// Постоянные регистры скомпилированного кода (сохраняемые вызываемым)
+constexpr Reg REGS = RBX;       // uint32_t* регистров Dalvik кадра
+constexpr Reg REFS = R12;       // Их копия для ссылок
+constexpr Reg HEAP = R13;       // База кучи
+constexpr Reg THREAD = R14;     // JitThread*
+constexpr Reg SITES = RBP;      // JitSiteTable* метода
+
+enum Cond : uint8_t {
+    COND_B = 0x2,
+    COND_AE = 0x3,
+    COND_E = 0x4,
+    COND_NE = 0x5,
+    COND_A = 0x7,
+    COND_L = 0xc,
+    COND_GE = 0xd,
+    COND_LE = 0xe,
+    COND_G = 0xf
+};
+
+// Номер операции в группе 0x81 /n; у формы "reg, r/m" опкод n * 8 + 3
+enum AluOp : uint8_t {
+    ALU_ADD = 0,
+    ALU_OR = 1,
+    ALU_AND = 4,
+    ALU_SUB = 5,
+    ALU_XOR = 6,
+    ALU_CMP = 7
+};
+
+enum ShiftOp : uint8_t {
+    SHIFT_SHL = 4,
+    SHIFT_SHR = 5,
+    SHIFT_SAR = 7
+};
+
+// Префиксы SSE: F3 - float, F2 - double
+constexpr uint8_t SSE_FLOAT = 0xf3;
+constexpr uint8_t SSE_DOUBLE = 0xf2;
+
+constexpr uint8_t NO_INDEX = 0xff;
+
+// Операнд в памяти: [base + index * (1 << scale) + disp]
+struct Mem {
+    uint8_t base;
+    uint8_t index;
+    uint8_t scale;
+    int32_t disp;
+};
+
+Mem at(Reg base, int32_t disp) {
+    return {base, NO_INDEX, 0, disp};
+}
+
+Mem at(Reg base, Reg index, uint8_t scale, int32_t disp) {
+    return {base, index, scale, disp};
+}
+
+// Кодировщик нужного компилятору подмножества x86_64
+class Assembler {
+public:
+    std::vector<uint8_t>& bytes() { return code; }
+    size_t size() const { return code.size(); }
+
+    void byte(uint8_t value) { code.push_back(value); }
+    void imm32(uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            byte(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+    void imm64(uint64_t value) {
+        imm32(static_cast<uint32_t>(value));
+        imm32(static_cast<uint32_t>(value >> 32));
+    }
+
+    // [префикс] [REX] опкод ModRM [SIB] [смещение]
+    void emit(std::initializer_list<uint8_t> opcode, bool wide, uint8_t reg, const Mem& m,
+              uint8_t prefix = 0, bool byte_reg = false) {
+        if (prefix) {
+            byte(prefix);
+        }
+        const uint8_t rex = static_cast<uint8_t>(0x40 | (wide ? 8 : 0) | (reg & 8) >> 1 |
+                                                 (m.index != NO_INDEX ? (m.index & 8) >> 2 : 0) |
+                                                 (m.base & 8) >> 3);
+        // Без REX байтовые регистры 4-7 - это ah..bh, а не spl..dil
+        if (rex != 0x40 || (byte_reg && reg >= 4)) {
+            byte(rex);
+        }
+        for (uint8_t op : opcode) {
+            byte(op);
+        }
+        const bool sib = m.index != NO_INDEX || (m.base & 7) == RSP;
+        const uint8_t mod = m.disp == 0 && (m.base & 7) != RBP ? 0 : (m.disp >= -128 && m.disp <= 127 ? 1 : 2);
+        byte(static_cast<uint8_t>(mod << 6 | (reg & 7) << 3 | (sib ? 4 : m.base & 7)));
+        if (sib) {
+            byte(static_cast<uint8_t>(m.scale << 6 | (m.index != NO_INDEX ? m.index & 7 : 4) << 3 | (m.base & 7)));
+        }
+        if (mod == 1) {
+            byte(static_cast<uint8_t>(m.disp));
+        } else if (mod == 2) {
+            imm32(static_cast<uint32_t>(m.disp));
+        }
+    }
+
+    // Оба операнда - регистры
+    void emitRR(std::initializer_list<uint8_t> opcode, bool wide, uint8_t reg, uint8_t rm, uint8_t prefix = 0) {
+        if (prefix) {
+            byte(prefix);
+        }
+        const uint8_t rex = static_cast<uint8_t>(0x40 | (wide ? 8 : 0) | (reg & 8) >> 1 | (rm & 8) >> 3);
+        if (rex != 0x40) {
+            byte(rex);
+        }
+        for (uint8_t op : opcode) {
+            byte(op);
+        }
+        byte(static_cast<uint8_t>(0xc0 | (reg & 7) << 3 | (rm & 7)));
+    }
+
+    void load(bool wide, Reg r, const Mem& m) { emit({0x8b}, wide, r, m); }
+    void store(bool wide, const Mem& m, Reg r) { emit({0x89}, wide, r, m); }
+    void store16(const Mem& m, Reg r) { emit({0x89}, false, r, m, 0x66); }
+    void store8(const Mem& m, Reg r) { emit({0x88}, false, r, m, 0, true); }
+    // Для wide значение расширяется знаком до 64 бит
+    void storeImm(bool wide, const Mem& m, uint32_t value) {
+        emit({0xc7}, wide, 0, m);
+        imm32(value);
+    }
+    void loadZx8(Reg r, const Mem& m) { emit({0x0f, 0xb6}, false, r, m); }
+    void loadSx8(Reg r, const Mem& m) { emit({0x0f, 0xbe}, false, r, m); }
+    void loadZx16(Reg r, const Mem& m) { emit({0x0f, 0xb7}, false, r, m); }
+    void loadSx16(Reg r, const Mem& m) { emit({0x0f, 0xbf}, false, r, m); }
+    void loadSx32(Reg r, const Mem& m) { emit({0x63}, true, r, m); }
+
+    void movImm32(Reg r, uint32_t value) {
+        if (r & 8) {
+            byte(0x41);
+        }
+        byte(static_cast<uint8_t>(0xb8 + (r & 7)));
+        imm32(value);
+    }
+    void movImm64(Reg r, uint64_t value) {
+        byte(static_cast<uint8_t>(0x48 | (r & 8) >> 3));
+        byte(static_cast<uint8_t>(0xb8 + (r & 7)));
+        imm64(value);
+    }
+    void mov(bool wide, Reg dst, Reg src) { emitRR({0x8b}, wide, dst, src); }
+    void lea(Reg r, const Mem& m) { emit({0x8d}, true, r, m); }
+
+    void alu(AluOp op, bool wide, Reg r, const Mem& m) { emit({static_cast<uint8_t>(op * 8 + 3)}, wide, r, m); }
+    void alu(AluOp op, bool wide, Reg dst, Reg src) { emitRR({static_cast<uint8_t>(op * 8 + 3)}, wide, dst, src); }
+    void aluImm(AluOp op, bool wide, Reg r, uint32_t value) {
+        emitRR({0x81}, wide, op, r);
+        imm32(value);
+    }
+    void cmpImm8(const Mem& m, int8_t value) {
+        emit({0x83}, false, ALU_CMP, m);
+        byte(static_cast<uint8_t>(value));
+    }
+    void imul(bool wide, Reg r, const Mem& m) { emit({0x0f, 0xaf}, wide, r, m); }
+    void imulImm(Reg r, const Mem& m, uint32_t value) {
+        emit({0x69}, false, r, m);
+        imm32(value);
+    }
+    void shiftCl(ShiftOp op, bool wide, Reg r) { emitRR({0xd3}, wide, op, r); }
+    void shiftImm(ShiftOp op, bool wide, Reg r, uint8_t count) {
+        emitRR({0xc1}, wide, op, r);
+        byte(count);
+    }
+    void neg(bool wide, Reg r) { emitRR({0xf7}, wide, 3, r); }
+    void bitNot(bool wide, Reg r) { emitRR({0xf7}, wide, 2, r); }
+    // cdq / cqo перед idiv
+    void signExtendAccumulator(bool wide) {
+        if (wide) {
+            byte(0x48);
+        }
+        byte(0x99);
+    }
+    void idiv(bool wide, Reg r) { emitRR({0xf7}, wide, 7, r); }
+    void test(bool wide, Reg a, Reg b) { emitRR({0x85}, wide, b, a); }
+    void testByte(Reg r) { emitRR({0x84}, false, r, r); }
+    void setcc(Cond cond, Reg r) { emitRR({0x0f, static_cast<uint8_t>(0x90 + cond)}, false, 0, r); }
+    void movzxByte(Reg dst, Reg src) { emitRR({0x0f, 0xb6}, false, dst, src); }
+
+    void sse(uint8_t prefix, uint8_t op, bool wide, uint8_t reg, const Mem& m) {
+        emit({0x0f, op}, wide, reg, m, prefix);
+    }
+
+    void push(Reg r) {
+        if (r & 8) {
+            byte(0x41);
+        }
+        byte(static_cast<uint8_t>(0x50 + (r & 7)));
+    }
+    void pop(Reg r) {
+        if (r & 8) {
+            byte(0x41);
+        }
+        byte(static_cast<uint8_t>(0x58 + (r & 7)));
+    }
+    void call(Reg r) { emitRR({0xff}, false, 2, r); }
+    void jmp(Reg r) { emitRR({0xff}, false, 4, r); }
+    void ret() { byte(0xc3); }
+
+    // Переходы с 32-битным смещением: возвращают его позицию для patch()
+    size_t jcc(Cond cond) {
+        byte(0x0f);
+        byte(static_cast<uint8_t>(0x80 + cond));
+        imm32(0);
+        return size() - 4;
+    }
+    size_t jmp() {
+        byte(0xe9);
+        imm32(0);
+        return size() - 4;
+    }
+    void patch(size_t at, size_t target) {
+        const int32_t rel = static_cast<int32_t>(target) - static_cast<int32_t>(at + 4);
+        std::memcpy(code.data() + at, &rel, sizeof(rel));
+    }
+
+private:
+    std::vector<uint8_t> code;
+};
+
+// Во что превращается опкод 0x44-0x51 / 0xe3-0xf2: ширина и расширение
+enum class Access : uint8_t {
+    Int,
+    Wide,
+    Object,
+    Boolean,
+    Byte,
+    Char,
+    Short
+};
+
+constexpr Access ARRAY_ACCESS[7] = {
+    Access::Int, Access::Wide, Access::Object, Access::Boolean, Access::Byte, Access::Char, Access::Short
+};
+
+constexpr uint32_t MAX_SWITCH_CASES = 64;
+
+// Однопроходный перевод метода. Регистры Dalvik читаются и пишутся прямо
+// в кадре (и копия для ссылок - тоже), поэтому в начале каждой инструкции
+// состояние совпадает с интерпретатором: native_offsets дает вход в код
+// с любой инструкции, а выход в интерпретатор - это просто возврат
+// смещения инструкции. Проверки на null, границы массивов и деление на
+// ноль выходят в интерпретатор, и он сам бросает исключение.
+class Compiler {
+public:
+    Compiler(Method* method, JitCode& out) : method(method), out(out) {}
+
+    // false - в методе есть инструкции, которые не компилируются
+    bool compile(std::vector<uint8_t>& code) {
+        const uint16_t* insns = method->insns;
+        const uint32_t size = method->insns_size;
+
+        emitPrologue();
+        out.native_offsets.assign(size, NO_NATIVE_OFFSET);
+
+        uint32_t last_opcode = OP_NOP;
+        for (uint32_t pc = 0; pc < size;) {
+            const uint16_t inst = insns[pc];
+            const uint8_t opcode = inst & 0xff;
+            if (opcode == OP_NOP && inst != 0) {
+                pc += payloadWidth(insns + pc);
+                continue;
+            }
+            const uint32_t width = INSTRUCTION_WIDTH[opcode];
+            if (pc + width > size) {
+                return false;
+            }
+            out.native_offsets[pc] = static_cast<uint32_t>(as.size());
+            if (!compileInstruction(pc)) {
+                return false;
+            }
+            last_opcode = opcode;
+            pc += width;
+        }
+        // Корректный код не доходит до конца метода
+        if (!endsFlow(last_opcode)) {
+            return false;
+        }
+
+        for (const Fixup& branch : branches) {
+            if (branch.target >= size || out.native_offsets[branch.target] == NO_NATIVE_OFFSET) {
+                return false;
+            }
+            as.patch(branch.at, out.native_offsets[branch.target]);
+        }
+        for (const Fixup& exit : exits) {
+            as.patch(exit.at, as.size());
+            as.movImm32(RAX, exit.target);
+            as.patch(as.jmp(), epilogue);
+        }
+        code = std::move(as.bytes());
+        return true;
+    }
+
+private:
+    struct Fixup {
+        size_t at;
+        uint32_t target;    // Инструкция перехода или код выхода
+    };
+
+    Method* method;
+    JitCode& out;
+    Assembler as;
+    std::vector<Fixup> branches;
+    std::vector<Fixup> exits;
+    size_t epilogue{0};
+
+    static bool endsFlow(uint32_t opcode) {
+        return (opcode >= 0x0e && opcode <= 0x11) || opcode == 0x27 || (opcode >= 0x28 && opcode <= 0x2a);
+    }
+
+    static Mem vreg(uint32_t r) { return at(REGS, static_cast<int32_t>(r * 4)); }
+    static Mem vref(uint32_t r) { return at(REFS, static_cast<int32_t>(r * 4)); }
+    static Mem retval() { return at(THREAD, offsetof(JitThread, retval)); }
+
+    // entry(thread, regs, start, sites): сохраняет регистры и переходит на start.
+    // Эпилог сразу за прологом, выходы возвращаются к нему с кодом в eax.
+    void emitPrologue() {
+        as.push(RBX);
+        as.push(R12);
+        as.push(R13);
+        as.push(R14);
+        as.push(SITES);     // Пятый регистр заодно выравнивает стек для вызовов
+        as.mov(true, THREAD, RDI);
+        as.mov(true, REGS, RSI);
+        as.lea(REFS, at(REGS, static_cast<int32_t>(method->registers_size * 4u)));
+        as.load(true, HEAP, at(THREAD, offsetof(JitThread, heap_base)));
+        as.mov(true, SITES, RCX);
+        as.jmp(RDX);
+
+        epilogue = as.size();
+        as.pop(SITES);
+        as.pop(R14);
+        as.pop(R13);
+        as.pop(R12);
+        as.pop(RBX);
+        as.ret();
+    }
+
+    void setInt(uint32_t r, Reg src) {
+        as.store(false, vreg(r), src);
+        as.storeImm(false, vref(r), NULL_REF);
+    }
+    void setRef(uint32_t r, Reg src) {
+        as.store(false, vreg(r), src);
+        as.store(false, vref(r), src);
+    }
+    void setWide(uint32_t r, Reg src) {
+        as.store(true, vreg(r), src);
+        as.storeImm(true, vref(r), NULL_REF);
+    }
+    void setIntImm(uint32_t r, uint32_t value) {
+        as.storeImm(false, vreg(r), value);
+        as.storeImm(false, vref(r), NULL_REF);
+    }
+    void set(Access access, uint32_t r, Reg src) {
+        if (access == Access::Wide) {
+            setWide(r, src);
+        } else if (access == Access::Object) {
+            setRef(r, src);
+        } else {
+            setInt(r, src);
+        }
+    }
+
+    void exitIf(Cond cond, uint32_t status) { exits.push_back({as.jcc(cond), status}); }
+    void exitTo(uint32_t status) { exits.push_back({as.jmp(), status}); }
+    void branchIf(Cond cond, uint32_t target) { branches.push_back({as.jcc(cond), target}); }
+    void branchTo(uint32_t target) { branches.push_back({as.jmp(), target}); }
+
+    void returnValue() {
+        as.movImm32(RAX, JIT_RETURNED);
+        as.patch(as.jmp(), epilogue);
+    }
+
+    // helper - смещение указателя в JitHelpers
+    void callHelper(size_t helper) {
+        as.load(true, RAX, at(THREAD, offsetof(JitThread, helpers)));
+        as.load(true, RAX, at(RAX, static_cast<int32_t>(helper)));
+        as.call(RAX);
+    }
+
+    // Загрузка/сохранение элемента или поля по адресу m
+    void loadValue(Access access, Reg r, const Mem& m) {
+        switch (access) {
+            case Access::Wide: as.load(true, r, m); break;
+            case Access::Boolean: as.loadZx8(r, m); break;
+            case Access::Byte: as.loadSx8(r, m); break;
+            case Access::Char: as.loadZx16(r, m); break;
+            case Access::Short: as.loadSx16(r, m); break;
+            default: as.load(false, r, m); break;
+        }
+    }
+    void storeValue(Access access, const Mem& m, Reg r) {
+        switch (access) {
+            case Access::Wide: as.store(true, m, r); break;
+            case Access::Boolean:
+            case Access::Byte: as.store8(m, r); break;
+            case Access::Char:
+            case Access::Short: as.store16(m, r); break;
+            default: as.store(false, m, r); break;
+        }
+    }
+    static uint8_t accessScale(Access access) {
+        switch (access) {
+            case Access::Wide: return 3;
+            case Access::Boolean:
+            case Access::Byte: return 0;
+            case Access::Char:
+            case Access::Short: return 1;
+            default: return 2;
+        }
+    }
+
+    // rax - начало элементов массива vArray, rcx - проверенный индекс
+    void arrayElement(uint32_t array, uint32_t index, uint32_t pc) {
+        as.load(false, RAX, vreg(array));
+        as.test(false, RAX, RAX);
+        exitIf(COND_E, pc);
+        as.load(false, RCX, vreg(index));
+        as.alu(ALU_CMP, false, RCX, at(HEAP, RAX, 0, offsetof(Object, length)));
+        exitIf(COND_AE, pc);
+        as.lea(RAX, at(HEAP, RAX, 0, sizeof(Object)));
+    }
+
+    // Деление и остаток: 0 - в интерпретатор (ArithmeticException),
+    // MIN / -1 без исключения процессора: результат MIN и 0
+    void divide(bool wide, bool remainder, uint32_t dst, uint32_t x, uint32_t y, uint32_t pc) {
+        as.load(wide, RCX, vreg(y));
+        as.test(wide, RCX, RCX);
+        exitIf(COND_E, pc);
+        as.load(wide, RAX, vreg(x));
+        as.aluImm(ALU_CMP, wide, RCX, 0xffffffff);
+        const size_t not_minus_one = as.jcc(COND_NE);
+        if (remainder) {
+            as.alu(ALU_XOR, false, RAX, RAX);
+        } else {
+            as.neg(wide, RAX);
+        }
+        const size_t done = as.jmp();
+        as.patch(not_minus_one, as.size());
+        as.signExtendAccumulator(wide);
+        as.idiv(wide, RCX);
+        if (remainder) {
+            as.mov(wide, RAX, RDX);
+        }
+        as.patch(done, as.size());
+        if (wide) {
+            setWide(dst, RAX);
+        } else {
+            setInt(dst, RAX);
+        }
+    }
+
+    // add, sub, mul, div, rem, and, or, xor, shl, shr, ushr: dst = x op y
+    bool integerOp(uint32_t op, bool wide, uint32_t dst, uint32_t x, uint32_t y, uint32_t pc) {
+        static constexpr AluOp ALU[] = {ALU_ADD, ALU_SUB, ALU_ADD, ALU_ADD, ALU_ADD, ALU_AND, ALU_OR, ALU_XOR};
+        static constexpr ShiftOp SHIFT[] = {SHIFT_SHL, SHIFT_SAR, SHIFT_SHR};
+        switch (op) {
+            case 2:
+                as.load(wide, RAX, vreg(x));
+                as.imul(wide, RAX, vreg(y));
+                break;
+            case 3:
+            case 4:
+                divide(wide, op == 4, dst, x, y, pc);
+                return true;
+            case 8:
+            case 9:
+            case 10:
+                // Сдвиг всегда в int-регистре; x86 сам берет 5 или 6 бит, как Java
+                as.load(false, RCX, vreg(y));
+                as.load(wide, RAX, vreg(x));
+                as.shiftCl(SHIFT[op - 8], wide, RAX);
+                break;
+            default:
+                as.load(wide, RAX, vreg(x));
+                as.alu(ALU[op], wide, RAX, vreg(y));
+                break;
+        }
+        if (wide) {
+            setWide(dst, RAX);
+        } else {
+            setInt(dst, RAX);
+        }
+        return true;
+    }
+
+    // add, sub, mul, div: dst = x op y (rem - через fmod, не компилируется)
+    bool floatOp(uint32_t op, bool wide, uint32_t dst, uint32_t x, uint32_t y) {
+        static constexpr uint8_t SSE_OP[] = {0x58, 0x5c, 0x59, 0x5e};
+        if (op >= 4) {
+            return false;
+        }
+        const uint8_t prefix = wide ? SSE_DOUBLE : SSE_FLOAT;
+        as.sse(prefix, 0x10, false, XMM0, vreg(x));
+        as.sse(prefix, SSE_OP[op], false, XMM0, vreg(y));
+        as.sse(prefix, 0x11, false, XMM0, vreg(dst));
+        as.storeImm(wide, vref(dst), NULL_REF);
+        return true;
+    }
+
+    // add, rsub, mul, div, rem, and, or, xor, shl, shr, ushr: dst = src op literal
+    bool literalOp(uint32_t op, uint32_t dst, uint32_t src, int32_t literal, uint32_t pc) {
+        const uint32_t value = static_cast<uint32_t>(literal);
+        switch (op) {
+            case 0: as.load(false, RAX, vreg(src)); as.aluImm(ALU_ADD, false, RAX, value); break;
+            case 1: as.movImm32(RAX, value); as.alu(ALU_SUB, false, RAX, vreg(src)); break;
+            case 2: as.imulImm(RAX, vreg(src), value); break;
+            case 3:
+            case 4:
+                if (literal == 0) {
+                    exitTo(pc);
+                    return true;
+                }
+                as.load(false, RAX, vreg(src));
+                if (literal == -1) {
+                    if (op == 4) {
+                        as.alu(ALU_XOR, false, RAX, RAX);
+                    } else {
+                        as.neg(false, RAX);
+                    }
+                } else {
+                    as.movImm32(RCX, value);
+                    as.signExtendAccumulator(false);
+                    as.idiv(false, RCX);
+                    if (op == 4) {
+                        as.mov(false, RAX, RDX);
+                    }
+                }
+                break;
+            case 5: as.load(false, RAX, vreg(src)); as.aluImm(ALU_AND, false, RAX, value); break;
+            case 6: as.load(false, RAX, vreg(src)); as.aluImm(ALU_OR, false, RAX, value); break;
+            case 7: as.load(false, RAX, vreg(src)); as.aluImm(ALU_XOR, false, RAX, value); break;
+            case 8: as.load(false, RAX, vreg(src)); as.shiftImm(SHIFT_SHL, false, RAX, value & 0x1f); break;
+            case 9: as.load(false, RAX, vreg(src)); as.shiftImm(SHIFT_SAR, false, RAX, value & 0x1f); break;
+            case 10: as.load(false, RAX, vreg(src)); as.shiftImm(SHIFT_SHR, false, RAX, value & 0x1f); break;
+            default: return false;
+        }
+        setInt(dst, RAX);
+        return true;
+    }
+
+    // cmpl/cmpg: при NaN -1 и 1 соответственно
+    void compareFloat(bool wide, bool nan_is_greater, uint32_t dst, uint32_t x, uint32_t y) {
+        const uint8_t prefix = wide ? SSE_DOUBLE : SSE_FLOAT;
+        // ucomis* выставляет CF и ZF при NaN: "меньше" для cmpl, а для cmpg
+        // сравниваем в обратном порядке
+        const uint32_t first = nan_is_greater ? y : x;
+        const uint32_t second = nan_is_greater ? x : y;
+        as.sse(prefix, 0x10, false, XMM0, vreg(first));
+        as.sse(wide ? 0x66 : 0, 0x2e, false, XMM0, vreg(second));
+        as.setcc(nan_is_greater ? COND_B : COND_A, RAX);
+        as.setcc(nan_is_greater ? COND_A : COND_B, RCX);
+        as.movzxByte(RAX, RAX);
+        as.movzxByte(RCX, RCX);
+        as.alu(ALU_SUB, false, RAX, RCX);
+        setInt(dst, RAX);
+    }
+
+    // float/double -> int/long с насыщением: неоднозначный результат
+    // cvtt (0x80..0, он же NaN и переполнение) пересчитывает интерпретатор
+    void truncate(bool from_double, bool to_long, uint32_t dst, uint32_t src, uint32_t pc) {
+        as.sse(from_double ? SSE_DOUBLE : SSE_FLOAT, 0x2c, to_long, RAX, vreg(src));
+        if (to_long) {
+            as.movImm64(RCX, 0x8000000000000000ull);
+            as.alu(ALU_CMP, true, RAX, RCX);
+        } else {
+            as.aluImm(ALU_CMP, false, RAX, 0x80000000);
+        }
+        exitIf(COND_E, pc);
+        if (to_long) {
+            setWide(dst, RAX);
+        } else {
+            setInt(dst, RAX);
+        }
+    }
+
+    // Преобразование через SSE: op с префиксом читает vSrc в xmm0
+    void convert(uint8_t prefix, uint8_t op, bool wide_source, bool to_double, uint32_t dst, uint32_t src) {
+        as.sse(prefix, op, wide_source, XMM0, vreg(src));
+        as.sse(to_double ? SSE_DOUBLE : SSE_FLOAT, 0x11, false, XMM0, vreg(dst));
+        as.storeImm(to_double, vref(dst), NULL_REF);
+    }
+
+    bool compileSwitch(uint32_t pc, bool packed) {
+        const uint16_t* insn = method->insns + pc;
+        const int64_t offset = static_cast<int64_t>(pc) + read32(insn + 1);
+        if (offset < 0 || offset + 2 > method->insns_size) {
+            return false;
+        }
+        const uint16_t* payload = method->insns + offset;
+        const uint32_t count = payload[1];
+        if (payload[0] != (packed ? PACKED_SWITCH_PAYLOAD : SPARSE_SWITCH_PAYLOAD) || count > MAX_SWITCH_CASES ||
+            offset + payloadWidth(payload) > method->insns_size) {
+            return false;
+        }
+        // Небольшие switch - цепочка сравнений, переходы относительно самой инструкции
+        as.load(false, RAX, vreg(insn[0] >> 8));
+        for (uint32_t i = 0; i < count; ++i) {
+            const int32_t key = packed ? read32(payload + 2) + static_cast<int32_t>(i) : read32(payload + 2 + i * 2);
+            const int32_t target = packed ? read32(payload + 4 + i * 2) : read32(payload + 2 + count * 2 + i * 2);
+            as.aluImm(ALU_CMP, false, RAX, static_cast<uint32_t>(key));
+            branchIf(COND_E, static_cast<uint32_t>(static_cast<int32_t>(pc) + target));
+        }
+        return true;
+    }
+
+    // Вызов через интерпретатор; для виртуальных - сначала inline-кэш:
+    // класс получателя совпал с запомненным - сразу его реализация
+    void compileInvoke(uint32_t pc, bool is_virtual, bool range) {
+        const uint16_t* insn = method->insns + pc;
+        const size_t site = out.call_sites.size();
+        out.call_sites.push_back({nullptr, nullptr, method, insn});
+
+        as.load(true, RSI, at(SITES, offsetof(JitSiteTable, calls)));
+        as.lea(RSI, at(RSI, static_cast<int32_t>(site * sizeof(JitCallSite))));
+        as.mov(true, RDI, THREAD);
+        as.mov(true, RDX, REGS);
+        if (is_virtual) {
+            as.load(false, RAX, vreg(range ? insn[2] : insn[2] & 0xf));
+            as.test(false, RAX, RAX);
+            exitIf(COND_E, pc);
+            as.load(true, RAX, at(HEAP, RAX, 0, offsetof(Object, klass)));
+            as.alu(ALU_CMP, true, RAX, at(RSI, offsetof(JitCallSite, cached_class)));
+            const size_t miss = as.jcc(COND_NE);
+            callHelper(offsetof(JitHelpers, invoke_cached));
+            const size_t done = as.jmp();
+            as.patch(miss, as.size());
+            callHelper(offsetof(JitHelpers, invoke));
+            as.patch(done, as.size());
+        } else {
+            callHelper(offsetof(JitHelpers, invoke));
+        }
+        as.testByte(RAX);
+        exitIf(COND_E, pc | JIT_EXCEPTION);
+    }
+
+    // Адрес статического поля в rax; до инициализации класса - через интерпретатор
+    void staticField(uint32_t pc) {
+        const size_t site = out.field_sites.size();
+        out.field_sites.push_back({nullptr, method, method->insns + pc});
+
+        as.load(true, RSI, at(SITES, offsetof(JitSiteTable, fields)));
+        as.lea(RSI, at(RSI, static_cast<int32_t>(site * sizeof(JitFieldSite))));
+        as.load(true, RAX, at(RSI, offsetof(JitFieldSite, address)));
+        as.test(true, RAX, RAX);
+        const size_t resolved = as.jcc(COND_NE);
+        as.mov(true, RDI, THREAD);
+        callHelper(offsetof(JitHelpers, static_field));
+        as.test(true, RAX, RAX);
+        exitIf(COND_E, pc | JIT_EXCEPTION);
+        as.patch(resolved, as.size());
+    }
+
+    bool compileInstruction(uint32_t pc) {
+        const uint16_t* insn = method->insns + pc;
+        const uint16_t inst = insn[0];
+        const uint8_t opcode = inst & 0xff;
+        const uint32_t a = (inst >> 8) & 0x0f;
+        const uint32_t b = inst >> 12;
+        const uint32_t aa = inst >> 8;
+        // Второе слово есть не у всех инструкций (последняя может быть в конце кода)
+        const uint16_t second = INSTRUCTION_WIDTH[opcode] > 1 ? insn[1] : 0;
+        const uint32_t bb = second & 0xff;
+        const uint32_t cc = second >> 8;
+
+        switch (opcode) {
+            case 0x00:  // nop
+                return true;
+
+            case 0x01: as.load(false, RAX, vreg(b)); setInt(a, RAX); return true;
+            case 0x02: as.load(false, RAX, vreg(insn[1])); setInt(aa, RAX); return true;
+            case 0x03: as.load(false, RAX, vreg(insn[2])); setInt(insn[1], RAX); return true;
+            case 0x04: as.load(true, RAX, vreg(b)); setWide(a, RAX); return true;
+            case 0x05: as.load(true, RAX, vreg(insn[1])); setWide(aa, RAX); return true;
+            case 0x06: as.load(true, RAX, vreg(insn[2])); setWide(insn[1], RAX); return true;
+            case 0x07: as.load(false, RAX, vreg(b)); setRef(a, RAX); return true;
+            case 0x08: as.load(false, RAX, vreg(insn[1])); setRef(aa, RAX); return true;
+            case 0x09: as.load(false, RAX, vreg(insn[2])); setRef(insn[1], RAX); return true;
+            case 0x0a: as.load(false, RAX, retval()); setInt(aa, RAX); return true;
+            case 0x0b: as.load(true, RAX, retval()); setWide(aa, RAX); return true;
+            case 0x0c: as.load(false, RAX, retval()); setRef(aa, RAX); return true;
+
+            // move-exception, monitor-enter/exit, throw: редкие, их выполняет интерпретатор
+            case 0x0d:
+            case 0x1d:
+            case 0x1e:
+            case 0x27:
+                exitTo(pc);
+                return true;
+
+            case 0x0e:  // return-void
+                as.storeImm(true, retval(), 0);
+                returnValue();
+                return true;
+            case 0x0f:  // return
+            case 0x11:  // return-object
+                as.load(false, RAX, vreg(aa));
+                as.store(true, retval(), RAX);
+                returnValue();
+                return true;
+            case 0x10:  // return-wide
+                as.load(true, RAX, vreg(aa));
+                as.store(true, retval(), RAX);
+                returnValue();
+                return true;
+
+            case 0x12: setIntImm(a, static_cast<uint32_t>(static_cast<int32_t>(static_cast<int16_t>(inst)) >> 12)); return true;
+            case 0x13: setIntImm(aa, static_cast<uint32_t>(static_cast<int16_t>(insn[1]))); return true;
+            case 0x14: setIntImm(aa, static_cast<uint32_t>(read32(insn + 1))); return true;
+            case 0x15: setIntImm(aa, static_cast<uint32_t>(insn[1]) << 16); return true;
+            case 0x16:
+                as.storeImm(true, vreg(aa), static_cast<uint32_t>(static_cast<int16_t>(insn[1])));
+                as.storeImm(true, vref(aa), NULL_REF);
+                return true;
+            case 0x17:
+                as.storeImm(true, vreg(aa), static_cast<uint32_t>(read32(insn + 1)));
+                as.storeImm(true, vref(aa), NULL_REF);
+                return true;
+            case 0x18:
+                as.movImm64(RAX, static_cast<uint32_t>(read32(insn + 1)) |
+                                 static_cast<uint64_t>(static_cast<uint32_t>(read32(insn + 3))) << 32);
+                setWide(aa, RAX);
+                return true;
+            case 0x19:
+                as.movImm64(RAX, static_cast<uint64_t>(insn[1]) << 48);
+                setWide(aa, RAX);
+                return true;
+
+            case 0x21:  // array-length
+                as.load(false, RAX, vreg(b));
+                as.test(false, RAX, RAX);
+                exitIf(COND_E, pc);
+                as.load(false, RAX, at(HEAP, RAX, 0, offsetof(Object, length)));
+                setInt(a, RAX);
+                return true;
+
+            case 0x28: branchTo(pc + static_cast<int8_t>(inst >> 8)); return true;
+            case 0x29: branchTo(pc + static_cast<int16_t>(insn[1])); return true;
+            case 0x2a: branchTo(pc + read32(insn + 1)); return true;
+            case 0x2b: return compileSwitch(pc, true);
+            case 0x2c: return compileSwitch(pc, false);
+
+            case 0x2d: compareFloat(false, false, aa, bb, cc); return true;
+            case 0x2e: compareFloat(false, true, aa, bb, cc); return true;
+            case 0x2f: compareFloat(true, false, aa, bb, cc); return true;
+            case 0x30: compareFloat(true, true, aa, bb, cc); return true;
+            case 0x31:  // cmp-long
+                as.load(true, RAX, vreg(bb));
+                as.alu(ALU_CMP, true, RAX, vreg(cc));
+                as.setcc(COND_G, RAX);
+                as.setcc(COND_L, RCX);
+                as.movzxByte(RAX, RAX);
+                as.movzxByte(RCX, RCX);
+                as.alu(ALU_SUB, false, RAX, RCX);
+                setInt(aa, RAX);
+                return true;
+
+            case 0x32: case 0x33: case 0x34: case 0x35: case 0x36: case 0x37: {
+                static constexpr Cond CONDS[] = {COND_E, COND_NE, COND_L, COND_GE, COND_G, COND_LE};
+                as.load(false, RAX, vreg(a));
+                as.alu(ALU_CMP, false, RAX, vreg(b));
+                branchIf(CONDS[opcode - 0x32], pc + static_cast<int16_t>(insn[1]));
+                return true;
+            }
+            case 0x38: case 0x39: case 0x3a: case 0x3b: case 0x3c: case 0x3d: {
+                static constexpr Cond CONDS[] = {COND_E, COND_NE, COND_L, COND_GE, COND_G, COND_LE};
+                as.cmpImm8(vreg(aa), 0);
+                branchIf(CONDS[opcode - 0x38], pc + static_cast<int16_t>(insn[1]));
+                return true;
+            }
+
+            case 0x44: case 0x45: case 0x46: case 0x47: case 0x48: case 0x49: case 0x4a: {
+                const Access access = ARRAY_ACCESS[opcode - 0x44];
+                arrayElement(bb, cc, pc);
+                loadValue(access, RDX, at(RAX, RCX, accessScale(access), 0));
+                set(access, aa, RDX);
+                return true;
+            }
+            case 0x4d:  // aput-object: проверка типа элемента остается интерпретатору
+                return false;
+            case 0x4b: case 0x4c: case 0x4e: case 0x4f: case 0x50: case 0x51: {
+                const Access access = ARRAY_ACCESS[opcode - 0x4b];
+                arrayElement(bb, cc, pc);
+                as.load(access == Access::Wide, RDX, vreg(aa));
+                storeValue(access, at(RAX, RCX, accessScale(access), 0), RDX);
+                return true;
+            }
+
+            case 0x60: case 0x61: case 0x62: case 0x63: case 0x64: case 0x65: case 0x66:
+                staticField(pc);
+                if (opcode == 0x61) {
+                    as.load(true, RDX, at(RAX, 0));
+                    setWide(aa, RDX);
+                } else {
+                    as.load(false, RDX, at(RAX, 0));
+                    set(opcode == 0x62 ? Access::Object : Access::Int, aa, RDX);
+                }
+                return true;
+            case 0x67: case 0x68: case 0x69: case 0x6a: case 0x6b: case 0x6c: case 0x6d:
+                staticField(pc);
+                as.load(opcode == 0x68, RDX, vreg(aa));
+                as.store(opcode == 0x68, at(RAX, 0), RDX);
+                return true;
+
+            case 0x6e: case 0x72: compileInvoke(pc, true, false); return true;
+            case 0x74: case 0x78: compileInvoke(pc, true, true); return true;
+            case 0x6f: case 0x70: case 0x71: compileInvoke(pc, false, false); return true;
+            case 0x75: case 0x76: case 0x77: compileInvoke(pc, false, true); return true;
+            case 0xe9: compileInvoke(pc, true, false); return true;
+            case 0xea: compileInvoke(pc, true, true); return true;
+
+            case 0x7b: as.load(false, RAX, vreg(b)); as.neg(false, RAX); setInt(a, RAX); return true;
+            case 0x7c: as.load(false, RAX, vreg(b)); as.bitNot(false, RAX); setInt(a, RAX); return true;
+            case 0x7d: as.load(true, RAX, vreg(b)); as.neg(true, RAX); setWide(a, RAX); return true;
+            case 0x7e: as.load(true, RAX, vreg(b)); as.bitNot(true, RAX); setWide(a, RAX); return true;
+            case 0x7f:
+                as.load(false, RAX, vreg(b));
+                as.aluImm(ALU_XOR, false, RAX, 0x80000000);
+                setInt(a, RAX);
+                return true;
+            case 0x80:
+                as.load(true, RAX, vreg(b));
+                as.movImm64(RCX, 0x8000000000000000ull);
+                as.alu(ALU_XOR, true, RAX, RCX);
+                setWide(a, RAX);
+                return true;
+            case 0x81: as.loadSx32(RAX, vreg(b)); setWide(a, RAX); return true;
+            case 0x82: convert(SSE_FLOAT, 0x2a, false, false, a, b); return true;
+            case 0x83: convert(SSE_DOUBLE, 0x2a, false, true, a, b); return true;
+            case 0x84: as.load(false, RAX, vreg(b)); setInt(a, RAX); return true;
+            case 0x85: convert(SSE_FLOAT, 0x2a, true, false, a, b); return true;
+            case 0x86: convert(SSE_DOUBLE, 0x2a, true, true, a, b); return true;
+            case 0x87: truncate(false, false, a, b, pc); return true;
+            case 0x88: truncate(false, true, a, b, pc); return true;
+            case 0x89: convert(SSE_FLOAT, 0x5a, false, true, a, b); return true;
+            case 0x8a: truncate(true, false, a, b, pc); return true;
+            case 0x8b: truncate(true, true, a, b, pc); return true;
+            case 0x8c: convert(SSE_DOUBLE, 0x5a, false, false, a, b); return true;
+            case 0x8d: as.loadSx8(RAX, vreg(b)); setInt(a, RAX); return true;
+            case 0x8e: as.loadZx16(RAX, vreg(b)); setInt(a, RAX); return true;
+            case 0x8f: as.loadSx16(RAX, vreg(b)); setInt(a, RAX); return true;
+
+            default:
+                break;
+        }
+
+        if (opcode >= 0x90 && opcode <= 0x9a) {
+            return integerOp(opcode - 0x90, false, aa, bb, cc, pc);
+        }
+        if (opcode >= 0x9b && opcode <= 0xa5) {
+            return integerOp(opcode - 0x9b, true, aa, bb, cc, pc);
+        }
+        if (opcode >= 0xa6 && opcode <= 0xaa) {
+            return floatOp(opcode - 0xa6, false, aa, bb, cc);
+        }
+        if (opcode >= 0xab && opcode <= 0xaf) {
+            return floatOp(opcode - 0xab, true, aa, bb, cc);
+        }
+        if (opcode >= 0xb0 && opcode <= 0xba) {
+            return integerOp(opcode - 0xb0, false, a, a, b, pc);
+        }
+        if (opcode >= 0xbb && opcode <= 0xc5) {
+            return integerOp(opcode - 0xbb, true, a, a, b, pc);
+        }
+        if (opcode >= 0xc6 && opcode <= 0xca) {
+            return floatOp(opcode - 0xc6, false, a, a, b);
+        }
+        if (opcode >= 0xcb && opcode <= 0xcf) {
+            return floatOp(opcode - 0xcb, true, a, a, b);
+        }
+        if (opcode >= 0xd0 && opcode <= 0xd7) {
+            return literalOp(opcode - 0xd0, a, b, static_cast<int16_t>(insn[1]), pc);
+        }
+        if (opcode >= 0xd8 && opcode <= 0xe2) {
+            return literalOp(opcode - 0xd8, aa, bb, static_cast<int8_t>(cc), pc);
+        }
+
+        // Ускоренные iget/iput: смещение поля во втором слове
+        for (uint32_t i = 0; i < 14; ++i) {
+            if (QUICK_FIELD_OPCODE[i] != opcode) {
+                continue;
+            }
+            const Access access = ARRAY_ACCESS[i % 7];
+            const Mem field = at(HEAP, RAX, 0, insn[1]);
+            as.load(false, RAX, vreg(b));
+            as.test(false, RAX, RAX);
+            exitIf(COND_E, pc);
+            if (i < 7) {
+                loadValue(access, RDX, field);
+                set(access, a, RDX);
+            } else if (access == Access::Object) {
+                // Объект молодого поколения - простая запись, иначе барьер
+                as.load(false, RCX, vreg(a));
+                as.alu(ALU_CMP, false, RAX, at(THREAD, offsetof(JitThread, young_limit)));
+                const size_t young = as.jcc(COND_B);
+                as.mov(false, RSI, RAX);
+                as.movImm32(RDX, insn[1]);
+                as.mov(true, RDI, THREAD);
+                callHelper(offsetof(JitHelpers, write_reference));
+                const size_t done = as.jmp();
+                as.patch(young, as.size());
+                as.store(false, field, RCX);
+                as.patch(done, as.size());
+            } else {
+                as.load(access == Access::Wide, RDX, vreg(a));
+                storeValue(access, field, RDX);
+            }
+            return true;
+        }
+        return false;
+    }
+};
+
+} // namespace
+
+class Jit::Impl {
+public:
+    explicit Impl(size_t code_cache_size) : cache_size(code_cache_size) {}
+
+    ~Impl() {
+        if (worker.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            cv.notify_one();
+            worker.join();
+        }
+        if (writable) {
+            munmap(writable, cache_size);
+        }
+        if (executable) {
+            munmap(executable, cache_size);
+        }
+    }
+
+    bool start() {
+        if (!isSupported() || worker.joinable()) {
+            return false;
+        }
+        // Одни и те же страницы: запись через writable, выполнение через executable
+        const int fd = memfd_create("anexec-jit", MFD_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        bool mapped = false;
+        if (ftruncate(fd, static_cast<off_t>(cache_size)) == 0) {
+            void* rw = mmap(nullptr, cache_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            void* rx = mmap(nullptr, cache_size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+            if (rw != MAP_FAILED && rx != MAP_FAILED) {
+                writable = static_cast<uint8_t*>(rw);
+                executable = static_cast<uint8_t*>(rx);
+                mapped = true;
+            } else {
+                if (rw != MAP_FAILED) {
+                    munmap(rw, cache_size);
+                }
+                if (rx != MAP_FAILED) {
+                    munmap(rx, cache_size);
+                }
+            }
+        }
+        close(fd);
+        if (!mapped) {
+            return false;
+        }
+
+        worker = std::thread([this]() { compileLoop(); });
+        return true;
+    }
+
+    void requestCompile(Method* method) {
+        uint8_t expected = NotCompiled;
+        if (!method->code || !method->prepared || method->rejected ||
+            !method->jit_state.compare_exchange_strong(expected, Queued, std::memory_order_relaxed)) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(method);
+        }
+        cv.notify_one();
+    }
+
+    JitStats getStats() const {
+        JitStats stats;
+        stats.compiled_methods = compiled_methods.load(std::memory_order_relaxed);
+        stats.rejected_methods = rejected_methods.load(std::memory_order_relaxed);
+        stats.code_bytes = code_bytes.load(std::memory_order_relaxed);
+        stats.compile_time_us = compile_time_us.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    const size_t cache_size;
+    uint8_t* writable{nullptr};
+    uint8_t* executable{nullptr};
+    size_t cache_used{0};           // Только поток компиляции
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Method*> queue;
+    bool stopping{false};
+    std::vector<std::unique_ptr<JitCode>> compiled;     // Только поток компиляции
+
+    std::atomic<uint64_t> compiled_methods{0};
+    std::atomic<uint64_t> rejected_methods{0};
+    std::atomic<uint64_t> code_bytes{0};
+    std::atomic<uint64_t> compile_time_us{0};
+
+    void compileLoop() {
+        while (true) {
+            Method* method = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this]() { return stopping || !queue.empty(); });
+                if (stopping) {
+                    return;
+                }
+                method = queue.front();
+                queue.pop_front();
+            }
+            compileMethod(method);
+        }
+    }
+
+    // Читает только код метода, неизменный после ускорения: остальные
+    // структуры рантайма поток компиляции не трогает
+    void compileMethod(Method* method) {
+        const auto start = std::chrono::steady_clock::now();
+        auto code = std::make_unique<JitCode>();
+        Compiler compiler(method, *code);
+        std::vector<uint8_t> bytes;
+
+        const size_t offset = (cache_used + 15) & ~size_t{15};
+        if (!compiler.compile(bytes) || bytes.size() > cache_size - std::min(offset, cache_size)) {
+            method->jit_state.store(Failed, std::memory_order_relaxed);
+            rejected_methods.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::memcpy(writable + offset, bytes.data(), bytes.size());
+        cache_used = offset + bytes.size();
+        code->code = executable + offset;
+        code->size = bytes.size();
+        code->bindSites();
+
+        // Запись кода видна потоку приложения вместе с указателем
+        method->jit_code.store(code.get(), std::memory_order_release);
+        method->jit_state.store(Compiled, std::memory_order_relaxed);
+        compiled.push_back(std::move(code));
+
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        compiled_methods.fetch_add(1, std::memory_order_relaxed);
+        code_bytes.store(cache_used, std::memory_order_relaxed);
+        compile_time_us.fetch_add(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()), std::memory_order_relaxed);
+    }
+};
+
+Jit::Jit(size_t code_cache_size) : impl(new Impl(code_cache_size)) {}
+
+Jit::~Jit() = default;
+
+bool Jit::isSupported() {
+#if defined(__x86_64__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Jit::compile(Method* method, std::vector<uint8_t>& code, JitCode& out) {
+    Compiler compiler(method, out);
+    return compiler.compile(code);
+}
+
+bool Jit::start() {
+    return impl->start();
+}
+
+void Jit::requestCompile(Method* method) {
+    impl->requestCompile(method);
+}
+
+JitStats Jit::getStats() const {
+    return impl->getStats();
+}
+
+} // namespace anexec
@@ -0,0 +1,152 @@
+#ifndef ANEXEC_JIT_H
+#define ANEXEC_JIT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace anexec {
+
+struct Class;
+struct JitHelpers;
+struct Method;
+
+// Состояние вызова из скомпилированного кода: результат последнего
+// вызова (move-result) и интерпретатор, которому он принадлежит.
+// Адреса, зависящие от процесса, код берет отсюда, а не из команд.
+struct JitThread {
+    uint64_t retval;
+    void* owner;
+    const JitHelpers* helpers;
+    uint8_t* heap_base;
+    uint32_t young_limit;       // Heap::youngLimit() для барьера записи
+};
+
+// Место вызова в скомпилированном методе с inline-кэшем: класс получателя
+// и найденная для него реализация. Меняются только потоком приложения.
+struct JitCallSite {
+    Class* cached_class;
+    Method* cached_target;
+    Method* caller;
+    const uint16_t* insn;
+};
+
+// Статическое поле: адрес запоминается после инициализации класса
+struct JitFieldSite {
+    uint8_t* address;
+    Method* caller;
+    const uint16_t* insn;
+};
+
+// Вызовы из скомпилированного кода в интерпретатор. false/nullptr -
+// брошено исключение, оно уже установлено.
+struct JitHelpers {
+    bool (*invoke)(JitThread* thread, JitCallSite* site, uint32_t* regs);
+    bool (*invoke_cached)(JitThread* thread, JitCallSite* site, uint32_t* regs);
+    uint8_t* (*static_field)(JitThread* thread, JitFieldSite* site);
+    // Барьер сборщика для записи ссылки в объект старого поколения
+    void (*write_reference)(JitThread* thread, uint32_t holder, uint32_t offset, uint32_t value);
+};
+
+// Места вызовов и статических полей метода; адрес таблицы код получает
+// при входе, сами места - по номеру
+struct JitSiteTable {
+    JitCallSite* calls;
+    JitFieldSite* fields;
+};
+
+// Скомпилированный код возвращает JIT_RETURNED (результат в JitThread::retval)
+// или смещение инструкции, с которой метод продолжает интерпретатор.
+// С флагом JIT_EXCEPTION - в этой инструкции брошено исключение.
+constexpr uint32_t JIT_RETURNED = 0xFFFFFFFF;
+constexpr uint32_t JIT_EXCEPTION = 0x80000000;
+constexpr uint32_t NO_NATIVE_OFFSET = 0xFFFFFFFF;
+
+// Машинный код метода. Регистры Dalvik остаются в кадре интерпретатора,
+// поэтому войти в код можно с любой инструкции (в том числе посреди
+// цикла) и выйти из него в интерпретатор в любой момент. Код не зависит
+// от адреса, по которому лежит, - его можно хранить в образе AOT.
+struct JitCode {
+    using Entry = uint32_t (*)(JitThread* thread, uint32_t* regs, const void* start, JitSiteTable* sites);
+
+    const uint8_t* code{nullptr};
+    size_t size{0};
+    std::vector<uint32_t> native_offsets;   // По смещению инструкции в словах
+    std::vector<JitCallSite> call_sites;    // Размер не меняется после bindSites
+    std::vector<JitFieldSite> field_sites;
+    JitSiteTable sites{nullptr, nullptr};
+
+    void bindSites() {
+        sites = {call_sites.data(), field_sites.data()};
+    }
+
+    const void* nativeAt(uint32_t dex_pc) const {
+        if (dex_pc >= native_offsets.size() || native_offsets[dex_pc] == NO_NATIVE_OFFSET) {
+            return nullptr;
+        }
+        return code + native_offsets[dex_pc];
+    }
+
+    uint32_t run(JitThread* thread, uint32_t* regs, const void* start) const {
+        return reinterpret_cast<Entry>(const_cast<uint8_t*>(code))(thread, regs, start,
+                                                                   const_cast<JitSiteTable*>(&sites));
+    }
+};
+
+struct JitStats {
+    uint64_t compiled_methods;
+    uint64_t rejected_methods;      // С неподдерживаемыми инструкциями
+    uint64_t code_bytes;            // Занято в кэше кода
+    uint64_t compile_time_us;
+};
+
+// Базовый JIT для x86_64: горячие методы (счетчик вызовов и обратных
+// переходов достиг COMPILE_THRESHOLD) компилируются в фоновом потоке,
+// поток приложения не ждет. Каждая инструкция Dalvik переводится в
+// короткую последовательность машинных команд над регистрами кадра;
+// редкие и сложные случаи (исключения, разрешение ссылок) уходят в
+// интерпретатор. Кэш кода - memfd, отображенный дважды: для записи
+// компилятором и для выполнения, без страниц с W и X одновременно.
+class Jit {
+public:
+    static constexpr uint32_t COMPILE_THRESHOLD = 10000;
+    static constexpr size_t DEFAULT_CODE_CACHE_SIZE = 32 * 1024 * 1024;
+
+    // Метод компилируется один раз; состояние в Method::jit_state
+    enum State : uint8_t {
+        NotCompiled,
+        Queued,
+        Compiled,
+        Failed
+    };
+
+    explicit Jit(size_t code_cache_size = DEFAULT_CODE_CACHE_SIZE);
+    ~Jit();
+
+    // Запрещаем копирование
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+
+    static bool isSupported();
+
+    // Компиляция без кэша кода (для образа AOT): байты кода и таблицы
+    // в out, out.code не заполняется. false - метод не компилируется.
+    static bool compile(Method* method, std::vector<uint8_t>& code, JitCode& out);
+
+    // Отображает кэш кода и запускает поток компиляции
+    bool start();
+
+    // Из потока приложения; код появится в Method::jit_code позже
+    void requestCompile(Method* method);
+
+    JitStats getStats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_JIT_H
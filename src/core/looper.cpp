@@ -0,0 +1,244 @@
+#include "looper.h"
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace anexec {
+
+namespace {
+
+thread_local Looper* current_looper = nullptr;
+
+constexpr int MAX_EVENTS = 16;
+
+} // namespace
+
+Looper::Looper() {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (epoll_fd >= 0) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        if (wake_fd >= 0) {
+            event.data.fd = wake_fd;
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+        }
+        if (timer_fd >= 0) {
+            event.data.fd = timer_fd;
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event);
+        }
+    }
+}
+
+Looper::~Looper() {
+    for (int fd : {timer_fd, wake_fd, epoll_fd}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+Looper* Looper::myLooper() {
+    return current_looper;
+}
+
+void Looper::post(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(std::move(task));
+    }
+    wake();
+}
+
+Looper::TimerId Looper::postDelayed(Task task, std::chrono::nanoseconds delay) {
+    const Clock::time_point deadline =
+        Clock::now() + std::chrono::duration_cast<Clock::duration>(delay);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const TimerId id = next_timer_id++;
+    timers.emplace(Timer{deadline, id}, std::move(task));
+    timer_deadlines.emplace(id, deadline);
+
+    // Перевзводим timerfd только если новый таймер стал ближайшим
+    if (deadline < armed_deadline) {
+        armTimer(deadline);
+    }
+    return id;
+}
+
+bool Looper::cancel(TimerId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = timer_deadlines.find(id);
+    if (it == timer_deadlines.end()) {
+        return false;
+    }
+    timers.erase(Timer{it->second, id});
+    timer_deadlines.erase(it);
+    // Лишнее срабатывание timerfd безвредно, поэтому его не перевзводим
+    return true;
+}
+
+bool Looper::addFd(int fd, uint32_t events, FdCallback callback) {
+    if (epoll_fd < 0 || fd < 0 || !callback) {
+        return false;
+    }
+
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+
+    const bool existing = fd_callbacks.count(fd) != 0;
+    if (epoll_ctl(epoll_fd, existing ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) != 0) {
+        return false;
+    }
+    fd_callbacks[fd] = std::move(callback);
+    return true;
+}
+
+void Looper::removeFd(int fd) {
+    if (fd_callbacks.erase(fd) != 0) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+}
+
+void Looper::wake() {
+    // Одной записи в eventfd достаточно до тех пор, пока цикл ее не прочитал
+    if (wake_pending.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    const uint64_t one = 1;
+    ssize_t written;
+    do {
+        written = ::write(wake_fd, &one, sizeof(one));
+    } while (written < 0 && errno == EINTR);
+}
+
+void Looper::quit() {
+    quitting.store(true, std::memory_order_release);
+    wake();
+}
+
+void Looper::reset() {
+    quitting.store(false, std::memory_order_release);
+}
+
+void Looper::closeAfterFork() {
+    // epoll_ctl здесь нельзя: экземпляр epoll общий с родителем.
+    // Закрытие копий дескрипторов его регистрации не меняет.
+    for (int* fd : {&timer_fd, &wake_fd, &epoll_fd}) {
+        if (*fd >= 0) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+    fd_callbacks.clear();
+}
+
+void Looper::drainWakeFd() {
+    // Флаг сбрасываем до чтения: запись после этого снова разбудит цикл
+    wake_pending.store(false, std::memory_order_release);
+    uint64_t value;
+    while (::read(wake_fd, &value, sizeof(value)) > 0) {
+    }
+}
+
+void Looper::armTimer(Clock::time_point deadline) {
+    armed_deadline = deadline;
+
+    // steady_clock в Linux соответствует CLOCK_MONOTONIC
+    itimerspec spec{};
+    if (deadline != Clock::time_point::max()) {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            deadline.time_since_epoch()).count();
+        // Нулевое значение выключает таймер, поэтому прошедший срок сдвигаем на 1 нс
+        const long long when = ns > 0 ? ns : 1;
+        spec.it_value.tv_sec = static_cast<time_t>(when / 1000000000LL);
+        spec.it_value.tv_nsec = static_cast<long>(when % 1000000000LL);
+    }
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+void Looper::runDueTimers() {
+    uint64_t expirations;
+    while (::read(timer_fd, &expirations, sizeof(expirations)) > 0) {
+    }
+
+    const Clock::time_point now = Clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!timers.empty() && timers.begin()->first.deadline <= now) {
+        auto it = timers.begin();
+        Task task = std::move(it->second);
+        timer_deadlines.erase(it->first.id);
+        timers.erase(it);
+
+        // Задача может сама вызвать postDelayed, поэтому выполняем без блокировки
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+    armTimer(timers.empty() ? Clock::time_point::max() : timers.begin()->first.deadline);
+}
+
+bool Looper::pollOnce(int timeout_ms) {
+    // Поток пула может по очереди обслуживать разные циклы (ExecutorHost),
+    // поэтому myLooper() восстанавливаем при выходе
+    struct CurrentScope {
+        Looper* previous;
+        explicit CurrentScope(Looper* looper) : previous(current_looper) {
+            current_looper = looper;
+        }
+        ~CurrentScope() { current_looper = previous; }
+    } scope(this);
+
+    if (quitting.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    epoll_event events[MAX_EVENTS];
+    int count;
+    do {
+        count = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout_ms);
+    } while (count < 0 && errno == EINTR);
+
+    bool timers_due = false;
+    for (int i = 0; i < count; ++i) {
+        const int fd = events[i].data.fd;
+        if (fd == wake_fd) {
+            drainWakeFd();
+        } else if (fd == timer_fd) {
+            timers_due = true;
+        } else {
+            auto it = fd_callbacks.find(fd);
+            if (it != fd_callbacks.end()) {
+                // Копия: обработчик может удалить сам себя через removeFd
+                FdCallback callback = it->second;
+                callback(fd, events[i].events);
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running.swap(pending);
+    }
+    for (Task& task : running) {
+        task();
+    }
+    running.clear();
+
+    if (timers_due) {
+        runDueTimers();
+    }
+    return !quitting.load(std::memory_order_acquire);
+}
+
+void Looper::loop() {
+    while (pollOnce(-1)) {
+    }
+}
+
+} // namespace anexec
@@ -0,0 +1,108 @@
+#ifndef ANEXEC_LOOPER_H
+#define ANEXEC_LOOPER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace anexec {
+
+/**
+ * @brief Цикл обработки событий по образцу android.os.Looper
+ *
+ * Построен на epoll: eventfd будит цикл при отправке задач,
+ * timerfd срабатывает к ближайшему отложенному вызову. Без событий
+ * поток спит в ядре и не просыпается по таймеру.
+ *
+ * post/postDelayed/cancel/wake/quit можно вызывать из любого потока,
+ * pollOnce/loop - только из потока, который обслуживает цикл.
+ */
+class Looper {
+public:
+    using Task = std::function<void()>;
+    using FdCallback = std::function<void(int fd, uint32_t events)>;
+    using TimerId = uint64_t;
+
+    Looper();
+    ~Looper();
+
+    // Запрещаем копирование
+    Looper(const Looper&) = delete;
+    Looper& operator=(const Looper&) = delete;
+
+    // Задача выполнится в потоке цикла при ближайшей итерации
+    void post(Task task);
+
+    // Отложенный вызов; id можно передать в cancel()
+    TimerId postDelayed(Task task, std::chrono::nanoseconds delay);
+    bool cancel(TimerId id);
+
+    // Наблюдение за дескриптором (events - маска EPOLLIN/EPOLLOUT/...)
+    bool addFd(int fd, uint32_t events, FdCallback callback);
+    void removeFd(int fd);
+
+    // Одна итерация: ждет события не дольше timeout_ms (-1 - без ограничения)
+    // и выполняет все готовые задачи. Возвращает false после quit().
+    bool pollOnce(int timeout_ms = -1);
+
+    // Обработка событий до quit()
+    void loop();
+
+    void quit();
+    void wake();
+    bool isQuitting() const { return quitting.load(std::memory_order_acquire); }
+
+    // Сбрасывает флаг quit(), чтобы цикл можно было запустить снова
+    void reset();
+
+    // Для дочернего процесса после fork: закрывает свои дескрипторы и
+    // забывает наблюдаемые, не трогая epoll родителя. Цикл больше не работает.
+    void closeAfterFork();
+
+    // Дескриптор epoll: становится читаемым, когда у цикла есть работа.
+    // Позволяет встраивать несколько циклов в один внешний цикл.
+    int getFd() const { return epoll_fd; }
+
+    // Цикл, который сейчас обслуживает текущий поток (или nullptr)
+    static Looper* myLooper();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Timer {
+        Clock::time_point deadline;
+        TimerId id;
+        bool operator<(const Timer& other) const {
+            return deadline < other.deadline || (deadline == other.deadline && id < other.id);
+        }
+    };
+
+    void drainWakeFd();
+    void armTimer(Clock::time_point deadline);
+    void runDueTimers();
+
+    int epoll_fd{-1};
+    int wake_fd{-1};
+    int timer_fd{-1};
+
+    std::mutex mutex;
+    std::vector<Task> pending;
+    std::vector<Task> running;  // Буфер для обмена, переиспользуется
+    std::map<Timer, Task> timers;
+    std::unordered_map<TimerId, Clock::time_point> timer_deadlines;
+    TimerId next_timer_id{1};
+    Clock::time_point armed_deadline{Clock::time_point::max()};
+
+    std::unordered_map<int, FdCallback> fd_callbacks;
+    std::atomic<bool> wake_pending{false};
+    std::atomic<bool> quitting{false};
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_LOOPER_H
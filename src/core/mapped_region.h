@@ -0,0 +1,34 @@
+#ifndef ANEXEC_MAPPED_REGION_H
+#define ANEXEC_MAPPED_REGION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/mman.h>
+
+namespace anexec {
+
+// Владелец области mmap. Освобождается вместе с последней ссылкой.
+class MappedRegion {
+public:
+    MappedRegion(void* base, size_t size) : base_(base), size_(size) {}
+    ~MappedRegion() {
+        if (base_) {
+            munmap(base_, size_);
+        }
+    }
+
+    // Запрещаем копирование
+    MappedRegion(const MappedRegion&) = delete;
+    MappedRegion& operator=(const MappedRegion&) = delete;
+
+    const uint8_t* data() const { return static_cast<const uint8_t*>(base_); }
+    size_t size() const { return size_; }
+
+private:
+    void* base_;
+    size_t size_;
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_MAPPED_REGION_H
@@ -0,0 +1,112 @@
+#ifndef ANEXEC_MPMC_QUEUE_H
+#define ANEXEC_MPMC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace anexec {
+
+// Ограниченная очередь без блокировок: много производителей и много
+// потребителей (схема Вьюкова). У каждой ячейки свой номер поколения,
+// поэтому производители и потребители сталкиваются только на своих
+// счетчиках позиции. Память выделяется один раз в конструкторе.
+template <typename T>
+class MpmcQueue {
+public:
+    // Емкость округляется вверх до степени двойки
+    explicit MpmcQueue(size_t capacity)
+        : mask(roundUp(capacity) - 1), slots(new Slot[mask + 1]) {
+        for (size_t i = 0; i <= mask; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+    // false - очередь заполнена, value не тронут
+    bool tryPush(T&& value) {
+        size_t position = enqueue_position.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots[position & mask];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const intptr_t difference = static_cast<intptr_t>(sequence) -
+                                        static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (enqueue_position.compare_exchange_weak(position, position + 1,
+                                                           std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = std::move(value);
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // false - очередь пуста
+    bool tryPop(T& value) {
+        size_t position = dequeue_position.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots[position & mask];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const intptr_t difference = static_cast<intptr_t>(sequence) -
+                                        static_cast<intptr_t>(position + 1);
+            if (difference == 0) {
+                if (dequeue_position.compare_exchange_weak(position, position + 1,
+                                                           std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = dequeue_position.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(slot->value);
+        slot->value = T{};
+        slot->sequence.store(position + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Приблизительно: другие потоки могут менять очередь одновременно
+    bool empty() const {
+        return enqueue_position.load(std::memory_order_acquire) ==
+               dequeue_position.load(std::memory_order_acquire);
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value{};
+    };
+
+    static size_t roundUp(size_t value) {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<size_t> enqueue_position{0};
+    alignas(64) std::atomic<size_t> dequeue_position{0};
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_MPMC_QUEUE_H
@@ -0,0 +1,123 @@
+#ifndef ANEXEC_MPSC_RING_H
+#define ANEXEC_MPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace anexec {
+
+// Ограниченная очередь без блокировок: много производителей, один потребитель.
+// Производитель резервирует сразу целый диапазон ячеек одним CAS, поэтому
+// пакет из N элементов стоит одну атомарную операцию, а не N захватов
+// мьютекса. Память выделяется один раз в конструкторе.
+template <typename T>
+class MpscRing {
+public:
+    // Емкость округляется вверх до степени двойки
+    explicit MpscRing(size_t capacity)
+        : mask(roundUp(capacity) - 1), slots(new Slot[mask + 1]) {
+        for (size_t i = 0; i <= mask; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+    // Любой поток. Все count элементов становятся видны потребителю
+    // одновременно. false - в очереди нет места для всего пакета.
+    bool tryPush(const T* items, size_t count) {
+        if (count == 0) {
+            return true;
+        }
+        if (count > capacity()) {
+            return false;
+        }
+
+        size_t position = enqueue_position.load(std::memory_order_relaxed);
+        while (true) {
+            // Потребитель освобождает ячейки по порядку: если свободна
+            // последняя ячейка диапазона, свободны и все перед ней
+            const size_t last = position + count - 1;
+            const size_t sequence = slots[last & mask].sequence.load(std::memory_order_acquire);
+            const intptr_t difference = static_cast<intptr_t>(sequence) -
+                                        static_cast<intptr_t>(last);
+            if (difference == 0) {
+                if (enqueue_position.compare_exchange_weak(position, position + count,
+                                                           std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            slots[(position + i) & mask].value = items[i];
+        }
+        // Первая ячейка публикуется последней: потребитель читает по порядку
+        // и не увидит часть пакета
+        for (size_t i = count; i-- > 0;) {
+            slots[(position + i) & mask].sequence.store(position + i + 1,
+                                                        std::memory_order_release);
+        }
+        return true;
+    }
+
+    // Только потребитель
+    bool empty() const {
+        const size_t position = dequeue_position;
+        return slots[position & mask].sequence.load(std::memory_order_acquire) != position + 1;
+    }
+
+    // Только потребитель. Передает в consume элементы, зарезервированные
+    // до вызова, и возвращает их количество. Пакеты, записанные во время
+    // разбора, остаются до следующего вызова.
+    template <typename Consumer>
+    size_t drain(Consumer&& consume) {
+        const size_t end = enqueue_position.load(std::memory_order_relaxed);
+        size_t taken = 0;
+        while (dequeue_position != end) {
+            Slot& slot = slots[dequeue_position & mask];
+            if (slot.sequence.load(std::memory_order_acquire) != dequeue_position + 1) {
+                break;
+            }
+            consume(static_cast<const T&>(slot.value));
+            slot.sequence.store(dequeue_position + mask + 1, std::memory_order_release);
+            ++dequeue_position;
+            ++taken;
+        }
+        return taken;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value{};
+    };
+
+    static size_t roundUp(size_t value) {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<size_t> enqueue_position{0};
+    alignas(64) size_t dequeue_position{0};
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_MPSC_RING_H
@@ -0,0 +1,461 @@
+#include "native_loader.h"
+#include "apk_archive.h"
+#include "hash.h"
+#include "resource_monitor.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dlfcn.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+
+namespace anexec {
+
+namespace {
+
+// Имена DT_NEEDED из ELF в памяти. Строки ищутся через PT_LOAD,
+// потому что DT_STRTAB - виртуальный адрес, а не смещение в файле.
+template <typename Ehdr, typename Phdr, typename Dyn>
+void readNeededAs(const uint8_t* data, size_t size, std::vector<std::string>& needed) {
+    Ehdr header;
+    if (size < sizeof(header)) {
+        return;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.e_phentsize != sizeof(Phdr) ||
+        header.e_phoff > size ||
+        header.e_phnum > (size - header.e_phoff) / sizeof(Phdr)) {
+        return;
+    }
+
+    std::vector<Phdr> segments(header.e_phnum);
+    std::memcpy(segments.data(), data + header.e_phoff, segments.size() * sizeof(Phdr));
+
+    auto toOffset = [&](uint64_t address, uint64_t& offset) {
+        for (const auto& segment : segments) {
+            if (segment.p_type == PT_LOAD && address >= segment.p_vaddr &&
+                address - segment.p_vaddr < segment.p_filesz) {
+                offset = address - segment.p_vaddr + segment.p_offset;
+                return offset < size;
+            }
+        }
+        return false;
+    };
+
+    for (const auto& segment : segments) {
+        if (segment.p_type != PT_DYNAMIC || segment.p_offset > size ||
+            segment.p_filesz > size - segment.p_offset) {
+            continue;
+        }
+
+        const size_t count = static_cast<size_t>(segment.p_filesz / sizeof(Dyn));
+        std::vector<Dyn> dynamic(count);
+        std::memcpy(dynamic.data(), data + segment.p_offset, count * sizeof(Dyn));
+
+        uint64_t strtab = 0;
+        uint64_t strsz = 0;
+        for (const auto& entry : dynamic) {
+            if (entry.d_tag == DT_STRTAB) {
+                strtab = entry.d_un.d_ptr;
+            } else if (entry.d_tag == DT_STRSZ) {
+                strsz = entry.d_un.d_val;
+            }
+        }
+
+        uint64_t strings = 0;
+        if (strtab == 0 || !toOffset(strtab, strings)) {
+            return;
+        }
+        const uint64_t limit = std::min<uint64_t>(size, strings + strsz);
+        for (const auto& entry : dynamic) {
+            if (entry.d_tag == DT_NULL) {
+                break;
+            }
+            if (entry.d_tag != DT_NEEDED || strings + entry.d_un.d_val >= limit) {
+                continue;
+            }
+            const char* name = reinterpret_cast<const char*>(data + strings + entry.d_un.d_val);
+            needed.emplace_back(name, strnlen(name, static_cast<size_t>(
+                limit - strings - entry.d_un.d_val)));
+        }
+        return;
+    }
+}
+
+// ELF32 (armeabi-v7a, x86) и ELF64 различаются только размерами структур
+void readNeeded(const uint8_t* data, size_t size, std::vector<std::string>& needed) {
+    if (size < EI_NIDENT || std::memcmp(data, ELFMAG, SELFMAG) != 0) {
+        return;
+    }
+    if (data[EI_CLASS] == ELFCLASS64) {
+        readNeededAs<Elf64_Ehdr, Elf64_Phdr, Elf64_Dyn>(data, size, needed);
+    } else if (data[EI_CLASS] == ELFCLASS32) {
+        readNeededAs<Elf32_Ehdr, Elf32_Phdr, Elf32_Dyn>(data, size, needed);
+    }
+}
+
+// Копирование диапазона файла силами ядра: copy_file_range, затем sendfile
+bool copyRange(int from, uint64_t offset, int to, uint64_t size) {
+    loff_t in = static_cast<loff_t>(offset);
+    uint64_t left = size;
+    while (left > 0) {
+        ssize_t n = copy_file_range(from, &in, to, nullptr, left, 0);
+        if (n <= 0) {
+            break;
+        }
+        left -= static_cast<uint64_t>(n);
+    }
+
+    // Между разными ФС (APK на ext4, memfd на tmpfs) copy_file_range дает EXDEV
+    off_t in_offset = static_cast<off_t>(in);
+    while (left > 0) {
+        ssize_t n = sendfile(to, from, &in_offset, static_cast<size_t>(left));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        left -= static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+// Общие memfd по содержимому. Ключ - размер и CRC записи; совпадение
+// ключа еще не значит совпадения содержимого (CRC легко подобрать), поэтому
+// новая копия сравнивается с общей побайтно.
+class SharedFiles {
+public:
+    using File = NativeLoader::SharedFile;
+
+    static SharedFiles& instance() {
+        static SharedFiles files;
+        return files;
+    }
+
+    std::shared_ptr<const File> find(uint64_t key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = files.find(key);
+        return it != files.end() ? it->second.lock() : nullptr;
+    }
+
+    // Другой поток мог опубликовать ту же библиотеку раньше: тогда его копия
+    void publish(uint64_t key, const std::shared_ptr<const File>& file) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = files.begin(); it != files.end();) {
+            it = it->second.expired() ? files.erase(it) : std::next(it);
+        }
+        files.emplace(key, file);
+    }
+
+private:
+    std::mutex mutex;
+    std::unordered_map<uint64_t, std::weak_ptr<const File>> files;
+};
+
+// Пространства имен компоновщика по наборам библиотек APK. glibc
+// освобождает пространство, когда из него выгружена последняя библиотека,
+// поэтому запись живет, пока пространством пользуется хоть один загрузчик.
+class LinkerNamespaces {
+public:
+    static LinkerNamespaces& instance() {
+        static LinkerNamespaces namespaces;
+        return namespaces;
+    }
+
+    // Первая библиотека загрузчика. Новое пространство создается под
+    // блокировкой, чтобы загрузчики одного APK не создали два.
+    void* openFirst(uint64_t key, bool share, const std::string& path, long& id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (share) {
+            auto it = namespaces.find(key);
+            if (it != namespaces.end()) {
+                void* handle = dlmopen(it->second.id, path.c_str(), RTLD_LAZY | RTLD_LOCAL);
+                if (handle) {
+                    ++it->second.users;
+                    id = it->second.id;
+                }
+                return handle;
+            }
+        }
+        void* handle = dlmopen(LM_ID_NEWLM, path.c_str(), RTLD_LAZY | RTLD_LOCAL);
+        Lmid_t lmid = 0;
+        if (!handle || dlinfo(handle, RTLD_DI_LMID, &lmid) != 0) {
+            if (handle) {
+                dlclose(handle);
+            }
+            return nullptr;
+        }
+        id = lmid;
+        if (share) {
+            namespaces.emplace(key, Entry{lmid, 1});
+        }
+        return handle;
+    }
+
+    // Загрузчик выгрузил все свои библиотеки
+    void release(uint64_t key, bool share) {
+        if (!share) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = namespaces.find(key);
+        if (it != namespaces.end() && --it->second.users == 0) {
+            namespaces.erase(it);
+        }
+    }
+
+private:
+    struct Entry {
+        Lmid_t id;
+        size_t users;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<uint64_t, Entry> namespaces;
+};
+
+} // namespace
+
+struct NativeLoader::SharedFile {
+    int fd;
+    uint64_t size;
+    std::vector<std::string> needed;
+
+    SharedFile(int fd, uint64_t size, std::vector<std::string> needed)
+        : fd(fd), size(size), needed(std::move(needed)) {
+        ResourceMonitor::instance().add(MemoryCategory::NativeLibs, static_cast<int64_t>(size));
+    }
+
+    ~SharedFile() {
+        ResourceMonitor::instance().add(MemoryCategory::NativeLibs, -static_cast<int64_t>(size));
+        ::close(fd);
+    }
+};
+
+NativeLoader::~NativeLoader() {
+    unloadAll();
+}
+
+void NativeLoader::attach(const ApkArchive* apk, const std::string& abi, bool share_files) {
+    unloadAll();
+    std::lock_guard<std::mutex> lock(mutex);
+    archive = apk;
+    prefix = "lib/" + abi + "/";
+    share = share_files;
+
+    // APK с теми же библиотеками могут делить пространство имен:
+    // DT_NEEDED разрешится в них так же
+    namespace_key = FNV1A_OFFSET_BASIS;
+    for (const auto& entry : archive->entries()) {
+        if (entry.name.compare(0, prefix.size(), prefix) == 0) {
+            namespace_key = fnv1a(namespace_key, entry.name.data(), entry.name.size());
+            namespace_key = fnv1a(namespace_key, &entry.crc32, sizeof(entry.crc32));
+            namespace_key = fnv1a(namespace_key, &entry.size, sizeof(entry.size));
+        }
+    }
+}
+
+void NativeLoader::unloadAll() {
+    std::lock_guard<std::mutex> lock(mutex);
+    // Обратный порядок: зависимости выгружаются после зависящих от них
+    for (auto it = libraries.rbegin(); it != libraries.rend(); ++it) {
+        dlclose(it->handle);
+    }
+    if (has_namespace) {
+        LinkerNamespaces::instance().release(namespace_key, share);
+        has_namespace = false;
+    }
+    libraries.clear();
+    symbols.clear();
+    loaded_bytes = 0;
+    archive = nullptr;
+}
+
+bool NativeLoader::loadLibrary(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> loading;
+    return loadFile("lib" + name + ".so", loading);
+}
+
+bool NativeLoader::isLoaded(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::string file = "lib" + name + ".so";
+    return std::any_of(libraries.begin(), libraries.end(),
+                       [&](const Library& library) { return library.file == file; });
+}
+
+void* NativeLoader::findSymbol(const std::string& symbol) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = symbols.find(symbol);
+    if (it != symbols.end()) {
+        return it->second;
+    }
+
+    for (const auto& library : libraries) {
+        if (void* address = dlsym(library.handle, symbol.c_str())) {
+            symbols.emplace(symbol, address);
+            return address;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<std::string> NativeLoader::availableLibraries() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> names;
+    if (!archive) {
+        return names;
+    }
+    for (const auto& entry : archive->entries()) {
+        const std::string& name = entry.name;
+        if (name.size() > prefix.size() + 3 &&
+            name.compare(0, prefix.size(), prefix) == 0 &&
+            name.compare(name.size() - 3, 3, ".so") == 0 &&
+            name.find('/', prefix.size()) == std::string::npos) {
+            names.push_back(name.substr(prefix.size()));
+        }
+    }
+    return names;
+}
+
+size_t NativeLoader::loadedCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return libraries.size();
+}
+
+uint64_t NativeLoader::loadedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return loaded_bytes;
+}
+
+std::string NativeLoader::getLastError() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return last_error;
+}
+
+std::shared_ptr<const NativeLoader::SharedFile> NativeLoader::extract(const std::string& file,
+                                                                      const ZipEntry& entry) {
+    const size_t size = static_cast<size_t>(entry.size);
+    const int fd = memfd_create(file.c_str(), MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        last_error = "Failed to create memfd for " + file + ": " + std::strerror(errno);
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return nullptr;
+    }
+
+    // Несжатая запись копируется ядром из page cache APK, сжатая
+    // распаковывается прямо в страницы memfd
+    uint64_t offset = 0;
+    const bool copied = entry.isStored() && archive->dataOffset(entry, offset) &&
+                        copyRange(archive->fd(), offset, fd, entry.size);
+
+    void* data = mmap(nullptr, size, copied ? PROT_READ : PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        last_error = "Failed to map memfd for " + file;
+        ::close(fd);
+        return nullptr;
+    }
+
+    if (!copied && !archive->inflate(entry, static_cast<uint8_t*>(data), size)) {
+        last_error = "Failed to extract " + entry.name;
+        munmap(data, size);
+        ::close(fd);
+        return nullptr;
+    }
+
+    // Та же библиотека уже распакована другим загрузчиком: наша копия не нужна
+    uint64_t key = FNV1A_OFFSET_BASIS;
+    key = fnv1a(key, &entry.size, sizeof(entry.size));
+    key = fnv1a(key, &entry.crc32, sizeof(entry.crc32));
+    std::shared_ptr<const SharedFile> shared = share ? SharedFiles::instance().find(key) : nullptr;
+    if (shared && shared->size == entry.size) {
+        void* other = mmap(nullptr, size, PROT_READ, MAP_SHARED, shared->fd, 0);
+        const bool same = other != MAP_FAILED && std::memcmp(data, other, size) == 0;
+        if (other != MAP_FAILED) {
+            munmap(other, size);
+        }
+        if (same) {
+            munmap(data, size);
+            ::close(fd);
+            return shared;
+        }
+    }
+
+    std::vector<std::string> needed;
+    readNeeded(static_cast<const uint8_t*>(data), size, needed);
+    munmap(data, size);
+    auto created = std::make_shared<const SharedFile>(fd, entry.size, std::move(needed));
+    // Ключ занят другим содержимым: эта копия остается своей
+    if (share && !shared) {
+        SharedFiles::instance().publish(key, created);
+    }
+    return created;
+}
+
+// Первая библиотека создает пространство имен загрузчика (или входит в
+// общее для этого набора библиотек), остальные загружаются в него же
+void* NativeLoader::open(const SharedFile& memfd, const std::string& file) {
+    const std::string path = "/proc/self/fd/" + std::to_string(memfd.fd);
+    void* handle = nullptr;
+    if (has_namespace) {
+        handle = dlmopen(namespace_id, path.c_str(), RTLD_LAZY | RTLD_LOCAL);
+    } else {
+        handle = LinkerNamespaces::instance().openFirst(namespace_key, share, path, namespace_id);
+        has_namespace = handle != nullptr;
+    }
+    if (!handle) {
+        const char* error = dlerror();
+        last_error = "Failed to load " + file + ": " + (error ? error : "unknown error");
+    }
+    return handle;
+}
+
+bool NativeLoader::loadFile(const std::string& file, std::vector<std::string>& loading) {
+    const bool loaded = std::any_of(libraries.begin(), libraries.end(),
+                                    [&](const Library& library) { return library.file == file; });
+    // Цикл зависимостей разрешит сам динамический загрузчик
+    if (loaded || std::find(loading.begin(), loading.end(), file) != loading.end()) {
+        return true;
+    }
+
+    const ZipEntry* entry = archive ? archive->find(prefix + file) : nullptr;
+    if (!entry || entry->size == 0) {
+        last_error = "Library " + prefix + file + " not found in APK";
+        return false;
+    }
+
+    std::shared_ptr<const SharedFile> memfd = extract(file, *entry);
+    if (!memfd) {
+        return false;
+    }
+
+    // Зависимости из APK загружаем первыми в то же пространство имен:
+    // glibc сопоставит DT_NEEDED с уже загруженной библиотекой по
+    // DT_SONAME. Системные (libc.so, liblog.so, ...) в APK отсутствуют
+    // и ищутся обычным путем.
+    loading.push_back(file);
+    for (const auto& dependency : memfd->needed) {
+        if (archive->find(prefix + dependency) && !loadFile(dependency, loading)) {
+            return false;
+        }
+    }
+    loading.pop_back();
+
+    void* handle = open(*memfd, file);
+    if (!handle) {
+        return false;
+    }
+
+    libraries.push_back(Library{file, handle, entry->size, std::move(memfd)});
+    loaded_bytes += entry->size;
+    return true;
+}
+
+} // namespace anexec
@@ -0,0 +1,90 @@
+#ifndef ANEXEC_NATIVE_LOADER_H
+#define ANEXEC_NATIVE_LOADER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <unordered_map>
+
+namespace anexec {
+
+class ApkArchive;
+struct ZipEntry;
+
+// Загрузка нативных библиотек приложения из lib/<abi>/ внутри APK.
+// Библиотека загружается при первом System.loadLibrary: запись копируется
+// ядром из APK в memfd (без файлов на диске) и открывается через
+// /proc/self/fd. Зависимости DT_NEEDED, лежащие в том же APK,
+// загружаются раньше самой библиотеки. Все методы потокобезопасны.
+//  - Библиотеки загружаются через dlmopen в отдельное пространство имен
+//    компоновщика: DT_NEEDED разрешается только среди библиотек этого
+//    APK и системных, а не одноименных библиотек других приложений.
+//    Загрузчики APK с тем же набором библиотек делят пространство имен,
+//    а в нем и сами библиотеки вместе с их глобальными данными (как
+//    исполнители одного APK делят образ DEX).
+//  - memfd с одинаковым содержимым общий для всех загрузчиков процесса:
+//    копии одной библиотеки не занимают память повторно.
+// При share = false у загрузчика свое пространство имен и свои memfd.
+// Пространств имен в glibc немного (около 15 на процесс): когда они
+// кончаются, загрузка завершается ошибкой dlmopen.
+class NativeLoader {
+public:
+    NativeLoader() = default;
+    ~NativeLoader();
+
+    // Запрещаем копирование
+    NativeLoader(const NativeLoader&) = delete;
+    NativeLoader& operator=(const NativeLoader&) = delete;
+
+    // Привязка к открытому APK; ранее загруженные библиотеки выгружаются.
+    // Архив должен жить, пока используется загрузчик.
+    void attach(const ApkArchive* archive, const std::string& abi, bool share = true);
+    void unloadAll();
+
+    // "foo" -> lib/<abi>/libfoo.so. Повторный вызов ничего не делает.
+    bool loadLibrary(const std::string& name);
+    bool isLoaded(const std::string& name) const;
+
+    // Поиск символа во всех загруженных библиотеках в порядке загрузки.
+    // Найденные адреса кэшируются.
+    void* findSymbol(const std::string& symbol);
+
+    // Библиотеки lib/<abi>/*.so, доступные в APK
+    std::vector<std::string> availableLibraries() const;
+
+    size_t loadedCount() const;
+    uint64_t loadedBytes() const;
+    std::string getLastError() const;
+
+    struct SharedFile;      // memfd с распакованной библиотекой
+
+private:
+    struct Library {
+        std::string file;     // libfoo.so
+        void* handle;
+        uint64_t size;
+        std::shared_ptr<const SharedFile> memfd;
+    };
+
+    bool loadFile(const std::string& file, std::vector<std::string>& loading);
+    std::shared_ptr<const SharedFile> extract(const std::string& file, const ZipEntry& entry);
+    void* open(const SharedFile& memfd, const std::string& file);
+
+    mutable std::mutex mutex;
+    const ApkArchive* archive{nullptr};
+    std::string prefix;     // lib/<abi>/
+    bool share{true};
+    uint64_t namespace_key{0};      // Набор библиотек APK
+    bool has_namespace{false};
+    long namespace_id{0};           // Lmid_t, когда has_namespace
+    std::vector<Library> libraries;
+    std::unordered_map<std::string, void*> symbols;
+    uint64_t loaded_bytes{0};
+    std::string last_error;
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_NATIVE_LOADER_H
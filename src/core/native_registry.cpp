@@ -0,0 +1,159 @@
+#include "native_registry.h"
+
+namespace anexec {
+
+namespace {
+
+constexpr size_t INITIAL_INDEX_CAPACITY = 256;
+
+} // namespace
+
+NativeRegistry& NativeRegistry::instance() {
+    static NativeRegistry registry;
+    return registry;
+}
+
+NativeRegistry::Index::Index(size_t capacity)
+    : mask(capacity - 1), slots(new std::atomic<const Entry*>[capacity]) {
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+NativeRegistry::NativeRegistry() {
+    indexes.push_back(std::make_unique<Index>(INITIAL_INDEX_CAPACITY));
+    index.store(indexes.back().get(), std::memory_order_release);
+}
+
+NativeRegistry::MethodId NativeRegistry::intern(std::string_view name) {
+    const uint64_t hash = hashName(name);
+    const MethodId existing = find(name, hash);
+    if (existing != INVALID_METHOD) {
+        return existing;
+    }
+    std::lock_guard<std::mutex> lock(write_mutex);
+    return internLocked(name, hash);
+}
+
+NativeRegistry::MethodId NativeRegistry::find(std::string_view name, uint64_t hash) const {
+    const Index* current = index.load(std::memory_order_acquire);
+    for (size_t i = hash & current->mask;; i = (i + 1) & current->mask) {
+        const Entry* entry = current->slots[i].load(std::memory_order_acquire);
+        if (!entry) {
+            return INVALID_METHOD;
+        }
+        if (entry->hash == hash && entry->name == name) {
+            return entry->id;
+        }
+    }
+}
+
+void* NativeRegistry::lookup(MethodId id) const {
+    if (id == INVALID_METHOD || id >= next_id.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return slot(id).load(std::memory_order_acquire);
+}
+
+NativeRegistry::MethodId NativeRegistry::registerNative(std::string_view name, void* function) {
+    if (name.empty()) {
+        return INVALID_METHOD;
+    }
+    std::lock_guard<std::mutex> lock(write_mutex);
+    const MethodId id = internLocked(name, hashName(name));
+    if (id != INVALID_METHOD) {
+        slot(id).store(function, std::memory_order_release);
+    }
+    return id;
+}
+
+bool NativeRegistry::registerNatives(std::string_view class_name, const NativeMethod* methods,
+                                     size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (!methods[i].name || !methods[i].name[0]) {
+            return false;
+        }
+    }
+
+    std::string name(class_name);
+    name += '.';
+    const size_t prefix = name.size();
+
+    std::lock_guard<std::mutex> lock(write_mutex);
+    for (size_t i = 0; i < count; ++i) {
+        name.resize(prefix);
+        name += methods[i].name;
+        const MethodId id = internLocked(name, hashName(name));
+        if (id == INVALID_METHOD) {
+            return false;
+        }
+        slot(id).store(methods[i].function, std::memory_order_release);
+    }
+    return true;
+}
+
+void NativeRegistry::unregisterNatives(std::string_view class_name) {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    for (const auto& entry : entries) {
+        const std::string_view name = entry->name;
+        if (name.size() > class_name.size() && name[class_name.size()] == '.' &&
+            name.compare(0, class_name.size(), class_name) == 0) {
+            slot(entry->id).store(nullptr, std::memory_order_release);
+        }
+    }
+}
+
+NativeRegistry::MethodId NativeRegistry::internLocked(std::string_view name, uint64_t hash) {
+    const MethodId existing = find(name, hash);
+    if (existing != INVALID_METHOD) {
+        return existing;
+    }
+
+    const MethodId id = next_id.load(std::memory_order_relaxed);
+    const size_t chunk = id / CHUNK_SIZE;
+    if (chunk >= MAX_CHUNKS) {
+        return INVALID_METHOD;
+    }
+    if (!chunks[chunk].load(std::memory_order_relaxed)) {
+        chunk_storage.push_back(std::make_unique<Chunk>());
+        for (auto& function : chunk_storage.back()->functions) {
+            function.store(nullptr, std::memory_order_relaxed);
+        }
+        chunks[chunk].store(chunk_storage.back().get(), std::memory_order_release);
+    }
+
+    entries.push_back(std::make_unique<Entry>(Entry{hash, id, std::string(name)}));
+    const Entry* entry = entries.back().get();
+
+    // Past half full the index is rebuilt at twice the size and swapped in;
+    // readers still walking the old one find everything that was there
+    const Index* current = index.load(std::memory_order_relaxed);
+    if (entries.size() * 2 > current->mask + 1) {
+        auto grown = std::make_unique<Index>((current->mask + 1) * 2);
+        for (const auto& existing_entry : entries) {
+            insert(*grown, existing_entry.get());
+        }
+        index.store(grown.get(), std::memory_order_release);
+        indexes.push_back(std::move(grown));
+    } else {
+        insert(*indexes.back(), entry);
+    }
+
+    next_id.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+void NativeRegistry::insert(Index& target, const Entry* entry) {
+    size_t i = entry->hash & target.mask;
+    while (target.slots[i].load(std::memory_order_relaxed)) {
+        i = (i + 1) & target.mask;
+    }
+    target.slots[i].store(entry, std::memory_order_release);
+}
+
+std::atomic<void*>& NativeRegistry::slot(MethodId id) const {
+    Chunk* chunk = chunks[id / CHUNK_SIZE].load(std::memory_order_acquire);
+    return chunk->functions[id % CHUNK_SIZE];
+}
+
+} // namespace anexec
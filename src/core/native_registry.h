@@ -0,0 +1,111 @@
+#ifndef ANEXEC_NATIVE_REGISTRY_H
+#define ANEXEC_NATIVE_REGISTRY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "hash.h"
+
+namespace anexec {
+
+// Нативный метод для пакетной регистрации, как JNINativeMethod
+struct NativeMethod {
+    const char* name;     // Имя метода внутри класса
+    void* function;
+};
+
+// Реестр нативных методов процесса. Имя "пакет.Класс.метод" один раз
+// превращается в числовой идентификатор (при линковке вызова), дальше
+// вызов находит функцию по идентификатору за две атомарные загрузки.
+// Чтение не берет блокировок: слоты функций никогда не перемещаются, а
+// индекс имен неизменяем после публикации и при росте заменяется копией.
+// Запись (регистрация) редкая и идет под мьютексом. После fork() (zygote)
+// дочерний процесс получает уже заполненный реестр.
+class NativeRegistry {
+public:
+    using MethodId = uint32_t;
+    static constexpr MethodId INVALID_METHOD = 0;
+
+    static NativeRegistry& instance();
+
+    NativeRegistry(const NativeRegistry&) = delete;
+    NativeRegistry& operator=(const NativeRegistry&) = delete;
+
+    // FNV-1a; constexpr, чтобы хеш известных имен считался при компиляции
+    static constexpr uint64_t hashName(std::string_view name) {
+        return fnv1a(name);
+    }
+
+    // Идентификатор имени; создается при первом запросе (функция пока nullptr)
+    MethodId intern(std::string_view name);
+
+    // Без блокировок; INVALID_METHOD, если имя не встречалось
+    MethodId find(std::string_view name) const { return find(name, hashName(name)); }
+    MethodId find(std::string_view name, uint64_t hash) const;
+
+    // Без блокировок; nullptr, если метод не зарегистрирован
+    void* lookup(MethodId id) const;
+    void* lookup(std::string_view name) const { return lookup(find(name)); }
+
+    // Регистрация или замена функции; возвращает идентификатор
+    MethodId registerNative(std::string_view name, void* function);
+
+    // Пакетная регистрация методов класса под одной блокировкой, как
+    // RegisterNatives в JNI. false - пустое имя (тогда ничего не
+    // зарегистрировано) или исчерпаны идентификаторы.
+    bool registerNatives(std::string_view class_name, const NativeMethod* methods, size_t count);
+
+    // Сброс функций класса в nullptr; идентификаторы остаются действительными
+    void unregisterNatives(std::string_view class_name);
+
+    size_t size() const { return next_id.load(std::memory_order_acquire) - 1; }
+
+private:
+    // Слоты функций: куски фиксированного размера, которые не перемещаются
+    static constexpr size_t CHUNK_SIZE = 1024;
+    static constexpr size_t MAX_CHUNKS = 1024;
+
+    struct Chunk {
+        std::atomic<void*> functions[CHUNK_SIZE];
+    };
+
+    struct Entry {
+        uint64_t hash;
+        MethodId id;
+        std::string name;
+    };
+
+    // Открытая адресация, не меньше половины слотов пусты
+    struct Index {
+        explicit Index(size_t capacity);
+        size_t mask;
+        std::unique_ptr<std::atomic<const Entry*>[]> slots;
+    };
+
+    NativeRegistry();
+
+    MethodId internLocked(std::string_view name, uint64_t hash);
+    static void insert(Index& index, const Entry* entry);
+    std::atomic<void*>& slot(MethodId id) const;
+
+    std::mutex write_mutex;
+    std::atomic<uint32_t> next_id{1};
+    std::atomic<Chunk*> chunks[MAX_CHUNKS] = {};
+    std::atomic<const Index*> index{nullptr};
+
+    // Владение: записи и прежние индексы живут до конца процесса, так
+    // читатель, взявший старый индекс, никогда не увидит освобожденную память
+    std::vector<std::unique_ptr<Entry>> entries;
+    std::vector<std::unique_ptr<Index>> indexes;
+    std::vector<std::unique_ptr<Chunk>> chunk_storage;
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_NATIVE_REGISTRY_H
@@ -0,0 +1,74 @@
+#include "resource_monitor.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+namespace anexec {
+
+ResourceMonitor& ResourceMonitor::instance() {
+    static ResourceMonitor monitor;
+    return monitor;
+}
+
+ResourceMonitor::ResourceMonitor() {
+    statm_fd = ::open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    long size = sysconf(_SC_PAGESIZE);
+    if (size > 0) {
+        page_size = static_cast<uint64_t>(size);
+    }
+    pthread_atfork(nullptr, nullptr, &ResourceMonitor::reopenAfterFork);
+}
+
+void ResourceMonitor::reopenAfterFork() {
+    ResourceMonitor& monitor = instance();
+    if (monitor.statm_fd >= 0) {
+        ::close(monitor.statm_fd);
+    }
+    monitor.statm_fd = ::open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+}
+
+ResourceMonitor::~ResourceMonitor() {
+    if (statm_fd >= 0) {
+        ::close(statm_fd);
+    }
+}
+
+ResourceMonitor::ProcessMemory ResourceMonitor::sampleProcessMemory() const {
+    ProcessMemory memory{0, 0};
+
+    // statm: "size resident shared text lib data dt" в страницах.
+    // pread с нулевого смещения перечитывает файл без повторного open.
+    if (statm_fd >= 0) {
+        char buf[128];
+        ssize_t n = pread(statm_fd, buf, sizeof(buf), 0);
+        const char* p = buf;
+        const char* end = buf + std::max<ssize_t>(n, 0);
+
+        // Пропускаем первое поле (size)
+        while (p < end && *p != ' ') {
+            ++p;
+        }
+        while (p < end && *p == ' ') {
+            ++p;
+        }
+
+        uint64_t pages = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            pages = pages * 10 + static_cast<uint64_t>(*p - '0');
+            ++p;
+        }
+        memory.resident = pages * page_size;
+    }
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        // ru_maxrss в килобайтах
+        memory.peak_resident = static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+    }
+    memory.peak_resident = std::max(memory.peak_resident, memory.resident);
+    return memory;
+}
+
+} // namespace anexec
@@ -0,0 +1,59 @@
+#ifndef ANEXEC_RESOURCE_MONITOR_H
+#define ANEXEC_RESOURCE_MONITOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace anexec {
+
+// Категории памяти, которые учитываются явно
+enum class MemoryCategory {
+    DexMaps,          // Отображения DEX
+    NativeLibs,       // Загруженные нативные библиотеки
+    GraphicsBuffers,  // Буферы и текстуры GL
+    Count
+};
+
+// Счетчики ресурсов процесса. Все методы потокобезопасны и не выделяют память,
+// поэтому их можно вызывать хоть 10 раз в секунду из любого потока.
+class ResourceMonitor {
+public:
+    struct ProcessMemory {
+        uint64_t resident;       // Текущий RSS
+        uint64_t peak_resident;  // Пиковый RSS
+    };
+
+    static ResourceMonitor& instance();
+
+    ResourceMonitor(const ResourceMonitor&) = delete;
+    ResourceMonitor& operator=(const ResourceMonitor&) = delete;
+
+    void add(MemoryCategory category, int64_t bytes) {
+        counters[static_cast<size_t>(category)].fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    uint64_t get(MemoryCategory category) const {
+        int64_t value = counters[static_cast<size_t>(category)].load(std::memory_order_relaxed);
+        return value > 0 ? static_cast<uint64_t>(value) : 0;
+    }
+
+    // RSS из /proc/self/statm (дескриптор открыт один раз) и пик из getrusage
+    ProcessMemory sampleProcessMemory() const;
+
+private:
+    ResourceMonitor();
+    ~ResourceMonitor();
+
+    // /proc/self при open() указывает на конкретный pid, поэтому после fork()
+    // (zygote) дочерний процесс открывает свой statm заново
+    static void reopenAfterFork();
+
+    int statm_fd{-1};
+    uint64_t page_size{4096};
+    std::atomic<int64_t> counters[static_cast<size_t>(MemoryCategory::Count)] = {};
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_RESOURCE_MONITOR_H
@@ -1,47 +1,105 @@
 #include "runtime.h"
+#include "aot_image.h"
+#include "apk_image.h"
+#include "class_linker.h"
+#include "heap.h"
+#include "interpreter.h"
+#include "native_registry.h"
+#include "trace.h"
 #include <chrono>
 #include <thread>
 #include <iostream>
-#include <sstream>
-#include <iomanip>
+#include <iterator>
+#include <algorithm>
 #include <ctime>
+#include <filesystem>
 
 namespace anexec {
 
-// Получение текущего времени в формате UTC
-std::string getCurrentUTCTime() {
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::gmtime(&time), "%Y-%m-%d %H:%M:%S");
-    return ss.str();
+namespace {
+
+// Текущее время UTC для журнала. Строка меняется раз в секунду, поэтому
+// форматируется заново только при смене секунды.
+const std::string& currentUTCTime() {
+    thread_local std::time_t cached_time = -1;
+    thread_local std::string cached;
+    const std::time_t time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    if (time != cached_time) {
+        std::tm tm{};
+        gmtime_r(&time, &tm);
+        char buffer[32];
+        cached.assign(buffer, std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm));
+        cached_time = time;
+    }
+    return cached;
+}
+
+// Базовые классы Android одинаковы для всех экземпляров Runtime в процессе:
+// загружаются один раз и дальше только читаются, как в zygote
+struct CoreClassSet {
+    std::vector<std::string> classes;
+};
+
+std::shared_ptr<const CoreClassSet> sharedCoreClasses() {
+    static const std::shared_ptr<const CoreClassSet> core = []() {
+        auto set = std::make_shared<CoreClassSet>();
+        set->classes = {
+            "android.app.Activity",
+            "android.content.Context",
+            "android.os.Bundle",
+            "android.view.View"
+        };
+        // Здесь будет реальная загрузка классов
+        return set;
+    }();
+    return core;
 }
 
+} // namespace
+
 class Runtime::Impl {
 private:
     RuntimeConfig config;
     RuntimeState state;
     std::string user;
     std::chrono::system_clock::time_point start_time;
-    std::vector<std::string> loaded_classes;
-    std::unordered_map<std::string, void*> native_methods;
+    std::shared_ptr<const CoreClassSet> core_classes;
+
+    // Классы приложения создаются линкером при первом обращении и
+    // исполняются интерпретатором; объекты лежат в heap
+    std::shared_ptr<const ApkImage> image;
+    std::shared_ptr<const AotImage> aot;    // Общий для всех приложений процесса
+    std::unique_ptr<Heap> heap;
+    std::unique_ptr<ClassLinker> linker;
+    std::unique_ptr<Interpreter> interpreter;
+    std::vector<std::string> unresolved_classes;   // Без образа DEX
+    std::vector<NativeRegistry::MethodId> native_methods;   // Зарегистрированные этим Runtime
     EventCallback event_callback;
 
     void log(const std::string& message) {
         if (event_callback) {
-            std::stringstream ss;
-            ss << "[" << getCurrentUTCTime() << "] " << message;
-            event_callback(ss.str());
+            const std::string& time = currentUTCTime();
+            std::string line;
+            line.reserve(time.size() + message.size() + 3);
+            line += '[';
+            line += time;
+            line += "] ";
+            line += message;
+            event_callback(line);
         }
     }
 
     bool initializeVM() {
+        TraceScope trace(TraceEvent::RuntimeInit);
         log("Initializing Android Runtime");
         
         // Настройка окружения
         std::string bootclasspath = config.system_dir + "/framework/";
         std::string libpath = config.system_dir + "/lib/";
 
+        // Образ отображается до fork() шаблона, поэтому его страницы общие
+        openAotImage(bootclasspath);
+
         // Загрузка базовых классов Android
         if (!loadCoreClasses()) {
             return false;
@@ -55,59 +113,141 @@ private:
         return true;
     }
 
-    bool loadCoreClasses() {
-        const std::vector<std::string> core_classes = {
-            "android.app.Activity",
-            "android.content.Context",
-            "android.os.Bundle",
-            "android.view.View"
-        };
-
-        for (const auto& class_name : core_classes) {
-            if (!loadClass(class_name)) {
-                log("Failed to load core class: " + class_name);
-                return false;
+    // Без образа классы платформы остаются заглушками, а код интерпретируется
+    void openAotImage(const std::string& bootclasspath) {
+        TraceScope trace(TraceEvent::AotImageMap);
+        std::string path = config.aot_image;
+        if (path.empty()) {
+            path = bootclasspath + AotImage::DEFAULT_NAME;
+            std::error_code ec;
+            if (!std::filesystem::exists(path, ec)) {
+                return;
             }
         }
+        std::string error;
+        aot = AotImage::open(path, error);
+        if (!aot) {
+            log("AOT image is not used: " + error);
+            return;
+        }
+        log("Mapped AOT image " + path + ": " + std::to_string(aot->dexCount()) + " DEX, " +
+            std::to_string(aot->methodCount()) + " methods" + (aot->hasCode() ? "" : ", no native code"));
+    }
 
+    bool loadCoreClasses() {
+        core_classes = sharedCoreClasses();
+        if (!core_classes) {
+            log("Failed to load core classes");
+            return false;
+        }
+        log("Using shared core classes: " + std::to_string(core_classes->classes.size()));
         return true;
     }
 
+    bool isCoreClass(const std::string& class_name) const {
+        if (!core_classes) {
+            return false;
+        }
+        const auto& classes = core_classes->classes;
+        return std::find(classes.begin(), classes.end(), class_name) != classes.end();
+    }
+
     bool loadClass(const std::string& class_name) {
-        log("Loading class: " + class_name);
-        
-        try {
-            // Здесь будет реальная загрузка класса
-            loaded_classes.push_back(class_name);
+        if (isCoreClass(class_name)) {
             return true;
-        } catch (const std::exception& e) {
-            log("Error loading class: " + std::string(e.what()));
+        }
+        if (!image) {
+            // Проверить негде: запоминаем как есть
+            unresolved_classes.push_back(class_name);
+            return true;
+        }
+        if (!findAppClass(class_name)) {
+            log("Class not found: " + class_name);
             return false;
         }
+        if (config.debug_mode) {
+            log("Loaded class " + class_name);
+        }
+        return true;
     }
 
-    bool registerNativeMethods() {
-        // Регистрация базовых нативных методов Android
-        const std::vector<std::pair<std::string, void*>> native_funcs = {
-            {"android.os.SystemClock.nativeCurrentTimeMillis", nullptr},
-            {"android.os.SystemClock.nativeElapsedRealtime", nullptr},
-            {"android.graphics.Canvas.nativeCreate", nullptr},
-            {"android.view.Surface.nativeCreateFromSurfaceTexture", nullptr}
-        };
+    Class* findAppClass(const std::string& class_name) {
+        if (!linker) {
+            return nullptr;
+        }
+        return linker->findClass(ClassIndex::toDescriptor(class_name));
+    }
 
-        for (const auto& [name, func] : native_funcs) {
-            if (!registerNativeMethod(name, func)) {
-                log("Failed to register native method: " + name);
-                return false;
-            }
+    void releaseVM() {
+        interpreter.reset();
+        linker.reset();
+        heap.reset();
+    }
+
+    // Вызов метода жизненного цикла, если приложение его переопределило.
+    // Реализации платформы - заглушки, их вызывать незачем.
+    bool callLifecycle(Class* klass, ObjectRef activity, const char* name, const char* signature,
+                       const uint32_t* args, size_t count) {
+        Method* declared = linker->findMethod(klass, name, signature);
+        Method* method = declared ? linker->findImplementation(klass, declared) : nullptr;
+        if (!method || method->stub) {
+            return true;
+        }
+        if (config.debug_mode) {
+            log(std::string("Calling ") + name + signature);
+        }
+        // Номера строк Tracer постоянны: метод берет свой один раз
+        if (Tracer::enabled() && method->trace_name == 0) {
+            method->trace_name = Tracer::instance().intern(name);
         }
+        TraceScope trace(TraceEvent::LifecycleCall, method->trace_name);
+        std::vector<uint32_t> words(count + 1);
+        words[0] = activity;
+        std::copy(args, args + count, words.begin() + 1);
+        if (interpreter->invoke(method, words.data(), words.size())) {
+            return true;
+        }
+        reportException(name);
+        return false;
+    }
 
-        return true;
+    void reportException(const char* where) {
+        const ObjectRef exception = interpreter->getException();
+        const Object* object = heap->object(exception);
+        std::string descriptor = object && object->klass ? std::string(object->klass->descriptor) : "unknown";
+        log(std::string("Uncaught exception in ") + where + ": " + descriptor);
+        interpreter->clearException();
+    }
+
+    bool registerNativeMethods() {
+        // Регистрация базовых нативных методов Android, по классам
+        static const NativeMethod system_clock[] = {
+            {"nativeCurrentTimeMillis", nullptr},
+            {"nativeElapsedRealtime", nullptr}
+        };
+        static const NativeMethod canvas[] = {
+            {"nativeCreate", nullptr}
+        };
+        static const NativeMethod surface[] = {
+            {"nativeCreateFromSurfaceTexture", nullptr}
+        };
+
+        return registerNatives("android.os.SystemClock", system_clock, std::size(system_clock)) &&
+               registerNatives("android.graphics.Canvas", canvas, std::size(canvas)) &&
+               registerNatives("android.view.Surface", surface, std::size(surface));
     }
 
-    bool registerNativeMethod(const std::string& name, void* func) {
-        log("Registering native method: " + name);
-        native_methods[name] = func;
+    bool registerNatives(const std::string& class_name, const NativeMethod* methods, size_t count) {
+        log("Registering " + std::to_string(count) + " native methods of " + class_name);
+        NativeRegistry& registry = NativeRegistry::instance();
+        if (!registry.registerNatives(class_name, methods, count)) {
+            log("Failed to register native methods of " + class_name);
+            return false;
+        }
+        // Идентификаторы нужны для статистики, имя ищется один раз
+        for (size_t i = 0; i < count; ++i) {
+            native_methods.push_back(registry.find(class_name + "." + methods[i].name));
+        }
         return true;
     }
 
@@ -141,9 +281,9 @@ public:
         return state;
     }
 
-    Result startActivity(const std::string& activity_name, void* savedInstanceState) {
+    RuntimeResult startActivity(const std::string& activity_name, void* savedInstanceState) {
         if (state != RuntimeState::Ready) {
-            return Result::RuntimeError;
+            return RuntimeResult::RuntimeError;
         }
 
         log("Starting activity: " + activity_name);
@@ -151,27 +291,77 @@ public:
         try {
             // Загружаем класс активности
             if (!loadClass(activity_name)) {
-                return Result::ClassNotFound;
+                return RuntimeResult::ClassNotFound;
             }
 
-            // Создаем экземпляр активности
-            // Вызываем onCreate
-            // Вызываем onStart
-            // Вызываем onResume
+            if (Class* klass = findAppClass(activity_name)) {
+                const RuntimeResult result = runActivity(klass);
+                if (result != RuntimeResult::Success) {
+                    return result;
+                }
+            }
 
             state = RuntimeState::Running;
-            return Result::Success;
+            return RuntimeResult::Success;
 
         } catch (const std::exception& e) {
             log("Error starting activity: " + std::string(e.what()));
-            return Result::RuntimeError;
+            return RuntimeResult::RuntimeError;
         }
     }
 
+    // Экземпляр активности и onCreate/onStart/onResume. Bundle пока не
+    // передается: savedInstanceState - null, как при первом запуске
+    RuntimeResult runActivity(Class* klass) {
+        if (!interpreter->ensureInitialized(klass)) {
+            reportException("<clinit>");
+            return RuntimeResult::RuntimeError;
+        }
+        ObjectRef activity = linker->allocObject(klass);
+        if (activity == NULL_REF) {
+            log("Out of memory creating activity");
+            return RuntimeResult::OutOfMemory;
+        }
+        // Между вызовами сборщик может переместить активность
+        Heap::ScopedRoot root(*heap, activity);
+
+        const uint32_t no_bundle[] = {NULL_REF};
+        if (!callLifecycle(klass, activity, "<init>", "()V", nullptr, 0) ||
+            !callLifecycle(klass, activity, "onCreate", "(Landroid/os/Bundle;)V", no_bundle, 1) ||
+            !callLifecycle(klass, activity, "onStart", "()V", nullptr, 0) ||
+            !callLifecycle(klass, activity, "onResume", "()V", nullptr, 0)) {
+            return RuntimeResult::RuntimeError;
+        }
+        return RuntimeResult::Success;
+    }
+
     void setEventCallback(EventCallback callback) {
         event_callback = callback;
     }
 
+    void attachImage(std::shared_ptr<const ApkImage> new_image) {
+        releaseVM();
+        unresolved_classes.clear();
+        if (!new_image) {
+            image.reset();
+            return;
+        }
+        image = AotImage::bind(aot, std::move(new_image));
+
+        heap = std::make_unique<Heap>();
+        if (!heap->reserve(config.heap_size)) {
+            log("Failed to reserve heap of " + std::to_string(config.heap_size) + " bytes");
+            releaseVM();
+            return;
+        }
+        linker = std::make_unique<ClassLinker>(*heap);
+        linker->attachImage(image);
+        interpreter = std::make_unique<Interpreter>(*linker);
+        if (config.enable_jit && !interpreter->enableJit()) {
+            log("JIT is not available, running interpreted only");
+        }
+    }
+
     RuntimeStats getStats() const {
         RuntimeStats stats;
         
@@ -179,8 +369,25 @@ public:
         stats.uptime = std::chrono::duration_cast<std::chrono::seconds>
                       (now - start_time);
         
-        stats.loaded_classes_count = loaded_classes.size();
+        stats.loaded_classes_count = (linker ? linker->loadedClasses() : 0) + unresolved_classes.size() +
+                                     (core_classes ? core_classes->classes.size() : 0);
+        stats.indexed_classes_count = image ? image->class_index.size() : 0;
         stats.native_methods_count = native_methods.size();
+        stats.jit_compiled_methods = interpreter ? interpreter->getJitStats().compiled_methods : 0;
+        const InterpreterStats interpreter_stats = interpreter ? interpreter->getStats() : InterpreterStats{};
+        stats.aot_methods = interpreter_stats.aot_methods;
+        stats.preinitialized_classes = interpreter_stats.preinitialized_classes;
+        const HeapStats heap_stats = heap ? heap->getStats() : HeapStats{};
+        stats.heap_used = heap ? heap->used() : 0;
+        stats.heap_capacity = heap ? heap->capacity() : 0;
+        stats.allocation_rate = heap_stats.allocation_rate;
+        stats.gc_young_collections = heap_stats.young_collections;
+        stats.gc_concurrent_cycles = heap_stats.concurrent_cycles;
+        stats.gc_full_collections = heap_stats.full_collections;
+        stats.gc_max_pause_us = heap_stats.max_pause_us;
+        stats.gc_max_young_pause_us = heap_stats.max_young_pause_us;
+        stats.gc_max_full_pause_us = heap_stats.max_full_pause_us;
+        stats.gc_total_pause_us = heap_stats.total_pause_us;
         stats.current_state = state;
         stats.start_time = start_time;
         stats.user = user;
@@ -193,7 +400,11 @@ public:
             log("Shutting down runtime");
             
             // Очищаем ресурсы
-            loaded_classes.clear();
+            core_classes.reset();
+            releaseVM();
+            unresolved_classes.clear();
+            image.reset();
+            aot.reset();
             native_methods.clear();
 
             state = RuntimeState::Stopped;
@@ -213,10 +424,14 @@ RuntimeState Runtime::getState() const {
     return impl->getState();
 }
 
-Result Runtime::startActivity(const std::string& activity_name, void* savedInstanceState) {
+RuntimeResult Runtime::startActivity(const std::string& activity_name, void* savedInstanceState) {
     return impl->startActivity(activity_name, savedInstanceState);
 }
 
+void Runtime::attachImage(std::shared_ptr<const ApkImage> image) {
+    impl->attachImage(std::move(image));
+}
+
 void Runtime::setEventCallback(EventCallback callback) {
     impl->setEventCallback(callback);
 }
@@ -7,10 +7,13 @@
 #include <functional>
 #include <unordered_map>
 #include <chrono>
+#include <cstdint>
 
 namespace anexec {
 
-enum class Result {
+struct ApkImage;
+
+enum class RuntimeResult {
     Success,
     RuntimeError,
     ClassNotFound,
@@ -32,13 +35,29 @@ struct RuntimeConfig {
     std::string data_dir;          // Путь к данным приложения
     size_t heap_size{256 * 1024 * 1024}; // Размер кучи (256MB по умолчанию)
     bool debug_mode{false};        // Режим отладки
+    bool enable_jit{true};         // JIT для горячих методов (только x86_64)
+    std::string aot_image;         // Образ AOT; пусто - framework/boot.oat, если он есть
     std::vector<std::string> classpath; // Дополнительные пути для классов
 };
 
 struct RuntimeStats {
     std::chrono::seconds uptime;   // Время работы
     size_t loaded_classes_count;    // Количество загруженных классов
+    size_t indexed_classes_count;   // Классов в индексе DEX приложения
     size_t native_methods_count;    // Количество нативных методов
+    size_t jit_compiled_methods;    // Скомпилировано JIT
+    size_t aot_methods;             // Методов с кодом из образа AOT
+    size_t preinitialized_classes;  // Классов со статическими полями из образа
+    size_t heap_used;               // Занято в управляемой куче
+    size_t heap_capacity;
+    uint64_t allocation_rate;       // Байт в секунду
+    uint64_t gc_young_collections;
+    uint64_t gc_concurrent_cycles;  // Циклов старого поколения
+    uint64_t gc_full_collections;
+    uint64_t gc_max_pause_us;       // Самая долгая пауза приложения
+    uint64_t gc_max_young_pause_us; // Самая долгая пауза молодой сборки
+    uint64_t gc_max_full_pause_us;  // Самая долгая полная сборка
+    uint64_t gc_total_pause_us;
     RuntimeState current_state;     // Текущее состояние
     std::chrono::system_clock::time_point start_time; // Время запуска
     std::string user;              // Текущий пользователь
@@ -57,7 +76,12 @@ public:
 
     bool initialize(const RuntimeConfig& config);
     RuntimeState getState() const;
-    Result startActivity(const std::string& activity_name, void* savedInstanceState = nullptr);
+    // DEX приложения: классы ищутся по индексу образа и создаются при
+    // первом обращении. Без образа классы приложения не проверяются.
+    // Куча размером heap_size создается заново для каждого образа.
+    void attachImage(std::shared_ptr<const ApkImage> image);
+    // Создает активность и выполняет ее onCreate/onStart/onResume
+    RuntimeResult startActivity(const std::string& activity_name, void* savedInstanceState = nullptr);
     void setEventCallback(EventCallback callback);
     RuntimeStats getStats() const;
     void shutdown();
@@ -0,0 +1,70 @@
+#ifndef ANEXEC_SEQLOCK_H
+#define ANEXEC_SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace anexec {
+
+// Значение с одним писателем и читателями без блокировок.
+// Данные хранятся атомарными словами, поэтому чтение во время записи
+// не является гонкой: читатель просто повторит попытку.
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SeqLock requires a trivially copyable type");
+
+public:
+    SeqLock() {
+        store(T{});
+    }
+
+    // Только один писатель одновременно
+    void store(const T& value) {
+        uint64_t buffer[WORDS] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+
+        const uint64_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        uint64_t buffer[WORDS];
+        uint64_t before;
+        uint64_t after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < WORDS; ++i) {
+                buffer[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+
+        T value;
+        std::memcpy(&value, buffer, sizeof(T));
+        return value;
+    }
+
+    // Номер версии: меняется при каждой записи
+    uint64_t version() const {
+        return sequence.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> words[WORDS];
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_SEQLOCK_H
@@ -0,0 +1,192 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace anexec {
+
+namespace {
+
+// Пул и номер рабочего потока, в котором мы находимся
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_index = 0;
+
+constexpr size_t NOT_A_WORKER = static_cast<size_t>(-1);
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    queues.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([this, i]() {
+            workerLoop(i);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    sleep_cv.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+size_t ThreadPool::currentWorker() const {
+    return current_pool == this ? current_index : NOT_A_WORKER;
+}
+
+void ThreadPool::submit(Task task) {
+    size_t index = currentWorker();
+    if (index == NOT_A_WORKER) {
+        index = next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    }
+
+    pending.fetch_add(1, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+
+    // Счетчик увеличен до захвата мьютекса, поэтому пробуждение не потеряется
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+    }
+    sleep_cv.notify_one();
+}
+
+bool ThreadPool::popTask(size_t index, Task& task) {
+    WorkQueue& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    pending.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool ThreadPool::stealTask(size_t thief, Task& task) {
+    const size_t count = queues.size();
+    const size_t start = thief == NOT_A_WORKER ? 0 : thief + 1;
+    for (size_t i = 0; i < count; ++i) {
+        const size_t victim = (start + i) % count;
+        if (victim == thief) {
+            continue;
+        }
+
+        WorkQueue& queue = *queues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::runPendingTask() {
+    if (pending.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+
+    const size_t index = currentWorker();
+    Task task;
+    if ((index != NOT_A_WORKER && popTask(index, task)) || stealTask(index, task)) {
+        task();
+        return true;
+    }
+    return false;
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    current_pool = this;
+    current_index = index;
+
+    while (true) {
+        Task task;
+        if (popTask(index, task) || stealTask(index, task)) {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        sleep_cv.wait(lock, [this]() {
+            return stopping || pending.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping && pending.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+
+void TaskGroup::run(ThreadPool::Task task) {
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->tasks.push_back(std::move(task));
+        ++state->pending;
+    }
+    // Задачу может забрать wait(); тогда исполнитель найдет очередь пустой
+    state->cv.notify_all();
+    pool.submit([state = state]() {
+        runOne(*state);
+    });
+}
+
+bool TaskGroup::runOne(State& state) {
+    ThreadPool::Task task;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.tasks.empty()) {
+            return false;
+        }
+        task = std::move(state.tasks.front());
+        state.tasks.pop_front();
+    }
+    task();
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        --state.pending;
+    }
+    state.cv.notify_all();
+    return true;
+}
+
+void TaskGroup::wait() {
+    while (true) {
+        if (runOne(*state)) {
+            continue;
+        }
+
+        // Оставшиеся задачи выполняются в пуле; ждем их или новых задач группы
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->cv.wait(lock, [this]() {
+            return state->pending == 0 || !state->tasks.empty();
+        });
+        if (state->pending == 0) {
+            return;
+        }
+    }
+}
+
+} // namespace anexec
@@ -0,0 +1,100 @@
+#ifndef ANEXEC_THREAD_POOL_H
+#define ANEXEC_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace anexec {
+
+// Пул рабочих потоков фиксированного размера с кражей задач.
+// У каждого потока своя очередь: свои задачи он берет с конца (LIFO),
+// а простаивающие потоки забирают чужие с начала (FIFO).
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    // 0 - по числу ядер
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    // Запрещаем копирование
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Из рабочего потока задача попадает в его очередь, иначе - по кругу
+    void submit(Task task);
+    size_t size() const { return workers.size(); }
+
+    // Выполнить одну задачу из очереди в текущем потоке.
+    // Нужно, чтобы ожидание внутри задачи пула не приводило к взаимной блокировке.
+    bool runPendingTask();
+
+    // Общий пул процесса
+    static ThreadPool& shared();
+
+private:
+    struct WorkQueue {
+        std::deque<Task> tasks;
+        std::mutex mutex;
+    };
+
+    void workerLoop(size_t index);
+    bool popTask(size_t index, Task& task);
+    bool stealTask(size_t thief, Task& task);
+    size_t currentWorker() const;
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> next_queue{0};
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cv;
+    bool stopping{false};
+};
+
+// Группа задач с ожиданием завершения.
+// Задачи группы лежат в ее собственной очереди, а в пул уходят только
+// исполнители, забирающие их оттуда. Ожидающий поток выполняет задачи
+// своей группы и никогда - чужие: иначе посторонняя задача, запущенная
+// поверх ожидания, могла бы ждать результата этого же потока.
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool) : pool(pool), state(std::make_shared<State>()) {}
+    ~TaskGroup() { wait(); }
+
+    // Запрещаем копирование
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(ThreadPool::Task task);
+
+    // Ожидающий поток помогает выполнять задачи группы
+    void wait();
+
+private:
+    // Исполнители в очередях пула могут пережить группу, поэтому
+    // состояние разделяемое
+    struct State {
+        std::deque<ThreadPool::Task> tasks;
+        size_t pending{0};          // Поставленные, но не завершенные задачи
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+
+    // Выполнить одну задачу группы; false - очередь пуста
+    static bool runOne(State& state);
+
+    ThreadPool& pool;
+    std::shared_ptr<State> state;
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_THREAD_POOL_H
@@ -0,0 +1,73 @@
+#ifndef ANEXEC_TOKEN_BUCKET_H
+#define ANEXEC_TOKEN_BUCKET_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace anexec {
+
+// Корзина токенов без блокировок (GCRA): состояние - одно атомарное
+// "теоретическое время прихода", вызов двигает его на интервал одним CAS.
+// Время монотонное (steady_clock), перевод системных часов не влияет.
+class TokenBucket {
+public:
+    // Без ограничения, пока не вызван configure
+    TokenBucket() = default;
+    TokenBucket(uint32_t rate, uint32_t burst) { configure(rate, burst); }
+
+    TokenBucket(const TokenBucket&) = delete;
+    TokenBucket& operator=(const TokenBucket&) = delete;
+
+    // rate - вызовов в секунду (0 - без ограничения), burst - сколько
+    // вызовов подряд допускается после простоя (не меньше одного)
+    void configure(uint32_t rate, uint32_t burst) {
+        const int64_t step = rate ? NANOS_PER_SECOND / rate : 0;
+        tolerance.store(step * (std::max<uint32_t>(burst, 1) - 1), std::memory_order_relaxed);
+        interval.store(step, std::memory_order_relaxed);
+    }
+
+    bool tryAcquire() { return tryAcquire(now()); }
+
+    bool tryAcquire(int64_t now_ns) {
+        const int64_t step = interval.load(std::memory_order_relaxed);
+        if (step == 0) {
+            return true;
+        }
+        const int64_t limit = tolerance.load(std::memory_order_relaxed);
+
+        int64_t current = arrival.load(std::memory_order_relaxed);
+        for (;;) {
+            const int64_t base = std::max(current, now_ns);
+            if (base - now_ns > limit) {
+                rejected_calls.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            if (arrival.compare_exchange_weak(current, base + step, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+
+    // Сколько вызовов отклонено с момента создания
+    uint64_t rejected() const { return rejected_calls.load(std::memory_order_relaxed); }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    static constexpr int64_t NANOS_PER_SECOND = 1000000000;
+
+    // Своя линия кэша: корзины разных методов не мешают друг другу
+    alignas(64) std::atomic<int64_t> arrival{0};
+    std::atomic<int64_t> interval{0};
+    std::atomic<int64_t> tolerance{0};
+    std::atomic<uint64_t> rejected_calls{0};
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_TOKEN_BUCKET_H
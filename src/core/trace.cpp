@@ -0,0 +1,367 @@
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace anexec {
+
+namespace {
+
+// Метка события: TSC там, где он есть (постоянной частоты на современных
+// x86), иначе steady_clock. В наносекунды переводится при снимке.
+inline uint64_t readTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+uint64_t steadyNanos() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+size_t roundUp(size_t value) {
+    size_t result = 16;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+// Частота TSC оценивается по интервалу от start(); короче этого
+// интервала оценка слишком грубая
+constexpr uint64_t MIN_CALIBRATION_NS = 1000000;
+
+void appendJsonString(std::string& out, std::string_view value) {
+    out += '"';
+    for (char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
+std::atomic<bool> Tracer::enabled_{false};
+
+// Кольцо одного потока. Записи хранятся атомарными словами, как в SeqLock,
+// поэтому снимок во время записи не гонка. reserved растет до записи слов,
+// committed - после: снимок копирует записи до committed и отбрасывает те,
+// что писатель мог начать затирать за время копирования.
+struct Tracer::ThreadBuffer {
+    static constexpr size_t WORDS = 3;  // Метка, arg, событие с фазой и name
+
+    ThreadBuffer(size_t capacity, uint32_t id)
+        : mask(capacity - 1), words(new std::atomic<uint64_t>[capacity * WORDS]), id(id) {}
+
+    // Только поток-владелец
+    void push(uint64_t ticks, uint64_t arg, uint64_t packed) {
+        const uint64_t index = reserved.load(std::memory_order_relaxed);
+        reserved.store(index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::atomic<uint64_t>* slot = &words[(index & mask) * WORDS];
+        slot[0].store(ticks, std::memory_order_relaxed);
+        slot[1].store(arg, std::memory_order_relaxed);
+        slot[2].store(packed, std::memory_order_relaxed);
+        committed.store(index + 1, std::memory_order_release);
+    }
+
+    uint64_t capacity() const { return mask + 1; }
+
+    const size_t mask;
+    const std::unique_ptr<std::atomic<uint64_t>[]> words;
+    const uint32_t id;
+    std::atomic<uint64_t> reserved{0};
+    std::atomic<uint64_t> committed{0};
+    std::atomic<uint64_t> begin{0};         // Первая запись текущей трассы
+    std::atomic<bool> retired{false};       // Поток завершился
+    std::string name;                       // Под Tracer::mutex
+};
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::Tracer() {
+    strings.emplace_back();
+}
+
+Tracer::~Tracer() = default;
+
+void Tracer::start(size_t events_per_thread) {
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer_events = roundUp(events_per_thread);
+    // Буферы завершившихся потоков больше не нужны: их события из прошлой трассы
+    buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+                                 [](const auto& buffer) {
+                                     return buffer->retired.load(std::memory_order_acquire);
+                                 }),
+                  buffers.end());
+    for (const auto& buffer : buffers) {
+        buffer->begin.store(buffer->committed.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+    start_ticks = readTicks();
+    start_nanos = steadyNanos();
+    enabled_.store(true, std::memory_order_release);
+}
+
+void Tracer::stop() {
+    enabled_.store(false, std::memory_order_release);
+}
+
+uint32_t Tracer::intern(std::string_view value) {
+    if (value.empty()) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = string_ids.find(value);
+    if (it != string_ids.end()) {
+        return it->second;
+    }
+    const auto id = static_cast<uint32_t>(strings.size());
+    strings.emplace_back(value);
+    string_ids.emplace(strings.back(), id);
+    return id;
+}
+
+std::string Tracer::lookup(uint32_t id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return id < strings.size() ? strings[id] : std::string();
+}
+
+void Tracer::setThreadName(std::string_view name) {
+    ThreadBuffer* buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer->name = std::string(name);
+}
+
+Tracer::ThreadBuffer* Tracer::threadBuffer() {
+    // Буфер переживает поток: его события нужны и после завершения
+    struct Slot {
+        ThreadBuffer* buffer{nullptr};
+        ~Slot() {
+            if (buffer) {
+                buffer->retired.store(true, std::memory_order_release);
+            }
+        }
+    };
+    thread_local Slot slot;
+    if (!slot.buffer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto buffer = std::make_unique<ThreadBuffer>(buffer_events, next_buffer_id++);
+        slot.buffer = buffer.get();
+        buffers.push_back(std::move(buffer));
+    }
+    return slot.buffer;
+}
+
+void Tracer::record(TraceEvent event, TracePhase phase, uint32_t name, uint64_t arg) {
+    const uint64_t packed = static_cast<uint64_t>(event) | static_cast<uint64_t>(phase) << 16 |
+                            static_cast<uint64_t>(name) << 32;
+    threadBuffer()->push(readTicks(), arg, packed);
+}
+
+std::vector<TraceEntry> Tracer::snapshot() const {
+    uint64_t now_nanos = steadyNanos();
+    std::unique_lock<std::mutex> lock(mutex);
+    if (now_nanos - start_nanos < MIN_CALIBRATION_NS) {
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::nanoseconds(MIN_CALIBRATION_NS));
+        lock.lock();
+    }
+    const uint64_t now_ticks = readTicks();
+    now_nanos = steadyNanos();
+    const long double nanos_per_tick = now_ticks > start_ticks
+        ? static_cast<long double>(now_nanos - start_nanos) / (now_ticks - start_ticks)
+        : 1.0L;
+
+    std::vector<TraceEntry> entries;
+    std::vector<uint64_t> copy;
+    for (const auto& buffer : buffers) {
+        const uint64_t capacity = buffer->capacity();
+        const uint64_t committed = buffer->committed.load(std::memory_order_acquire);
+        const uint64_t begin = std::max(buffer->begin.load(std::memory_order_relaxed),
+                                        committed > capacity ? committed - capacity : 0);
+        if (begin >= committed) {
+            continue;
+        }
+        copy.resize((committed - begin) * ThreadBuffer::WORDS);
+        for (uint64_t index = begin; index < committed; ++index) {
+            const std::atomic<uint64_t>* slot = &buffer->words[(index & buffer->mask) * ThreadBuffer::WORDS];
+            for (size_t w = 0; w < ThreadBuffer::WORDS; ++w) {
+                copy[(index - begin) * ThreadBuffer::WORDS + w] = slot[w].load(std::memory_order_relaxed);
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t reserved = buffer->reserved.load(std::memory_order_relaxed);
+        const uint64_t valid = std::max(begin, reserved > capacity ? reserved - capacity : 0);
+
+        for (uint64_t index = valid; index < committed; ++index) {
+            const uint64_t* words = &copy[(index - begin) * ThreadBuffer::WORDS];
+            if (words[0] < start_ticks || (words[2] & 0xffff) >= static_cast<uint64_t>(TraceEvent::Count)) {
+                continue;
+            }
+            TraceEntry entry;
+            entry.time_ns = static_cast<uint64_t>((words[0] - start_ticks) * nanos_per_tick);
+            entry.arg = words[1];
+            entry.thread = buffer->id;
+            entry.name = static_cast<uint32_t>(words[2] >> 32);
+            entry.event = static_cast<TraceEvent>(words[2] & 0xffff);
+            entry.phase = static_cast<TracePhase>((words[2] >> 16) & 0xff);
+            entries.push_back(entry);
+        }
+    }
+    lock.unlock();
+
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const TraceEntry& a, const TraceEntry& b) { return a.time_ns < b.time_ns; });
+    return entries;
+}
+
+TraceStats Tracer::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    TraceStats stats{};
+    for (const auto& buffer : buffers) {
+        const uint64_t recorded = buffer->committed.load(std::memory_order_acquire) -
+                                  buffer->begin.load(std::memory_order_relaxed);
+        stats.recorded_events += recorded;
+        stats.overwritten_events += recorded > buffer->capacity() ? recorded - buffer->capacity() : 0;
+    }
+    stats.threads = buffers.size();
+    return stats;
+}
+
+std::vector<uint64_t> Tracer::spanTotals() const {
+    std::vector<uint64_t> totals(static_cast<size_t>(TraceEvent::Count), 0);
+    // Начала открытых интервалов по потоку и событию; интервалы одного
+    // события в потоке вложены, поэтому стек
+    std::unordered_map<uint64_t, std::vector<uint64_t>> open;
+    for (const TraceEntry& entry : snapshot()) {
+        const uint64_t key = static_cast<uint64_t>(entry.thread) << 16 | static_cast<uint64_t>(entry.event);
+        if (entry.phase == TracePhase::Begin) {
+            open[key].push_back(entry.time_ns);
+        } else if (entry.phase == TracePhase::End) {
+            auto it = open.find(key);
+            if (it != open.end() && !it->second.empty()) {
+                totals[static_cast<size_t>(entry.event)] += entry.time_ns - it->second.back();
+                it->second.pop_back();
+            }
+        }
+    }
+    return totals;
+}
+
+void Tracer::eraseRetired(const std::vector<const ThreadBuffer*>& retired) {
+    buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+                                 [&](const auto& buffer) {
+                                     return std::find(retired.begin(), retired.end(), buffer.get()) !=
+                                            retired.end();
+                                 }),
+                  buffers.end());
+}
+
+bool Tracer::exportJson(const std::string& path, std::string* error) {
+    // Поток, завершившийся до снимка, больше не пишет: снимок содержит
+    // все его события, и после экспорта его буфер можно освободить
+    std::vector<const ThreadBuffer*> retired;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& buffer : buffers) {
+            if (buffer->retired.load(std::memory_order_acquire)) {
+                retired.push_back(buffer.get());
+            }
+        }
+    }
+    const std::vector<TraceEntry> entries = snapshot();
+    const std::string pid = std::to_string(getpid());
+
+    std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& buffer : buffers) {
+            out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid +
+                   ",\"tid\":" + std::to_string(buffer->id) + ",\"args\":{\"name\":";
+            appendJsonString(out, buffer->name.empty() ? "thread " + std::to_string(buffer->id) : buffer->name);
+            out += "}},\n";
+        }
+    }
+
+    char ts[32];
+    for (const TraceEntry& entry : entries) {
+        const TraceEventInfo& info = TRACE_EVENT_INFO[static_cast<size_t>(entry.event)];
+        static const char* const PHASES[] = {"B", "E", "i", "C"};
+        std::snprintf(ts, sizeof(ts), "%.3f", entry.time_ns / 1000.0);
+
+        out += "{\"name\":\"";
+        out += info.name;
+        out += "\",\"cat\":\"";
+        out += info.category;
+        out += "\",\"ph\":\"";
+        out += PHASES[static_cast<size_t>(entry.phase) & 3];
+        out += "\",\"ts\":";
+        out += ts;
+        out += ",\"pid\":" + pid + ",\"tid\":" + std::to_string(entry.thread);
+        if (entry.phase == TracePhase::Instant) {
+            out += ",\"s\":\"t\"";
+        }
+        out += ",\"args\":{";
+        bool first = true;
+        if (entry.name != 0) {
+            out += "\"name\":";
+            appendJsonString(out, lookup(entry.name));
+            first = false;
+        }
+        if (entry.arg != 0 || entry.phase == TracePhase::Counter) {
+            out += first ? "" : ",";
+            out += "\"value\":" + std::to_string(entry.arg);
+        }
+        out += "}},\n";
+    }
+    if (out.back() == '\n' && out[out.size() - 2] == ',') {
+        out.erase(out.size() - 2, 1);
+    }
+    out += "]}\n";
+
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        if (error) {
+            *error = "Failed to create " + path;
+        }
+        return false;
+    }
+    const bool ok = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+    if (std::fclose(file) != 0 || !ok) {
+        if (error) {
+            *error = "Failed to write " + path;
+        }
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    eraseRetired(retired);
+    return true;
+}
+
+} // namespace anexec
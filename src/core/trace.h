@@ -0,0 +1,223 @@
+#ifndef ANEXEC_TRACE_H
+#define ANEXEC_TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace anexec {
+
+// Номера событий известны при компиляции: в буфер пишется только номер,
+// имя и категория берутся из TRACE_EVENT_INFO при экспорте
+enum class TraceEvent : uint16_t {
+    ApkLoad,
+    ApkOpen,
+    ManifestParse,
+    DexMap,
+    ClassIndexBuild,
+    RuntimeInit,
+    AotImageMap,
+    ClassLoad,
+    LifecycleCall,
+    ApiCall,
+    RenderFrame,
+    FrameSkipped,
+    ActivityConstructed,
+    ActivityCreate,
+    ActivityStart,
+    ActivityResume,
+    ActivityPause,
+    ActivityStop,
+    ActivityDestroy,
+    ActivitySaveState,
+    ActivityRestoreState,
+    ActivityFocus,
+    ActivityLaunch,
+    ActivityFinish,
+    ActivityError,
+    Count
+};
+
+enum class TracePhase : uint8_t {
+    Begin,
+    End,
+    Instant,
+    Counter
+};
+
+struct TraceEventInfo {
+    const char* name;
+    const char* category;
+};
+
+inline constexpr TraceEventInfo TRACE_EVENT_INFO[] = {
+    {"loadApk", "executor"},
+    {"openApk", "executor"},
+    {"parseManifest", "executor"},
+    {"mapDex", "executor"},
+    {"buildClassIndex", "executor"},
+    {"initializeRuntime", "runtime"},
+    {"mapAotImage", "runtime"},
+    {"loadClass", "runtime"},
+    {"callLifecycle", "runtime"},
+    {"apiCall", "api"},
+    {"renderFrame", "renderer"},
+    {"frameSkipped", "renderer"},
+    {"constructed", "activity"},
+    {"onCreate", "activity"},
+    {"onStart", "activity"},
+    {"onResume", "activity"},
+    {"onPause", "activity"},
+    {"onStop", "activity"},
+    {"onDestroy", "activity"},
+    {"onSaveInstanceState", "activity"},
+    {"onRestoreInstanceState", "activity"},
+    {"onWindowFocusChanged", "activity"},
+    {"startActivity", "activity"},
+    {"finish", "activity"},
+    {"lifecycleError", "activity"},
+};
+
+static_assert(sizeof(TRACE_EVENT_INFO) / sizeof(TRACE_EVENT_INFO[0]) ==
+                  static_cast<size_t>(TraceEvent::Count),
+              "every trace event needs a name");
+
+// Событие из снимка буферов, время - от начала записи
+struct TraceEntry {
+    uint64_t time_ns;
+    uint64_t arg;
+    uint32_t thread;        // Номер буфера, не tid системы
+    uint32_t name;          // Строка из Tracer::intern, 0 - нет
+    TraceEvent event;
+    TracePhase phase;
+};
+
+struct TraceStats {
+    uint64_t recorded_events;   // С начала записи
+    uint64_t overwritten_events;    // Вытеснены из заполненных буферов
+    size_t threads;
+};
+
+// Двоичная трассировка: у каждого потока свое кольцо записей фиксированного
+// размера, писатель у кольца один, поэтому запись события - это метка TSC и
+// несколько обычных записей в память, без блокировок и выделений. Заполненное
+// кольцо перезаписывает старые события. Пока запись выключена, событие
+// стоит одну проверку флага. Снимок и экспорт (JSON Chrome, открывается в
+// Perfetto) можно делать во время записи: события, затертые за время
+// копирования, отбрасываются.
+class Tracer {
+public:
+    static constexpr size_t DEFAULT_BUFFER_EVENTS = 64 * 1024;
+
+    static Tracer& instance();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    static bool enabled() {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    // Начинает новую запись; events_per_thread - для потоков, у которых
+    // еще нет буфера (округляется до степени двойки)
+    void start(size_t events_per_thread = DEFAULT_BUFFER_EVENTS);
+    void stop();
+
+    // Номер строки для поля name событий. Под мьютексом, поэтому строки
+    // лучше получать заранее, а не на каждое событие.
+    uint32_t intern(std::string_view value);
+    std::string lookup(uint32_t id) const;
+
+    // Имя потока в экспорте; создает буфер потока
+    void setThreadName(std::string_view name);
+
+    // Медленный путь TraceScope/traceEvent, вызывается только при enabled()
+    void record(TraceEvent event, TracePhase phase, uint32_t name, uint64_t arg);
+
+    // События всех потоков текущей записи по времени
+    std::vector<TraceEntry> snapshot() const;
+    TraceStats getStats() const;
+
+    // Суммарная длительность интервалов каждого события в текущей записи,
+    // нс, индекс - TraceEvent. Незакрытые интервалы не учитываются.
+    std::vector<uint64_t> spanTotals() const;
+
+    // Формат Chrome trace (JSON), его читают chrome://tracing и Perfetto.
+    // После записи файла освобождает буферы потоков, завершившихся до
+    // экспорта: все их события уже в файле.
+    bool exportJson(const std::string& path, std::string* error = nullptr);
+
+private:
+    struct ThreadBuffer;
+
+    Tracer();
+    ~Tracer();
+
+    ThreadBuffer* threadBuffer();
+    // Удаляет буферы завершившихся потоков; под mutex
+    void eraseRetired(const std::vector<const ThreadBuffer*>& retired);
+
+    static std::atomic<bool> enabled_;
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    size_t buffer_events{DEFAULT_BUFFER_EVENTS};
+    uint32_t next_buffer_id{1};         // Номера не повторяются после удаления буферов
+    uint64_t start_ticks{0};
+    uint64_t start_nanos{0};
+    std::deque<std::string> strings;    // [id], 0 - пустая строка
+    std::unordered_map<std::string_view, uint32_t> string_ids;
+};
+
+// Событие без длительности; arg - число, name - строка из intern
+inline void traceEvent(TraceEvent event, uint64_t arg = 0, uint32_t name = 0) {
+    if (Tracer::enabled()) {
+        Tracer::instance().record(event, TracePhase::Instant, name, arg);
+    }
+}
+
+inline void traceCounter(TraceEvent event, uint64_t value) {
+    if (Tracer::enabled()) {
+        Tracer::instance().record(event, TracePhase::Counter, 0, value);
+    }
+}
+
+// Интервал от конструктора до деструктора. Если запись включили посреди
+// интервала, он не попадает в трассу.
+class TraceScope {
+public:
+    explicit TraceScope(TraceEvent event, uint32_t name = 0, uint64_t arg = 0)
+        : event(event), active(Tracer::enabled()) {
+        if (active) {
+            Tracer::instance().record(event, TracePhase::Begin, name, arg);
+        }
+    }
+
+    ~TraceScope() {
+        if (active) {
+            Tracer::instance().record(event, TracePhase::End, 0, end_arg);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    // Значение для события конца (например, число обработанных команд)
+    void setResult(uint64_t value) { end_arg = value; }
+
+private:
+    TraceEvent event;
+    bool active;
+    uint64_t end_arg{0};
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_TRACE_H
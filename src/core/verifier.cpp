@@ -0,0 +1,272 @@
+#include "verifier.h"
+#include "dex_instructions.h"
+#include <cstdlib>
+#include <vector>
+
+namespace anexec {
+
+namespace {
+
+// Чем начинается слово кода
+enum class Unit : uint8_t {
+    Inside,         // Операнд инструкции или данные
+    Instruction,
+    Payload         // Данные switch или fill-array-data
+};
+
+// Типы операндов унарных операций 0x7b-0x8f: результат, источник.
+// J и D занимают пару регистров.
+constexpr char UNARY_TYPES[21][3] = {
+    "II", "II", "JJ", "JJ", "FF", "DD",         // neg-int .. neg-double
+    "JI", "FI", "DI", "IJ", "FJ", "DJ",         // int-to-long .. long-to-double
+    "IF", "JF", "DF", "ID", "JD", "FD",         // float-to-int .. double-to-float
+    "II", "II", "II"                            // int-to-byte, -char, -short
+};
+
+bool isWide(char type) {
+    return type == 'J' || type == 'D';
+}
+
+// Размер данных в словах; 64 бита: у fill-array-data он может не
+// поместиться в 32
+uint64_t payloadSize(const uint16_t* insn, uint32_t available) {
+    if (available < 2) {
+        return UINT64_MAX;
+    }
+    switch (insn[0]) {
+        case PACKED_SWITCH_PAYLOAD:
+            return insn[1] * 2ull + 4;
+        case SPARSE_SWITCH_PAYLOAD:
+            return insn[1] * 4ull + 2;
+        case FILL_ARRAY_DATA_PAYLOAD:
+            if (available < 4) {
+                return UINT64_MAX;
+            }
+            return 4 + (uint64_t{static_cast<uint32_t>(read32(insn + 2))} * insn[1] + 1) / 2;
+        default:
+            return UINT64_MAX;
+    }
+}
+
+bool isPayload(uint16_t unit) {
+    return unit == PACKED_SWITCH_PAYLOAD || unit == SPARSE_SWITCH_PAYLOAD ||
+           unit == FILL_ARRAY_DATA_PAYLOAD;
+}
+
+// Регистровые операнды инструкции по ее формату
+bool checkRegisters(const uint16_t* insn, uint32_t registers) {
+    const uint16_t inst = insn[0];
+    const uint8_t opcode = inst & 0xff;
+    const uint32_t a = (inst >> 8) & 0x0f;
+    const uint32_t b = inst >> 12;
+    const uint32_t aa = inst >> 8;
+    // Второе слово есть не у всех инструкций: последняя может быть короткой
+    const uint16_t second = INSTRUCTION_WIDTH[opcode] > 1 ? insn[1] : 0;
+    const uint32_t bb = second & 0xff;
+    const uint32_t cc = second >> 8;
+    auto reg = [registers](uint32_t r) { return r < registers; };
+    auto wide = [registers](uint32_t r) { return r + 1 < registers; };
+    auto typed = [&](uint32_t r, bool is_wide) { return is_wide ? wide(r) : reg(r); };
+
+    switch (opcode) {
+        case 0x00: case 0x0e:                               // nop, return-void
+        case 0x28: case 0x29: case 0x2a:                    // goto
+            return true;
+        case 0x01: case 0x07: case 0x21:                    // move, move-object, array-length
+        case 0x20: case 0x23:                               // instance-of, new-array
+        case 0x32: case 0x33: case 0x34: case 0x35: case 0x36: case 0x37:   // if-test
+            return reg(a) && reg(b);
+        case 0x04:                                          // move-wide
+            return wide(a) && wide(b);
+        case 0x02: case 0x08:                               // move/from16
+            return reg(aa) && reg(second);
+        case 0x05:
+            return wide(aa) && wide(second);
+        case 0x03: case 0x09:                               // move/16
+            return reg(second) && reg(insn[2]);
+        case 0x06:
+            return wide(second) && wide(insn[2]);
+        case 0x0b: case 0x10:                               // move-result-wide, return-wide
+        case 0x16: case 0x17: case 0x18: case 0x19:         // const-wide
+            return wide(aa);
+        case 0x12:                                          // const/4
+            return reg(a);
+        case 0x24: case 0x6e: case 0x6f: case 0x70: case 0x71: case 0x72: {     // 35c
+            if (b > 5) {
+                return false;
+            }
+            for (uint32_t i = 0; i < b; ++i) {
+                if (!reg(i < 4 ? (insn[2] >> (i * 4)) & 0x0f : a)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case 0x25: case 0x74: case 0x75: case 0x76: case 0x77: case 0x78:       // 3rc
+            return uint32_t{insn[2]} + aa <= registers;
+        case 0x2d: case 0x2e:                               // cmp-float
+            return reg(aa) && reg(bb) && reg(cc);
+        case 0x2f: case 0x30: case 0x31:                    // cmp-double, cmp-long
+            return reg(aa) && wide(bb) && wide(cc);
+        default:
+            break;
+    }
+
+    if (opcode <= 0x2c || (opcode >= 0x38 && opcode <= 0x3d)) {
+        // Остальные форматы 11x, 21x, 31x с единственным регистром vAA
+        return reg(aa);
+    }
+    if (opcode >= 0x44 && opcode <= 0x51) {                 // aget/aput: значение, массив, индекс
+        return typed(aa, opcode == 0x45 || opcode == 0x4c) && reg(bb) && reg(cc);
+    }
+    if (opcode >= 0x52 && opcode <= 0x5f) {                 // iget/iput: значение, объект
+        return typed(a, opcode == 0x53 || opcode == 0x5a) && reg(b);
+    }
+    if (opcode >= 0x60 && opcode <= 0x6d) {                 // sget/sput
+        return typed(aa, opcode == 0x61 || opcode == 0x68);
+    }
+    if (opcode >= 0x7b && opcode <= 0x8f) {
+        const char* types = UNARY_TYPES[opcode - 0x7b];
+        return typed(a, isWide(types[0])) && typed(b, isWide(types[1]));
+    }
+    if (opcode >= 0x90 && opcode <= 0xaf) {                 // binop vAA, vBB, vCC
+        const bool is_long = opcode >= 0x9b && opcode <= 0xa5;
+        const bool is_double = opcode >= 0xab;
+        const bool shift = opcode >= 0xa3 && opcode <= 0xa5;   // Сдвиг long на int
+        return typed(aa, is_long || is_double) && typed(bb, is_long || is_double) &&
+               typed(cc, (is_long && !shift) || is_double);
+    }
+    if (opcode >= 0xb0 && opcode <= 0xcf) {                 // binop/2addr vA, vB
+        const bool is_long = opcode >= 0xbb && opcode <= 0xc5;
+        const bool is_double = opcode >= 0xcb;
+        const bool shift = opcode >= 0xc3 && opcode <= 0xc5;
+        return typed(a, is_long || is_double) && typed(b, (is_long && !shift) || is_double);
+    }
+    if (opcode >= 0xd0 && opcode <= 0xd7) {                 // lit16
+        return reg(a) && reg(b);
+    }
+    if (opcode >= 0xd8 && opcode <= 0xe2) {                 // lit8
+        return reg(aa) && reg(bb);
+    }
+    // Неиспользуемые опкоды, ускоренные варианты и invoke-polymorphic/custom
+    return false;
+}
+
+// Продолжается ли выполнение следующей инструкцией
+bool fallsThrough(uint8_t opcode) {
+    return !(opcode >= 0x0e && opcode <= 0x11) && opcode != 0x27 && !(opcode >= 0x28 && opcode <= 0x2a);
+}
+
+} // namespace
+
+bool verifyCode(const DexView& dex, const DexCodeItem* code) {
+    const uint16_t* insns = DexView::insns(code);
+    const uint32_t size = code->insns_size;
+    const uint32_t registers = code->registers_size;
+    if (size == 0 || code->ins_size > registers) {
+        return false;
+    }
+
+    // Границы инструкций и данных
+    std::vector<Unit> units(size, Unit::Inside);
+    for (uint32_t pc = 0; pc < size;) {
+        const uint8_t opcode = insns[pc] & 0xff;
+        uint64_t width = INSTRUCTION_WIDTH[opcode];
+        if (opcode == OP_NOP && isPayload(insns[pc])) {
+            width = payloadSize(insns + pc, size - pc);
+            units[pc] = Unit::Payload;
+        } else {
+            units[pc] = Unit::Instruction;
+        }
+        if (width > size - pc) {
+            return false;
+        }
+        pc += static_cast<uint32_t>(width);
+    }
+
+    auto isInstruction = [&](int64_t target) {
+        return target >= 0 && target < size && units[target] == Unit::Instruction;
+    };
+
+    for (uint32_t pc = 0; pc < size; ++pc) {
+        if (units[pc] != Unit::Instruction) {
+            continue;
+        }
+        const uint16_t* insn = insns + pc;
+        const uint8_t opcode = insn[0] & 0xff;
+        const uint32_t width = INSTRUCTION_WIDTH[opcode];
+        if (!checkRegisters(insn, registers)) {
+            return false;
+        }
+
+        int64_t branch = 0;
+        bool has_branch = true;
+        switch (opcode) {
+            case 0x28:
+                branch = static_cast<int8_t>(insn[0] >> 8);
+                break;
+            case 0x29:
+                branch = static_cast<int16_t>(insn[1]);
+                break;
+            case 0x2a:
+                branch = read32(insn + 1);
+                break;
+            default:
+                // if-test и if-testz
+                has_branch = opcode >= 0x32 && opcode <= 0x3d;
+                branch = has_branch ? static_cast<int16_t>(insn[1]) : 0;
+                break;
+        }
+        if (has_branch && !isInstruction(int64_t{pc} + branch)) {
+            return false;
+        }
+
+        // switch и fill-array-data: данные нужного типа, для switch - и ветви
+        if (opcode == 0x26 || opcode == 0x2b || opcode == 0x2c) {
+            const int64_t payload = int64_t{pc} + read32(insn + 1);
+            const uint16_t expected = opcode == 0x26 ? FILL_ARRAY_DATA_PAYLOAD
+                                    : opcode == 0x2b ? PACKED_SWITCH_PAYLOAD : SPARSE_SWITCH_PAYLOAD;
+            if (payload < 0 || payload >= size || units[payload] != Unit::Payload ||
+                insns[payload] != expected) {
+                return false;
+            }
+            const uint16_t* data = insns + payload;
+            const uint32_t count = data[1];
+            const uint16_t* targets = opcode == 0x2b ? data + 4 : data + 2 + count * 2;
+            for (uint32_t i = 0; opcode != 0x26 && i < count; ++i) {
+                if (!isInstruction(int64_t{pc} + read32(targets + i * 2))) {
+                    return false;
+                }
+            }
+        }
+
+        // Следующее слово должно быть инструкцией: ни конец кода, ни данные
+        if (fallsThrough(opcode) && !isInstruction(int64_t{pc} + width)) {
+            return false;
+        }
+    }
+
+    // Обработчики исключений
+    const uint64_t tries = dex.triesOffset(code);
+    const uint64_t handlers = tries + uint64_t{code->tries_size} * sizeof(DexTryItem);
+    for (uint32_t i = 0; i < code->tries_size; ++i) {
+        const uint64_t item = tries + uint64_t{i} * sizeof(DexTryItem);
+        uint64_t offset = handlers + dex.read16(item + 6);
+        const int32_t count = dex.readSleb128(offset);
+        if (count < -0xffff || count > 0xffff) {
+            return false;
+        }
+        for (int32_t h = 0; h < std::abs(count); ++h) {
+            dex.readUleb128(offset);    // type_idx
+            if (!isInstruction(dex.readUleb128(offset))) {
+                return false;
+            }
+        }
+        if (count <= 0 && !isInstruction(dex.readUleb128(offset))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace anexec
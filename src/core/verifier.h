@@ -0,0 +1,24 @@
+#ifndef ANEXEC_VERIFIER_H
+#define ANEXEC_VERIFIER_H
+
+#include "dex_file.h"
+
+namespace anexec {
+
+// Проверка байткода метода до первого выполнения. Обработчики
+// интерпретатора, JIT и AOT доверяют операндам: номер регистра не
+// сверяется с размером кадра, смещение перехода - с размером кода.
+// Поэтому код метода проверяется целиком один раз:
+//  - каждый регистр (у wide - и следующий за ним) меньше registers_size,
+//    аргументы помещаются в кадр;
+//  - переходы, ветви switch и обработчики исключений ведут на начало
+//    инструкции внутри insns, а switch и fill-array-data - на данные
+//    своего типа, целиком лежащие в insns;
+//  - выполнение не может уйти за конец кода или в данные;
+//  - опкодов, которых нет в DEX (в том числе ускоренных), в коде нет.
+// false - метод отвергнут, вызов должен бросить VerifyError.
+bool verifyCode(const DexView& dex, const DexCodeItem* code);
+
+} // namespace anexec
+
+#endif // ANEXEC_VERIFIER_H
@@ -0,0 +1,399 @@
+#include "zygote.h"
+#include "looper.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unordered_set>
+#include <vector>
+#include <csignal>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace anexec {
+
+namespace {
+
+// Протокол: одно сообщение SOCK_SEQPACKET на запрос и одно на ответ
+constexpr uint32_t ZYGOTE_MAGIC = 0x5a47584e;  // "NXGZ"
+constexpr uint16_t PROTOCOL_VERSION = 1;
+constexpr size_t MAX_MESSAGE = 8192;
+
+struct RequestHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t apk_length;
+    uint16_t activity_length;
+    uint16_t reserved;
+};
+
+struct ResponseHeader {
+    int32_t pid;            // -1 при ошибке, текст ошибки следом
+    uint32_t error_length;
+};
+
+bool makeAddress(const std::string& path, sockaddr_un& address, socklen_t& length) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+
+    // '@' в начале - абстрактное пространство имен: первый байт sun_path равен нулю
+    std::memcpy(address.sun_path, path.data(), path.size());
+    if (path[0] == '@') {
+        address.sun_path[0] = '\0';
+    }
+    length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size() +
+                                    (path[0] == '@' ? 0 : 1));
+    return true;
+}
+
+} // namespace
+
+class ZygoteServer::Impl {
+private:
+    Runtime runtime;
+    Looper looper;
+    std::string socket_path;
+    int listen_fd{-1};
+    int signal_fd{-1};
+    sigset_t saved_mask;
+    ChildMain child_main;
+    std::unordered_set<pid_t> children;
+    std::unordered_set<int> clients;    // Принятые соединения, ждущие запроса
+    std::string last_error;
+
+    bool parseRequest(const char* data, size_t size, ZygoteRequest& request) {
+        RequestHeader header;
+        if (size < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (header.magic != ZYGOTE_MAGIC || header.version != PROTOCOL_VERSION ||
+            sizeof(header) + header.apk_length + header.activity_length != size ||
+            header.apk_length == 0) {
+            return false;
+        }
+
+        const char* cursor = data + sizeof(header);
+        request.apk_path.assign(cursor, header.apk_length);
+        request.activity.assign(cursor + header.apk_length, header.activity_length);
+        return true;
+    }
+
+    void reply(int fd, pid_t pid, const std::string& error) {
+        std::vector<char> message(sizeof(ResponseHeader) + error.size());
+        ResponseHeader header{static_cast<int32_t>(pid), static_cast<uint32_t>(error.size())};
+        std::memcpy(message.data(), &header, sizeof(header));
+        std::memcpy(message.data() + sizeof(header), error.data(), error.size());
+        send(fd, message.data(), message.size(), MSG_NOSIGNAL);
+    }
+
+    void handleRequest(int fd) {
+        char buffer[MAX_MESSAGE];
+        ssize_t n;
+        do {
+            n = recv(fd, buffer, sizeof(buffer), 0);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+
+        looper.removeFd(fd);
+        clients.erase(fd);
+        ZygoteRequest request;
+        if (n <= 0 || !parseRequest(buffer, static_cast<size_t>(n), request)) {
+            reply(fd, -1, "Malformed request");
+            ::close(fd);
+            return;
+        }
+
+        std::string error;
+        const pid_t pid = spawn(request, error);
+        reply(fd, pid, error);
+        ::close(fd);
+    }
+
+    pid_t spawn(const ZygoteRequest& request, std::string& error) {
+        // Буферы stdio сбрасываем, иначе дочерний процесс напечатает их повторно
+        std::cout.flush();
+        std::cerr.flush();
+        std::fflush(nullptr);
+
+        const pid_t pid = fork();
+        if (pid < 0) {
+            error = "fork failed: " + std::string(std::strerror(errno));
+            return -1;
+        }
+        if (pid > 0) {
+            children.insert(pid);
+            return pid;
+        }
+
+        // Дочерний процесс: дескрипторы сервера и чужие соединения ему не
+        // нужны. Свое соединение остается открытым до выхода: клиент, который
+        // не закрыл его после ответа, увидит завершение процесса.
+        for (int fd : clients) {
+            ::close(fd);
+        }
+        clients.clear();
+        looper.closeAfterFork();
+        ::close(listen_fd);
+        ::close(signal_fd);
+        listen_fd = -1;
+        signal_fd = -1;
+        std::signal(SIGCHLD, SIG_DFL);
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        sigprocmask(SIG_SETMASK, &saved_mask, nullptr);
+
+        int code = 1;
+        try {
+            code = child_main(request, runtime);
+        } catch (const std::exception& e) {
+            std::cerr << "Zygote child failed: " << e.what() << std::endl;
+        }
+        // Деструкторы и atexit копии сервера не запускаем: они принадлежат
+        // родителю (сокет, прогретый Runtime). Поэтому stdio сбрасываем сами.
+        std::cout.flush();
+        std::cerr.flush();
+        std::fflush(nullptr);
+        _exit(code);
+    }
+
+    void acceptConnections() {
+        while (true) {
+            const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+            if (fd < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            clients.insert(fd);
+            looper.addFd(fd, EPOLLIN, [this](int ready_fd, uint32_t) {
+                handleRequest(ready_fd);
+            });
+        }
+    }
+
+    void handleSignals() {
+        signalfd_siginfo info;
+        while (::read(signal_fd, &info, sizeof(info)) == static_cast<ssize_t>(sizeof(info))) {
+            if (info.ssi_signo == SIGINT || info.ssi_signo == SIGTERM) {
+                looper.quit();
+            }
+        }
+
+        // Несколько SIGCHLD сливаются в один, поэтому собираем всех завершившихся
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            children.erase(pid);
+        }
+    }
+
+public:
+    Impl() {
+        sigemptyset(&saved_mask);
+    }
+
+    ~Impl() {
+        if (listen_fd >= 0) {
+            ::close(listen_fd);
+            if (socket_path[0] != '@') {
+                unlink(socket_path.c_str());
+            }
+        }
+    }
+
+    bool start(const std::string& path, const RuntimeConfig& config) {
+        // Прогрев: все, что здесь загружено, дочерние процессы получают даром
+        if (!runtime.initialize(config)) {
+            last_error = "Failed to initialize runtime";
+            return false;
+        }
+
+        sockaddr_un address;
+        socklen_t length;
+        if (!makeAddress(path, address, length)) {
+            last_error = "Invalid socket path: " + path;
+            return false;
+        }
+
+        listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        if (listen_fd < 0) {
+            last_error = "socket failed: " + std::string(std::strerror(errno));
+            return false;
+        }
+
+        socket_path = path;
+        if (path[0] != '@') {
+            unlink(path.c_str());
+        }
+        if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), length) != 0 ||
+            listen(listen_fd, SOMAXCONN) != 0) {
+            last_error = "Failed to listen on " + path + ": " + std::strerror(errno);
+            ::close(listen_fd);
+            listen_fd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    int run(ChildMain main) {
+        if (listen_fd < 0) {
+            last_error = "Zygote is not started";
+            return 1;
+        }
+        child_main = std::move(main);
+
+        // Сигналы принимаем через signalfd в том же цикле
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGCHLD);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        sigprocmask(SIG_BLOCK, &mask, &saved_mask);
+        signal_fd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+        if (signal_fd < 0) {
+            last_error = "signalfd failed: " + std::string(std::strerror(errno));
+            sigprocmask(SIG_SETMASK, &saved_mask, nullptr);
+            return 1;
+        }
+
+        looper.addFd(listen_fd, EPOLLIN, [this](int, uint32_t) {
+            acceptConnections();
+        });
+        looper.addFd(signal_fd, EPOLLIN, [this](int, uint32_t) {
+            handleSignals();
+        });
+
+        looper.loop();
+        looper.reset();
+
+        looper.removeFd(listen_fd);
+        looper.removeFd(signal_fd);
+        for (int fd : clients) {
+            looper.removeFd(fd);
+            ::close(fd);
+        }
+        clients.clear();
+        ::close(signal_fd);
+        signal_fd = -1;
+        sigprocmask(SIG_SETMASK, &saved_mask, nullptr);
+        runtime.shutdown();
+        return 0;
+    }
+
+    void stop() {
+        looper.quit();
+    }
+
+    size_t childCount() const {
+        return children.size();
+    }
+
+    std::string getLastError() const {
+        return last_error;
+    }
+};
+
+ZygoteServer::ZygoteServer() : impl(new Impl()) {}
+ZygoteServer::~ZygoteServer() = default;
+
+bool ZygoteServer::start(const std::string& socket_path, const RuntimeConfig& config) {
+    return impl->start(socket_path, config);
+}
+
+int ZygoteServer::run(ChildMain child_main) {
+    return impl->run(std::move(child_main));
+}
+
+void ZygoteServer::stop() {
+    impl->stop();
+}
+
+size_t ZygoteServer::childCount() const {
+    return impl->childCount();
+}
+
+std::string ZygoteServer::getLastError() const {
+    return impl->getLastError();
+}
+
+bool ZygoteClient::launch(const std::string& socket_path, const ZygoteRequest& request,
+                          pid_t& pid, std::string* error) {
+    pid = -1;
+    auto fail = [error](const std::string& message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    if (request.apk_path.empty() || request.apk_path.size() > UINT16_MAX ||
+        request.activity.size() > UINT16_MAX ||
+        sizeof(RequestHeader) + request.apk_path.size() + request.activity.size() > MAX_MESSAGE) {
+        return fail("Request is too long");
+    }
+
+    sockaddr_un address;
+    socklen_t length;
+    if (!makeAddress(socket_path, address, length)) {
+        return fail("Invalid socket path: " + socket_path);
+    }
+
+    const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return fail("socket failed: " + std::string(std::strerror(errno)));
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), length) != 0) {
+        const std::string message = "Failed to connect to " + socket_path + ": " +
+                                    std::strerror(errno);
+        ::close(fd);
+        return fail(message);
+    }
+
+    RequestHeader header{ZYGOTE_MAGIC, PROTOCOL_VERSION,
+                         static_cast<uint16_t>(request.apk_path.size()),
+                         static_cast<uint16_t>(request.activity.size()), 0};
+    std::vector<char> message(sizeof(header));
+    std::memcpy(message.data(), &header, sizeof(header));
+    message.insert(message.end(), request.apk_path.begin(), request.apk_path.end());
+    message.insert(message.end(), request.activity.begin(), request.activity.end());
+
+    char buffer[MAX_MESSAGE];
+    ssize_t n = -1;
+    if (send(fd, message.data(), message.size(), MSG_NOSIGNAL) ==
+        static_cast<ssize_t>(message.size())) {
+        do {
+            n = recv(fd, buffer, sizeof(buffer), 0);
+        } while (n < 0 && errno == EINTR);
+    }
+    ::close(fd);
+
+    ResponseHeader response;
+    if (n < static_cast<ssize_t>(sizeof(response))) {
+        return fail("No response from zygote");
+    }
+    std::memcpy(&response, buffer, sizeof(response));
+    if (response.pid <= 0) {
+        const size_t text = std::min<size_t>(response.error_length,
+                                             static_cast<size_t>(n) - sizeof(response));
+        return fail(std::string(buffer + sizeof(response), text));
+    }
+
+    pid = static_cast<pid_t>(response.pid);
+    return true;
+}
+
+} // namespace anexec
@@ -0,0 +1,64 @@
+#ifndef ANEXEC_ZYGOTE_H
+#define ANEXEC_ZYGOTE_H
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <sys/types.h>
+
+#include "runtime.h"
+
+namespace anexec {
+
+// Запрос на запуск приложения
+struct ZygoteRequest {
+    std::string apk_path;       // Путь к APK
+    std::string activity;       // Активность (пусто - главная из манифеста)
+};
+
+// Процесс-шаблон по образцу zygote в Android.
+// Runtime инициализируется один раз, затем на каждый запрос из
+// Unix-сокета создается дочерний процесс через fork(). Дочерний процесс
+// наследует прогретые таблицы классов и нативных методов.
+//
+// До fork() в процессе-шаблоне не должно быть других потоков,
+// поэтому сервер не использует ThreadPool и работает в одном потоке.
+class ZygoteServer {
+public:
+    // Выполняется в дочернем процессе; возвращаемое значение - код выхода
+    using ChildMain = std::function<int(const ZygoteRequest& request, Runtime& runtime)>;
+
+    ZygoteServer();
+    ~ZygoteServer();
+
+    // Запрещаем копирование
+    ZygoteServer(const ZygoteServer&) = delete;
+    ZygoteServer& operator=(const ZygoteServer&) = delete;
+
+    // Прогрев Runtime и создание сокета. Путь, начинающийся с '@',
+    // означает абстрактный сокет (без файла).
+    bool start(const std::string& socket_path, const RuntimeConfig& config);
+
+    // Обработка запросов до SIGINT/SIGTERM или stop()
+    int run(ChildMain child_main);
+    void stop();
+
+    // Количество запущенных и еще не завершившихся процессов
+    size_t childCount() const;
+    std::string getLastError() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+// Клиентская сторона: отправляет запрос и получает pid запущенного процесса
+class ZygoteClient {
+public:
+    static bool launch(const std::string& socket_path, const ZygoteRequest& request,
+                       pid_t& pid, std::string* error = nullptr);
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_ZYGOTE_H
@@ -0,0 +1,121 @@
+#include "damage_tracker.h"
+#include <algorithm>
+#include <cmath>
+
+namespace anexec {
+
+void DamageRect::unite(const DamageRect& other) {
+    if (other.empty()) {
+        return;
+    }
+    if (empty()) {
+        *this = other;
+        return;
+    }
+    left = std::min(left, other.left);
+    bottom = std::min(bottom, other.bottom);
+    right = std::max(right, other.right);
+    top = std::max(top, other.top);
+}
+
+void DamageTracker::update(const std::vector<RenderCommand>& commands, int new_width,
+                           int new_height, float new_scale, int buffer_age) {
+    const DamageRect full{0, 0, new_width, new_height};
+    if (new_width != width || new_height != height || new_scale != scale) {
+        valid = false;
+        width = new_width;
+        height = new_height;
+        scale = new_scale;
+    }
+
+    damage_ = DamageRect{};
+    if (!valid) {
+        damage_ = full;
+    } else {
+        const size_t count = std::max(commands.size(), previous.size());
+        for (size_t i = 0; i < count; ++i) {
+            if (i >= previous.size()) {
+                damage_.unite(bounds(commands[i]));
+            } else if (i >= commands.size()) {
+                damage_.unite(bounds(previous[i]));
+            } else if (!sameContent(commands[i], previous[i])) {
+                damage_.unite(bounds(previous[i]));
+                damage_.unite(bounds(commands[i]));
+            }
+        }
+    }
+
+    // The buffer being drawn still misses whatever changed since it was shown
+    repaint_ = damage_;
+    if (buffer_age <= 0 || static_cast<size_t>(buffer_age) > history_count + 1) {
+        repaint_ = full;
+    } else {
+        for (int i = 0; i + 1 < buffer_age; ++i) {
+            repaint_.unite(history[i]);
+        }
+    }
+
+    if (damage_.empty()) {
+        return;
+    }
+    for (size_t i = HISTORY_SIZE - 1; i > 0; --i) {
+        history[i] = history[i - 1];
+    }
+    history[0] = damage_;
+    history_count = std::min(history_count + 1, HISTORY_SIZE);
+    previous = commands;
+    valid = true;
+}
+
+void DamageTracker::invalidate() {
+    valid = false;
+}
+
+bool DamageTracker::fullRepaint() const {
+    return repaint_.left <= 0 && repaint_.bottom <= 0 && repaint_.right >= width &&
+           repaint_.top >= height;
+}
+
+bool DamageTracker::intersectsRepaint(const RenderCommand& command) const {
+    const DamageRect rect = bounds(command);
+    return rect.left < repaint_.right && rect.right > repaint_.left &&
+           rect.bottom < repaint_.top && rect.top > repaint_.bottom;
+}
+
+DamageRect DamageTracker::bounds(const RenderCommand& command) const {
+    if (command.type == RenderCommand::Type::Clear) {
+        return DamageRect{0, 0, width, height};
+    }
+
+    // Commands are in design units with y down; the target has y up
+    const float x0 = std::min(command.x, command.x + command.width) * scale;
+    const float x1 = std::max(command.x, command.x + command.width) * scale;
+    const float y0 = std::min(command.y, command.y + command.height) * scale;
+    const float y1 = std::max(command.y, command.y + command.height) * scale;
+    const float target_height = static_cast<float>(height);
+
+    DamageRect rect;
+    rect.left = static_cast<int>(std::floor(x0)) - EDGE_MARGIN;
+    rect.right = static_cast<int>(std::ceil(x1)) + EDGE_MARGIN;
+    rect.bottom = static_cast<int>(std::floor(target_height - y1)) - EDGE_MARGIN;
+    rect.top = static_cast<int>(std::ceil(target_height - y0)) + EDGE_MARGIN;
+    rect.left = std::max(rect.left, 0);
+    rect.bottom = std::max(rect.bottom, 0);
+    rect.right = std::min(rect.right, width);
+    rect.top = std::min(rect.top, height);
+    return rect;
+}
+
+bool DamageTracker::sameContent(const RenderCommand& a, const RenderCommand& b) {
+    if (a.type != b.type || a.x != b.x || a.y != b.y || a.width != b.width ||
+        a.height != b.height) {
+        return false;
+    }
+    if (a.type != RenderCommand::Type::DrawTexture) {
+        return true;
+    }
+    return a.texture_handle != 0 && a.texture_handle == b.texture_handle &&
+           a.texture_width == b.texture_width && a.texture_height == b.texture_height;
+}
+
+} // namespace anexec
@@ -0,0 +1,73 @@
+#ifndef ANEXEC_DAMAGE_TRACKER_H
+#define ANEXEC_DAMAGE_TRACKER_H
+
+#include <cstddef>
+#include <vector>
+
+#include "renderer.h"
+
+namespace anexec {
+
+// Прямоугольник в пикселях цели рисования, начало в левом нижнем углу
+// (как у glScissor и EGL)
+struct DamageRect {
+    int left{0};
+    int bottom{0};
+    int right{0};
+    int top{0};
+
+    bool empty() const { return right <= left || top <= bottom; }
+    int width() const { return right - left; }
+    int height() const { return top - bottom; }
+    void unite(const DamageRect& other);
+};
+
+// Отслеживание изменений между кадрами. Команды кадра сравниваются с
+// командами предыдущего по порядку; область повреждения - объединение
+// старых и новых границ изменившихся команд. Кадр без изменений не
+// рисуется. Текстура без дескриптора (texture_handle 0) считается
+// изменившейся в каждом кадре.
+class DamageTracker {
+public:
+    // Сравнение кадра с предыдущим. scale - пикселей на единицу дизайна,
+    // buffer_age - возраст содержимого буфера в кадрах (EGL_EXT_buffer_age),
+    // 0 - содержимое не определено.
+    void update(const std::vector<RenderCommand>& commands, int width, int height, float scale,
+                int buffer_age);
+
+    // Следующий кадр рисуется целиком
+    void invalidate();
+
+    bool hasDamage() const { return !damage_.empty(); }
+    // Что изменилось относительно предыдущего кадра
+    const DamageRect& damage() const { return damage_; }
+    // Что перерисовать в текущем буфере
+    const DamageRect& repaint() const { return repaint_; }
+    bool fullRepaint() const;
+
+    // Затрагивает ли команда перерисовываемую область
+    bool intersectsRepaint(const RenderCommand& command) const;
+
+private:
+    // Кадров истории повреждений: больше буферов в цепочке не бывает
+    static constexpr size_t HISTORY_SIZE = 4;
+    // Запас в пикселях на растеризацию и MSAA по краям
+    static constexpr int EDGE_MARGIN = 1;
+
+    DamageRect bounds(const RenderCommand& command) const;
+    static bool sameContent(const RenderCommand& a, const RenderCommand& b);
+
+    std::vector<RenderCommand> previous;
+    bool valid{false};
+    int width{0};
+    int height{0};
+    float scale{1.0f};
+    DamageRect damage_;
+    DamageRect repaint_;
+    DamageRect history[HISTORY_SIZE];   // [0] - предыдущий показанный кадр
+    size_t history_count{0};
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_DAMAGE_TRACKER_H
@@ -0,0 +1,366 @@
+#include "egl_context.h"
+#include "util.h"
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <EGL/eglext.h>
+#include <GLES2/gl2ext.h>
+
+namespace anexec {
+
+namespace {
+
+// Keys of the shared display table
+constexpr int DEFAULT_DISPLAY_KEY = -1;
+constexpr int SURFACELESS_DISPLAY_KEY = -2;
+
+// eglTerminate destroys every context on a display, so renderers that
+// share a GPU share one initialized display and the last one terminates it
+class DisplayTable {
+public:
+    static DisplayTable& instance() {
+        static DisplayTable table;
+        return table;
+    }
+
+    EGLDisplay acquire(bool headless, int gpu_index, int& key) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        EGLDisplay display = EGL_NO_DISPLAY;
+        if (headless) {
+            display = openDevice(gpu_index, key);
+            if (display == EGL_NO_DISPLAY) {
+                display = openPlatform(EGL_PLATFORM_SURFACELESS_MESA, "EGL_MESA_platform_surfaceless",
+                                       SURFACELESS_DISPLAY_KEY, key);
+            }
+        }
+        if (display == EGL_NO_DISPLAY) {
+            display = open(DEFAULT_DISPLAY_KEY, eglGetDisplay(EGL_DEFAULT_DISPLAY));
+            key = DEFAULT_DISPLAY_KEY;
+        }
+        return display;
+    }
+
+    void release(int key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = displays.find(key);
+        if (it != displays.end() && --it->second.references == 0) {
+            eglTerminate(it->second.display);
+            displays.erase(it);
+        }
+    }
+
+private:
+    struct Entry {
+        EGLDisplay display;
+        int references;
+    };
+
+    // EGLDevice: one display per GPU, instances spread over the devices
+    EGLDisplay openDevice(int gpu_index, int& key) {
+        const char* client = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (!hasExtension(client, "EGL_EXT_device_enumeration") ||
+            !hasExtension(client, "EGL_EXT_platform_device")) {
+            return EGL_NO_DISPLAY;
+        }
+        auto queryDevices = reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(
+            eglGetProcAddress("eglQueryDevicesEXT"));
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        EGLDeviceEXT devices[16];
+        EGLint count = 0;
+        if (!queryDevices || !getPlatformDisplay || !queryDevices(16, devices, &count) ||
+            count <= 0) {
+            return EGL_NO_DISPLAY;
+        }
+
+        const int index = gpu_index >= 0 ? gpu_index % count : next_device++ % count;
+        key = index;
+        return open(index, getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, devices[index], nullptr));
+    }
+
+    EGLDisplay openPlatform(EGLenum platform, const char* extension, int platform_key, int& key) {
+        if (!hasExtension(eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS), extension)) {
+            return EGL_NO_DISPLAY;
+        }
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (!getPlatformDisplay) {
+            return EGL_NO_DISPLAY;
+        }
+        key = platform_key;
+        return open(platform_key, getPlatformDisplay(platform, EGL_DEFAULT_DISPLAY, nullptr));
+    }
+
+    // Takes a reference on an already initialized display or initializes it
+    EGLDisplay open(int key, EGLDisplay display) {
+        auto it = displays.find(key);
+        if (it != displays.end()) {
+            it->second.references++;
+            return it->second.display;
+        }
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+            return EGL_NO_DISPLAY;
+        }
+        displays.emplace(key, Entry{display, 1});
+        return display;
+    }
+
+    std::mutex mutex;
+    std::map<int, Entry> displays;
+    int next_device{0};
+};
+
+} // namespace
+
+EglContext::~EglContext() {
+    release();
+}
+
+bool EglContext::create(const RenderConfig& render_config) {
+    release();
+
+    const bool headless = render_config.surface_type != SurfaceType::Window;
+    display = DisplayTable::instance().acquire(headless, render_config.gpu_index, display_key);
+    if (display == EGL_NO_DISPLAY) {
+        return fail("No EGL display");
+    }
+    if (!eglBindAPI(EGL_OPENGL_ES_API)) {
+        return fail("eglBindAPI failed");
+    }
+
+    // A pbuffer config may be missing (EGLDevice on some drivers) and
+    // surfaceless needs an extension; each falls back to the other
+    SurfaceType requested = render_config.surface_type;
+    const bool surfaceless = hasExtension(eglQueryString(display, EGL_EXTENSIONS),
+                                          "EGL_KHR_surfaceless_context");
+    if (requested == SurfaceType::Surfaceless && !surfaceless) {
+        requested = SurfaceType::Pbuffer;
+    }
+    if (!chooseConfig(requested, render_config.msaa_samples)) {
+        if (requested != SurfaceType::Pbuffer || !surfaceless ||
+            !chooseConfig(SurfaceType::Surfaceless, 0)) {
+            return fail("No matching EGL config");
+        }
+        requested = SurfaceType::Surfaceless;
+    }
+    type = requested;
+    native_window = render_config.native_window;
+
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    has_buffer_age = hasExtension(extensions, "EGL_EXT_buffer_age") ||
+                     hasExtension(extensions, "EGL_KHR_partial_update");
+    set_damage_region = nullptr;
+    if (type == SurfaceType::Window && hasExtension(extensions, "EGL_KHR_partial_update")) {
+        set_damage_region = reinterpret_cast<PFNEGLSETDAMAGEREGIONKHRPROC>(
+            eglGetProcAddress("eglSetDamageRegionKHR"));
+    }
+
+    if (!createContext() ||
+        !createSurface(render_config.design_width, render_config.design_height)) {
+        return false;
+    }
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        return fail("eglMakeCurrent failed");
+    }
+    return type != SurfaceType::Surfaceless || createFramebuffer();
+}
+
+void EglContext::release() {
+    if (display == EGL_NO_DISPLAY) {
+        return;
+    }
+    if (context != EGL_NO_CONTEXT) {
+        if (framebuffer) {
+            glDeleteFramebuffers(1, &framebuffer);
+            glDeleteRenderbuffers(1, &color_buffer);
+            framebuffer = 0;
+            color_buffer = 0;
+        }
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+        context = EGL_NO_CONTEXT;
+    }
+    destroySurface();
+    DisplayTable::instance().release(display_key);
+    display = EGL_NO_DISPLAY;
+    config = nullptr;
+}
+
+bool EglContext::resize(int new_width, int new_height) {
+    if (new_width <= 0 || new_height <= 0 || (new_width == width && new_height == height)) {
+        return true;
+    }
+
+    switch (type) {
+        case SurfaceType::Window:
+            width = new_width;
+            height = new_height;
+            return true;
+        case SurfaceType::Pbuffer:
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            destroySurface();
+            if (!createSurface(new_width, new_height) ||
+                !eglMakeCurrent(display, surface, surface, context)) {
+                return fail("Failed to resize pbuffer");
+            }
+            return true;
+        case SurfaceType::Surfaceless:
+            width = new_width;
+            height = new_height;
+            glBindRenderbuffer(GL_RENDERBUFFER, color_buffer);
+            glRenderbufferStorage(GL_RENDERBUFFER, color_format, width, height);
+            return true;
+    }
+    return false;
+}
+
+void EglContext::bindTarget() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+int EglContext::bufferAge() const {
+    if (type != SurfaceType::Window) {
+        return 1;
+    }
+    EGLint age = 0;
+    if (has_buffer_age) {
+        if (!eglQuerySurface(display, surface, EGL_BUFFER_AGE_EXT, &age)) {
+            age = 0;
+        }
+        return age;
+    }
+    // Without the extension only a preserved swap keeps the last frame
+    EGLint behavior = EGL_BUFFER_DESTROYED;
+    eglQuerySurface(display, surface, EGL_SWAP_BEHAVIOR, &behavior);
+    return behavior == EGL_BUFFER_PRESERVED ? 1 : 0;
+}
+
+void EglContext::setDamageRegion(int x, int y, int region_width, int region_height) const {
+    if (!set_damage_region) {
+        return;
+    }
+    EGLint rect[4] = {x, y, region_width, region_height};
+    set_damage_region(display, surface, rect, 1);
+}
+
+bool EglContext::chooseConfig(SurfaceType requested, int samples) {
+    EGLint surface_bits = 0;
+    if (requested == SurfaceType::Window) {
+        surface_bits = EGL_WINDOW_BIT;
+    } else if (requested == SurfaceType::Pbuffer) {
+        surface_bits = EGL_PBUFFER_BIT;
+    }
+
+    // ES 3 configs first, then ES 2; MSAA is dropped before giving up
+    const EGLint renderable[] = {EGL_OPENGL_ES3_BIT_KHR, EGL_OPENGL_ES2_BIT};
+    const EGLint sample_counts[] = {samples, 0};
+    for (EGLint samples_wanted : sample_counts) {
+        for (EGLint bit : renderable) {
+            const EGLint attributes[] = {
+                EGL_SURFACE_TYPE, surface_bits,
+                EGL_RENDERABLE_TYPE, bit,
+                EGL_RED_SIZE, 8,
+                EGL_GREEN_SIZE, 8,
+                EGL_BLUE_SIZE, 8,
+                EGL_ALPHA_SIZE, 8,
+                EGL_SAMPLE_BUFFERS, samples_wanted > 0 ? 1 : 0,
+                EGL_SAMPLES, samples_wanted > 0 ? samples_wanted : 0,
+                EGL_NONE
+            };
+            EGLint count = 0;
+            if (eglChooseConfig(display, attributes, &config, 1, &count) && count > 0) {
+                return true;
+            }
+        }
+        if (samples_wanted == 0) {
+            break;
+        }
+    }
+    return false;
+}
+
+bool EglContext::createContext() {
+    for (EGLint version : {3, 2}) {
+        const EGLint attributes[] = {EGL_CONTEXT_CLIENT_VERSION, version, EGL_NONE};
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, attributes);
+        if (context != EGL_NO_CONTEXT) {
+            return true;
+        }
+    }
+    return fail("eglCreateContext failed");
+}
+
+bool EglContext::createSurface(int surface_width, int surface_height) {
+    width = surface_width;
+    height = surface_height;
+
+    switch (type) {
+        case SurfaceType::Window:
+            if (!native_window) {
+                return fail("SurfaceType::Window requires a native window");
+            }
+            surface = eglCreateWindowSurface(display, config,
+                                             reinterpret_cast<EGLNativeWindowType>(native_window),
+                                             nullptr);
+            if (surface != EGL_NO_SURFACE) {
+                eglQuerySurface(display, surface, EGL_WIDTH, &width);
+                eglQuerySurface(display, surface, EGL_HEIGHT, &height);
+            }
+            break;
+        case SurfaceType::Pbuffer: {
+            const EGLint attributes[] = {EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+            surface = eglCreatePbufferSurface(display, config, attributes);
+            break;
+        }
+        case SurfaceType::Surfaceless:
+            return true;
+    }
+    return surface != EGL_NO_SURFACE || fail("Failed to create EGL surface");
+}
+
+bool EglContext::createFramebuffer() {
+    // RGBA8 renderbuffers are core in ES 3 and an extension in ES 2
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    if ((version && std::strncmp(version, "OpenGL ES 3", 11) == 0) ||
+        hasExtension(extensions, "GL_OES_rgb8_rgba8")) {
+        color_format = GL_RGBA8_OES;
+    } else {
+        color_format = GL_RGBA4;
+    }
+
+    glGenRenderbuffers(1, &color_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, color_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, color_format, width, height);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_buffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        return fail("Surfaceless framebuffer is incomplete");
+    }
+    return true;
+}
+
+void EglContext::destroySurface() {
+    if (surface != EGL_NO_SURFACE) {
+        eglDestroySurface(display, surface);
+        surface = EGL_NO_SURFACE;
+    }
+}
+
+bool EglContext::fail(const std::string& message) {
+    last_error = message;
+    const EGLint error = eglGetError();
+    if (error != EGL_SUCCESS) {
+        char code[16];
+        std::snprintf(code, sizeof(code), "0x%04x", error);
+        last_error += " (EGL error ";
+        last_error += code;
+        last_error += ")";
+    }
+    return false;
+}
+
+} // namespace anexec
@@ -0,0 +1,81 @@
+#ifndef ANEXEC_EGL_CONTEXT_H
+#define ANEXEC_EGL_CONTEXT_H
+
+#include <string>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+
+#include "renderer.h"
+
+namespace anexec {
+
+// Контекст EGL рендерера: окно, pbuffer или поверхность без дисплея
+// (EGL_KHR_surfaceless_context + FBO). Для headless дисплей берется через
+// EGLDevice или платформу surfaceless Mesa; один EGLDisplay на устройство
+// делят все рендереры процесса, поэтому на одном GPU работает сколько
+// угодно экземпляров. Все методы вызываются в потоке рендеринга.
+class EglContext {
+public:
+    EglContext() = default;
+    ~EglContext();
+
+    EglContext(const EglContext&) = delete;
+    EglContext& operator=(const EglContext&) = delete;
+
+    // Создает контекст и делает его текущим в вызывающем потоке
+    bool create(const RenderConfig& config);
+    void release();
+
+    // Новый размер pbuffer или FBO; окно меняет размер само
+    bool resize(int width, int height);
+
+    // Привязка цели рисования (FBO для поверхности без дисплея)
+    void bindTarget() const;
+
+    // Сколько кадров назад рисовалось содержимое текущего буфера;
+    // 0 - не определено. Pbuffer и FBO сохраняют содержимое всегда.
+    int bufferAge() const;
+    // Область, которую кадр перерисует (EGL_KHR_partial_update);
+    // вызывается до первой команды рисования кадра
+    void setDamageRegion(int x, int y, int region_width, int region_height) const;
+
+    SurfaceType surfaceType() const { return type; }
+    EGLDisplay getDisplay() const { return display; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    const std::string& getLastError() const { return last_error; }
+
+private:
+    bool chooseConfig(SurfaceType requested, int samples);
+    bool createContext();
+    bool createSurface(int surface_width, int surface_height);
+    bool createFramebuffer();
+    void destroySurface();
+    bool fail(const std::string& message);
+
+    EGLDisplay display{EGL_NO_DISPLAY};
+    EGLConfig config{nullptr};
+    EGLContext context{EGL_NO_CONTEXT};
+    EGLSurface surface{EGL_NO_SURFACE};
+    SurfaceType type{SurfaceType::Window};
+    void* native_window{nullptr};
+    int display_key{0};
+    int width{0};
+    int height{0};
+
+    // Частичное обновление окна
+    PFNEGLSETDAMAGEREGIONKHRPROC set_damage_region{nullptr};
+    bool has_buffer_age{false};
+
+    // Цель рисования для SurfaceType::Surfaceless
+    GLuint framebuffer{0};
+    GLuint color_buffer{0};
+    GLenum color_format{GL_RGBA4};
+
+    std::string last_error;
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_EGL_CONTEXT_H
@@ -0,0 +1,133 @@
+#include "frame_readback.h"
+#include <cstring>
+#include <EGL/egl.h>
+
+namespace anexec {
+
+FrameReadback::~FrameReadback() {
+    release();
+}
+
+void FrameReadback::initialize() {
+    if (initialized) {
+        return;
+    }
+
+    functions = Functions{};
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    if (version && std::strncmp(version, "OpenGL ES 3", 11) == 0) {
+        functions.mapBufferRange = reinterpret_cast<PFNGLMAPBUFFERRANGEPROC>(
+            eglGetProcAddress("glMapBufferRange"));
+        functions.unmapBuffer = reinterpret_cast<PFNGLUNMAPBUFFERPROC>(
+            eglGetProcAddress("glUnmapBuffer"));
+        functions.fenceSync = reinterpret_cast<PFNGLFENCESYNCPROC>(
+            eglGetProcAddress("glFenceSync"));
+        functions.clientWaitSync = reinterpret_cast<PFNGLCLIENTWAITSYNCPROC>(
+            eglGetProcAddress("glClientWaitSync"));
+        functions.deleteSync = reinterpret_cast<PFNGLDELETESYNCPROC>(
+            eglGetProcAddress("glDeleteSync"));
+    }
+    next = 0;
+    oldest = 0;
+    initialized = true;
+}
+
+void FrameReadback::release() {
+    if (!initialized) {
+        return;
+    }
+    for (auto& slot : slots) {
+        if (slot.fence) {
+            functions.deleteSync(slot.fence);
+        }
+        if (slot.buffer) {
+            glDeleteBuffers(1, &slot.buffer);
+        }
+        slot = Slot{};
+    }
+    pixels.clear();
+    pixels.shrink_to_fit();
+    initialized = false;
+}
+
+void FrameReadback::capture(uint64_t frame, int width, int height, const FrameCallback& callback) {
+    if (!initialized || !callback || width <= 0 || height <= 0) {
+        return;
+    }
+
+    const size_t stride = static_cast<size_t>(width) * 4;
+    const size_t bytes = stride * static_cast<size_t>(height);
+    if (!functions.available()) {
+        pixels.resize(bytes);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        callback(FrameImage{frame, width, height, stride, pixels.data()});
+        return;
+    }
+
+    // The ring is full only if the GPU is several frames behind
+    Slot& slot = slots[next];
+    if (slot.pending) {
+        deliver(slot, true, callback);
+        oldest = (oldest + 1) % RING_SIZE;
+    }
+
+    if (!slot.buffer) {
+        glGenBuffers(1, &slot.buffer);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (bytes > slot.capacity) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_READ);
+        slot.capacity = bytes;
+    }
+    // With a pack buffer bound the copy is queued on the GPU and returns at once
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = functions.fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = frame;
+    slot.width = width;
+    slot.height = height;
+    slot.pending = true;
+    next = (next + 1) % RING_SIZE;
+}
+
+void FrameReadback::collect(bool block, const FrameCallback& callback) {
+    while (initialized && slots[oldest].pending) {
+        if (!deliver(slots[oldest], block, callback)) {
+            return;
+        }
+        oldest = (oldest + 1) % RING_SIZE;
+    }
+}
+
+bool FrameReadback::hasPending() const {
+    return initialized && slots[oldest].pending;
+}
+
+bool FrameReadback::deliver(Slot& slot, bool block, const FrameCallback& callback) {
+    const GLenum result = functions.clientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                                   block ? 1000000000ull : 0);
+    if (!block && result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+        return false;
+    }
+    functions.deleteSync(slot.fence);
+    slot.fence = nullptr;
+    slot.pending = false;
+
+    const size_t stride = static_cast<size_t>(slot.width) * 4;
+    const size_t bytes = stride * static_cast<size_t>(slot.height);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const void* data = functions.mapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                                static_cast<GLsizeiptr>(bytes), GL_MAP_READ_BIT);
+    if (data) {
+        if (callback) {
+            callback(FrameImage{slot.frame, slot.width, slot.height, stride,
+                                static_cast<const uint8_t*>(data)});
+        }
+        functions.unmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+} // namespace anexec
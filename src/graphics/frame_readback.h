@@ -0,0 +1,72 @@
+#ifndef ANEXEC_FRAME_READBACK_H
+#define ANEXEC_FRAME_READBACK_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <GLES3/gl3.h>
+
+#include "renderer.h"
+
+namespace anexec {
+
+// Чтение готовых кадров в память без glFinish. На ES 3.0 glReadPixels
+// пишет в кольцо PBO, кадр отдается, когда его fence сработал, обычно
+// через кадр-два. На ES 2.0 чтение синхронное.
+// Все методы вызываются в потоке с текущим контекстом GL.
+class FrameReadback {
+public:
+    FrameReadback() = default;
+    ~FrameReadback();
+
+    FrameReadback(const FrameReadback&) = delete;
+    FrameReadback& operator=(const FrameReadback&) = delete;
+
+    void initialize();
+    void release();
+
+    // Запуск чтения текущей цели рисования
+    void capture(uint64_t frame, int width, int height, const FrameCallback& callback);
+
+    // Отдача прочитанных кадров; block - дождаться всех
+    void collect(bool block, const FrameCallback& callback);
+
+    bool hasPending() const;
+
+private:
+    struct Functions {
+        PFNGLMAPBUFFERRANGEPROC mapBufferRange{nullptr};
+        PFNGLUNMAPBUFFERPROC unmapBuffer{nullptr};
+        PFNGLFENCESYNCPROC fenceSync{nullptr};
+        PFNGLCLIENTWAITSYNCPROC clientWaitSync{nullptr};
+        PFNGLDELETESYNCPROC deleteSync{nullptr};
+        bool available() const {
+            return mapBufferRange && unmapBuffer && fenceSync && clientWaitSync && deleteSync;
+        }
+    };
+
+    struct Slot {
+        GLuint buffer{0};
+        size_t capacity{0};
+        GLsync fence{nullptr};
+        uint64_t frame{0};
+        int width{0};
+        int height{0};
+        bool pending{false};
+    };
+
+    static constexpr size_t RING_SIZE = 3;
+
+    bool deliver(Slot& slot, bool block, const FrameCallback& callback);
+
+    Functions functions;
+    Slot slots[RING_SIZE];
+    size_t next{0};                 // Слот следующего чтения
+    size_t oldest{0};               // Самый старый ожидающий слот
+    std::vector<uint8_t> pixels;    // Синхронное чтение без PBO
+    bool initialized{false};
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_FRAME_READBACK_H
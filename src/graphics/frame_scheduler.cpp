@@ -0,0 +1,356 @@
+#include "frame_scheduler.h"
+#include "util.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+
+namespace anexec {
+
+namespace {
+
+void sleepUntil(int64_t deadline) {
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(deadline / 1000000000);
+    ts.tv_nsec = static_cast<long>(deadline % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+}
+
+// Nearest usual panel rate within 5%, 0 if there is none
+int64_t snapPeriod(int64_t period) {
+    static const int rates[] = {30, 48, 50, 60, 72, 75, 90, 100, 120, 144, 165, 240};
+    for (int rate : rates) {
+        const int64_t nominal = 1000000000 / rate;
+        if (std::abs(nominal - period) * 20 < nominal) {
+            return nominal;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+FrameScheduler::~FrameScheduler() {
+    release();
+}
+
+void FrameScheduler::initialize(const RenderConfig& config) {
+    if (initialized) {
+        return;
+    }
+
+    loadFunctions();
+    display = eglGetCurrentDisplay();
+    surface = eglGetCurrentSurface(EGL_DRAW);
+    fixed_rate = config.refresh_rate;
+    setPeriod(fixed_rate > 0 ? 1000000000 / fixed_rate : 1000000000 / 60);
+
+    const bool has_surface = display != EGL_NO_DISPLAY && surface != EGL_NO_SURFACE;
+    if (!config.vsync_enabled) {
+        pacing = Pacing::None;
+        if (has_surface) {
+            eglSwapInterval(display, 0);
+        }
+    } else if (has_surface) {
+        // Whether the swap really waits for vsync shows up in calibration
+        eglSwapInterval(display, 1);
+        pacing = Pacing::Vsync;
+        calibrating = fixed_rate <= 0;
+        calibration_count = 0;
+        calibration_frames = 0;
+    } else {
+        pacing = Pacing::Timer;
+    }
+
+    for (auto& frame : frames) {
+        frame = Frame{};
+        if (functions.timerQueries()) {
+            functions.genQueries(1, &frame.query);
+        }
+    }
+    frame_index = 0;
+    phase_ns = nowNanoseconds();
+    last_present_ns = phase_ns;
+    predicted_cpu_ns = 0.0;
+
+    const double rate = stats_.refresh_rate;
+    stats_ = FrameStats{};
+    stats_.refresh_rate = rate;
+    initialized = true;
+}
+
+void FrameScheduler::release() {
+    if (!initialized) {
+        return;
+    }
+    for (auto& frame : frames) {
+        deleteFence(frame.fence);
+        if (frame.query) {
+            functions.deleteQueries(1, &frame.query);
+        }
+        frame = Frame{};
+    }
+    display = EGL_NO_DISPLAY;
+    surface = EGL_NO_SURFACE;
+    initialized = false;
+}
+
+void FrameScheduler::waitForFrame() {
+    if (!initialized || pacing == Pacing::None || calibrating) {
+        return;
+    }
+
+    // Aim at the first vsync this frame can still make, and wake up just
+    // early enough to record it
+    const int64_t now = nowNanoseconds();
+    const int64_t budget = static_cast<int64_t>(predicted_cpu_ns * 1.25) + WAKE_MARGIN_NS;
+    int64_t deadline = phase_ns + period_ns;
+    if (deadline < now + budget) {
+        const int64_t late = now + budget - phase_ns;
+        deadline = phase_ns + (late + period_ns - 1) / period_ns * period_ns;
+    }
+    deadline_ns = deadline;
+
+    const int64_t wake = deadline - budget;
+    if (wake > now) {
+        sleepUntil(wake);
+    }
+}
+
+void FrameScheduler::beginFrame() {
+    frame_start_ns = nowNanoseconds();
+
+    // Reusing the slot of frame N-2 caps the GPU queue at two frames
+    Frame& frame = frames[frame_index % MAX_FRAMES_IN_FLIGHT];
+    retire(frame, true);
+    for (auto& other : frames) {
+        if (&other != &frame) {
+            retire(other, false);
+        }
+    }
+
+    frame.start_ns = frame_start_ns;
+    if (frame.query) {
+        functions.beginQuery(GL_TIME_ELAPSED_EXT, frame.query);
+        frame.query_active = true;
+    }
+}
+
+void FrameScheduler::endFrame(const EGLint* damage_rect) {
+    Frame& frame = frames[frame_index % MAX_FRAMES_IN_FLIGHT];
+    if (frame.query_active) {
+        functions.endQuery(GL_TIME_ELAPSED_EXT);
+    }
+
+    const int64_t recorded = nowNanoseconds();
+    const double cpu = static_cast<double>(recorded - frame_start_ns);
+    stats_.cpu_time_ms = cpu / 1e6;
+    // Rises immediately, decays slowly: a late frame is worse than an early wake
+    predicted_cpu_ns = cpu > predicted_cpu_ns ? cpu : predicted_cpu_ns * 0.9 + cpu * 0.1;
+
+    frame.fence = createFence();
+    // A resized pbuffer is a new surface
+    if (surface != EGL_NO_SURFACE) {
+        surface = eglGetCurrentSurface(EGL_DRAW);
+    }
+    if (surface != EGL_NO_SURFACE) {
+        if (damage_rect && functions.swapBuffersWithDamage) {
+            functions.swapBuffersWithDamage(display, surface, damage_rect, 1);
+        } else {
+            eglSwapBuffers(display, surface);
+        }
+    } else {
+        glFlush();
+    }
+
+    const int64_t present = nowNanoseconds();
+    const int64_t interval = present - last_present_ns;
+    // Only frames that waited for nothing but the previous swap show the period
+    const bool back_to_back = (frame_start_ns - last_present_ns) * 4 < interval;
+    stats_.frame_interval_ms = static_cast<double>(interval) / 1e6;
+
+    switch (pacing) {
+        case Pacing::Vsync:
+            // The swap returns right after the vsync that showed the frame
+            if (calibrating) {
+                calibrate(back_to_back ? interval : 0);
+            } else if (present > deadline_ns + period_ns / 2) {
+                stats_.janky_frames++;
+            }
+            phase_ns = present;
+            break;
+        case Pacing::Timer:
+            // The frame shows at the first virtual vsync after it is done
+            if (present <= deadline_ns) {
+                phase_ns = deadline_ns;
+            } else {
+                stats_.janky_frames++;
+                phase_ns = deadline_ns + (present - deadline_ns + period_ns - 1) / period_ns * period_ns;
+            }
+            break;
+        case Pacing::None:
+            phase_ns = present;
+            break;
+    }
+
+    last_present_ns = present;
+    stats_.frames++;
+    frame_index++;
+
+    // The panel may switch modes, so the rate is measured again now and then
+    if (pacing == Pacing::Vsync && fixed_rate <= 0 && !calibrating &&
+        stats_.frames % RECALIBRATE_FRAMES == 0) {
+        calibrating = true;
+        calibration_count = 0;
+        calibration_frames = 0;
+    }
+}
+
+void FrameScheduler::loadFunctions() {
+    functions = Functions{};
+
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    if (version && std::strncmp(version, "OpenGL ES 3", 11) == 0) {
+        functions.fenceSync = reinterpret_cast<PFNGLFENCESYNCPROC>(
+            eglGetProcAddress("glFenceSync"));
+        functions.clientWaitSync = reinterpret_cast<PFNGLCLIENTWAITSYNCPROC>(
+            eglGetProcAddress("glClientWaitSync"));
+        functions.deleteSync = reinterpret_cast<PFNGLDELETESYNCPROC>(
+            eglGetProcAddress("glDeleteSync"));
+    } else if (hasExtension(eglQueryString(eglGetCurrentDisplay(), EGL_EXTENSIONS),
+                            "EGL_KHR_fence_sync")) {
+        functions.eglCreateSync = reinterpret_cast<PFNEGLCREATESYNCKHRPROC>(
+            eglGetProcAddress("eglCreateSyncKHR"));
+        functions.eglClientWaitSync = reinterpret_cast<PFNEGLCLIENTWAITSYNCKHRPROC>(
+            eglGetProcAddress("eglClientWaitSyncKHR"));
+        functions.eglDestroySync = reinterpret_cast<PFNEGLDESTROYSYNCKHRPROC>(
+            eglGetProcAddress("eglDestroySyncKHR"));
+    }
+
+    // Both extensions have the same entry point signature
+    const char* egl_extensions = eglQueryString(eglGetCurrentDisplay(), EGL_EXTENSIONS);
+    if (hasExtension(egl_extensions, "EGL_KHR_swap_buffers_with_damage")) {
+        functions.swapBuffersWithDamage = reinterpret_cast<PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC>(
+            eglGetProcAddress("eglSwapBuffersWithDamageKHR"));
+    } else if (hasExtension(egl_extensions, "EGL_EXT_swap_buffers_with_damage")) {
+        functions.swapBuffersWithDamage = reinterpret_cast<PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC>(
+            eglGetProcAddress("eglSwapBuffersWithDamageEXT"));
+    }
+
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    if (hasExtension(extensions, "GL_EXT_disjoint_timer_query")) {
+        functions.genQueries = reinterpret_cast<PFNGLGENQUERIESEXTPROC>(
+            eglGetProcAddress("glGenQueriesEXT"));
+        functions.deleteQueries = reinterpret_cast<PFNGLDELETEQUERIESEXTPROC>(
+            eglGetProcAddress("glDeleteQueriesEXT"));
+        functions.beginQuery = reinterpret_cast<PFNGLBEGINQUERYEXTPROC>(
+            eglGetProcAddress("glBeginQueryEXT"));
+        functions.endQuery = reinterpret_cast<PFNGLENDQUERYEXTPROC>(
+            eglGetProcAddress("glEndQueryEXT"));
+        functions.getQueryObjectuiv = reinterpret_cast<PFNGLGETQUERYOBJECTUIVEXTPROC>(
+            eglGetProcAddress("glGetQueryObjectuivEXT"));
+        functions.getQueryObjectui64v = reinterpret_cast<PFNGLGETQUERYOBJECTUI64VEXTPROC>(
+            eglGetProcAddress("glGetQueryObjectui64vEXT"));
+    }
+}
+
+void* FrameScheduler::createFence() {
+    if (functions.fenceSync) {
+        return functions.fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    if (functions.eglCreateSync) {
+        EGLSyncKHR sync = functions.eglCreateSync(display, EGL_SYNC_FENCE_KHR, nullptr);
+        return sync == EGL_NO_SYNC_KHR ? nullptr : sync;
+    }
+    return nullptr;
+}
+
+bool FrameScheduler::waitFence(void* fence, uint64_t timeout_ns) {
+    if (functions.clientWaitSync) {
+        const GLenum result = functions.clientWaitSync(static_cast<GLsync>(fence),
+                                                       GL_SYNC_FLUSH_COMMANDS_BIT, timeout_ns);
+        return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+    }
+    return functions.eglClientWaitSync(display, fence, EGL_SYNC_FLUSH_COMMANDS_BIT_KHR,
+                                       timeout_ns) == EGL_CONDITION_SATISFIED_KHR;
+}
+
+void FrameScheduler::deleteFence(void* fence) {
+    if (!fence) {
+        return;
+    }
+    if (functions.deleteSync) {
+        functions.deleteSync(static_cast<GLsync>(fence));
+    } else if (functions.eglDestroySync) {
+        functions.eglDestroySync(display, fence);
+    }
+}
+
+void FrameScheduler::retire(Frame& frame, bool block) {
+    if (!frame.fence) {
+        return;
+    }
+    // A second is far past any real frame; a hung GPU must not hang the thread
+    if (!waitFence(frame.fence, block ? 1000000000ull : 0) && !block) {
+        return;
+    }
+
+    // Seen when the fence is observed, so late by at most one poll
+    stats_.present_latency_ms = static_cast<double>(nowNanoseconds() - frame.start_ns) / 1e6;
+    deleteFence(frame.fence);
+    frame.fence = nullptr;
+
+    if (frame.query_active) {
+        GLuint available = 0;
+        functions.getQueryObjectuiv(frame.query, GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+        GLint disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+        if (available && !disjoint) {
+            GLuint64 elapsed = 0;
+            functions.getQueryObjectui64v(frame.query, GL_QUERY_RESULT_EXT, &elapsed);
+            stats_.gpu_time_ms = static_cast<double>(elapsed) / 1e6;
+        }
+        frame.query_active = false;
+    }
+}
+
+void FrameScheduler::calibrate(int64_t interval) {
+    if (interval > 0) {
+        calibration[calibration_count++] = interval;
+    }
+    if (++calibration_frames >= CALIBRATION_FRAMES * 4 && calibration_count < CALIBRATION_FRAMES) {
+        // Frames come too sparsely to measure; the timer keeps the pace
+        calibrating = false;
+        pacing = Pacing::Timer;
+        return;
+    }
+    if (calibration_count < CALIBRATION_FRAMES) {
+        return;
+    }
+
+    std::sort(calibration, calibration + CALIBRATION_FRAMES);
+    const int64_t median = calibration[CALIBRATION_FRAMES / 2];
+    const int64_t spread = calibration[CALIBRATION_FRAMES * 3 / 4] -
+                           calibration[CALIBRATION_FRAMES / 4];
+    calibrating = false;
+    calibration_count = 0;
+
+    // Vsync gives steady intervals at a panel rate. Anything else means
+    // the swap does not block (pbuffer, compositor without vsync) and the
+    // intervals are just the frame cost.
+    const int64_t period = snapPeriod(median);
+    if (median < MIN_VSYNC_PERIOD_NS || period == 0 || spread * 10 > median) {
+        pacing = Pacing::Timer;
+        return;
+    }
+    setPeriod(period);
+}
+
+void FrameScheduler::setPeriod(int64_t period) {
+    period_ns = period;
+    stats_.refresh_rate = 1e9 / static_cast<double>(period);
+}
+
+} // namespace anexec
@@ -0,0 +1,120 @@
+#ifndef ANEXEC_FRAME_SCHEDULER_H
+#define ANEXEC_FRAME_SCHEDULER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+
+#include "renderer.h"
+
+namespace anexec {
+
+// Темп кадров потока рендеринга. С поверхностью EGL и vsync кадры идут
+// по eglSwapBuffers с интервалом 1, частота обновления измеряется по
+// интервалам показа (60/90/120/144 Гц). Без дисплея или если swap не
+// блокирует - по таймеру clock_nanosleep. Начало кадра сдвигается к дедлайну на предсказанное
+// время записи, чтобы кадр брал самые свежие команды. Вместо glFinish
+// ставятся fence, на GPU находится не больше двух кадров.
+// Все методы вызываются в потоке с текущим контекстом GL.
+class FrameScheduler {
+public:
+    FrameScheduler() = default;
+    ~FrameScheduler();
+
+    FrameScheduler(const FrameScheduler&) = delete;
+    FrameScheduler& operator=(const FrameScheduler&) = delete;
+
+    void initialize(const RenderConfig& config);
+    void release();
+    bool isInitialized() const { return initialized; }
+
+    // Ожидание момента начала следующего кадра
+    void waitForFrame();
+
+    void beginFrame();
+    // Конец записи: fence, показ кадра и сбор завершенных кадров.
+    // damage_rect - изменившаяся область {x, y, ширина, высота} от левого
+    // нижнего угла для EGL_KHR_swap_buffers_with_damage; nullptr - весь кадр.
+    void endFrame(const EGLint* damage_rect = nullptr);
+
+    const FrameStats& stats() const { return stats_; }
+
+private:
+    enum class Pacing {
+        None,       // vsync выключен: кадр начинается сразу
+        Timer,      // Нет дисплея или swap не блокирует
+        Vsync       // eglSwapBuffers ждет vsync
+    };
+
+    struct Frame {
+        void* fence{nullptr};
+        GLuint query{0};
+        bool query_active{false};
+        int64_t start_ns{0};
+    };
+
+    struct Functions {
+        PFNGLFENCESYNCPROC fenceSync{nullptr};
+        PFNGLCLIENTWAITSYNCPROC clientWaitSync{nullptr};
+        PFNGLDELETESYNCPROC deleteSync{nullptr};
+        PFNEGLCREATESYNCKHRPROC eglCreateSync{nullptr};
+        PFNEGLCLIENTWAITSYNCKHRPROC eglClientWaitSync{nullptr};
+        PFNEGLDESTROYSYNCKHRPROC eglDestroySync{nullptr};
+        PFNGLGENQUERIESEXTPROC genQueries{nullptr};
+        PFNGLDELETEQUERIESEXTPROC deleteQueries{nullptr};
+        PFNGLBEGINQUERYEXTPROC beginQuery{nullptr};
+        PFNGLENDQUERYEXTPROC endQuery{nullptr};
+        PFNGLGETQUERYOBJECTUIVEXTPROC getQueryObjectuiv{nullptr};
+        PFNGLGETQUERYOBJECTUI64VEXTPROC getQueryObjectui64v{nullptr};
+        PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC swapBuffersWithDamage{nullptr};
+        bool timerQueries() const {
+            return genQueries && deleteQueries && beginQuery && endQuery &&
+                   getQueryObjectuiv && getQueryObjectui64v;
+        }
+    };
+
+    static constexpr size_t MAX_FRAMES_IN_FLIGHT = 2;
+    static constexpr size_t CALIBRATION_FRAMES = 16;
+    static constexpr uint64_t RECALIBRATE_FRAMES = 600;   // ~5-10 с
+    static constexpr int64_t MIN_VSYNC_PERIOD_NS = 4000000;  // Не выше 250 Гц
+    static constexpr int64_t WAKE_MARGIN_NS = 1000000;
+
+    void loadFunctions();
+    void* createFence();
+    bool waitFence(void* fence, uint64_t timeout_ns);
+    void deleteFence(void* fence);
+    void retire(Frame& frame, bool block);
+    void calibrate(int64_t interval);
+    void setPeriod(int64_t period);
+
+    Functions functions;
+    Pacing pacing{Pacing::Timer};
+    EGLDisplay display{EGL_NO_DISPLAY};
+    EGLSurface surface{EGL_NO_SURFACE};
+    int fixed_rate{0};
+
+    Frame frames[MAX_FRAMES_IN_FLIGHT];
+    uint64_t frame_index{0};
+
+    int64_t period_ns{16666667};
+    int64_t phase_ns{0};            // Vsync, к которому привязана сетка кадров
+    int64_t last_present_ns{0};
+    int64_t deadline_ns{0};         // Vsync, к которому готовится текущий кадр
+    int64_t frame_start_ns{0};
+    double predicted_cpu_ns{0.0};   // Сглаженное время записи
+
+    int64_t calibration[CALIBRATION_FRAMES] = {};
+    size_t calibration_count{0};
+    size_t calibration_frames{0};
+    bool calibrating{false};
+
+    FrameStats stats_;
+    bool initialized{false};
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_FRAME_SCHEDULER_H
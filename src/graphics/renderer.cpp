@@ -1,39 +1,145 @@
 #include "renderer.h"
+#include "damage_tracker.h"
+#include "egl_context.h"
+#include "frame_readback.h"
+#include "frame_scheduler.h"
+#include "shader_cache.h"
+#include "texture_cache.h"
+#include "util.h"
+#include "../core/mpsc_ring.h"
+#include "../core/resource_monitor.h"
+#include "../core/seqlock.h"
+#include "../core/trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include <chrono>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <future>
+#include <stdexcept>
+#include <EGL/egl.h>
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace anexec {
 
 class Renderer::Impl {
 private:
+    // Instanced arrays come from ES 3.0 core or one of the ES 2.0 extensions
+    struct Instancing {
+        PFNGLDRAWARRAYSINSTANCEDEXTPROC drawArraysInstanced{nullptr};
+        PFNGLVERTEXATTRIBDIVISOREXTPROC vertexAttribDivisor{nullptr};
+        bool available() const { return drawArraysInstanced && vertexAttribDivisor; }
+    };
+
     struct RenderState {
-        bool initialized{false};
+        std::atomic<bool> initialized{false};
         bool surface_created{false};
         int surface_width{0};
         int surface_height{0};
+        int viewport_width{0};       // Last glViewport, set again only on change
+        int viewport_height{0};
         float scale_factor{1.0f};
-        GLuint program_id{0};
-        GLuint vertex_buffer{0};
-        GLuint texture_id{0};
+        Instancing instancing;
+        uint32_t base_variant{0};    // ShaderCache::INSTANCED when instancing is used
+        GLuint vertex_buffer{0};     // Stream buffer, orphaned once per frame
+        GLuint corner_buffer{0};     // Unit quad for the instanced path
+        GLuint index_buffer{0};      // Shared quad indices for the expanded path
+        size_t vertex_buffer_capacity{0};
+        size_t vertex_buffer_bytes{0};  // Текущий размер данных в буферах GL
+        size_t texture_bytes{0};
         std::mutex state_mutex;
     } state;
 
+    // One quad as uploaded for the instanced path
+    struct QuadInstance {
+        float x, y, width, height;
+        float u0, v0, u1, v1;
+    };
+
+    // One corner of a quad as uploaded for the expanded path
+    struct Vertex {
+        float x, y;
+        float u, v;
+    };
+
+    // Consecutive quads drawn with a single call. A Clear command becomes
+    // a batch of its own so that it keeps its place in the frame.
+    struct Batch {
+        bool clear;
+        GLuint texture;                   // 0 for plain rects
+        float left, top, right, bottom;  // Union of the quads, for overlap tests
+        size_t first;                     // First quad in the frame buffer
+        size_t count;
+    };
+
+    // A command may move back past at most this many batches to join
+    // one with the same texture
+    static constexpr size_t BATCH_LOOKBACK = 32;
+    // Quads per indexed draw: 4 vertices each must fit 16-bit indices
+    static constexpr size_t MAX_INDEXED_QUADS = 65536 / 4;
+
+    // Commands in flight between producers and the render thread
+    static constexpr size_t COMMAND_RING_CAPACITY = 65536;
+    // How often an idle render thread checks for finished readbacks
+    static constexpr std::chrono::milliseconds READBACK_POLL{2};
+
+    // Frame scratch storage, reused so that steady-state frames do not allocate
+    std::vector<RenderCommand> frame_commands;
+    std::vector<Batch> batches;
+    std::vector<size_t> command_batch;
+    std::vector<QuadInstance> instances;
+    std::vector<Vertex> vertices;
+    std::vector<TextureRegion> command_regions;
+
+    DamageTracker damage;
+    ShaderCache shaders;
+    TextureCache texture_cache;
+    SeqLock<TextureStats> texture_stats;
+    FrameScheduler scheduler;
+    SeqLock<FrameStats> frame_stats;
+
+    // The context lives on the render thread from creation to release
+    EglContext egl;
+    FrameReadback readback;
+    uint64_t frame_number{0};
+    uint64_t skipped_frames{0};
+    std::mutex callback_mutex;
+    std::shared_ptr<const FrameCallback> frame_callback;
+    std::atomic<bool> redraw_requested{false};  // Draw the next frame in full
+
     struct RenderThread {
         std::thread thread;
         bool running{false};
         std::mutex mutex;
-        std::condition_variable cv;
+        std::condition_variable cv;          // Commands were published
+        std::condition_variable space_cv;    // The ring was drained
+        std::condition_variable idle_cv;     // A frame with new commands finished
+        std::atomic<bool> wake_pending{false};
+        std::atomic<bool> surface_ready{false};
+        std::atomic<int> waiting_producers{0};
+        bool init_requested{false};
+        std::promise<std::string> init_result;  // Empty on success, the error otherwise
     } render_thread;
 
     RenderConfig config;
-    std::vector<RenderCommand> command_queue;
-    std::mutex queue_mutex;
+    MpscRing<RenderCommand> command_ring{COMMAND_RING_CAPACITY};
+    // Commands pushed by producers, taken into frames (render thread only)
+    // and in frames that have finished, for waitForIdle
+    std::atomic<uint64_t> submitted_commands{0};
+    uint64_t drained_commands{0};
+    std::atomic<uint64_t> finished_commands{0};
+    std::atomic<uint64_t> dropped_commands{0};  // The ring was full with nothing to draw to
 
     bool initGLContext() {
         std::lock_guard<std::mutex> lock(state.state_mutex);
@@ -42,88 +148,136 @@ private:
             return true;
         }
 
-        // Basic vertex shader
-        const char* vertex_shader_source = R"(
-            attribute vec4 a_position;
-            attribute vec2 a_texCoord;
-            varying vec2 v_texCoord;
-            uniform mat4 u_mvpMatrix;
-            
-            void main() {
-                gl_Position = u_mvpMatrix * a_position;
-                v_texCoord = a_texCoord;
-            }
-        )";
-
-        // Basic fragment shader
-        const char* fragment_shader_source = R"(
-            precision mediump float;
-            varying vec2 v_texCoord;
-            uniform sampler2D u_texture;
-            
-            void main() {
-                gl_FragColor = texture2D(u_texture, v_texCoord);
-            }
-        )";
+        loadInstancing();
 
-        // Create and compile shaders
-        GLuint vertex_shader = compileShader(GL_VERTEX_SHADER, vertex_shader_source);
-        GLuint fragment_shader = compileShader(GL_FRAGMENT_SHADER, fragment_shader_source);
-        
-        if (!vertex_shader || !fragment_shader) {
-            return false;
+        // Both variants are built (or loaded from binaries) before the
+        // first frame, so it never waits for the shader compiler
+        state.base_variant = state.instancing.available()
+            ? static_cast<uint32_t>(ShaderCache::INSTANCED) : 0u;
+        shaders.initialize(config.shader_cache_dir);
+        for (uint32_t variant : {state.base_variant, state.base_variant | ShaderCache::TEXTURED}) {
+            if (!shaders.get(variant)) {
+                return false;
+            }
         }
 
-        // Create and link program
-        state.program_id = glCreateProgram();
-        glAttachShader(state.program_id, vertex_shader);
-        glAttachShader(state.program_id, fragment_shader);
-        glLinkProgram(state.program_id);
+        createBuffers();
+        texture_cache.initialize();
+
+        state.initialized = true;
+        return true;
+    }
+
+    // Report GL memory to the executor statistics
+    static void trackGraphicsMemory(size_t& current, size_t bytes) {
+        ResourceMonitor::instance().add(MemoryCategory::GraphicsBuffers,
+                                        static_cast<int64_t>(bytes) - static_cast<int64_t>(current));
+        current = bytes;
+    }
 
-        // Check link status
-        GLint link_status;
-        glGetProgramiv(state.program_id, GL_LINK_STATUS, &link_status);
-        if (!link_status) {
-            GLint log_length;
-            glGetProgramiv(state.program_id, GL_INFO_LOG_LENGTH, &log_length);
-            std::vector<char> log(log_length);
-            glGetProgramInfoLog(state.program_id, log_length, nullptr, log.data());
-            std::cerr << "Program linking failed: " << log.data() << std::endl;
-            return false;
+    void loadInstancing() {
+        state.instancing = Instancing{};
+
+        const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+        const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+
+        const char* draw_name = nullptr;
+        const char* divisor_name = nullptr;
+        if (version && std::strncmp(version, "OpenGL ES 3", 11) == 0) {
+            draw_name = "glDrawArraysInstanced";
+            divisor_name = "glVertexAttribDivisor";
+        } else if (hasExtension(extensions, "GL_EXT_instanced_arrays")) {
+            draw_name = "glDrawArraysInstancedEXT";
+            divisor_name = "glVertexAttribDivisorEXT";
+        } else if (hasExtension(extensions, "GL_ANGLE_instanced_arrays")) {
+            draw_name = "glDrawArraysInstancedANGLE";
+            divisor_name = "glVertexAttribDivisorANGLE";
+        } else {
+            return;
         }
 
-        // Cleanup shaders
-        glDeleteShader(vertex_shader);
-        glDeleteShader(fragment_shader);
+        state.instancing.drawArraysInstanced = reinterpret_cast<PFNGLDRAWARRAYSINSTANCEDEXTPROC>(
+            eglGetProcAddress(draw_name));
+        state.instancing.vertexAttribDivisor = reinterpret_cast<PFNGLVERTEXATTRIBDIVISOREXTPROC>(
+            eglGetProcAddress(divisor_name));
+    }
 
+    void createBuffers() {
         // Create vertex buffer
         glGenBuffers(1, &state.vertex_buffer);
-        
-        // Create texture
-        glGenTextures(1, &state.texture_id);
-        
-        state.initialized = true;
-        return true;
+        state.vertex_buffer_capacity = 0;
+
+        size_t static_bytes = 0;
+        if (state.instancing.available()) {
+            const GLfloat corners[] = {
+                0.0f, 0.0f,
+                1.0f, 0.0f,
+                0.0f, 1.0f,
+                1.0f, 1.0f
+            };
+            glGenBuffers(1, &state.corner_buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, state.corner_buffer);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+            static_bytes = sizeof(corners);
+        } else {
+            // Two triangles per quad; every indexed draw starts at quad 0
+            std::vector<GLushort> indices(MAX_INDEXED_QUADS * 6);
+            for (size_t quad = 0; quad < MAX_INDEXED_QUADS; ++quad) {
+                const GLushort base = static_cast<GLushort>(quad * 4);
+                GLushort* out = &indices[quad * 6];
+                out[0] = base;
+                out[1] = static_cast<GLushort>(base + 1);
+                out[2] = static_cast<GLushort>(base + 2);
+                out[3] = static_cast<GLushort>(base + 2);
+                out[4] = static_cast<GLushort>(base + 1);
+                out[5] = static_cast<GLushort>(base + 3);
+            }
+            glGenBuffers(1, &state.index_buffer);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, state.index_buffer);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort),
+                         indices.data(), GL_STATIC_DRAW);
+            static_bytes = indices.size() * sizeof(GLushort);
+        }
+        trackGraphicsMemory(state.vertex_buffer_bytes, static_bytes);
     }
 
-    GLuint compileShader(GLenum type, const char* source) {
-        GLuint shader = glCreateShader(type);
-        glShaderSource(shader, 1, &source, nullptr);
-        glCompileShader(shader);
+    // Runs on the render thread, which owns the context until release
+    std::string createContext() {
+        if (!egl.create(config)) {
+            return egl.getLastError();
+        }
+        if (!initGLContext()) {
+            return "Failed to build shader programs";
+        }
+        readback.initialize();
 
-        GLint compile_status;
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
-        if (!compile_status) {
-            GLint log_length;
-            glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_length);
-            std::vector<char> log(log_length);
-            glGetShaderInfoLog(shader, log_length, nullptr, log.data());
-            std::cerr << "Shader compilation failed: " << log.data() << std::endl;
-            glDeleteShader(shader);
-            return 0;
+        std::lock_guard<std::mutex> lock(state.state_mutex);
+        if (state.surface_width <= 0 || state.surface_height <= 0) {
+            state.surface_width = egl.getWidth();
+            state.surface_height = egl.getHeight();
         }
+        return {};
+    }
 
-        return shader;
+    void releaseContext() {
+        collectFrames(true);
+        cleanup();
+        readback.release();
+        egl.release();
+    }
+
+    std::shared_ptr<const FrameCallback> currentFrameCallback() {
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        return frame_callback;
+    }
+
+    // Frames are handed out as their fences signal, in the order drawn
+    void collectFrames(bool block) {
+        if (!readback.hasPending()) {
+            return;
+        }
+        const auto callback = currentFrameCallback();
+        readback.collect(block, callback ? *callback : FrameCallback{});
     }
 
     void renderFrame() {
@@ -133,64 +287,372 @@ private:
             return;
         }
 
-        glViewport(0, 0, state.surface_width, state.surface_height);
+        // A pbuffer is recreated on resize, so this comes before the scheduler looks at the surface
+        if ((state.surface_width != egl.getWidth() || state.surface_height != egl.getHeight()) &&
+            !egl.resize(state.surface_width, state.surface_height)) {
+            std::cerr << "Renderer: " << egl.getLastError() << std::endl;
+        }
+
+        // Set up lazily: the scheduler needs the render thread's surface
+        if (!scheduler.isInitialized()) {
+            scheduler.initialize(config);
+        }
+
+        frame_commands.clear();
+        command_ring.drain([this](const RenderCommand& cmd) {
+            frame_commands.push_back(cmd);
+        });
+        drained_commands += frame_commands.size();
+        releaseProducers();
+        TraceScope trace(TraceEvent::RenderFrame, 0, frame_commands.size());
+
+        // A frame identical to the one on screen is neither drawn nor presented
+        if (redraw_requested.exchange(false)) {
+            damage.invalidate();
+        }
+        const float scale = static_cast<float>(egl.getWidth()) / config.design_width;
+        damage.update(frame_commands, egl.getWidth(), egl.getHeight(), scale, egl.bufferAge());
+        if (!damage.hasDamage()) {
+            traceEvent(TraceEvent::FrameSkipped, frame_commands.size());
+            ++skipped_frames;
+            publishFrameStats();
+            return;
+        }
+        const DamageRect& repaint = damage.repaint();
+        const bool partial = !damage.fullRepaint();
+        egl.setDamageRegion(repaint.left, repaint.bottom, repaint.width(), repaint.height());
+
+        scheduler.beginFrame();
+
+        egl.bindTarget();
+        if (state.viewport_width != egl.getWidth() || state.viewport_height != egl.getHeight()) {
+            state.viewport_width = egl.getWidth();
+            state.viewport_height = egl.getHeight();
+            glViewport(0, 0, state.viewport_width, state.viewport_height);
+            updateProjection(scale);
+        }
+
+        // The rest of the buffer still holds the previous frame: only the
+        // damaged area is cleared and filled, and commands outside it are dropped
+        if (partial) {
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(repaint.left, repaint.bottom, repaint.width(), repaint.height());
+            frame_commands.erase(
+                std::remove_if(frame_commands.begin(), frame_commands.end(),
+                               [this](const RenderCommand& cmd) {
+                                   return cmd.type != RenderCommand::Type::Clear &&
+                                          !damage.intersectsRepaint(cmd);
+                               }),
+                frame_commands.end());
+        }
         glClear(GL_COLOR_BUFFER_BIT);
 
-        std::vector<RenderCommand> current_commands;
-        {
-            std::lock_guard<std::mutex> queue_lock(queue_mutex);
-            current_commands.swap(command_queue);
+        resolveTextures(frame_commands);
+        buildBatches(frame_commands);
+        uploadQuads();
+
+        glActiveTexture(GL_TEXTURE0);
+        bindQuadAttributes();
+
+        // Plain rects use the variant without texture sampling
+        uint32_t current_variant = ShaderCache::VARIANT_COUNT;
+        for (const auto& batch : batches) {
+            if (batch.clear) {
+                glClear(GL_COLOR_BUFFER_BIT);
+                continue;
+            }
+            const uint32_t variant =
+                state.base_variant | (batch.texture ? ShaderCache::TEXTURED : 0u);
+            if (variant != current_variant) {
+                glUseProgram(shaders.get(variant)->id);
+                current_variant = variant;
+            }
+            if (batch.texture) {
+                glBindTexture(GL_TEXTURE_2D, batch.texture);
+            }
+            drawBatch(batch);
         }
 
-        glUseProgram(state.program_id);
+        unbindQuadAttributes();
+        if (partial) {
+            glDisable(GL_SCISSOR_TEST);
+        }
 
-        for (const auto& cmd : current_commands) {
-            switch (cmd.type) {
-                case RenderCommand::Type::DrawRect:
-                    drawRect(cmd);
-                    break;
-                case RenderCommand::Type::DrawTexture:
-                    drawTexture(cmd);
+        // Queued before the swap, which may discard a window's back buffer
+        ++frame_number;
+        if (const auto callback = currentFrameCallback()) {
+            readback.capture(frame_number, egl.getWidth(), egl.getHeight(), *callback);
+        }
+        const DamageRect& changed = damage.damage();
+        const EGLint damage_rect[4] = {changed.left, changed.bottom, changed.width(), changed.height()};
+        scheduler.endFrame(damage_rect);
+
+        publishFrameStats();
+        texture_stats.store(texture_cache.stats());
+        trackGraphicsMemory(state.texture_bytes,
+                            static_cast<size_t>(texture_cache.stats().resident_bytes));
+    }
+
+    // Design units to clip space, y down. The only per-vertex transform is
+    // this uniform, and it changes only when the surface does.
+    void updateProjection(float scale) {
+        const float sx = 2.0f * scale / static_cast<float>(state.viewport_width);
+        const float sy = -2.0f * scale / static_cast<float>(state.viewport_height);
+        const GLfloat projection[16] = {
+            sx,    0.0f, 0.0f, 0.0f,
+            0.0f,  sy,   0.0f, 0.0f,
+            0.0f,  0.0f, 1.0f, 0.0f,
+            -1.0f, 1.0f, 0.0f, 1.0f
+        };
+        for (uint32_t variant : {state.base_variant, state.base_variant | ShaderCache::TEXTURED}) {
+            const ShaderCache::Program* program = shaders.get(variant);
+            glUseProgram(program->id);
+            glUniformMatrix4fv(program->u_mvpMatrix, 1, GL_FALSE, projection);
+        }
+    }
+
+    void publishFrameStats() {
+        FrameStats stats = scheduler.stats();
+        stats.skipped_frames = skipped_frames;
+        frame_stats.store(stats);
+    }
+
+    // Map every textured command to its place in the cache and send the
+    // frame's misses before anything is drawn. Cached content is not
+    // uploaded again, and atlas neighbours end up in the same batch.
+    void resolveTextures(const std::vector<RenderCommand>& commands) {
+        texture_cache.beginFrame();
+        command_regions.resize(commands.size());
+        for (size_t i = 0; i < commands.size(); ++i) {
+            const RenderCommand& cmd = commands[i];
+            if (cmd.type != RenderCommand::Type::DrawTexture) {
+                command_regions[i] = TextureRegion{};
+                continue;
+            }
+            const int width = cmd.texture_width > 0 ? cmd.texture_width
+                                                    : static_cast<int>(cmd.width);
+            const int height = cmd.texture_height > 0 ? cmd.texture_height
+                                                      : static_cast<int>(cmd.height);
+            command_regions[i] = texture_cache.acquire(cmd.texture_handle, cmd.texture_data,
+                                                       width, height);
+        }
+        texture_cache.flushUploads();
+    }
+
+    static bool overlaps(const Batch& batch, float left, float top, float right, float bottom) {
+        return left < batch.right && right > batch.left && top < batch.bottom && bottom > batch.top;
+    }
+
+    // Group commands into batches by texture object. A command joins an earlier batch
+    // with the same texture only if no batch in between overlaps it, so the
+    // result looks exactly like drawing the commands one by one.
+    void buildBatches(const std::vector<RenderCommand>& commands) {
+        batches.clear();
+        command_batch.assign(commands.size(), 0);
+        size_t segment_start = 0;
+
+        for (size_t i = 0; i < commands.size(); ++i) {
+            const RenderCommand& cmd = commands[i];
+            if (cmd.type == RenderCommand::Type::Clear) {
+                batches.push_back(Batch{true, 0, 0.0f, 0.0f, 0.0f, 0.0f, 0, 0});
+                segment_start = batches.size();
+                command_batch[i] = batches.size() - 1;
+                continue;
+            }
+
+            const GLuint texture = command_regions[i].texture;
+            const float left = std::min(cmd.x, cmd.x + cmd.width);
+            const float right = std::max(cmd.x, cmd.x + cmd.width);
+            const float top = std::min(cmd.y, cmd.y + cmd.height);
+            const float bottom = std::max(cmd.y, cmd.y + cmd.height);
+
+            size_t target = batches.size();
+            const size_t limit = batches.size() - std::min(batches.size() - segment_start,
+                                                           BATCH_LOOKBACK);
+            for (size_t j = batches.size(); j-- > limit;) {
+                const Batch& candidate = batches[j];
+                if (!candidate.clear && candidate.texture == texture) {
+                    target = j;
                     break;
-                case RenderCommand::Type::Clear:
-                    glClear(GL_COLOR_BUFFER_BIT);
+                }
+                if (overlaps(candidate, left, top, right, bottom)) {
                     break;
+                }
             }
+
+            if (target == batches.size()) {
+                batches.push_back(Batch{false, texture, left, top, right, bottom, 0, 0});
+            } else {
+                Batch& batch = batches[target];
+                batch.left = std::min(batch.left, left);
+                batch.top = std::min(batch.top, top);
+                batch.right = std::max(batch.right, right);
+                batch.bottom = std::max(batch.bottom, bottom);
+            }
+            batches[target].count++;
+            command_batch[i] = target;
         }
 
-        glFinish();
+        // Lay the quads out batch after batch, keeping submission order inside each
+        size_t total = 0;
+        for (auto& batch : batches) {
+            batch.first = total;
+            total += batch.count;
+            batch.count = 0;
+        }
+
+        instances.resize(total);
+        for (size_t i = 0; i < commands.size(); ++i) {
+            const RenderCommand& cmd = commands[i];
+            if (cmd.type == RenderCommand::Type::Clear) {
+                continue;
+            }
+            Batch& batch = batches[command_batch[i]];
+            const TextureRegion& region = command_regions[i];
+            instances[batch.first + batch.count++] = QuadInstance{
+                cmd.x, cmd.y, cmd.width, cmd.height, region.u0, region.v0, region.u1, region.v1
+            };
+        }
     }
 
-    void drawRect(const RenderCommand& cmd) {
-        const float vertices[] = {
-            cmd.x, cmd.y,
-            cmd.x + cmd.width, cmd.y,
-            cmd.x, cmd.y + cmd.height,
-            cmd.x + cmd.width, cmd.y + cmd.height
-        };
+    // The whole frame goes to the GPU in one upload. Orphaning the buffer
+    // lets the driver hand out fresh storage instead of waiting for the
+    // previous frame to finish reading it.
+    void uploadQuads() {
+        const void* data = instances.data();
+        size_t bytes = instances.size() * sizeof(QuadInstance);
+        if (!state.instancing.available()) {
+            expandQuads();
+            data = vertices.data();
+            bytes = vertices.size() * sizeof(Vertex);
+        }
+        if (bytes == 0) {
+            return;
+        }
 
         glBindBuffer(GL_ARRAY_BUFFER, state.vertex_buffer);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-        
-        GLint pos_attrib = glGetAttribLocation(state.program_id, "a_position");
-        glEnableVertexAttribArray(pos_attrib);
-        glVertexAttribPointer(pos_attrib, 2, GL_FLOAT, GL_FALSE, 0, 0);
-        
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        if (bytes > state.vertex_buffer_capacity) {
+            const size_t grown = std::max(bytes, state.vertex_buffer_capacity * 2);
+            trackGraphicsMemory(state.vertex_buffer_bytes,
+                                state.vertex_buffer_bytes - state.vertex_buffer_capacity + grown);
+            state.vertex_buffer_capacity = grown;
+        }
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(state.vertex_buffer_capacity),
+                     nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(bytes), data);
     }
 
-    void drawTexture(const RenderCommand& cmd) {
-        glBindTexture(GL_TEXTURE_2D, state.texture_id);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, cmd.width, cmd.height,
-                    0, GL_RGBA, GL_UNSIGNED_BYTE, cmd.texture_data);
-        
-        drawRect(cmd);
+    // Four corners per quad for the path without instancing. Each corner is
+    // a lane shuffle of the quad's two float4 halves, so the loop is a pair
+    // of loads and four stores per quad with no matrix math.
+    void expandQuads() {
+        static_assert(sizeof(QuadInstance) == 8 * sizeof(float), "QuadInstance is two float4");
+        static_assert(sizeof(Vertex) == 4 * sizeof(float), "Vertex is one float4");
+
+        vertices.resize(instances.size() * 4);
+        const float* in = reinterpret_cast<const float*>(instances.data());
+        float* out = reinterpret_cast<float*>(vertices.data());
+        for (size_t i = 0; i < instances.size(); ++i, in += 8, out += 16) {
+#if defined(__SSE2__)
+            const __m128 rect = _mm_loadu_ps(in);      // x, y, w, h
+            const __m128 uv = _mm_loadu_ps(in + 4);    // u0, v0, u1, v1
+            // x, y, x + w, y + h
+            const __m128 edges = _mm_movelh_ps(rect, _mm_add_ps(rect, _mm_movehl_ps(rect, rect)));
+            _mm_storeu_ps(out, _mm_movelh_ps(edges, uv));
+            _mm_storeu_ps(out + 4, _mm_shuffle_ps(edges, uv, _MM_SHUFFLE(1, 2, 1, 2)));
+            _mm_storeu_ps(out + 8, _mm_shuffle_ps(edges, uv, _MM_SHUFFLE(3, 0, 3, 0)));
+            _mm_storeu_ps(out + 12, _mm_movehl_ps(uv, edges));
+#elif defined(__ARM_NEON)
+            const float32x4_t rect = vld1q_f32(in);
+            const float32x4_t uv = vld1q_f32(in + 4);
+            const float32x2_t origin = vget_low_f32(rect);                        // x, y
+            const float32x2_t end = vadd_f32(origin, vget_high_f32(rect));        // x + w, y + h
+            const float32x2_t uv0 = vget_low_f32(uv);                             // u0, v0
+            const float32x2_t uv1 = vget_high_f32(uv);                            // u1, v1
+            vst1q_f32(out, vcombine_f32(origin, uv0));
+            vst1q_f32(out + 4, vcombine_f32(vset_lane_f32(vget_lane_f32(end, 0), origin, 0),
+                                            vset_lane_f32(vget_lane_f32(uv1, 0), uv0, 0)));
+            vst1q_f32(out + 8, vcombine_f32(vset_lane_f32(vget_lane_f32(origin, 0), end, 0),
+                                            vset_lane_f32(vget_lane_f32(uv0, 0), uv1, 0)));
+            vst1q_f32(out + 12, vcombine_f32(end, uv1));
+#else
+            const float right = in[0] + in[2];
+            const float bottom = in[1] + in[3];
+            const float corners[16] = {
+                in[0], in[1], in[4], in[5],
+                right, in[1], in[6], in[5],
+                in[0], bottom, in[4], in[7],
+                right, bottom, in[6], in[7]
+            };
+            std::memcpy(out, corners, sizeof(corners));
+#endif
+        }
+    }
+
+    // Every variant has the same attribute locations, so this holds across program switches
+    void bindQuadAttributes() {
+        if (state.instancing.available()) {
+            glBindBuffer(GL_ARRAY_BUFFER, state.corner_buffer);
+            glEnableVertexAttribArray(ShaderCache::ATTRIB_CORNER);
+            glVertexAttribPointer(ShaderCache::ATTRIB_CORNER, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+            glEnableVertexAttribArray(ShaderCache::ATTRIB_RECT);
+            glEnableVertexAttribArray(ShaderCache::ATTRIB_UV_RECT);
+            state.instancing.vertexAttribDivisor(ShaderCache::ATTRIB_RECT, 1);
+            state.instancing.vertexAttribDivisor(ShaderCache::ATTRIB_UV_RECT, 1);
+        } else {
+            glEnableVertexAttribArray(ShaderCache::ATTRIB_POSITION);
+            glEnableVertexAttribArray(ShaderCache::ATTRIB_TEXCOORD);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, state.index_buffer);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, state.vertex_buffer);
+    }
+
+    void unbindQuadAttributes() {
+        if (state.instancing.available()) {
+            state.instancing.vertexAttribDivisor(ShaderCache::ATTRIB_RECT, 0);
+            state.instancing.vertexAttribDivisor(ShaderCache::ATTRIB_UV_RECT, 0);
+            glDisableVertexAttribArray(ShaderCache::ATTRIB_CORNER);
+            glDisableVertexAttribArray(ShaderCache::ATTRIB_RECT);
+            glDisableVertexAttribArray(ShaderCache::ATTRIB_UV_RECT);
+        } else {
+            glDisableVertexAttribArray(ShaderCache::ATTRIB_POSITION);
+            glDisableVertexAttribArray(ShaderCache::ATTRIB_TEXCOORD);
+        }
+    }
+
+    void drawBatch(const Batch& batch) {
+        if (state.instancing.available()) {
+            // ES 2.0 instancing has no base instance, so the attribute start moves instead
+            const size_t offset = batch.first * sizeof(QuadInstance);
+            glVertexAttribPointer(ShaderCache::ATTRIB_RECT, 4, GL_FLOAT, GL_FALSE,
+                                  sizeof(QuadInstance), reinterpret_cast<const void*>(offset));
+            glVertexAttribPointer(ShaderCache::ATTRIB_UV_RECT, 4, GL_FLOAT, GL_FALSE,
+                                  sizeof(QuadInstance),
+                                  reinterpret_cast<const void*>(offset + 4 * sizeof(float)));
+            state.instancing.drawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
+                                                 static_cast<GLsizei>(batch.count));
+            return;
+        }
+
+        for (size_t done = 0; done < batch.count; done += MAX_INDEXED_QUADS) {
+            const size_t quads = std::min(batch.count - done, MAX_INDEXED_QUADS);
+            const size_t offset = (batch.first + done) * 4 * sizeof(Vertex);
+            glVertexAttribPointer(ShaderCache::ATTRIB_POSITION, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                                  reinterpret_cast<const void*>(offset));
+            glVertexAttribPointer(ShaderCache::ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                                  reinterpret_cast<const void*>(offset + 2 * sizeof(float)));
+            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(quads * 6), GL_UNSIGNED_SHORT, nullptr);
+        }
     }
 
 public:
     Impl() {
         render_thread.running = true;
         render_thread.thread = std::thread([this]() {
+            if (Tracer::enabled()) {
+                Tracer::instance().setThreadName("RenderThread");
+            }
             renderLoop();
         });
     }
@@ -204,46 +666,187 @@ public:
         if (render_thread.thread.joinable()) {
             render_thread.thread.join();
         }
-
-        cleanup();
     }
 
     void renderLoop() {
+        {
+            std::unique_lock<std::mutex> lock(render_thread.mutex);
+            render_thread.cv.wait(lock, [this]() {
+                return !render_thread.running || render_thread.init_requested;
+            });
+            if (!render_thread.running) {
+                return;
+            }
+        }
+
+        const std::string error = createContext();
+        render_thread.init_result.set_value(error);
+        if (!error.empty()) {
+            releaseContext();
+            return;
+        }
+
         while (true) {
+            bool frame_due = true;
             {
                 std::unique_lock<std::mutex> lock(render_thread.mutex);
-                render_thread.cv.wait(lock, [this]() {
-                    return !render_thread.running || !command_queue.empty();
-                });
+                auto ready = [this]() {
+                    // Clearing the flag first means a producer publishing after
+                    // this check sees it unset and notifies under the mutex
+                    render_thread.wake_pending.exchange(false);
+                    return !render_thread.running ||
+                           (render_thread.surface_ready.load() && !command_ring.empty());
+                };
+                // Finished readbacks are delivered even when nothing new is drawn
+                if (readback.hasPending()) {
+                    frame_due = render_thread.cv.wait_for(lock, READBACK_POLL, ready);
+                } else {
+                    render_thread.cv.wait(lock, ready);
+                }
 
                 if (!render_thread.running) {
                     break;
                 }
             }
 
-            renderFrame();
-            std::this_thread::sleep_for(std::chrono::milliseconds(16)); // ~60 FPS
+            if (frame_due) {
+                // Commands keep arriving while the scheduler waits for the
+                // deadline, and the frame picks up all of them
+                scheduler.waitForFrame();
+                renderFrame();
+                publishFinished();
+            }
+            collectFrames(false);
         }
+
+        releaseContext();
     }
 
+    // The context is created on the render thread; the caller waits for it
     void initialize(const RenderConfig& cfg) {
-        config = cfg;
-        if (!initGLContext()) {
-            throw std::runtime_error("Failed to initialize GL context");
+        if (state.initialized) {
+            return;
         }
-    }
 
-    void submitCommand(const RenderCommand& cmd) {
+        std::future<std::string> result;
         {
-            std::lock_guard<std::mutex> lock(queue_mutex);
-            command_queue.push_back(cmd);
+            std::lock_guard<std::mutex> lock(render_thread.mutex);
+            if (render_thread.init_requested) {
+                throw std::runtime_error("Renderer initialization already failed");
+            }
+            config = cfg;
+            render_thread.init_requested = true;
+            result = render_thread.init_result.get_future();
         }
         render_thread.cv.notify_one();
+
+        const std::string error = result.get();
+        if (!error.empty()) {
+            throw std::runtime_error("Failed to initialize GL context: " + error);
+        }
+    }
+
+    void setFrameCallback(FrameCallback callback) {
+        auto stored = callback ? std::make_shared<const FrameCallback>(std::move(callback))
+                               : nullptr;
+        {
+            std::lock_guard<std::mutex> lock(callback_mutex);
+            frame_callback = std::move(stored);
+        }
+        // A new reader gets the next frame even if nothing on screen changes
+        redraw_requested.store(true);
+    }
+
+    // Commands of one call reach the render thread together, so a frame
+    // never shows half of a submission. Larger spans than the ring holds
+    // are split.
+    bool submitCommands(const RenderCommand* commands, size_t count) {
+        bool accepted = true;
+        while (count > 0) {
+            const size_t chunk = std::min(count, command_ring.capacity());
+            while (!command_ring.tryPush(commands, chunk)) {
+                // Without a context and a surface the render thread never
+                // drains the ring, so waiting for space would never end
+                if (!canDraw()) {
+                    dropped_commands.fetch_add(count);
+                    accepted = false;
+                    break;
+                }
+                waitForSpace();
+            }
+            if (!accepted) {
+                break;
+            }
+            submitted_commands.fetch_add(chunk);
+            commands += chunk;
+            count -= chunk;
+        }
+        wakeRenderer();
+        return accepted;
+    }
+
+    // The render thread has somewhere to draw the commands
+    bool canDraw() const {
+        return state.initialized.load() && render_thread.surface_ready.load();
+    }
+
+    bool waitForIdle(std::chrono::milliseconds timeout) {
+        const uint64_t target = submitted_commands.load();
+        std::unique_lock<std::mutex> lock(render_thread.mutex);
+        return render_thread.idle_cv.wait_for(lock, timeout, [this, target]() {
+            return finished_commands.load() >= target;
+        });
+    }
+
+    // Waiters check the count under the mutex, so the store is made under it too
+    void publishFinished() {
+        if (finished_commands.load(std::memory_order_relaxed) == drained_commands) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(render_thread.mutex);
+            finished_commands.store(drained_commands);
+        }
+        render_thread.idle_cv.notify_all();
+    }
+
+    // Only the first producer after a frame starts pays for the mutex
+    void wakeRenderer() {
+        if (!render_thread.wake_pending.exchange(true)) {
+            {
+                std::lock_guard<std::mutex> lock(render_thread.mutex);
+            }
+            render_thread.cv.notify_one();
+        }
+    }
+
+    // The ring is full: let the render thread catch up
+    void waitForSpace() {
+        render_thread.waiting_producers.fetch_add(1);
+        wakeRenderer();
+        {
+            std::unique_lock<std::mutex> lock(render_thread.mutex);
+            render_thread.space_cv.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        render_thread.waiting_producers.fetch_sub(1);
+    }
+
+    void releaseProducers() {
+        if (render_thread.waiting_producers.load() > 0) {
+            {
+                std::lock_guard<std::mutex> lock(render_thread.mutex);
+            }
+            render_thread.space_cv.notify_all();
+        }
     }
 
     void onSurfaceCreated() {
-        std::lock_guard<std::mutex> lock(state.state_mutex);
-        state.surface_created = true;
+        {
+            std::lock_guard<std::mutex> lock(state.state_mutex);
+            state.surface_created = true;
+        }
+        render_thread.surface_ready.store(true);
+        wakeRenderer();
     }
 
     void onSurfaceChanged(int width, int height) {
@@ -256,9 +859,16 @@ public:
     void cleanup() {
         std::lock_guard<std::mutex> lock(state.state_mutex);
         if (state.initialized) {
-            glDeleteProgram(state.program_id);
+            shaders.release();
             glDeleteBuffers(1, &state.vertex_buffer);
-            glDeleteTextures(1, &state.texture_id);
+            glDeleteBuffers(1, &state.corner_buffer);
+            glDeleteBuffers(1, &state.index_buffer);
+            texture_cache.release();
+            scheduler.release();
+            trackGraphicsMemory(state.vertex_buffer_bytes, 0);
+            trackGraphicsMemory(state.texture_bytes, 0);
+            state.viewport_width = 0;
+            state.viewport_height = 0;
             state.initialized = false;
         }
     }
@@ -270,6 +880,16 @@ public:
     float getScaleFactor() const {
         return state.scale_factor;
     }
+
+    TextureStats getTextureStats() const {
+        return texture_stats.load();
+    }
+
+    FrameStats getFrameStats() const {
+        FrameStats stats = frame_stats.load();
+        stats.dropped_commands = dropped_commands.load();
+        return stats;
+    }
 };
 
 // Реализация публичного интерфейса
@@ -280,8 +900,16 @@ void Renderer::initialize(const RenderConfig& config) {
     impl->initialize(config);
 }
 
-void Renderer::submitCommand(const RenderCommand& command) {
-    impl->submitCommand(command);
+bool Renderer::submitCommand(const RenderCommand& command) {
+    return impl->submitCommands(&command, 1);
+}
+
+bool Renderer::submitCommands(const RenderCommand* commands, size_t count) {
+    return impl->submitCommands(commands, count);
+}
+
+bool Renderer::waitForIdle(std::chrono::milliseconds timeout) {
+    return impl->waitForIdle(timeout);
 }
 
 void Renderer::onSurfaceCreated() {
@@ -300,4 +928,16 @@ float Renderer::getScaleFactor() const {
     return impl->getScaleFactor();
 }
 
+TextureStats Renderer::getTextureStats() const {
+    return impl->getTextureStats();
+}
+
+FrameStats Renderer::getFrameStats() const {
+    return impl->getFrameStats();
+}
+
+void Renderer::setFrameCallback(FrameCallback callback) {
+    impl->setFrameCallback(std::move(callback));
+}
+
 } // namespace anexec
\ No newline at end of file
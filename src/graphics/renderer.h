@@ -1,16 +1,32 @@
 #ifndef ANEXEC_RENDERER_H
 #define ANEXEC_RENDERER_H
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 
 namespace anexec {
 
+// Куда рисует рендерер
+enum class SurfaceType {
+    Window,         // native_window (ANativeWindow*, X11 Window, ...)
+    Pbuffer,        // Внеэкранный буфер EGL
+    Surfaceless     // Без поверхности: контекст EGL_KHR_surfaceless_context и FBO
+};
+
 struct RenderConfig {
     int design_width{1080};    // Базовая ширина для расчета масштаба
     int design_height{1920};   // Базовая высота для расчета масштаба
     bool vsync_enabled{true};  // Включена ли вертикальная синхронизация
     int msaa_samples{4};       // Количество сэмплов для MSAA
+    int refresh_rate{0};       // Гц; 0 - определить по vsync (60 Гц без дисплея)
+    SurfaceType surface_type{SurfaceType::Window};
+    void* native_window{nullptr};  // Для SurfaceType::Window
+    int gpu_index{-1};         // Устройство EGL без дисплея; -1 - по кругу между GPU
+    std::string shader_cache_dir;  // Бинарники шейдеров; пусто - компиляция при каждом запуске
 };
 
 struct RenderCommand {
@@ -20,13 +36,59 @@ struct RenderCommand {
         Clear
     } type;
 
+    // В единицах дизайна (RenderConfig::design_width), начало в левом
+    // верхнем углу, y вниз
     float x{0.0f};
     float y{0.0f};
     float width{0.0f};
     float height{0.0f};
-    void* texture_data{nullptr};
+    void* texture_data{nullptr};      // RGBA8
+    // Дескриптор содержимого texture_data: одинаковый дескриптор означает
+    // одинаковые пиксели, и такая текстура передается в GPU один раз.
+    // 0 - без кэширования, загрузка в каждом кадре.
+    uint64_t texture_handle{0};
+    // Размер текстуры в пикселях; 0 - совпадает с width/height
+    int texture_width{0};
+    int texture_height{0};
+};
+
+// Счетчики кэша текстур (обновляются после каждого кадра)
+struct TextureStats {
+    uint64_t cache_hits{0};
+    uint64_t cache_misses{0};
+    uint64_t uploaded_bytes{0};     // Всего передано в GL
+    double upload_bandwidth{0.0};   // Байт в секунду за последнее окно
+    uint32_t atlas_pages{0};
+    double atlas_occupancy{0.0};    // Доля занятой площади страниц атласа
+    uint64_t resident_bytes{0};     // Память текстур и буферов загрузки
+    uint32_t cached_textures{0};
+};
+
+// Тайминги кадров (обновляются после каждого кадра)
+struct FrameStats {
+    uint64_t frames{0};
+    uint64_t janky_frames{0};       // Показаны позже своего vsync
+    uint64_t skipped_frames{0};     // Без изменений: не рисовались и не показывались
+    uint64_t dropped_commands{0};   // Отброшены: кольцо заполнено, а рисовать некуда
+    double refresh_rate{0.0};       // Гц, по которой идет темп кадров
+    double cpu_time_ms{0.0};        // Запись команд последнего кадра
+    double gpu_time_ms{0.0};        // По таймер-запросам; 0 - не поддерживаются
+    double present_latency_ms{0.0}; // От начала кадра до завершения на GPU
+    double frame_interval_ms{0.0};  // Между двумя последними показами
+};
+
+// Готовый кадр из конвейера чтения. Пиксели RGBA8, первая строка - нижняя;
+// указатель действителен только во время вызова FrameCallback.
+struct FrameImage {
+    uint64_t frame{0};
+    int width{0};
+    int height{0};
+    size_t stride{0};
+    const uint8_t* pixels{nullptr};
 };
 
+using FrameCallback = std::function<void(const FrameImage&)>;
+
 class Renderer {
 public:
     Renderer();
@@ -37,11 +99,27 @@ public:
     Renderer& operator=(const Renderer&) = delete;
 
     void initialize(const RenderConfig& config);
-    void submitCommand(const RenderCommand& command);
+    bool submitCommand(const RenderCommand& command);
+    // Пакет команд одним вызовом: без блокировок и выделений памяти,
+    // все команды пакета попадают в один кадр. Потокобезопасно. Пока нет
+    // контекста или поверхности, команды копятся в кольце; когда оно
+    // заполнено, они отбрасываются и возвращается false: вызов не ждет
+    // места, которое некому освободить.
+    bool submitCommands(const RenderCommand* commands, size_t count);
+    // Ждет, пока поток рендеринга нарисует (или пропустит как неизмененные)
+    // все команды, отправленные до вызова. false - не дождались за timeout.
+    bool waitForIdle(std::chrono::milliseconds timeout);
     void onSurfaceCreated();
     void onSurfaceChanged(int width, int height);
     bool isInitialized() const;
     float getScaleFactor() const;
+    TextureStats getTextureStats() const;
+    FrameStats getFrameStats() const;
+
+    // Чтение кадров без остановки GPU: кадр приходит через несколько кадров
+    // после отрисовки, в потоке рендеринга. Кадр без изменений не рисуется
+    // и не приходит. nullptr выключает чтение.
+    void setFrameCallback(FrameCallback callback);
 
 private:
     class Impl;
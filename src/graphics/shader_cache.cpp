@@ -0,0 +1,395 @@
+#include "shader_cache.h"
+#include "util.h"
+#include "../core/hash.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <EGL/egl.h>
+
+namespace anexec {
+
+namespace {
+
+// One source per stage; the variant bits arrive as #defines in front of it
+const char* const VERTEX_SOURCE = R"(
+    #ifdef INSTANCED
+    attribute vec2 a_corner;
+    attribute vec4 a_rect;
+    attribute vec4 a_uvRect;
+    #else
+    attribute vec4 a_position;
+    attribute vec2 a_texCoord;
+    #endif
+    #ifdef TEXTURED
+    varying vec2 v_texCoord;
+    #endif
+    uniform mat4 u_mvpMatrix;
+
+    void main() {
+    #ifdef INSTANCED
+        vec2 position = a_rect.xy + a_corner * a_rect.zw;
+        gl_Position = u_mvpMatrix * vec4(position, 0.0, 1.0);
+    #ifdef TEXTURED
+        v_texCoord = mix(a_uvRect.xy, a_uvRect.zw, a_corner);
+    #endif
+    #else
+        gl_Position = u_mvpMatrix * a_position;
+    #ifdef TEXTURED
+        v_texCoord = a_texCoord;
+    #endif
+    #endif
+    }
+)";
+
+const char* const FRAGMENT_SOURCE = R"(
+    precision mediump float;
+    #ifdef TEXTURED
+    varying vec2 v_texCoord;
+    uniform sampler2D u_texture;
+    #endif
+
+    void main() {
+    #ifdef TEXTURED
+        gl_FragColor = texture2D(u_texture, v_texCoord);
+    #else
+        gl_FragColor = vec4(1.0);
+    #endif
+    }
+)";
+
+struct VariantDefine {
+    uint32_t bit;
+    const char* define;
+};
+
+constexpr VariantDefine VARIANT_DEFINES[] = {
+    {ShaderCache::INSTANCED, "#define INSTANCED 1\n"},
+    {ShaderCache::TEXTURED, "#define TEXTURED 1\n"},
+};
+
+constexpr char BINARY_MAGIC[8] = {'A', 'N', 'X', 'S', 'H', 'A', 'D', 'R'};
+constexpr uint32_t BINARY_VERSION = 1;
+constexpr const char* BINARY_SUFFIX = ".bin";
+
+struct BinaryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t format;    // GLenum from glGetProgramBinary
+    uint64_t key;
+    uint32_t size;
+    uint32_t reserved;
+};
+
+uint64_t hashString(uint64_t hash, const char* text) {
+    // The terminator separates neighbouring strings
+    return text ? fnv1a(hash, text, std::strlen(text) + 1) : fnv1a(hash, "", 1);
+}
+
+bool readAll(int fd, void* buf, size_t size) {
+    auto* out = static_cast<uint8_t*>(buf);
+    while (size > 0) {
+        ssize_t n = ::read(fd, out, size);
+        if (n <= 0) {
+            return false;
+        }
+        out += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool writeAll(int fd, const void* buf, size_t size) {
+    const auto* in = static_cast<const uint8_t*>(buf);
+    while (size > 0) {
+        ssize_t n = ::write(fd, in, size);
+        if (n <= 0) {
+            return false;
+        }
+        in += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+std::string variantSource(uint32_t variant, const char* source) {
+    std::string result;
+    for (const auto& entry : VARIANT_DEFINES) {
+        if (variant & entry.bit) {
+            result += entry.define;
+        }
+    }
+    result += source;
+    return result;
+}
+
+} // namespace
+
+ShaderCache::~ShaderCache() {
+    release();
+}
+
+void ShaderCache::initialize(const std::string& binary_dir) {
+    if (initialized) {
+        return;
+    }
+    dir = binary_dir;
+    loadFunctions();
+
+    driver_hash = FNV1A_OFFSET_BASIS;
+    driver_hash = hashString(driver_hash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    driver_hash = hashString(driver_hash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    driver_hash = hashString(driver_hash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    loaded_binaries = 0;
+    compiled_programs = 0;
+    initialized = true;
+}
+
+void ShaderCache::release() {
+    if (!initialized) {
+        return;
+    }
+    for (auto& entry : entries) {
+        if (entry.program.id) {
+            glDeleteProgram(entry.program.id);
+        }
+        entry = Entry{};
+    }
+    initialized = false;
+}
+
+const ShaderCache::Program* ShaderCache::get(uint32_t variant) {
+    if (!initialized || variant >= VARIANT_COUNT) {
+        return nullptr;
+    }
+    Entry& entry = entries[variant];
+    if (!entry.attempted) {
+        entry.attempted = true;
+
+        const std::string vertex = variantSource(variant, VERTEX_SOURCE);
+        const std::string fragment = variantSource(variant, FRAGMENT_SOURCE);
+        const uint64_t key = programKey(vertex, fragment);
+        if (loadBinary(key, entry.program)) {
+            loaded_binaries++;
+        } else if (link(vertex, fragment, entry.program)) {
+            compiled_programs++;
+            storeBinary(key, entry.program);
+        }
+    }
+    return entry.program.id ? &entry.program : nullptr;
+}
+
+void ShaderCache::loadFunctions() {
+    functions = Functions{};
+    if (dir.empty()) {
+        return;
+    }
+
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    if (version && std::strncmp(version, "OpenGL ES 3", 11) == 0) {
+        functions.getProgramBinary = reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(
+            eglGetProcAddress("glGetProgramBinary"));
+        functions.programBinary = reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(
+            eglGetProcAddress("glProgramBinary"));
+        functions.programParameteri = reinterpret_cast<PFNGLPROGRAMPARAMETERIPROC>(
+            eglGetProcAddress("glProgramParameteri"));
+    } else if (hasExtension(extensions, "GL_OES_get_program_binary")) {
+        functions.getProgramBinary = reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(
+            eglGetProcAddress("glGetProgramBinaryOES"));
+        functions.programBinary = reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(
+            eglGetProcAddress("glProgramBinaryOES"));
+    } else {
+        return;
+    }
+
+    // A driver may expose the entry points and still support no formats
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+    if (formats <= 0) {
+        functions = Functions{};
+    }
+}
+
+uint64_t ShaderCache::programKey(const std::string& vertex, const std::string& fragment) const {
+    uint64_t hash = driver_hash;
+    hash = hashString(hash, vertex.c_str());
+    hash = hashString(hash, fragment.c_str());
+    return hash;
+}
+
+std::string ShaderCache::binaryPath(uint64_t key) const {
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return dir + "/" + name + BINARY_SUFFIX;
+}
+
+bool ShaderCache::loadBinary(uint64_t key, Program& program) {
+    if (!functions.available()) {
+        return false;
+    }
+    int fd = ::open(binaryPath(key).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    BinaryHeader header;
+    std::vector<uint8_t> binary;
+    bool ok = readAll(fd, &header, sizeof(header)) &&
+              std::memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0 &&
+              header.version == BINARY_VERSION && header.key == key && header.size > 0;
+    if (ok) {
+        binary.resize(header.size);
+        ok = readAll(fd, binary.data(), binary.size());
+    }
+    ::close(fd);
+    if (!ok) {
+        return false;
+    }
+
+    // A driver update can reject an old binary; the caller then compiles from source
+    program.id = glCreateProgram();
+    functions.programBinary(program.id, header.format, binary.data(),
+                            static_cast<GLint>(binary.size()));
+    GLint link_status = 0;
+    glGetProgramiv(program.id, GL_LINK_STATUS, &link_status);
+    if (!link_status) {
+        glDeleteProgram(program.id);
+        program = Program{};
+        return false;
+    }
+    resolveUniforms(program);
+    return true;
+}
+
+void ShaderCache::storeBinary(uint64_t key, const Program& program) {
+    if (!functions.available()) {
+        return;
+    }
+    GLint length = 0;
+    glGetProgramiv(program.id, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<uint8_t> binary(static_cast<size_t>(length));
+    GLsizei written = 0;
+    GLenum format = 0;
+    functions.getProgramBinary(program.id, length, &written, &format, binary.data());
+    if (written <= 0) {
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        return;
+    }
+
+    BinaryHeader header;
+    std::memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.format = format;
+    header.key = key;
+    header.size = static_cast<uint32_t>(written);
+    header.reserved = 0;
+
+    // Written aside and renamed, so other processes never load half a file
+    const std::string path = binaryPath(key);
+    const std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    // Synced before the rename: after a crash the final name never holds a
+    // binary whose blocks did not reach the disk
+    bool ok = writeAll(fd, &header, sizeof(header)) &&
+              writeAll(fd, binary.data(), static_cast<size_t>(written)) &&
+              fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        unlink(tmp_path.c_str());
+    }
+}
+
+bool ShaderCache::link(const std::string& vertex, const std::string& fragment, Program& program) {
+    GLuint vertex_shader = compile(GL_VERTEX_SHADER, vertex);
+    GLuint fragment_shader = compile(GL_FRAGMENT_SHADER, fragment);
+    if (!vertex_shader || !fragment_shader) {
+        glDeleteShader(vertex_shader);
+        glDeleteShader(fragment_shader);
+        return false;
+    }
+
+    program.id = glCreateProgram();
+    glAttachShader(program.id, vertex_shader);
+    glAttachShader(program.id, fragment_shader);
+    bindAttributes(program.id);
+    if (functions.programParameteri) {
+        functions.programParameteri(program.id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(program.id);
+
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    GLint link_status;
+    glGetProgramiv(program.id, GL_LINK_STATUS, &link_status);
+    if (!link_status) {
+        GLint log_length;
+        glGetProgramiv(program.id, GL_INFO_LOG_LENGTH, &log_length);
+        std::vector<char> log(std::max(log_length, 1));
+        glGetProgramInfoLog(program.id, log_length, nullptr, log.data());
+        std::cerr << "Program linking failed: " << log.data() << std::endl;
+        glDeleteProgram(program.id);
+        program = Program{};
+        return false;
+    }
+    resolveUniforms(program);
+    return true;
+}
+
+GLuint ShaderCache::compile(GLenum type, const std::string& source) {
+    GLuint shader = glCreateShader(type);
+    const char* text = source.c_str();
+    glShaderSource(shader, 1, &text, nullptr);
+    glCompileShader(shader);
+
+    GLint compile_status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
+    if (!compile_status) {
+        GLint log_length;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_length);
+        std::vector<char> log(std::max(log_length, 1));
+        glGetShaderInfoLog(shader, log_length, nullptr, log.data());
+        std::cerr << "Shader compilation failed: " << log.data() << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// Names that a variant does not declare are ignored by the linker
+void ShaderCache::bindAttributes(GLuint id) {
+    glBindAttribLocation(id, ATTRIB_POSITION, "a_position");
+    glBindAttribLocation(id, ATTRIB_TEXCOORD, "a_texCoord");
+    glBindAttribLocation(id, ATTRIB_CORNER, "a_corner");
+    glBindAttribLocation(id, ATTRIB_RECT, "a_rect");
+    glBindAttribLocation(id, ATTRIB_UV_RECT, "a_uvRect");
+}
+
+// Uniform values are not part of a binary, so they are set here for both paths
+void ShaderCache::resolveUniforms(Program& program) {
+    program.u_mvpMatrix = glGetUniformLocation(program.id, "u_mvpMatrix");
+    program.u_texture = glGetUniformLocation(program.id, "u_texture");
+    if (program.u_texture >= 0) {
+        glUseProgram(program.id);
+        glUniform1i(program.u_texture, 0);
+    }
+}
+
+} // namespace anexec
@@ -0,0 +1,90 @@
+#ifndef ANEXEC_SHADER_CACHE_H
+#define ANEXEC_SHADER_CACHE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+
+namespace anexec {
+
+// Программы рендерера по вариантам. Вариант - битовая маска возможностей,
+// каждый бит превращается в #define перед общим исходником шейдеров.
+// Слинкованные программы сохраняются в binary_dir через
+// GL_OES_get_program_binary (в ES 3.0 - в ядре), при следующем запуске
+// программа загружается без компиляции. Ключ файла включает драйвер и
+// исходник, поэтому обновление любого из них дает промах, а не ошибку.
+// Все методы вызываются в потоке с текущим контекстом GL.
+class ShaderCache {
+public:
+    enum Variant : uint32_t {
+        INSTANCED = 1u << 0,    // Прямоугольник из атрибутов экземпляра
+        TEXTURED = 1u << 1      // Выборка из текстуры; без него - белый цвет
+    };
+    static constexpr uint32_t VARIANT_COUNT = 4;
+
+    // Атрибуты привязаны до линковки, у всех вариантов одинаковые
+    static constexpr GLuint ATTRIB_POSITION = 0;
+    static constexpr GLuint ATTRIB_TEXCOORD = 1;
+    static constexpr GLuint ATTRIB_CORNER = 0;
+    static constexpr GLuint ATTRIB_RECT = 1;
+    static constexpr GLuint ATTRIB_UV_RECT = 2;
+
+    struct Program {
+        GLuint id{0};
+        GLint u_mvpMatrix{-1};
+        GLint u_texture{-1};
+    };
+
+    ShaderCache() = default;
+    ~ShaderCache();
+
+    ShaderCache(const ShaderCache&) = delete;
+    ShaderCache& operator=(const ShaderCache&) = delete;
+
+    // binary_dir пустой - без сохранения бинарников
+    void initialize(const std::string& binary_dir);
+    void release();
+
+    // Программа варианта, собирается при первом запросе; nullptr - ошибка сборки
+    const Program* get(uint32_t variant);
+
+    uint32_t loadedBinaries() const { return loaded_binaries; }
+    uint32_t compiledPrograms() const { return compiled_programs; }
+
+private:
+    struct Functions {
+        PFNGLGETPROGRAMBINARYOESPROC getProgramBinary{nullptr};
+        PFNGLPROGRAMBINARYOESPROC programBinary{nullptr};
+        PFNGLPROGRAMPARAMETERIPROC programParameteri{nullptr};  // Только ES 3.0
+        bool available() const { return getProgramBinary && programBinary; }
+    };
+
+    struct Entry {
+        Program program;
+        bool attempted{false};
+    };
+
+    void loadFunctions();
+    uint64_t programKey(const std::string& vertex, const std::string& fragment) const;
+    std::string binaryPath(uint64_t key) const;
+    bool loadBinary(uint64_t key, Program& program);
+    void storeBinary(uint64_t key, const Program& program);
+    bool link(const std::string& vertex, const std::string& fragment, Program& program);
+    static GLuint compile(GLenum type, const std::string& source);
+    static void bindAttributes(GLuint id);
+    static void resolveUniforms(Program& program);
+
+    Functions functions;
+    Entry entries[VARIANT_COUNT];
+    std::string dir;
+    uint64_t driver_hash{0};    // GL_VENDOR, GL_RENDERER и GL_VERSION
+    uint32_t loaded_binaries{0};
+    uint32_t compiled_programs{0};
+    bool initialized{false};
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_SHADER_CACHE_H
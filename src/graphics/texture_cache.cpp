@@ -0,0 +1,466 @@
+#include "texture_cache.h"
+#include "util.h"
+#include <algorithm>
+#include <cstring>
+#include <EGL/egl.h>
+
+namespace anexec {
+
+namespace {
+
+uint64_t textureBytes(int width, int height) {
+    return static_cast<uint64_t>(width) * static_cast<uint64_t>(height) * 4;
+}
+
+} // namespace
+
+TextureCache::~TextureCache() {
+    release();
+}
+
+void TextureCache::initialize() {
+    if (initialized) {
+        return;
+    }
+
+    // Pixel unpack buffers and fences are ES 3.0 core; on ES 2.0 uploads
+    // go straight from client memory
+    pbo_functions = PixelBuffers{};
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    if (version && std::strncmp(version, "OpenGL ES 3", 11) == 0) {
+        pbo_functions.mapBufferRange = reinterpret_cast<PFNGLMAPBUFFERRANGEPROC>(
+            eglGetProcAddress("glMapBufferRange"));
+        pbo_functions.unmapBuffer = reinterpret_cast<PFNGLUNMAPBUFFERPROC>(
+            eglGetProcAddress("glUnmapBuffer"));
+        pbo_functions.fenceSync = reinterpret_cast<PFNGLFENCESYNCPROC>(
+            eglGetProcAddress("glFenceSync"));
+        pbo_functions.clientWaitSync = reinterpret_cast<PFNGLCLIENTWAITSYNCPROC>(
+            eglGetProcAddress("glClientWaitSync"));
+        pbo_functions.deleteSync = reinterpret_cast<PFNGLDELETESYNCPROC>(
+            eglGetProcAddress("glDeleteSync"));
+    }
+
+    stats_ = TextureStats{};
+    window_start_ns = nowNanoseconds();
+    window_bytes = 0;
+    initialized = true;
+}
+
+void TextureCache::release() {
+    if (!initialized) {
+        return;
+    }
+
+    for (auto& entry : entries) {
+        if (entry.second.page < 0) {
+            glDeleteTextures(1, &entry.second.texture);
+        }
+    }
+    for (auto& page : pages) {
+        glDeleteTextures(1, &page.texture);
+    }
+    releaseTransient(transient_used);
+    releaseTransient(transient_free);
+    for (size_t i = 0; i < PBO_COUNT; ++i) {
+        if (pbo_fences[i]) {
+            pbo_functions.deleteSync(pbo_fences[i]);
+            pbo_fences[i] = nullptr;
+        }
+        if (pbos[i]) {
+            glDeleteBuffers(1, &pbos[i]);
+            pbos[i] = 0;
+        }
+        pbo_capacity[i] = 0;
+    }
+
+    entries.clear();
+    pages.clear();
+    standalone_lru.clear();
+    standalone_bytes = 0;
+    transient_bytes = 0;
+    pending.clear();
+    stats_ = TextureStats{};
+    initialized = false;
+}
+
+void TextureCache::beginFrame() {
+    ++frame;
+
+    // Transient textures left unused for a whole frame are dropped,
+    // the ones used last frame become available again
+    releaseTransient(transient_free);
+    transient_free.swap(transient_used);
+}
+
+TextureRegion TextureCache::acquire(uint64_t handle, const void* pixels, int width, int height) {
+    if (!pixels || width <= 0 || height <= 0) {
+        return TextureRegion{};
+    }
+
+    if (handle == 0) {
+        // Nothing identifies the content, so it is uploaded every frame
+        stats_.cache_misses++;
+        auto it = std::find_if(transient_free.begin(), transient_free.end(), [&](const Entry& e) {
+            return e.width == width && e.height == height;
+        });
+        Entry entry;
+        if (it != transient_free.end()) {
+            entry = *it;
+            transient_free.erase(it);
+        } else {
+            entry.texture = createTexture(width, height);
+            entry.width = width;
+            entry.height = height;
+            transient_bytes += textureBytes(width, height);
+        }
+        transient_used.push_back(entry);
+        pending.push_back(PendingUpload{entry.texture, 0, 0, width, height, false, pixels});
+        return regionOf(entry);
+    }
+
+    auto found = entries.find(handle);
+    if (found != entries.end()) {
+        Entry& entry = found->second;
+        if (entry.width == width && entry.height == height) {
+            stats_.cache_hits++;
+            entry.last_used = frame;
+            if (entry.page >= 0) {
+                pages[static_cast<size_t>(entry.page)].last_used = frame;
+            } else {
+                standalone_lru.splice(standalone_lru.end(), standalone_lru, entry.lru);
+            }
+            return regionOf(entry);
+        }
+        // Same handle with new dimensions means new content
+        dropEntry(handle);
+    }
+
+    stats_.cache_misses++;
+    Entry entry;
+    entry.width = width;
+    entry.height = height;
+    entry.last_used = frame;
+
+    if (width <= MAX_ATLAS_SIZE && height <= MAX_ATLAS_SIZE && allocateInAtlas(width, height, entry)) {
+        pending.push_back(PendingUpload{pages[static_cast<size_t>(entry.page)].texture,
+                                        entry.x - PADDING, entry.y - PADDING,
+                                        width, height, true, pixels});
+    } else {
+        const uint64_t bytes = textureBytes(width, height);
+        evictStandalone(bytes);
+        entry.page = -1;
+        entry.texture = createTexture(width, height);
+        standalone_bytes += bytes;
+        entry.lru = standalone_lru.insert(standalone_lru.end(), handle);
+        pending.push_back(PendingUpload{entry.texture, 0, 0, width, height, false, pixels});
+    }
+
+    auto inserted = entries.emplace(handle, entry).first;
+    return regionOf(inserted->second);
+}
+
+void TextureCache::flushUploads() {
+    if (pending.empty()) {
+        updateStats(0);
+        return;
+    }
+
+    std::vector<size_t> offsets(pending.size());
+    size_t total = 0;
+    for (size_t i = 0; i < pending.size(); ++i) {
+        const PendingUpload& upload = pending[i];
+        offsets[i] = total;
+        total += static_cast<size_t>(textureBytes(
+            upload.width + (upload.padded ? 2 * PADDING : 0),
+            upload.height + (upload.padded ? 2 * PADDING : 0)));
+    }
+
+    auto uploadRect = [](const PendingUpload& upload, const void* data) {
+        const int border = upload.padded ? PADDING : 0;
+        glBindTexture(GL_TEXTURE_2D, upload.texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, upload.x, upload.y,
+                        upload.width + 2 * border, upload.height + 2 * border,
+                        GL_RGBA, GL_UNSIGNED_BYTE, data);
+    };
+
+    bool uploaded = false;
+    if (pbo_functions.available()) {
+        // The frame's uploads share one staging buffer. The driver copies from
+        // it to the textures asynchronously, so the CPU only waits if the buffer
+        // from PBO_COUNT frames ago is somehow still in flight.
+        const size_t index = static_cast<size_t>(frame % PBO_COUNT);
+        if (pbo_fences[index]) {
+            pbo_functions.clientWaitSync(pbo_fences[index], GL_SYNC_FLUSH_COMMANDS_BIT,
+                                         GL_TIMEOUT_IGNORED);
+            pbo_functions.deleteSync(pbo_fences[index]);
+            pbo_fences[index] = nullptr;
+        }
+        if (!pbos[index]) {
+            glGenBuffers(1, &pbos[index]);
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[index]);
+        if (total > pbo_capacity[index]) {
+            pbo_capacity[index] = std::max(total, pbo_capacity[index] * 2);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(pbo_capacity[index]),
+                         nullptr, GL_STREAM_DRAW);
+        }
+
+        // The fence above guarantees the GPU is done with this buffer
+        auto* mapped = static_cast<uint8_t*>(pbo_functions.mapBufferRange(
+            GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(total),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        if (mapped) {
+            for (size_t i = 0; i < pending.size(); ++i) {
+                writeUpload(pending[i], mapped + offsets[i]);
+            }
+            pbo_functions.unmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            for (size_t i = 0; i < pending.size(); ++i) {
+                uploadRect(pending[i], reinterpret_cast<const void*>(offsets[i]));
+            }
+            pbo_fences[index] = pbo_functions.fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            uploaded = true;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    if (!uploaded) {
+        for (const auto& upload : pending) {
+            if (!upload.padded) {
+                uploadRect(upload, upload.pixels);
+                continue;
+            }
+            scratch.resize(static_cast<size_t>(textureBytes(upload.width + 2 * PADDING,
+                                                            upload.height + 2 * PADDING)));
+            writeUpload(upload, scratch.data());
+            uploadRect(upload, scratch.data());
+        }
+    }
+
+    pending.clear();
+    updateStats(total);
+}
+
+bool TextureCache::allocateInAtlas(int width, int height, Entry& entry) {
+    const int padded_width = width + 2 * PADDING;
+    const int padded_height = height + 2 * PADDING;
+
+    auto place = [&](size_t index) {
+        Page& page = pages[index];
+        int x, y;
+        if (!allocateInPage(page, padded_width, padded_height, x, y)) {
+            return false;
+        }
+        page.used_area += static_cast<uint64_t>(padded_width) * static_cast<uint64_t>(padded_height);
+        page.last_used = frame;
+        entry.page = static_cast<int>(index);
+        entry.x = x + PADDING;
+        entry.y = y + PADDING;
+        return true;
+    };
+
+    for (size_t i = 0; i < pages.size(); ++i) {
+        if (place(i)) {
+            return true;
+        }
+    }
+    if (pages.size() < MAX_PAGES) {
+        return place(static_cast<size_t>(createPage()));
+    }
+
+    // All pages are full: recycle the least recently used one, but never
+    // a page that already holds quads of the current frame
+    size_t victim = pages.size();
+    for (size_t i = 0; i < pages.size(); ++i) {
+        if (pages[i].last_used < frame &&
+            (victim == pages.size() || pages[i].last_used < pages[victim].last_used)) {
+            victim = i;
+        }
+    }
+    if (victim == pages.size()) {
+        return false;
+    }
+    resetPage(victim);
+    return place(victim);
+}
+
+bool TextureCache::allocateInPage(Page& page, int width, int height, int& x, int& y) {
+    // Best fit among shelves that waste at most a quarter of their height,
+    // then a new shelf, then any shelf that still fits
+    Shelf* best = nullptr;
+    Shelf* loose = nullptr;
+    for (auto& shelf : page.shelves) {
+        if (shelf.height < height || PAGE_SIZE - shelf.x < width) {
+            continue;
+        }
+        if (shelf.height - height <= shelf.height / 4) {
+            if (!best || shelf.height < best->height) {
+                best = &shelf;
+            }
+        } else if (!loose || shelf.height < loose->height) {
+            loose = &shelf;
+        }
+    }
+
+    if (!best) {
+        // Heights are rounded up so that similar sizes share shelves
+        const int shelf_height = std::min(PAGE_SIZE, (height + 7) & ~7);
+        if (PAGE_SIZE - page.next_y >= shelf_height) {
+            page.shelves.push_back(Shelf{page.next_y, shelf_height, 0});
+            page.next_y += shelf_height;
+            best = &page.shelves.back();
+        } else {
+            best = loose;
+        }
+    }
+    if (!best) {
+        return false;
+    }
+
+    x = best->x;
+    y = best->y;
+    best->x += width;
+    return true;
+}
+
+void TextureCache::resetPage(size_t index) {
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->second.page == static_cast<int>(index)) {
+            it = entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    Page& page = pages[index];
+    page.shelves.clear();
+    page.next_y = 0;
+    page.used_area = 0;
+}
+
+int TextureCache::createPage() {
+    Page page;
+    page.texture = createTexture(PAGE_SIZE, PAGE_SIZE);
+    pages.push_back(page);
+    return static_cast<int>(pages.size() - 1);
+}
+
+GLuint TextureCache::createTexture(int width, int height) {
+    // No mipmaps and clamped edges so any size is complete in ES 2.0
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    return texture;
+}
+
+void TextureCache::evictStandalone(uint64_t needed) {
+    while (!standalone_lru.empty() && standalone_bytes + needed > STANDALONE_BUDGET) {
+        const uint64_t handle = standalone_lru.front();
+        if (entries[handle].last_used == frame) {
+            // Everything left is drawn this frame; go over budget instead
+            break;
+        }
+        dropEntry(handle);
+    }
+}
+
+void TextureCache::dropEntry(uint64_t handle) {
+    auto it = entries.find(handle);
+    if (it == entries.end()) {
+        return;
+    }
+
+    Entry& entry = it->second;
+    if (entry.page >= 0) {
+        // Shelf space comes back only when the whole page is recycled
+        pages[static_cast<size_t>(entry.page)].used_area -=
+            static_cast<uint64_t>(entry.width + 2 * PADDING) *
+            static_cast<uint64_t>(entry.height + 2 * PADDING);
+    } else {
+        glDeleteTextures(1, &entry.texture);
+        standalone_bytes -= textureBytes(entry.width, entry.height);
+        standalone_lru.erase(entry.lru);
+    }
+    entries.erase(it);
+}
+
+void TextureCache::releaseTransient(std::vector<Entry>& textures) {
+    for (auto& entry : textures) {
+        glDeleteTextures(1, &entry.texture);
+        transient_bytes -= textureBytes(entry.width, entry.height);
+    }
+    textures.clear();
+}
+
+void TextureCache::writeUpload(const PendingUpload& upload, uint8_t* out) const {
+    const auto* source = static_cast<const uint8_t*>(upload.pixels);
+    const size_t row = static_cast<size_t>(upload.width) * 4;
+    if (!upload.padded) {
+        std::memcpy(out, source, row * static_cast<size_t>(upload.height));
+        return;
+    }
+
+    // Edge texels are repeated into the padding so that linear filtering
+    // never picks up a neighbour in the atlas
+    const size_t padded_row = row + 2 * PADDING * 4;
+    for (int y = -PADDING; y < upload.height + PADDING; ++y) {
+        const int source_y = std::min(std::max(y, 0), upload.height - 1);
+        const uint8_t* in = source + static_cast<size_t>(source_y) * row;
+        uint8_t* line = out + static_cast<size_t>(y + PADDING) * padded_row;
+        for (int x = 0; x < PADDING; ++x) {
+            std::memcpy(line + x * 4, in, 4);
+            std::memcpy(line + padded_row - (x + 1) * 4, in + row - 4, 4);
+        }
+        std::memcpy(line + PADDING * 4, in, row);
+    }
+}
+
+void TextureCache::updateStats(uint64_t bytes) {
+    stats_.uploaded_bytes += bytes;
+    window_bytes += bytes;
+
+    // Bandwidth is averaged over windows of at least a second
+    const int64_t now = nowNanoseconds();
+    const int64_t elapsed = now - window_start_ns;
+    if (elapsed >= 1000000000) {
+        stats_.upload_bandwidth = static_cast<double>(window_bytes) * 1e9 /
+                                  static_cast<double>(elapsed);
+        window_start_ns = now;
+        window_bytes = 0;
+    }
+
+    uint64_t used = 0;
+    for (const auto& page : pages) {
+        used += page.used_area;
+    }
+    const uint64_t page_area = static_cast<uint64_t>(PAGE_SIZE) * PAGE_SIZE;
+    stats_.atlas_pages = static_cast<uint32_t>(pages.size());
+    stats_.atlas_occupancy = pages.empty() ? 0.0
+        : static_cast<double>(used) / static_cast<double>(page_area * pages.size());
+
+    uint64_t staging = 0;
+    for (size_t capacity : pbo_capacity) {
+        staging += capacity;
+    }
+    stats_.resident_bytes = pages.size() * page_area * 4 + standalone_bytes +
+                            transient_bytes + staging;
+    stats_.cached_textures = static_cast<uint32_t>(entries.size());
+}
+
+TextureRegion TextureCache::regionOf(const Entry& entry) const {
+    if (entry.page < 0) {
+        return TextureRegion{entry.texture, 0.0f, 0.0f, 1.0f, 1.0f};
+    }
+    const float size = static_cast<float>(PAGE_SIZE);
+    return TextureRegion{pages[static_cast<size_t>(entry.page)].texture,
+                         static_cast<float>(entry.x) / size,
+                         static_cast<float>(entry.y) / size,
+                         static_cast<float>(entry.x + entry.width) / size,
+                         static_cast<float>(entry.y + entry.height) / size};
+}
+
+} // namespace anexec
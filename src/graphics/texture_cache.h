@@ -0,0 +1,136 @@
+#ifndef ANEXEC_TEXTURE_CACHE_H
+#define ANEXEC_TEXTURE_CACHE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include <GLES3/gl3.h>
+
+#include "renderer.h"
+
+namespace anexec {
+
+// Участок текстуры, который рисует команда
+struct TextureRegion {
+    GLuint texture{0};
+    float u0{0.0f}, v0{0.0f}, u1{1.0f}, v1{1.0f};
+};
+
+// Кэш текстур по дескриптору содержимого. Мелкие изображения
+// упаковываются в страницы атласа, крупные получают свою текстуру.
+// Загрузки кадра собираются и передаются одним PBO (ES 3.0),
+// повторная отрисовка закэшированного изображения ничего не передает.
+// Все методы вызываются в потоке с текущим контекстом GL.
+class TextureCache {
+public:
+    TextureCache() = default;
+    ~TextureCache();
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    void initialize();
+    void release();
+
+    void beginFrame();
+
+    // handle == 0 - содержимое без дескриптора, загружается в каждом кадре.
+    // pixels (RGBA8) должны жить до flushUploads().
+    TextureRegion acquire(uint64_t handle, const void* pixels, int width, int height);
+
+    // Передача всех загрузок кадра; вызывается до отрисовки
+    void flushUploads();
+
+    const TextureStats& stats() const { return stats_; }
+
+private:
+    struct Shelf {
+        int y;
+        int height;
+        int x;
+    };
+
+    struct Page {
+        GLuint texture{0};
+        std::vector<Shelf> shelves;
+        int next_y{0};
+        uint64_t used_area{0};
+        uint64_t last_used{0};
+    };
+
+    struct Entry {
+        int page{-1};              // Страница атласа или -1 для отдельной текстуры
+        GLuint texture{0};         // Отдельная текстура
+        int x{0}, y{0};
+        int width{0}, height{0};
+        uint64_t last_used{0};
+        std::list<uint64_t>::iterator lru;  // Только для отдельных текстур
+    };
+
+    struct PendingUpload {
+        GLuint texture;
+        int x, y;
+        int width, height;      // Размер исходного изображения
+        bool padded;            // Слот атласа: края дублируются в отступ
+        const void* pixels;
+    };
+
+    // Функции ES 3.0 через eglGetProcAddress
+    struct PixelBuffers {
+        PFNGLMAPBUFFERRANGEPROC mapBufferRange{nullptr};
+        PFNGLUNMAPBUFFERPROC unmapBuffer{nullptr};
+        PFNGLFENCESYNCPROC fenceSync{nullptr};
+        PFNGLCLIENTWAITSYNCPROC clientWaitSync{nullptr};
+        PFNGLDELETESYNCPROC deleteSync{nullptr};
+        bool available() const {
+            return mapBufferRange && unmapBuffer && fenceSync && clientWaitSync && deleteSync;
+        }
+    };
+
+    static constexpr int PAGE_SIZE = 2048;
+    static constexpr int MAX_ATLAS_SIZE = 256;     // Крупнее - отдельная текстура
+    static constexpr int PADDING = 1;
+    static constexpr size_t MAX_PAGES = 4;
+    static constexpr uint64_t STANDALONE_BUDGET = 128ull * 1024 * 1024;
+    static constexpr size_t PBO_COUNT = 3;
+
+    bool allocateInAtlas(int width, int height, Entry& entry);
+    bool allocateInPage(Page& page, int width, int height, int& x, int& y);
+    void resetPage(size_t index);
+    int createPage();
+    GLuint createTexture(int width, int height);
+    void evictStandalone(uint64_t needed);
+    void dropEntry(uint64_t handle);
+    void releaseTransient(std::vector<Entry>& textures);
+    void writeUpload(const PendingUpload& upload, uint8_t* out) const;
+    void updateStats(uint64_t bytes);
+    TextureRegion regionOf(const Entry& entry) const;
+
+    std::unordered_map<uint64_t, Entry> entries;
+    std::vector<Page> pages;
+    std::list<uint64_t> standalone_lru;      // Голова - давно не использованные
+    uint64_t standalone_bytes{0};
+    // Текстуры для содержимого без дескриптора переиспользуются между кадрами
+    std::vector<Entry> transient_used;
+    std::vector<Entry> transient_free;
+    uint64_t transient_bytes{0};
+    std::vector<PendingUpload> pending;
+    std::vector<uint8_t> scratch;            // Подготовка слотов атласа без PBO
+    uint64_t frame{0};
+
+    PixelBuffers pbo_functions;
+    GLuint pbos[PBO_COUNT] = {};
+    size_t pbo_capacity[PBO_COUNT] = {};
+    GLsync pbo_fences[PBO_COUNT] = {};
+
+    TextureStats stats_;
+    int64_t window_start_ns{0};
+    uint64_t window_bytes{0};
+    bool initialized{false};
+};
+
+} // namespace anexec
+
+#endif // ANEXEC_TEXTURE_CACHE_H
@@ -0,0 +1,34 @@
+#ifndef ANEXEC_GRAPHICS_UTIL_H
+#define ANEXEC_GRAPHICS_UTIL_H
+
+#include <cstdint>
+#include <cstring>
+#include <time.h>
+
+namespace anexec {
+
+// Есть ли name в списке расширений GL/EGL (имена через пробел).
+// Простой strstr нашел бы и префикс более длинного имени.
+inline bool hasExtension(const char* extensions, const char* name) {
+    if (!extensions) {
+        return false;
+    }
+    const size_t length = std::strlen(name);
+    for (const char* p = std::strstr(extensions, name); p; p = std::strstr(p + length, name)) {
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// CLOCK_MONOTONIC: те же часы, что у clock_nanosleep и временных меток кадров
+inline int64_t nowNanoseconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+} // namespace anexec
+
+#endif // ANEXEC_GRAPHICS_UTIL_H
@@ -1,12 +1,26 @@
 #include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdio>
+#include <filesystem>
 #include <iomanip>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <cstdlib>
 #include <csignal>
 #include <thread>
+#include <vector>
 
+#include "core/aot_image.h"
 #include "core/executor.h"
+#include "core/executor_host.h"
+#include "core/apk_image.h"
+#include "core/runtime.h"
+#include "core/zygote.h"
+#include "core/thread_pool.h"
+#include "core/trace.h"
 #include "android/api.h"
 #include "android/activity.h"
 #include "graphics/renderer.h"
@@ -49,47 +63,73 @@ void printHeader() {
     std::cout << "Started by AnmiTaliDev at 2025-04-03 05:07:43 UTC" << std::endl << std::endl;
 }
 
-void printApkInfo(const anexec::ApkMetadata& metadata) {
+void printApkInfo(const anexec::ApkInfo& info) {
     std::cout << "APK Information:" << std::endl;
-    std::cout << "  Package:       " << metadata.packageName << std::endl;
-    std::cout << "  Version:       " << metadata.versionName
-              << " (" << metadata.versionCode << ")" << std::endl;
-    std::cout << "  Min SDK:       " << metadata.minSdkVersion << std::endl;
-    std::cout << "  Target SDK:    " << metadata.targetSdkVersion << std::endl;
-    std::cout << "  Main Activity: " << metadata.mainActivity << std::endl;
+    std::cout << "  Package:       " << info.package_name << std::endl;
+    std::cout << "  Version:       " << info.version_name
+              << " (" << info.version_code << ")" << std::endl;
+    std::cout << "  Min SDK:       " << info.min_sdk << std::endl;
+    std::cout << "  Target SDK:    " << info.target_sdk << std::endl;
+    std::cout << "  Main Activity: " << info.main_activity << std::endl;
     
-    if (!metadata.permissions.empty()) {
+    if (!info.permissions.empty()) {
         std::cout << "  Permissions:" << std::endl;
-        for (const auto& permission : metadata.permissions) {
+        for (const auto& permission : info.permissions) {
             std::cout << "    - " << permission << std::endl;
         }
     }
     std::cout << std::endl;
 }
 
+anexec::APILevel toApiLevel(const std::string& sdk) {
+    int level = static_cast<int>(anexec::APILevel::ANDROID_10);
+    try {
+        level = std::stoi(sdk);
+    } catch (const std::exception&) {
+        // Кодовые имена предварительных версий считаем самым новым API
+        level = static_cast<int>(anexec::APILevel::ANDROID_14);
+    }
+    level = std::clamp(level, static_cast<int>(anexec::APILevel::ANDROID_10),
+                       static_cast<int>(anexec::APILevel::ANDROID_14));
+    return static_cast<anexec::APILevel>(level);
+}
+
 class ExecutionManager {
 public:
     ExecutionManager() {
         setupSignalHandlers();
     }
 
-    int run(const char* apk_path) {
+    // runtime - прогретый Runtime процесса-шаблона (zygote), если есть
+    int run(const char* apk_path, anexec::Runtime* runtime = nullptr,
+            const std::string& activity = std::string()) {
         try {
             anexec::Executor executor;
             
             std::cout << "Loading APK: " << apk_path << "..." << std::endl << std::endl;
             
-            auto [result, metadata] = executor.loadApk(apk_path);
-            if (result != anexec::Result::OK) {
-                std::cerr << "Failed to load APK: " << static_cast<int>(result) << std::endl;
+            anexec::Result result = executor.loadApk(apk_path);
+            if (result != anexec::Result::Success) {
+                std::cerr << "Failed to load APK: " << anexec::utils::formatError(result)
+                          << " (" << executor.getLastError() << ")" << std::endl;
                 return 1;
             }
 
-            printApkInfo(metadata);
-            if (!initializeComponents(metadata)) {
+            const anexec::ApkInfo info = executor.getInfo();
+            printApkInfo(info);
+            if (!initializeComponents(info, executor)) {
                 return 1;
             }
 
+            if (runtime) {
+                runtime->attachImage(executor.getImage());
+                const std::string& name = activity.empty() ? info.main_activity : activity;
+                if (runtime->startActivity(name) != anexec::RuntimeResult::Success) {
+                    std::cerr << "Failed to start activity " << name << std::endl;
+                    return 1;
+                }
+            }
+
             std::cout << "Starting execution..." << std::endl;
             std::cout << "Press Ctrl+C to stop" << std::endl << std::endl;
 
@@ -101,45 +141,131 @@ public:
         }
     }
 
+    // Холодный старт до первого кадра без главного цикла. Фазы загрузки APK
+    // и Runtime берутся из интервалов трассы, этапы - по часам между ними.
+    // Запись трассы должна быть включена.
+    int profileStartup(const char* apk_path) {
+        using Clock = std::chrono::steady_clock;
+        try {
+            const auto start = Clock::now();
+            anexec::Executor executor;
+            anexec::Result result = executor.loadApk(apk_path);
+            if (result != anexec::Result::Success) {
+                std::cerr << "Failed to load APK: " << anexec::utils::formatError(result)
+                          << " (" << executor.getLastError() << ")" << std::endl;
+                return 1;
+            }
+            const auto loaded = Clock::now();
+
+            const anexec::ApkInfo info = executor.getInfo();
+            anexec::Runtime runtime;
+            if (!runtime.initialize(anexec::RuntimeConfig())) {
+                std::cerr << "Failed to initialize runtime" << std::endl;
+                return 1;
+            }
+            runtime.attachImage(executor.getImage());
+            const auto runtime_ready = Clock::now();
+
+            if (!initializeComponents(info, executor)) {
+                return 1;
+            }
+            activity_->onStart();
+            activity_->onResume();
+            if (!info.main_activity.empty() &&
+                runtime.startActivity(info.main_activity) != anexec::RuntimeResult::Success) {
+                std::cerr << "Warning: failed to start activity " << info.main_activity << std::endl;
+            }
+            const auto started = Clock::now();
+
+            anexec::RenderCommand clear{anexec::RenderCommand::Type::Clear};
+            renderer_.submitCommand(clear);
+            const bool presented = renderer_.waitForIdle(std::chrono::seconds(5));
+            const auto first_frame = Clock::now();
+
+            const std::vector<uint64_t> spans = anexec::Tracer::instance().spanTotals();
+            auto span = [&spans](anexec::TraceEvent event) {
+                return std::chrono::nanoseconds(spans[static_cast<size_t>(event)]);
+            };
+            const auto total = first_frame - start;
+            auto row = [total](const char* name, std::chrono::nanoseconds time) {
+                const double ms = std::chrono::duration<double, std::milli>(time).count();
+                const double share = total.count() > 0 ? 100.0 * time.count() / total.count() : 0.0;
+                std::cout << "  " << std::left << std::setw(18) << name << std::right << std::fixed
+                          << std::setprecision(3) << std::setw(10) << ms << " ms"
+                          << std::setprecision(1) << std::setw(7) << share << " %" << std::endl;
+            };
+
+            std::cout << "Startup profile: " << apk_path << std::endl;
+            row("loadApk", loaded - start);
+            row("  zip open", span(anexec::TraceEvent::ApkOpen));
+            row("  manifest", span(anexec::TraceEvent::ManifestParse));
+            row("  DEX map", span(anexec::TraceEvent::DexMap));
+            row("  class index", span(anexec::TraceEvent::ClassIndexBuild));
+            row("runtime", runtime_ready - loaded);
+            row("  VM init", span(anexec::TraceEvent::RuntimeInit));
+            row("  AOT image", span(anexec::TraceEvent::AotImageMap));
+            row("components", started - runtime_ready);
+            row("first frame", first_frame - started);
+            row("total", total);
+            if (!presented) {
+                std::cout << "  (no frame within 5 s)" << std::endl;
+            }
+            if (anexec::Tracer::instance().getStats().overwritten_events > 0) {
+                std::cout << "  (trace buffers overflowed, phase times are incomplete)" << std::endl;
+            }
+
+            const anexec::Executor::Statistics stats = executor.getStatistics();
+            const anexec::RuntimeStats runtime_stats = runtime.getStats();
+            std::cout << "Memory: RSS " << stats.memory_used / 1024 << " KB (peak "
+                      << stats.peak_memory / 1024 << " KB), DEX " << stats.dex_memory / 1024
+                      << " KB, heap " << runtime_stats.heap_used / 1024 << " KB" << std::endl;
+            std::cout << "Classes: " << runtime_stats.loaded_classes_count << " loaded in "
+                      << std::setprecision(3)
+                      << std::chrono::duration<double, std::milli>(span(anexec::TraceEvent::ClassLoad)).count()
+                      << " ms, " << runtime_stats.indexed_classes_count << " indexed" << std::endl;
+
+            activity_->onPause();
+            activity_->onStop();
+            activity_->onDestroy();
+            runtime.shutdown();
+            return presented ? 0 : 1;
+
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
 private:
-    bool initializeComponents(const anexec::ApkMetadata& metadata) {
+    bool initializeComponents(const anexec::ApkInfo& info, const anexec::Executor& executor) {
         try {
             // Инициализация рендерера
-            anexec::RenderConfig render_config{
-                .width = 1080,
-                .height = 1920,
-                .vsync = true,
-                .msaa = 4,
-                .surface_type = anexec::SurfaceType::PBUFFER
-            };
-            
-            if (!renderer_.initialize(render_config)) {
-                std::cerr << "Failed to initialize renderer" << std::endl;
-                return false;
+            anexec::RenderConfig render_config;
+            render_config.surface_type = anexec::SurfaceType::Pbuffer;  // Окна у CLI нет
+            // Бинарники шейдеров рядом с кэшем распакованных DEX; без data_dir
+            // шейдеры, как и DEX, не кэшируются
+            const std::string data_dir = executor.getConfig().data_dir;
+            if (!data_dir.empty()) {
+                render_config.shader_cache_dir = data_dir + "/cache/shaders";
             }
+            renderer_.initialize(render_config);
+            renderer_.onSurfaceCreated();
+            renderer_.onSurfaceChanged(render_config.design_width, render_config.design_height);
 
             // Инициализация Android API
             anexec::APIConfig api_config{
-                .package_name = metadata.packageName,
-                .version_name = metadata.versionName,
-                .version_code = metadata.versionCode,
-                .min_sdk = metadata.minSdkVersion,
-                .target_sdk = metadata.targetSdkVersion,
-                .data_dir = "/data/data/" + metadata.packageName,
-                .native_lib_dir = "/data/app/" + metadata.packageName + "/lib"
+                .package_name = info.package_name,
+                .version_name = info.version_name,
+                .version_code = static_cast<int>(info.version_code),
+                .min_sdk_level = toApiLevel(info.min_sdk),
+                .target_sdk_level = toApiLevel(info.target_sdk)
             };
-            
-            if (!api_.initialize(api_config)) {
-                std::cerr << "Failed to initialize Android API" << std::endl;
-                return false;
-            }
+            api_.initialize(api_config);
+            api_.setPermissions(executor.getPermissions());
 
             // Создание и инициализация Activity
-            activity_ = std::make_unique<anexec::Activity>(metadata.mainActivity);
-            if (!activity_->onCreate(api_.getContext())) {
-                std::cerr << "Failed to create main activity" << std::endl;
-                return false;
-            }
+            activity_ = std::make_unique<anexec::Activity>();
+            activity_->onCreate();
 
             return true;
         } catch (const std::exception& e) {
@@ -150,32 +276,21 @@ private:
 
     int executeMainLoop(anexec::Executor& executor) {
         try {
-            if (!activity_->onStart()) {
-                return 1;
-            }
+            activity_->onStart();
+            activity_->onResume();
 
-            anexec::RenderCommand cmd;
-            while (g_running) {
-                // Обработка событий Activity
-                if (!activity_->onResume()) {
-                    break;
-                }
+            std::thread executor_thread([&executor]() {
+                executor.execute();
+            });
 
-                // Обновление состояния приложения
-                executor.update();
-
-                // Отрисовка кадра
-                while (renderer_.pollCommand(cmd)) {
-                    renderer_.executeCommand(cmd);
-                }
-                
-                renderer_.swapBuffers();
-
-                // Поддержание стабильного FPS
+            while (g_running) {
                 std::this_thread::sleep_for(std::chrono::milliseconds(16));
             }
 
             // Корректное завершение
+            executor.stop();
+            executor_thread.join();
+
             activity_->onPause();
             activity_->onStop();
             activity_->onDestroy();
@@ -193,12 +308,305 @@ private:
     std::unique_ptr<anexec::Activity> activity_;
 };
 
-} // namespace
+// Экранирование строки для JSON
+void appendJsonString(std::string& out, const std::string& value) {
+    out += '"';
+    for (char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+// Пакетная проверка APK без запуска: одна JSON строка на файл
+class InspectionManager {
+public:
+    int run(int argc, char* argv[], int first) {
+        auto start = std::chrono::steady_clock::now();
+        {
+            anexec::TaskGroup group(anexec::ThreadPool::shared());
+            for (int i = first; i < argc; ++i) {
+                const std::filesystem::path path(argv[i]);
+                std::error_code ec;
+                if (!std::filesystem::is_directory(path, ec)) {
+                    submit(group, path.string());
+                    continue;
+                }
+
+                // Задачи отправляются по мере обхода каталога
+                for (auto it = std::filesystem::recursive_directory_iterator(
+                         path, std::filesystem::directory_options::skip_permission_denied, ec);
+                     !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+                    if (it->is_regular_file(ec) && it->path().extension() == ".apk") {
+                        submit(group, it->path().string());
+                    }
+                }
+            }
+            group.wait();
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        std::cerr << "Inspected " << total_ << " APKs (" << compatible_ << " compatible, "
+                  << failed_ << " failed) in " << elapsed.count() << " ms" << std::endl;
+        return failed_ > 0 ? 1 : 0;
+    }
+
+private:
+    void submit(anexec::TaskGroup& group, std::string path) {
+        ++total_;
+        group.run([this, path = std::move(path)]() {
+            inspect(path);
+        });
+    }
+
+    void inspect(const std::string& path) {
+        thread_local anexec::ApkInfo info;
+        thread_local std::string line;
+        std::string error;
+
+        line.clear();
+        line += "{\"path\":";
+        appendJsonString(line, path);
+
+        // Поврежденный APK может запросить огромный буфер (bad_alloc,
+        // length_error); исключение из задачи пула завершило бы весь пакет
+        anexec::Result result = anexec::Result::InvalidApk;
+        try {
+            result = anexec::Executor::inspectApk(path, info, &error);
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        if (result != anexec::Result::Success) {
+            ++failed_;
+            line += ",\"ok\":false,\"error\":";
+            appendJsonString(line, anexec::utils::formatError(result) + ": " + error);
+        } else {
+            const bool compatible = anexec::utils::isApkCompatible(info);
+            compatible_ += compatible ? 1 : 0;
+
+            line += ",\"ok\":true,\"package\":";
+            appendJsonString(line, info.package_name);
+            line += ",\"version_name\":";
+            appendJsonString(line, info.version_name);
+            line += ",\"version_code\":" + std::to_string(info.version_code);
+            line += ",\"min_sdk\":";
+            appendJsonString(line, info.min_sdk);
+            line += ",\"target_sdk\":";
+            appendJsonString(line, info.target_sdk);
+            line += ",\"main_activity\":";
+            appendJsonString(line, info.main_activity);
+            line += ",\"permissions\":[";
+            for (size_t i = 0; i < info.permissions.size(); ++i) {
+                if (i > 0) {
+                    line += ',';
+                }
+                appendJsonString(line, info.permissions[i]);
+            }
+            line += "],\"compatible\":";
+            line += compatible ? "true" : "false";
+        }
+        line += "}\n";
+
+        std::lock_guard<std::mutex> lock(output_mutex_);
+        std::fwrite(line.data(), 1, line.size(), stdout);
+    }
+
+    std::mutex output_mutex_;
+    size_t total_{0};
+    std::atomic<size_t> compatible_{0};
+    std::atomic<size_t> failed_{0};
+};
+
+// Несколько экземпляров в одном процессе: одинаковые APK делят DEX и библиотеки
+class HostManager {
+public:
+    int run(size_t count, int argc, char* argv[], int first) {
+        setupSignalHandlers();
+
+        const size_t apks = static_cast<size_t>(argc - first);
+        std::vector<std::unique_ptr<anexec::Executor>> executors(count * apks);
+        std::vector<anexec::Result> results(executors.size(), anexec::Result::Success);
+
+        // Загрузка параллельно: реестр образов распакует каждый APK один раз
+        auto start = std::chrono::steady_clock::now();
+        {
+            anexec::TaskGroup group(anexec::ThreadPool::shared());
+            for (size_t i = 0; i < executors.size(); ++i) {
+                group.run([&, i]() {
+                    executors[i] = std::make_unique<anexec::Executor>();
+                    results[i] = executors[i]->loadApk(argv[first + static_cast<int>(i % apks)]);
+                });
+            }
+            group.wait();
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+
+        anexec::ExecutorHost host;
+        for (size_t i = 0; i < executors.size(); ++i) {
+            if (results[i] != anexec::Result::Success) {
+                std::cerr << "Failed to load " << argv[first + static_cast<int>(i % apks)] << ": "
+                          << anexec::utils::formatError(results[i])
+                          << " (" << executors[i]->getLastError() << ")" << std::endl;
+                return 1;
+            }
+            host.add(std::move(executors[i]));
+        }
+
+        std::cout << "Loaded " << host.size() << " instances in " << elapsed.count()
+                  << " ms (" << anexec::ImageRegistry::instance().size()
+                  << " shared images)" << std::endl;
+        std::cout << "Press Ctrl+C to stop" << std::endl << std::endl;
+
+        std::thread host_thread([&host]() {
+            host.run();
+        });
+        while (g_running) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(16));
+        }
+        host.stop();
+        host_thread.join();
+        return 0;
+    }
+};
+
+// Процесс-шаблон: Runtime прогревается один раз, приложения запускаются через fork()
+int runZygote(const char* socket_path) {
+    anexec::ZygoteServer zygote;
+    anexec::RuntimeConfig config;
+    if (!zygote.start(socket_path, config)) {
+        std::cerr << "Failed to start zygote: " << zygote.getLastError() << std::endl;
+        return 1;
+    }
+    std::cerr << "Zygote listening on " << socket_path << std::endl;
+
+    return zygote.run([](const anexec::ZygoteRequest& request, anexec::Runtime& runtime) {
+        ExecutionManager manager;
+        return manager.run(request.apk_path.c_str(), &runtime, request.activity);
+    });
+}
+
+int launchFromZygote(const char* socket_path, const char* apk_path, const char* activity) {
+    anexec::ZygoteRequest request;
+    request.apk_path = std::filesystem::absolute(apk_path).string();
+    request.activity = activity ? activity : "";
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = -1;
+    std::string error;
+    if (!anexec::ZygoteClient::launch(socket_path, request, pid, &error)) {
+        std::cerr << "Launch failed: " << error << std::endl;
+        return 1;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    std::cout << "Started pid " << pid << " in " << elapsed.count() << " us" << std::endl;
+    return 0;
+}
+
+// Образ AOT из jar платформы (<system_dir>/framework или BOOTCLASSPATH) и APK
+int compileImage(const char* output, const char* system_dir, const char* apk_path) {
+    const std::vector<std::string> jars =
+        anexec::AotImage::bootClassPath(std::string(system_dir) + "/framework/");
+    anexec::AotBuildStats stats{};
+    std::string error;
+
+    auto start = std::chrono::steady_clock::now();
+    if (!anexec::AotImage::build(jars, apk_path ? apk_path : "", output, &stats, error)) {
+        std::cerr << "Failed to compile image: " << error << std::endl;
+        return 1;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    std::cout << "Compiled " << output << " in " << elapsed.count() << " ms ("
+              << stats.file_size << " bytes)" << std::endl;
+    std::cout << "  DEX files: " << stats.dex_files << " (" << stats.boot_dex_files << " boot)" << std::endl;
+    std::cout << "  Classes:   " << stats.classes << " (" << stats.preinitialized_classes
+              << " preinitialized)" << std::endl;
+    std::cout << "  Methods:   " << stats.methods << " (" << stats.quickened_methods << " quickened, "
+              << stats.compiled_methods << " compiled, " << stats.code_bytes << " bytes of code)" << std::endl;
+    return 0;
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <apk_file>" << std::endl;
+    std::cerr << "       " << program << " --inspect <apk_file|directory>..." << std::endl;
+    std::cerr << "       " << program << " --host <instances> <apk_file>..." << std::endl;
+    std::cerr << "       " << program << " --zygote <socket>" << std::endl;
+    std::cerr << "       " << program << " --launch <socket> <apk_file> [activity]" << std::endl;
+    std::cerr << "       " << program << " --compile-image <image> <system_dir> [apk_file]" << std::endl;
+    std::cerr << "       " << program << " --profile-startup <apk_file>" << std::endl;
+    std::cerr << "Set ANEXEC_TRACE=<file.json> to write a trace (chrome://tracing, Perfetto)" << std::endl;
+}
+
+int run(int argc, char* argv[]) {
+    if (argc >= 2 && std::string(argv[1]) == "--inspect") {
+        if (argc < 3) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        InspectionManager inspector;
+        return inspector.run(argc, argv, 2);
+    }
+
+    if (argc >= 2 && std::string(argv[1]) == "--host") {
+        const long count = argc >= 3 ? std::strtol(argv[2], nullptr, 10) : 0;
+        if (argc < 4 || count <= 0) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        HostManager host;
+        return host.run(static_cast<size_t>(count), argc, argv, 3);
+    }
+
+    if (argc == 3 && std::string(argv[1]) == "--zygote") {
+        return runZygote(argv[2]);
+    }
+
+    if ((argc == 4 || argc == 5) && std::string(argv[1]) == "--launch") {
+        return launchFromZygote(argv[2], argv[3], argc == 5 ? argv[4] : nullptr);
+    }
+
+    if ((argc == 4 || argc == 5) && std::string(argv[1]) == "--compile-image") {
+        return compileImage(argv[2], argv[3], argc == 5 ? argv[4] : nullptr);
+    }
+
+    if (argc == 3 && std::string(argv[1]) == "--profile-startup") {
+        // Запись, включенная через ANEXEC_TRACE, продолжается и попадает в файл
+        anexec::Tracer& tracer = anexec::Tracer::instance();
+        const bool tracing = anexec::Tracer::enabled();
+        if (!tracing) {
+            tracer.start();
+        }
+        int status;
+        {
+            ExecutionManager manager;
+            status = manager.profileStartup(argv[2]);
+        }
+        if (!tracing) {
+            tracer.stop();
+        }
+        return status;
+    }
 
-int main(int argc, char* argv[]) {
     if (argc != 2) {
         std::cerr << "Error: Please provide APK file path" << std::endl;
-        std::cerr << "Usage: " << argv[0] << " <apk_file>" << std::endl;
+        printUsage(argv[0]);
         return 1;
     }
 
@@ -206,4 +614,33 @@ int main(int argc, char* argv[]) {
 
     ExecutionManager manager;
     return manager.run(argv[1]);
-}
\ No newline at end of file
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const char* trace_path = std::getenv("ANEXEC_TRACE");
+    if (trace_path && *trace_path) {
+        anexec::Tracer::instance().setThreadName("main");
+        anexec::Tracer::instance().start();
+    }
+
+    const int status = run(argc, argv);
+
+    if (trace_path && *trace_path) {
+        anexec::Tracer& tracer = anexec::Tracer::instance();
+        tracer.stop();
+        std::string error;
+        if (!tracer.exportJson(trace_path, &error)) {
+            std::cerr << "Failed to write trace: " << error << std::endl;
+        } else {
+            const anexec::TraceStats stats = tracer.getStats();
+            std::cerr << "Trace written to " << trace_path << " (" << stats.recorded_events << " events";
+            if (stats.overwritten_events) {
+                std::cerr << ", " << stats.overwritten_events << " overwritten";
+            }
+            std::cerr << ")" << std::endl;
+        }
+    }
+    return status;
+}